@@ -1,2 +1,8 @@
-glslc.exe -fshader-stage=vert triangle_vert.glsl -o triangle_vert.spv
-glslc.exe -fshader-stage=frag triangle_frag.glsl -o triangle_frag.spv
\ No newline at end of file
+glslc.exe -fshader-stage=vert triangle_vert.glsl -o triangle_vert.spv || exit /b 1
+glslc.exe -fshader-stage=frag triangle_frag.glsl -o triangle_frag.spv || exit /b 1
+glslc.exe -fshader-stage=vert hud_vert.glsl -o hud_vert.spv || exit /b 1
+glslc.exe -fshader-stage=frag hud_frag.glsl -o hud_frag.spv || exit /b 1
+spirv-val.exe --target-env vulkan1.0 triangle_vert.spv || exit /b 1
+spirv-val.exe --target-env vulkan1.0 triangle_frag.spv || exit /b 1
+spirv-val.exe --target-env vulkan1.0 hud_vert.spv || exit /b 1
+spirv-val.exe --target-env vulkan1.0 hud_frag.spv || exit /b 1
\ No newline at end of file
@@ -0,0 +1,10 @@
+#!/bin/sh
+set -e
+glslc -fshader-stage=vert triangle_vert.glsl -o triangle_vert.spv
+glslc -fshader-stage=frag triangle_frag.glsl -o triangle_frag.spv
+glslc -fshader-stage=vert hud_vert.glsl -o hud_vert.spv
+glslc -fshader-stage=frag hud_frag.glsl -o hud_frag.spv
+spirv-val --target-env vulkan1.0 triangle_vert.spv
+spirv-val --target-env vulkan1.0 triangle_frag.spv
+spirv-val --target-env vulkan1.0 hud_vert.spv
+spirv-val --target-env vulkan1.0 hud_frag.spv
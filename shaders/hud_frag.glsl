@@ -0,0 +1,12 @@
+#version 450 core
+
+layout(location = 0) in vec2 vertex_uv;
+layout(location = 1) in vec4 vertex_color;
+
+layout(location = 0)  out vec4 color_out;
+
+layout(set = 0, binding = 0) uniform sampler2D font_atlas;
+
+void main() {
+    color_out = vertex_color * texture(font_atlas, vertex_uv);
+}
@@ -0,0 +1,19 @@
+#version 450 core
+
+// One overlay quad per instance, see VulkanOverlayQuad.
+layout(location = 0) in vec4 in_rect;
+layout(location = 1) in vec4 in_uv_rect;
+layout(location = 2) in vec4 in_color;
+layout(location = 0) out vec2 vertex_uv;
+layout(location = 1) out vec4 vertex_color;
+
+// Corners of the two triangles; bit 0 selects x1/u1, bit 1 selects y1/v1.
+const uint QUAD_CORNERS[6] = uint[6](0u, 1u, 2u, 2u, 1u, 3u);
+
+void main() {
+    uint corner = QUAD_CORNERS[gl_VertexIndex];
+    vec2 t = vec2(float(corner & 1u), float(corner >> 1u));
+    gl_Position = vec4(mix(in_rect.xy, in_rect.zw, t), 0.0, 1.0);
+    vertex_uv = mix(in_uv_rect.xy, in_uv_rect.zw, t);
+    vertex_color = in_color;
+}
@@ -4,7 +4,12 @@ layout(location = 0) in vec2 in_position;
 layout(location = 1) in vec3 in_color;
 layout(location = 0) out vec3 vertex_color;
 
+layout(set = 0, binding = 0) uniform FrameConstants {
+    mat4 view_projection;
+    vec4 time;
+} frame;
+
 void main() {
-    gl_Position = vec4(in_position, 0.0, 1.0);
+    gl_Position = frame.view_projection * vec4(in_position, 0.0, 1.0);
     vertex_color = in_color;
 }
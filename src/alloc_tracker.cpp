@@ -0,0 +1,254 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "alloc_tracker.h"
+#include "logger.h"
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+#if defined(ALLOC_TRACKING_HOOK_MALLOC) && !defined(__GLIBC__)
+#undef ALLOC_TRACKING_HOOK_MALLOC
+#endif
+
+// Plain data only, so the thread_local is constant initialised and touching it never allocates.
+struct AllocThreadState {
+    uint64_t allocations;
+    uint64_t bytes;
+    const char* zeroAllocRegion;
+    uint32_t allowDepth;
+    // Set while a violation is reported, since logging and backtrace_symbols may allocate themselves.
+    bool reporting;
+};
+
+static thread_local AllocThreadState allocThreadState = {};
+static std::atomic<uint64_t> zeroAllocViolations{0};
+static std::atomic<uint32_t> allocViolationAction{ALLOC_VIOLATION_LOG};
+
+#ifdef ALLOC_TRACKING
+
+static void reportViolation(AllocThreadState* state, size_t size, uint64_t violation) {
+    const AllocViolationAction action = static_cast<AllocViolationAction>(allocViolationAction.load(std::memory_order_relaxed));
+    if (action == ALLOC_VIOLATION_COUNT || (action == ALLOC_VIOLATION_LOG && violation >= ZERO_ALLOC_MAX_REPORTS)) {
+        return;
+    }
+    state->reporting = true;
+    LOG_ERROR("Heap allocation of ", static_cast<unsigned long long>(size), " bytes in zero-alloc region ", state->zeroAllocRegion);
+#if defined(__GLIBC__)
+    // The backtrace goes straight to stderr, so the log line has to be out first.
+    flushLogger();
+    void* frames[ZERO_ALLOC_BACKTRACE_DEPTH];
+    const int frameCount = backtrace(frames, ZERO_ALLOC_BACKTRACE_DEPTH);
+    backtrace_symbols_fd(frames, frameCount, STDERR_FILENO);
+#endif
+    if (action == ALLOC_VIOLATION_LOG && violation + 1 == ZERO_ALLOC_MAX_REPORTS) {
+        LOG_WARN("Further zero-alloc violations are only counted.");
+    }
+    state->reporting = false;
+    if (action == ALLOC_VIOLATION_ASSERT) {
+        flushLogger();
+        assert(!"Heap allocation in a zero-alloc region");
+    }
+}
+
+static void recordAllocation(size_t size) {
+    AllocThreadState* state = &allocThreadState;
+    state->allocations++;
+    state->bytes += size;
+    if (state->zeroAllocRegion == nullptr || state->allowDepth != 0 || state->reporting) {
+        return;
+    }
+    reportViolation(state, size, zeroAllocViolations.fetch_add(1, std::memory_order_relaxed));
+}
+
+#ifdef ALLOC_TRACKING_HOOK_MALLOC
+// glibc exports its allocator under these names as well, so the hooks can forward to it.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    recordAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    recordAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    recordAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+static void* trackedAllocate(size_t size) {
+#ifndef ALLOC_TRACKING_HOOK_MALLOC
+    // With the malloc hooks in place, malloc counts the allocation itself.
+    recordAllocation(size);
+#endif
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* trackedAllocateAligned(size_t size, size_t alignment) {
+    recordAllocation(size);
+    if (size == 0) {
+        size = 1;
+    }
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* pointer = nullptr;
+    return posix_memalign(&pointer, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) == 0 ? pointer : nullptr;
+#endif
+}
+
+static void trackedFreeAligned(void* pointer) {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(size_t size) {
+    void* pointer = trackedAllocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    void* pointer = trackedAllocateAligned(size, static_cast<size_t>(alignment));
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return trackedAllocateAligned(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return trackedAllocateAligned(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    trackedFreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    trackedFreeAligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    trackedFreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+    trackedFreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+    trackedFreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+    trackedFreeAligned(pointer);
+}
+
+#endif
+
+AllocationCounters getThreadAllocationCounters() {
+    return {allocThreadState.allocations, allocThreadState.bytes};
+}
+
+uint64_t getZeroAllocViolationCount() {
+    return zeroAllocViolations.load(std::memory_order_relaxed);
+}
+
+void setAllocViolationAction(AllocViolationAction action) {
+    allocViolationAction.store(action, std::memory_order_relaxed);
+}
+
+bool parseAllocViolationAction(const char* text, AllocViolationAction* action) {
+    if (std::strcmp(text, "count") == 0) {
+        *action = ALLOC_VIOLATION_COUNT;
+    } else if (std::strcmp(text, "log") == 0) {
+        *action = ALLOC_VIOLATION_LOG;
+    } else if (std::strcmp(text, "assert") == 0) {
+        *action = ALLOC_VIOLATION_ASSERT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ZeroAllocScope::ZeroAllocScope(const char* name) {
+    previousRegion = allocThreadState.zeroAllocRegion;
+    if (name != nullptr) {
+        allocThreadState.zeroAllocRegion = name;
+    }
+}
+
+ZeroAllocScope::~ZeroAllocScope() {
+    allocThreadState.zeroAllocRegion = previousRegion;
+}
+
+AllowAllocScope::AllowAllocScope() {
+    allocThreadState.allowDepth++;
+}
+
+AllowAllocScope::~AllowAllocScope() {
+    allocThreadState.allowDepth--;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Debug builds replace the global operator new and delete to count heap allocations per thread
+// and to catch allocations in regions marked as allocation free. Release builds keep the standard
+// allocator and every counter reads zero.
+//#define ALLOC_TRACKING_DISABLE
+// Also interposes malloc, calloc and realloc on glibc. Off by default, since SDL and the Vulkan
+// driver allocate with malloc inside calls the frame loop cannot avoid.
+//#define ALLOC_TRACKING_HOOK_MALLOC
+
+#if !defined(NDEBUG) && !defined(ALLOC_TRACKING_DISABLE)
+#define ALLOC_TRACKING
+#endif
+
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+
+#ifdef ALLOC_TRACKING
+#define ZERO_ALLOC_SCOPE(name) ZeroAllocScope ALLOC_CONCAT(zeroAllocScope, __LINE__)(name)
+#define ALLOW_ALLOC_SCOPE() AllowAllocScope ALLOC_CONCAT(allowAllocScope, __LINE__)
+#else
+#define ZERO_ALLOC_SCOPE(name)
+#define ALLOW_ALLOC_SCOPE()
+#endif
+
+// Frames before the frame loop has to stop allocating. Threads register with the profiler and the
+// logger on first use, and GPU profiler scopes are created the first time they are recorded.
+static constexpr uint64_t ZERO_ALLOC_WARMUP_FRAMES = 8;
+// Violations reported with a log line and a backtrace. Later ones are only counted, so a leak in
+// every frame cannot flood the log.
+static constexpr uint64_t ZERO_ALLOC_MAX_REPORTS = 16;
+static constexpr uint32_t ZERO_ALLOC_BACKTRACE_DEPTH = 32;
+
+enum AllocViolationAction {
+    ALLOC_VIOLATION_COUNT,
+    ALLOC_VIOLATION_LOG,
+    ALLOC_VIOLATION_ASSERT,
+};
+
+struct AllocationCounters {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// Allocations of the calling thread since it started. Take the difference of two calls for a frame.
+AllocationCounters getThreadAllocationCounters();
+// Allocations made by any thread inside a zero-alloc region.
+uint64_t getZeroAllocViolationCount();
+// What an allocation inside a zero-alloc region does besides being counted. Defaults to logging.
+void setAllocViolationAction(AllocViolationAction action);
+// Parses "count", "log" or "assert".
+bool parseAllocViolationAction(const char* text, AllocViolationAction* action);
+
+// Marks the rest of the scope on this thread as allocation free. A null name leaves the thread as
+// it is, so a region can be armed only once warmed up. Regions nest; the innermost name is reported.
+struct ZeroAllocScope {
+    const char* previousRegion;
+    explicit ZeroAllocScope(const char* name);
+    ~ZeroAllocScope();
+    ZeroAllocScope(const ZeroAllocScope&) = delete;
+    ZeroAllocScope& operator=(const ZeroAllocScope&) = delete;
+};
+
+// Allows allocations again inside a zero-alloc region, for rare events such as a swapchain rebuild.
+struct AllowAllocScope {
+    AllowAllocScope();
+    ~AllowAllocScope();
+    AllowAllocScope(const AllowAllocScope&) = delete;
+    AllowAllocScope& operator=(const AllowAllocScope&) = delete;
+};
@@ -0,0 +1,139 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "async_io.h"
+#include "logger.h"
+#include "profiler.h"
+#include <cstdio>
+
+static bool readWholeFile(const char* path, std::vector<uint8_t>* bytes) {
+    PROFILE_SCOPE("Read file");
+    bytes->clear();
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    const long size = ok ? std::ftell(file) : -1;
+    ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        bytes->resize(static_cast<size_t>(size));
+        ok = std::fread(bytes->data(), 1, bytes->size(), file) == bytes->size();
+    }
+    std::fclose(file);
+    if (!ok) {
+        LOG_WARN("Failed to read ", path);
+        bytes->clear();
+    }
+    return ok;
+}
+
+static void completeRequest(AsyncIo* io, AsyncIoRequest* request, bool result) {
+    request->result = result;
+    submitJobs(io->jobs, &request->completion, 1, JOB_PRIORITY_NORMAL, nullptr);
+}
+
+static void asyncIoMain(AsyncIo* io) {
+    PROFILE_THREAD_NAME("Async I/O");
+    AsyncIoRequest* fenceWaits[ASYNC_IO_MAX_FENCE_WAITS];
+    uint32_t fenceWaitCount = 0;
+    for (;;) {
+        AsyncIoRequest* requests = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(io->mutex);
+            // With fences outstanding the thread only checks for requests between polls.
+            if (fenceWaitCount == 0) {
+                io->wake.wait(lock, [io] { return io->queueHead != nullptr || io->quit; });
+            }
+            if (io->quit) {
+                return;
+            }
+            // Fence waits beyond the polled set stay queued, file reads never wait behind them.
+            AsyncIoRequest** link = &io->queueHead;
+            AsyncIoRequest** taken = &requests;
+            io->queueTail = nullptr;
+            uint32_t takenFenceWaits = fenceWaitCount;
+            while (*link != nullptr) {
+                AsyncIoRequest* request = *link;
+                if (request->kind == ASYNC_IO_FENCE_WAIT && takenFenceWaits == ASYNC_IO_MAX_FENCE_WAITS) {
+                    io->queueTail = request;
+                    link = &request->next;
+                    continue;
+                }
+                if (request->kind == ASYNC_IO_FENCE_WAIT) {
+                    takenFenceWaits++;
+                }
+                *link = request->next;
+                *taken = request;
+                taken = &request->next;
+            }
+            *taken = nullptr;
+        }
+
+        while (requests != nullptr) {
+            AsyncIoRequest* request = requests;
+            requests = request->next;
+            if (request->kind == ASYNC_IO_FILE_READ) {
+                completeRequest(io, request, readWholeFile(request->path, request->bytes));
+            } else {
+                fenceWaits[fenceWaitCount++] = request;
+            }
+        }
+
+        if (fenceWaitCount == 0) {
+            continue;
+        }
+        // Fences may belong to different devices, so only the oldest one is waited on; the rest
+        // are polled right after.
+        {
+            PROFILE_SCOPE("Wait for fences");
+            vkWaitForFences(fenceWaits[0]->device, 1, &fenceWaits[0]->fence, VK_TRUE, ASYNC_IO_FENCE_POLL_NS);
+        }
+        uint32_t remaining = 0;
+        for (uint32_t i = 0; i < fenceWaitCount; i++) {
+            AsyncIoRequest* request = fenceWaits[i];
+            const VkResult status = vkGetFenceStatus(request->device, request->fence);
+            if (status == VK_NOT_READY) {
+                fenceWaits[remaining++] = request;
+            } else {
+                if (status != VK_SUCCESS) {
+                    LOG_ERROR("Fence wait failed: ", static_cast<int>(status));
+                }
+                completeRequest(io, request, status == VK_SUCCESS);
+            }
+        }
+        fenceWaitCount = remaining;
+    }
+}
+
+void startAsyncIo(AsyncIo* io, JobSystem* jobs) {
+    io->jobs = jobs;
+    io->queueHead = nullptr;
+    io->queueTail = nullptr;
+    io->quit = false;
+    io->thread = std::thread(asyncIoMain, io);
+}
+
+void stopAsyncIo(AsyncIo* io) {
+    if (!io->thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(io->mutex);
+        io->quit = true;
+    }
+    io->wake.notify_one();
+    io->thread.join();
+}
+
+void submitAsyncIo(AsyncIo* io, AsyncIoRequest* request) {
+    request->next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(io->mutex);
+        if (io->queueTail != nullptr) {
+            io->queueTail->next = request;
+        } else {
+            io->queueHead = request;
+        }
+        io->queueTail = request;
+    }
+    io->wake.notify_one();
+}
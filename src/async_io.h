@@ -0,0 +1,53 @@
+#pragma once
+#include "job_system.h"
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fence waits the I/O thread polls at once. Requests beyond that stay queued until one finishes.
+static constexpr uint32_t ASYNC_IO_MAX_FENCE_WAITS = 64;
+// How long the I/O thread blocks on a fence before it looks for new requests again.
+static constexpr uint64_t ASYNC_IO_FENCE_POLL_NS = 1000000ull;
+
+enum AsyncIoKind {
+    // Reads the whole file at path into bytes.
+    ASYNC_IO_FILE_READ,
+    // Waits until fence is signalled.
+    ASYNC_IO_FENCE_WAIT,
+};
+
+// Like a job, the caller owns the request, usually in a coroutine frame, and it has to stay alive
+// until its completion job runs. Nothing of it is touched once the completion job is submitted.
+struct AsyncIoRequest {
+    AsyncIoKind kind;
+    const char* path;
+    std::vector<uint8_t>* bytes;
+    VkDevice device;
+    VkFence fence;
+    // False if the file could not be read or the device was lost.
+    bool result;
+    // Submitted to the job system when the request is done.
+    Job completion;
+    AsyncIoRequest* next;
+};
+
+// One thread for everything that would otherwise block a job worker: file reads and GPU fences.
+// Completions go back to the job system, so the code waiting for them never occupies a thread.
+struct AsyncIo {
+    JobSystem* jobs;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // Guarded by mutex.
+    AsyncIoRequest* queueHead;
+    AsyncIoRequest* queueTail;
+    bool quit;
+};
+
+void startAsyncIo(AsyncIo* io, JobSystem* jobs);
+// Requests still pending are dropped without completion. Call it once every request has completed.
+void stopAsyncIo(AsyncIo* io);
+void submitAsyncIo(AsyncIo* io, AsyncIoRequest* request);
@@ -0,0 +1,799 @@
+#include "binary_log.h"
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+// Asynchronous logger backend. Every thread owns a lock-free single-producer ring of log records;
+// a writer thread drains all rings, formats the records into one output buffer and writes it in
+// large chunks, so logging costs a copy on the calling thread and never a flush. Deferred messages
+// reach the ring as raw argument bytes and are only formatted here, or with a binary output not at
+// all.
+//
+// Rings are registered on first use and live until the process exits, so the crash handler can
+// always reach them. When a thread exits its ring is released, and the next thread that registers
+// takes it over once the writer has drained it. Before initLogger(), after exitLogger(), during a
+// thread's exit and while LOG_MAX_THREADS live threads own a ring, messages are written
+// synchronously instead.
+
+static constexpr uint32_t LOG_RING_SIZE = 64 * 1024;
+static constexpr uint32_t LOG_MAX_THREADS = 64;
+// Longer messages are truncated, so every record fits into a ring comfortably.
+static constexpr uint32_t LOG_MAX_MESSAGE_SIZE = 4096;
+static constexpr uint32_t LOG_OUTPUT_BUFFER_SIZE = 64 * 1024;
+// After waking up, the writer waits this long so bursts end up in one write.
+static constexpr uint32_t LOG_WRITER_COALESCE_US = 500;
+// How long the crash handler spins for another thread's drain to finish before it writes anyway.
+static constexpr uint32_t LOG_CRASH_DRAIN_WAIT_SPINS = 1u << 24;
+
+enum LogRecordKind : uint16_t {
+    LOG_RECORD_TEXT,
+    LOG_RECORD_PADDING,
+    // The message is the payload of site.
+    LOG_RECORD_DEFERRED
+};
+
+// Records are 8 byte aligned. A record never wraps: when the contiguous space at the end of the ring
+// is too small, the producer fills it with a padding record, or leaves it when not even a header fits.
+struct LogRecordHeader {
+    uint32_t size;
+    uint16_t level;
+    uint16_t kind;
+    uint32_t lineNumber;
+    uint32_t messageLength;
+    const char* file;
+    const LogSite* site;
+};
+
+struct LogRing {
+    // Read position, only written by whoever drains (the writer, or a flush holding drainMutex).
+    alignas(64) std::atomic<uint64_t> head;
+    // Write position, only written by the owning thread.
+    alignas(64) std::atomic<uint64_t> tail;
+    // The owning thread's last look at head, so it only reads the writer's cache line when the ring
+    // seems full.
+    uint64_t cachedHead;
+    std::atomic<uint64_t> dropped;
+    // Cleared when the owning thread exits, set again by the thread that takes the ring over.
+    std::atomic<bool> owned;
+    alignas(8) uint8_t data[LOG_RING_SIZE];
+};
+
+// Releases the thread's ring when the thread exits.
+struct LogRingReleaser {
+    ~LogRingReleaser();
+};
+
+static std::atomic<LogRing*> logRings[LOG_MAX_THREADS];
+static std::atomic<uint32_t> logRingCount{0};
+static thread_local LogRing* logThreadRing = nullptr;
+static thread_local bool logThreadRingFailed = false;
+static thread_local LogRingReleaser logRingReleaser;
+
+static std::atomic<bool> logRunning{false};
+static std::atomic<uint32_t> logSignal{0};
+// Set while the writer is about to sleep on logSignal. Producers only signal then, which keeps the
+// notify off the hot path.
+static std::atomic<bool> logWriterWaiting{false};
+static std::atomic<LogOverflowPolicy> logOverflowPolicy{LOG_OVERFLOW_DROP};
+static std::thread logWriter;
+// Serialises draining and the synchronous fallback path, which share the output buffer.
+static std::mutex drainMutex;
+// Set while a drain or the synchronous path uses the output buffer. The crash handler cannot take
+// drainMutex, so it claims this flag instead and keeps it, which stops every later drain.
+static std::atomic<bool> logDraining{false};
+// Only touched while holding drainMutex and logDraining, or by the crash handler.
+static char outputBuffer[LOG_OUTPUT_BUFFER_SIZE];
+static uint32_t outputLength = 0;
+#ifdef _WIN32
+static int outputFile = 1;
+#else
+static int outputFile = STDOUT_FILENO;
+#endif
+static bool binaryOutput = false;
+
+static constexpr int CRASH_SIGNALS[] = {
+    SIGSEGV,
+    SIGABRT,
+    SIGFPE,
+    SIGILL,
+#ifdef SIGBUS
+    SIGBUS,
+#endif
+};
+
+static void writeOutput(const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        const int written = _write(outputFile, data, static_cast<unsigned int>(size));
+#else
+        const ssize_t written = write(outputFile, data, size);
+#endif
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+static void flushOutput() {
+    writeOutput(outputBuffer, outputLength);
+    outputLength = 0;
+}
+
+static void appendOutput(const char* data, size_t size) {
+    if (outputLength + size > LOG_OUTPUT_BUFFER_SIZE) {
+        flushOutput();
+        if (size > LOG_OUTPUT_BUFFER_SIZE) {
+            writeOutput(data, size);
+            return;
+        }
+    }
+    std::memcpy(outputBuffer + outputLength, data, size);
+    outputLength += static_cast<uint32_t>(size);
+}
+
+static void appendOutput(const char* text) {
+    appendOutput(text, std::strlen(text));
+}
+
+static void appendUnsigned(uint64_t value) {
+    char text[LOG_MAX_NUMBER_SIZE];
+    appendOutput(text, static_cast<size_t>(formatLogUnsigned(text, value) - text));
+}
+
+// Same line format as the synchronous backend. Line 0 marks the logger's own messages.
+static void appendLineBegin(uint16_t level, const char* file, uint32_t lineNumber) {
+    if (level == LOG_LEVEL_WARN) {
+        appendOutput("\033[33m");
+    } else if (level == LOG_LEVEL_ERROR) {
+        appendOutput("\033[31m");
+    }
+    appendOutput("[");
+    appendOutput(file);
+    if (lineNumber != 0) {
+        appendOutput(":");
+        appendUnsigned(lineNumber);
+    }
+    appendOutput("]: ");
+}
+
+static void appendLineEnd(uint16_t level) {
+    if (level != LOG_LEVEL_INFO) {
+        appendOutput("\033[0m");
+    }
+    appendOutput("\n");
+}
+
+static LogFileEntry makeEntry(LogEntryKind kind, uint16_t level, uint32_t siteId, uint32_t lineNumber, uint32_t argCount, size_t bodySize) {
+    LogFileEntry entry = {};
+    entry.size = static_cast<uint32_t>(sizeof(entry) + bodySize);
+    entry.kind = kind;
+    entry.level = static_cast<uint8_t>(level);
+    entry.argCount = static_cast<uint16_t>(argCount);
+    entry.siteId = siteId;
+    entry.lineNumber = lineNumber;
+    return entry;
+}
+
+static void appendEntry(LogEntryKind kind, uint16_t level, uint32_t siteId, uint32_t lineNumber, uint32_t argCount, size_t bodySize) {
+    const LogFileEntry entry = makeEntry(kind, level, siteId, lineNumber, argCount, bodySize);
+    appendOutput(reinterpret_cast<const char*>(&entry), sizeof(entry));
+}
+
+static void appendText(uint16_t level, const char* file, uint32_t lineNumber, const char* message, size_t messageLength) {
+    if (binaryOutput) {
+        const size_t fileLength = std::strlen(file);
+        appendEntry(LOG_ENTRY_TEXT, level, 0, lineNumber, 0, fileLength + 1 + messageLength);
+        appendOutput(file, fileLength + 1);
+        appendOutput(message, messageLength);
+        return;
+    }
+    appendLineBegin(level, file, lineNumber);
+    appendOutput(message, messageLength);
+    appendLineEnd(level);
+}
+
+static void appendDecoded(const char* text, size_t length, void* userData) {
+    (void)userData;
+    appendOutput(text, length);
+}
+
+static void appendDeferred(const LogSite* site, const uint8_t* payload, size_t payloadSize) {
+    const uint32_t id = site->id.load(std::memory_order_relaxed);
+    if (binaryOutput) {
+        if (!site->described) {
+            // Only drains write entries, and those hold drainMutex.
+            const_cast<LogSite*>(site)->described = true;
+            const size_t fileLength = std::strlen(site->file);
+            appendEntry(LOG_ENTRY_SITE, site->level, id, site->lineNumber, site->argCount, site->argCount + fileLength);
+            appendOutput(reinterpret_cast<const char*>(site->argTypes), site->argCount);
+            appendOutput(site->file, fileLength);
+        }
+        appendEntry(LOG_ENTRY_RECORD, site->level, id, 0, 0, payloadSize);
+        appendOutput(reinterpret_cast<const char*>(payload), payloadSize);
+        return;
+    }
+    appendLineBegin(site->level, site->file, site->lineNumber);
+    decodeLogArgs(site->argTypes, site->argCount, payload, payloadSize, appendDecoded, nullptr);
+    appendLineEnd(site->level);
+}
+
+// A ring released by an exited thread, once the writer has drained everything it logged.
+static LogRing* takeReleasedRing() {
+    const uint32_t ringCount = logRingCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < ringCount && i < LOG_MAX_THREADS; i++) {
+        LogRing* ring = logRings[i].load(std::memory_order_acquire);
+        if (ring == nullptr || ring->owned.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        bool owned = false;
+        // Acquire pairs with the releaser, so the previous owner's tail is visible.
+        if (!ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+            continue;
+        }
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (head != ring->tail.load(std::memory_order_relaxed)) {
+            ring->owned.store(false, std::memory_order_release);
+            continue;
+        }
+        ring->cachedHead = head;
+        return ring;
+    }
+    return nullptr;
+}
+
+static LogRing* registerLogRing() {
+    LogRing* ring = takeReleasedRing();
+    if (ring == nullptr) {
+        const uint32_t index = logRingCount.load(std::memory_order_relaxed);
+        if (index >= LOG_MAX_THREADS) {
+            logThreadRingFailed = true;
+            return nullptr;
+        }
+        // Claim the slot first; the counter is only a hint for readers, the slot itself is authoritative.
+        uint32_t claimed = index;
+        while (!logRingCount.compare_exchange_weak(claimed, claimed + 1, std::memory_order_relaxed)) {
+            if (claimed >= LOG_MAX_THREADS) {
+                logThreadRingFailed = true;
+                return nullptr;
+            }
+        }
+        ring = new LogRing();
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->tail.store(0, std::memory_order_relaxed);
+        ring->cachedHead = 0;
+        ring->dropped.store(0, std::memory_order_relaxed);
+        ring->owned.store(true, std::memory_order_relaxed);
+        logRings[claimed].store(ring, std::memory_order_release);
+    }
+    // First use on this thread constructs the releaser, which registers its destructor.
+    (void)&logRingReleaser;
+    logThreadRing = ring;
+    return ring;
+}
+
+LogRingReleaser::~LogRingReleaser() {
+    LogRing* ring = logThreadRing;
+    logThreadRing = nullptr;
+    // Whatever the rest of the thread's exit logs goes out synchronously.
+    logThreadRingFailed = true;
+    if (ring != nullptr) {
+        ring->owned.store(false, std::memory_order_release);
+    }
+}
+
+// Moves every complete record of one ring into the output buffer.
+static bool drainRing(LogRing* ring) {
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    const bool hadRecords = head != tail;
+    while (head != tail) {
+        const uint32_t position = static_cast<uint32_t>(head % LOG_RING_SIZE);
+        const uint32_t contiguous = LOG_RING_SIZE - position;
+        if (contiguous < sizeof(LogRecordHeader)) {
+            head += contiguous;
+            continue;
+        }
+        LogRecordHeader header;
+        std::memcpy(&header, ring->data + position, sizeof(header));
+        const uint8_t* message = ring->data + position + sizeof(header);
+        if (header.kind == LOG_RECORD_TEXT) {
+            appendText(header.level, header.file, header.lineNumber, reinterpret_cast<const char*>(message), header.messageLength);
+        } else if (header.kind == LOG_RECORD_DEFERRED) {
+            appendDeferred(header.site, message, header.messageLength);
+        }
+        head += header.size;
+    }
+    ring->head.store(head, std::memory_order_release);
+
+    // Only write the producer's cache line when there is something to report.
+    const uint64_t dropped = (ring->dropped.load(std::memory_order_relaxed) != 0) ? ring->dropped.exchange(0, std::memory_order_relaxed) : 0;
+    if (dropped != 0) {
+        static constexpr char DROPPED_SUFFIX[] = " messages dropped, ring full";
+        char message[LOG_MAX_NUMBER_SIZE + sizeof(DROPPED_SUFFIX)];
+        char* end = formatLogUnsigned(message, dropped);
+        std::memcpy(end, DROPPED_SUFFIX, sizeof(DROPPED_SUFFIX) - 1);
+        appendText(LOG_LEVEL_WARN, "logger", 0, message, static_cast<size_t>(end - message) + sizeof(DROPPED_SUFFIX) - 1);
+    }
+    return hadRecords || dropped != 0;
+}
+
+// Call with drainMutex held. False once the crash handler owns the output.
+static bool beginDrain() {
+    return !logDraining.exchange(true, std::memory_order_acquire);
+}
+
+static void endDrain() {
+    logDraining.store(false, std::memory_order_release);
+}
+
+// Call between beginDrain() and endDrain().
+static bool drainAllRings() {
+    bool drained = false;
+    const uint32_t ringCount = logRingCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < ringCount && i < LOG_MAX_THREADS; i++) {
+        LogRing* ring = logRings[i].load(std::memory_order_acquire);
+        if (ring != nullptr) {
+            drained |= drainRing(ring);
+        }
+    }
+    flushOutput();
+    return drained;
+}
+
+// Whether any ring holds records, without draining them.
+static bool ringsHaveRecords() {
+    const uint32_t ringCount = logRingCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < ringCount && i < LOG_MAX_THREADS; i++) {
+        LogRing* ring = logRings[i].load(std::memory_order_acquire);
+        if (ring != nullptr && ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void logWriterMain() {
+    for (;;) {
+        const uint32_t signal = logSignal.load(std::memory_order_acquire);
+        bool drained = false;
+        {
+            std::lock_guard<std::mutex> lock(drainMutex);
+            if (beginDrain()) {
+                drained = drainAllRings();
+                endDrain();
+            }
+        }
+        if (!logRunning.load(std::memory_order_acquire)) {
+            return;
+        }
+        if (!drained) {
+            // Pairs with commitRecord(): either the producer sees the flag and signals, or the
+            // check below sees its record.
+            logWriterWaiting.store(true, std::memory_order_seq_cst);
+            if (!ringsHaveRecords()) {
+                logSignal.wait(signal, std::memory_order_acquire);
+            }
+            logWriterWaiting.store(false, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(LOG_WRITER_COALESCE_US));
+        }
+    }
+}
+
+static void crashWriteText(const char* text) {
+    writeOutput(text, std::strlen(text));
+}
+
+// The crash handler's own number formatting: std::to_chars is not async-signal-safe.
+static void crashWriteUnsigned(uint64_t value, uint32_t base, uint32_t minDigits) {
+    char digits[64];
+    uint32_t count = 0;
+    do {
+        digits[sizeof(digits) - 1 - count] = "0123456789abcdef"[value % base];
+        value /= base;
+        count++;
+    } while (value != 0 || count < minDigits);
+    writeOutput(digits + sizeof(digits) - count, count);
+}
+
+static void crashWriteSigned(int64_t value) {
+    if (value < 0) {
+        writeOutput("-", 1);
+    }
+    crashWriteUnsigned(value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), 10, 1);
+}
+
+// Fixed with six decimals like formatLogDouble(). Magnitudes beyond a 64 bit integer get an
+// exponent appended instead, which loses a few low digits.
+static void crashWriteDouble(double value) {
+    if (value != value) {
+        crashWriteText("nan");
+        return;
+    }
+    if (value < 0.0) {
+        writeOutput("-", 1);
+        value = -value;
+    }
+    if (value > 1.7976931348623157e308) {
+        crashWriteText("inf");
+        return;
+    }
+    uint32_t exponent = 0;
+    while (value >= 1e18) {
+        value /= 10.0;
+        exponent++;
+    }
+    uint64_t integer = static_cast<uint64_t>(value);
+    uint64_t fraction = static_cast<uint64_t>((value - static_cast<double>(integer)) * 1e6 + 0.5);
+    if (fraction >= 1000000) {
+        integer++;
+        fraction -= 1000000;
+    }
+    crashWriteUnsigned(integer, 10, 1);
+    writeOutput(".", 1);
+    crashWriteUnsigned(fraction, 10, 6);
+    if (exponent != 0) {
+        crashWriteText("e+");
+        crashWriteUnsigned(exponent, 10, 1);
+    }
+}
+
+static void crashWriteLineBegin(uint16_t level, const char* file, uint32_t lineNumber) {
+    if (level == LOG_LEVEL_WARN) {
+        crashWriteText("\033[33m");
+    } else if (level == LOG_LEVEL_ERROR) {
+        crashWriteText("\033[31m");
+    }
+    crashWriteText("[");
+    crashWriteText(file);
+    if (lineNumber != 0) {
+        crashWriteText(":");
+        crashWriteUnsigned(lineNumber, 10, 1);
+    }
+    crashWriteText("]: ");
+}
+
+static void crashWriteLineEnd(uint16_t level) {
+    if (level != LOG_LEVEL_INFO) {
+        crashWriteText("\033[0m");
+    }
+    crashWriteText("\n");
+}
+
+// Same output as decodeLogArgs(), written straight to the file.
+static void crashWriteArgs(const LogSite* site, const uint8_t* payload, size_t payloadSize) {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < site->argCount && offset < payloadSize; i++) {
+        const size_t remaining = payloadSize - offset;
+        const uint8_t type = site->argTypes[i];
+        if (type == LOG_ARG_CHAR) {
+            writeOutput(reinterpret_cast<const char*>(payload + offset), 1);
+            offset += 1;
+            continue;
+        }
+        if (type == LOG_ARG_STRING) {
+            uint32_t stringLength = 0;
+            if (remaining < sizeof(stringLength)) {
+                return;
+            }
+            std::memcpy(&stringLength, payload + offset, sizeof(stringLength));
+            if (remaining - sizeof(stringLength) < stringLength) {
+                return;
+            }
+            writeOutput(reinterpret_cast<const char*>(payload + offset + sizeof(stringLength)), stringLength);
+            offset += sizeof(stringLength) + stringLength;
+            continue;
+        }
+
+        uint64_t bits = 0;
+        if (remaining < sizeof(bits)) {
+            return;
+        }
+        std::memcpy(&bits, payload + offset, sizeof(bits));
+        offset += sizeof(bits);
+        if (type == LOG_ARG_INT) {
+            crashWriteSigned(static_cast<int64_t>(bits));
+        } else if (type == LOG_ARG_UINT) {
+            crashWriteUnsigned(bits, 10, 1);
+        } else if (type == LOG_ARG_DOUBLE) {
+            double value = 0.0;
+            std::memcpy(&value, &bits, sizeof(value));
+            crashWriteDouble(value);
+        } else if (type == LOG_ARG_POINTER) {
+            crashWriteText("0x");
+            crashWriteUnsigned(bits, 16, 1);
+        } else {
+            return;
+        }
+    }
+}
+
+static void crashWriteRecord(const LogRecordHeader& header, const uint8_t* message) {
+    if (header.kind == LOG_RECORD_TEXT) {
+        if (binaryOutput) {
+            const size_t fileLength = std::strlen(header.file);
+            const LogFileEntry entry = makeEntry(LOG_ENTRY_TEXT, header.level, 0, header.lineNumber, 0, fileLength + 1 + header.messageLength);
+            writeOutput(reinterpret_cast<const char*>(&entry), sizeof(entry));
+            writeOutput(header.file, fileLength + 1);
+            writeOutput(reinterpret_cast<const char*>(message), header.messageLength);
+            return;
+        }
+        crashWriteLineBegin(header.level, header.file, header.lineNumber);
+        writeOutput(reinterpret_cast<const char*>(message), header.messageLength);
+        crashWriteLineEnd(header.level);
+        return;
+    }
+
+    const LogSite* site = header.site;
+    if (binaryOutput) {
+        const uint32_t id = site->id.load(std::memory_order_relaxed);
+        if (!site->described) {
+            const size_t fileLength = std::strlen(site->file);
+            const LogFileEntry siteEntry = makeEntry(LOG_ENTRY_SITE, site->level, id, site->lineNumber, site->argCount, site->argCount + fileLength);
+            writeOutput(reinterpret_cast<const char*>(&siteEntry), sizeof(siteEntry));
+            writeOutput(reinterpret_cast<const char*>(site->argTypes), site->argCount);
+            writeOutput(site->file, fileLength);
+            const_cast<LogSite*>(site)->described = true;
+        }
+        const LogFileEntry entry = makeEntry(LOG_ENTRY_RECORD, site->level, id, 0, 0, header.messageLength);
+        writeOutput(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        writeOutput(reinterpret_cast<const char*>(message), header.messageLength);
+        return;
+    }
+    crashWriteLineBegin(site->level, site->file, site->lineNumber);
+    crashWriteArgs(site, message, header.messageLength);
+    crashWriteLineEnd(site->level);
+}
+
+// Writes the committed records of one ring without consuming them. A ring that is being drained
+// or overwritten concurrently may hold garbage, so the walk stops at the first bad header.
+static void crashWriteRing(const LogRing* ring) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    while (head < tail) {
+        const uint32_t position = static_cast<uint32_t>(head % LOG_RING_SIZE);
+        const uint32_t contiguous = LOG_RING_SIZE - position;
+        if (contiguous < sizeof(LogRecordHeader)) {
+            head += contiguous;
+            continue;
+        }
+        LogRecordHeader header;
+        std::memcpy(&header, ring->data + position, sizeof(header));
+        if (header.size < sizeof(header) || header.size > contiguous || header.size > tail - head || header.messageLength > header.size - sizeof(header)) {
+            return;
+        }
+        if (header.kind == LOG_RECORD_TEXT || header.kind == LOG_RECORD_DEFERRED) {
+            crashWriteRecord(header, ring->data + position + sizeof(header));
+        }
+        head += header.size;
+    }
+}
+
+// Only lock-free atomics, memcpy, strlen and write(), which are async-signal-safe. The handler
+// takes logDraining for good, so no later drain interferes. When it cannot, the crash interrupted
+// a drain, or another thread is stuck in one: then the formatted output that drain has not written
+// yet goes out first, and lines it already wrote may appear twice.
+static void crashHandler(int signal) {
+    bool claimed = false;
+    for (uint32_t i = 0; i < LOG_CRASH_DRAIN_WAIT_SPINS && !claimed; i++) {
+        claimed = !logDraining.exchange(true, std::memory_order_acquire);
+    }
+    if (!claimed) {
+        writeOutput(outputBuffer, outputLength);
+    }
+    const uint32_t ringCount = logRingCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < ringCount && i < LOG_MAX_THREADS; i++) {
+        const LogRing* ring = logRings[i].load(std::memory_order_acquire);
+        if (ring != nullptr) {
+            crashWriteRing(ring);
+        }
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+static void exitHandler() {
+    flushLogger();
+}
+
+// The calling thread's ring, or nullptr when messages have to be written synchronously.
+static LogRing* getThreadRing() {
+    LogRing* ring = logThreadRing;
+    if (ring == nullptr && !logThreadRingFailed && logRunning.load(std::memory_order_acquire)) {
+        ring = registerLogRing();
+    }
+    if (ring == nullptr || !logRunning.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return ring;
+}
+
+// Makes room for a record of messageLength bytes and fills in its header. Returns nullptr when the
+// message was dropped; otherwise the message goes to the returned address, then commitRecord().
+static uint8_t* reserveRecord(LogRing* ring, LogRecordHeader* header, uint64_t* recordTail) {
+    const uint32_t recordSize = static_cast<uint32_t>((sizeof(LogRecordHeader) + header->messageLength + 7) & ~static_cast<size_t>(7));
+
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    const uint32_t position = static_cast<uint32_t>(tail % LOG_RING_SIZE);
+    const uint32_t contiguous = LOG_RING_SIZE - position;
+    const uint32_t skipped = (recordSize > contiguous) ? contiguous : 0;
+    for (;;) {
+        if (tail + skipped + recordSize - ring->cachedHead <= LOG_RING_SIZE) {
+            break;
+        }
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (head != ring->cachedHead) {
+            ring->cachedHead = head;
+            continue;
+        }
+        if (logOverflowPolicy.load(std::memory_order_relaxed) == LOG_OVERFLOW_DROP || !logRunning.load(std::memory_order_acquire)) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        logSignal.fetch_add(1, std::memory_order_release);
+        logSignal.notify_one();
+        std::this_thread::yield();
+    }
+
+    if (skipped != 0) {
+        if (skipped >= sizeof(LogRecordHeader)) {
+            LogRecordHeader padding = {};
+            padding.size = skipped;
+            padding.kind = LOG_RECORD_PADDING;
+            std::memcpy(ring->data + position, &padding, sizeof(padding));
+        }
+        tail += skipped;
+    }
+
+    header->size = recordSize;
+    uint8_t* record = ring->data + tail % LOG_RING_SIZE;
+    std::memcpy(record, header, sizeof(*header));
+    *recordTail = tail + recordSize;
+    return record + sizeof(*header);
+}
+
+static void commitRecord(LogRing* ring, uint64_t recordTail) {
+    ring->tail.store(recordTail, std::memory_order_seq_cst);
+    if (logWriterWaiting.load(std::memory_order_seq_cst) && logWriterWaiting.exchange(false, std::memory_order_relaxed)) {
+        logSignal.fetch_add(1, std::memory_order_release);
+        logSignal.notify_one();
+    }
+}
+
+static void logRecord(uint16_t level, size_t lineNumber, const char* file, const char* message, size_t messageLength) {
+    LogRing* ring = getThreadRing();
+    if (ring == nullptr) {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        if (beginDrain()) {
+            appendText(level, file, static_cast<uint32_t>(lineNumber), message, messageLength);
+            flushOutput();
+            endDrain();
+        }
+        return;
+    }
+
+    LogRecordHeader header = {};
+    header.level = level;
+    header.kind = LOG_RECORD_TEXT;
+    header.lineNumber = static_cast<uint32_t>(lineNumber);
+    header.messageLength = static_cast<uint32_t>((messageLength > LOG_MAX_MESSAGE_SIZE) ? LOG_MAX_MESSAGE_SIZE : messageLength);
+    header.file = file;
+    uint64_t recordTail = 0;
+    uint8_t* record = reserveRecord(ring, &header, &recordTail);
+    if (record != nullptr) {
+        std::memcpy(record, message, header.messageLength);
+        commitRecord(ring, recordTail);
+    }
+}
+
+void logDeferred(const LogSite* site, const uint8_t* payload, size_t payloadSize) {
+    LogRing* ring = getThreadRing();
+    if (ring == nullptr) {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        if (beginDrain()) {
+            appendDeferred(site, payload, payloadSize);
+            flushOutput();
+            endDrain();
+        }
+        return;
+    }
+
+    LogRecordHeader header = {};
+    header.level = site->level;
+    header.kind = LOG_RECORD_DEFERRED;
+    header.messageLength = static_cast<uint32_t>(payloadSize);
+    header.site = site;
+    uint64_t recordTail = 0;
+    uint8_t* record = reserveRecord(ring, &header, &recordTail);
+    if (record != nullptr) {
+        std::memcpy(record, payload, payloadSize);
+        commitRecord(ring, recordTail);
+    }
+}
+
+bool setLogBinaryOutput(const char* path) {
+#ifdef _WIN32
+    const int file = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (file < 0) {
+        return false;
+    }
+    // Everything logged so far still goes out as text.
+    std::lock_guard<std::mutex> lock(drainMutex);
+    if (!beginDrain()) {
+        return false;
+    }
+    drainAllRings();
+    outputFile = file;
+    binaryOutput = true;
+    appendOutput(LOG_FILE_MAGIC, sizeof(LOG_FILE_MAGIC));
+    flushOutput();
+    endDrain();
+    return true;
+}
+
+void initLogger() {
+    if (logRunning.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    logWriter = std::thread(logWriterMain);
+
+    static bool handlersInstalled = false;
+    if (!handlersInstalled) {
+        handlersInstalled = true;
+        std::atexit(exitHandler);
+        for (int signal : CRASH_SIGNALS) {
+            std::signal(signal, crashHandler);
+        }
+    }
+}
+
+void exitLogger() {
+    if (!logRunning.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    logSignal.fetch_add(1, std::memory_order_release);
+    logSignal.notify_one();
+    logWriter.join();
+    // Records committed after the writer's last drain.
+    flushLogger();
+}
+
+void flushLogger() {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    if (beginDrain()) {
+        drainAllRings();
+        endDrain();
+    }
+}
+
+void setLogOverflowPolicy(LogOverflowPolicy policy) {
+    logOverflowPolicy.store(policy, std::memory_order_relaxed);
+}
+
+void logInfo(size_t lineNumber, const char* file, const char* message, size_t messageLength) {
+    logRecord(LOG_LEVEL_INFO, lineNumber, file, message, messageLength);
+}
+
+void logWarn(size_t lineNumber, const char* file, const char* message, size_t messageLength) {
+    logRecord(LOG_LEVEL_WARN, lineNumber, file, message, messageLength);
+}
+
+void logError(size_t lineNumber, const char* file, const char* message, size_t messageLength) {
+    logRecord(LOG_LEVEL_ERROR, lineNumber, file, message, messageLength);
+}
@@ -0,0 +1,309 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "benchmark.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+void seedRandom(XorShiftRandom* random, uint64_t seed) {
+    // A zero state would stay zero forever.
+    random->state = seed != 0 ? seed : BENCHMARK_DEFAULT_SEED;
+}
+
+static uint64_t xorShiftStep(uint64_t x) {
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x;
+}
+
+uint64_t nextRandom(XorShiftRandom* random) {
+    random->state = xorShiftStep(random->state);
+    return random->state * 0x2545F4914F6CDD1Dull;
+}
+
+float nextRandomFloat(XorShiftRandom* random) {
+    // Top 24 bits fill the float mantissa exactly.
+    return static_cast<float>(nextRandom(random) >> 40) / static_cast<float>(1u << 24);
+}
+
+static uint64_t applyRandomJump(const uint64_t* columns, uint64_t state) {
+    // Masked instead of branching on the bit, since the bits are random.
+    uint64_t result = 0;
+    for (uint32_t bit = 0; bit < 64; bit++) {
+        result ^= columns[bit] & (0 - ((state >> bit) & 1));
+    }
+    return result;
+}
+
+void makeRandomJump(XorShiftJump* jump, uint64_t steps) {
+    // Square and multiply; power holds the matrix of 2^k steps.
+    uint64_t power[64];
+    for (uint32_t bit = 0; bit < 64; bit++) {
+        power[bit] = xorShiftStep(1ull << bit);
+        jump->columns[bit] = 1ull << bit;
+    }
+    while (steps != 0) {
+        if (steps & 1) {
+            for (uint32_t bit = 0; bit < 64; bit++) {
+                jump->columns[bit] = applyRandomJump(power, jump->columns[bit]);
+            }
+        }
+        steps >>= 1;
+        if (steps != 0) {
+            uint64_t squared[64];
+            for (uint32_t bit = 0; bit < 64; bit++) {
+                squared[bit] = applyRandomJump(power, power[bit]);
+            }
+            std::memcpy(power, squared, sizeof(power));
+        }
+    }
+}
+
+void jumpRandom(XorShiftRandom* random, const XorShiftJump* jump) {
+    random->state = applyRandomJump(jump->columns, random->state);
+}
+
+static double percentile(const std::vector<float>& sorted, uint32_t percent) {
+    const size_t last = sorted.size() - 1;
+    return sorted[last * percent / 100];
+}
+
+FrameTimeStats computeFrameTimeStats(const std::vector<float>& frameTimesMs) {
+    FrameTimeStats stats = {};
+    if (frameTimesMs.empty()) {
+        return stats;
+    }
+
+    std::vector<float> sorted = frameTimesMs;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (float frameTimeMs : sorted) {
+        sum += frameTimeMs;
+    }
+
+    stats.frameCount = static_cast<uint32_t>(sorted.size());
+    stats.meanMs = sum / static_cast<double>(sorted.size());
+    stats.minMs = sorted.front();
+    stats.p50Ms = percentile(sorted, 50);
+    stats.p95Ms = percentile(sorted, 95);
+    stats.p99Ms = percentile(sorted, 99);
+    stats.maxMs = sorted.back();
+    return stats;
+}
+
+uint64_t getPeakResidentMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    struct rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static const char* getPresentModeName(VkPresentModeKHR presentMode) {
+    switch (presentMode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "fifo_relaxed";
+        default:
+            return "other";
+    }
+}
+
+// Totals, instructions per cycle and the totals divided by itemCount, keyed by itemName.
+static void writePerfCounterTotals(FILE* file, const char* phase, const PerfCounterTotals& totals, const char* itemName, uint64_t itemCount) {
+    std::fprintf(file, "    \"%s\": {\"scopes\": %llu", phase, static_cast<unsigned long long>(totals.scopeCount));
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (totals.valid[i]) {
+            std::fprintf(file, ", \"%s\": %llu", getPerfCounterName(static_cast<PerfCounter>(i)), static_cast<unsigned long long>(totals.values[i]));
+        }
+    }
+    if (totals.valid[PERF_COUNTER_CYCLES] && totals.valid[PERF_COUNTER_INSTRUCTIONS] && totals.values[PERF_COUNTER_CYCLES] > 0) {
+        std::fprintf(file, ", \"ipc\": %.4f", static_cast<double>(totals.values[PERF_COUNTER_INSTRUCTIONS]) / static_cast<double>(totals.values[PERF_COUNTER_CYCLES]));
+    }
+    if (itemCount > 0) {
+        std::fprintf(file, ", \"per_%s\": {", itemName);
+        bool first = true;
+        for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+            if (totals.valid[i]) {
+                std::fprintf(file, "%s\"%s\": %.4f", first ? "" : ", ", getPerfCounterName(static_cast<PerfCounter>(i)), static_cast<double>(totals.values[i]) / static_cast<double>(itemCount));
+                first = false;
+            }
+        }
+        std::fputc('}', file);
+    }
+    std::fputc('}', file);
+}
+
+void runMathBenchmarks(const AabbSoa* boxes, const Mat4* viewProjections, uint32_t viewProjectionCount, MathBenchmarkStats* stats) {
+    *stats = {};
+    stats->backend = getSimdMathBackendName();
+    stats->boxCount = boxes->count;
+    if (boxes->count == 0 || viewProjectionCount == 0) {
+        return;
+    }
+
+    std::vector<Frustum> frustums(viewProjectionCount);
+    for (uint32_t i = 0; i < viewProjectionCount; i++) {
+        frustumFromViewProjection(&viewProjections[i], &frustums[i]);
+    }
+
+    // Results first, so the timed passes below have nothing to check.
+    std::vector<uint8_t> visible(boxes->count);
+    std::vector<uint8_t> visibleScalar(boxes->count);
+    uint64_t visibleCount = 0;
+    for (const Frustum& frustum : frustums) {
+        visibleCount += cullAabbs(&frustum, boxes, visible.data());
+        cullAabbsScalar(&frustum, boxes, visibleScalar.data());
+        for (uint32_t i = 0; i < boxes->count; i++) {
+            stats->cullMismatches += visible[i] != visibleScalar[i] ? 1 : 0;
+        }
+    }
+    const double boxTests = static_cast<double>(boxes->count) * viewProjectionCount;
+    stats->visibleFraction = static_cast<double>(visibleCount) / boxTests;
+
+    std::vector<float> outX(boxes->count);
+    std::vector<float> outY(boxes->count);
+    std::vector<float> outZ(boxes->count);
+    uint64_t cullNs = UINT64_MAX;
+    uint64_t cullScalarNs = UINT64_MAX;
+    uint64_t transformNs = UINT64_MAX;
+    uint64_t transformScalarNs = UINT64_MAX;
+    for (uint32_t pass = 0; pass < BENCHMARK_MATH_PASSES; pass++) {
+        uint64_t start = framePacerNow();
+        for (const Frustum& frustum : frustums) {
+            cullAabbs(&frustum, boxes, visible.data());
+        }
+        cullNs = std::min(cullNs, framePacerNow() - start);
+
+        start = framePacerNow();
+        for (const Frustum& frustum : frustums) {
+            cullAabbsScalar(&frustum, boxes, visibleScalar.data());
+        }
+        cullScalarNs = std::min(cullScalarNs, framePacerNow() - start);
+
+        start = framePacerNow();
+        for (uint32_t i = 0; i < viewProjectionCount; i++) {
+            transformPoints(&viewProjections[i], boxes->minX, boxes->minY, boxes->minZ, outX.data(), outY.data(), outZ.data(), boxes->count);
+        }
+        transformNs = std::min(transformNs, framePacerNow() - start);
+
+        start = framePacerNow();
+        for (uint32_t i = 0; i < viewProjectionCount; i++) {
+            transformPointsScalar(&viewProjections[i], boxes->minX, boxes->minY, boxes->minZ, outX.data(), outY.data(), outZ.data(), boxes->count);
+        }
+        transformScalarNs = std::min(transformScalarNs, framePacerNow() - start);
+    }
+    stats->cullNsPerBox = static_cast<double>(cullNs) / boxTests;
+    stats->cullScalarNsPerBox = static_cast<double>(cullScalarNs) / boxTests;
+    stats->transformNsPerPoint = static_cast<double>(transformNs) / boxTests;
+    stats->transformScalarNsPerPoint = static_cast<double>(transformScalarNs) / boxTests;
+
+    std::vector<Mat4> products(viewProjectionCount);
+    const uint64_t start = framePacerNow();
+    for (uint32_t i = 0; i < BENCHMARK_MATH_MULTIPLY_COUNT; i++) {
+        const uint32_t index = i % viewProjectionCount;
+        mat4Multiply(&viewProjections[index], &viewProjections[(i + 1) % viewProjectionCount], &products[index]);
+    }
+    stats->mat4MultiplyNs = static_cast<double>(framePacerNow() - start) / BENCHMARK_MATH_MULTIPLY_COUNT;
+
+    if (stats->cullMismatches != 0) {
+        LOG_WARN("SIMD and scalar frustum culling disagree on ", static_cast<unsigned long long>(stats->cullMismatches), " boxes.");
+    }
+}
+
+bool writeBenchmarkReport(const char* path, const BenchmarkReport& report) {
+    FILE* file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open benchmark output ", path);
+        return false;
+    }
+
+    std::fputs("{\n  \"device\": ", file);
+    writeJsonString(file, report.deviceName);
+    std::fprintf(file, ",\n  \"resolution\": [%u, %u],\n", report.width, report.height);
+    std::fprintf(file, "  \"present_mode\": \"%s\",\n", getPresentModeName(report.presentMode));
+    std::fprintf(file, "  \"seed\": %llu,\n", static_cast<unsigned long long>(report.config.seed));
+    std::fprintf(file, "  \"warmup_frames\": %u,\n", report.config.warmupFrames);
+    std::fprintf(file, "  \"scene_quads\": %u,\n", report.sceneQuadCount);
+    std::fprintf(file, "  \"duration_s\": %.3f,\n", report.durationSeconds);
+
+    const FrameTimeStats& frameTimes = report.frameTimes;
+    std::fprintf(file, "  \"frame_time_ms\": {\"frames\": %u, \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+        frameTimes.frameCount, frameTimes.meanMs, frameTimes.minMs, frameTimes.p50Ms, frameTimes.p95Ms, frameTimes.p99Ms, frameTimes.maxMs);
+
+    const FramePacerStats& pacer = report.pacer;
+    std::fprintf(file, "  \"cpu_ms\": {\"main\": %.4f, \"render\": %.4f},\n", pacer.mainCpuMs, pacer.renderCpuMs);
+    std::fprintf(file, "  \"latency_ms\": {\"value\": %.4f, \"source\": \"%s\"},\n", pacer.latencyMs, pacer.latencyFromPresentWait ? "present_wait" : "fence_estimate");
+
+    std::fputs("  \"gpu_passes_ms\": [", file);
+    for (size_t i = 0; i < report.gpuPasses.size(); i++) {
+        const VulkanGpuProfilerStats& pass = report.gpuPasses[i];
+        std::fputs(i == 0 ? "\n    {\"name\": " : ",\n    {\"name\": ", file);
+        writeJsonString(file, pass.name);
+        std::fprintf(file, ", \"samples\": %u, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f}",
+            pass.sampleCount, pass.averageMs, pass.p50Ms, pass.p95Ms, pass.p99Ms);
+    }
+    std::fputs(report.gpuPasses.empty() ? "],\n" : "\n  ],\n", file);
+
+    if (report.sceneBuildCounters.scopeCount > 0 || report.renderFrameCounters.scopeCount > 0) {
+        std::fputs("  \"cpu_counters\": {\n", file);
+        writePerfCounterTotals(file, "scene_build", report.sceneBuildCounters, "quad", report.sceneQuadCount);
+        std::fputs(",\n", file);
+        writePerfCounterTotals(file, "render_frame", report.renderFrameCounters, "frame", report.renderFrameCounters.scopeCount);
+        std::fputs("\n  },\n", file);
+    }
+
+    const MathBenchmarkStats& math = report.math;
+    std::fprintf(file, "  \"math\": {\"backend\": \"%s\", \"boxes\": %u, \"visible_fraction\": %.4f, \"cull_ns_per_box\": {\"simd\": %.4f, \"scalar\": %.4f}, \"cull_mismatches\": %llu, ",
+        math.backend != nullptr ? math.backend : getSimdMathBackendName(), math.boxCount, math.visibleFraction, math.cullNsPerBox, math.cullScalarNsPerBox,
+        static_cast<unsigned long long>(math.cullMismatches));
+    std::fprintf(file, "\"transform_ns_per_point\": {\"simd\": %.4f, \"scalar\": %.4f}, \"mat4_multiply_ns\": %.4f},\n",
+        math.transformNsPerPoint, math.transformScalarNsPerPoint, math.mat4MultiplyNs);
+
+    std::fprintf(file, "  \"memory\": {\n    \"peak_resident_bytes\": %llu,\n    \"heaps\": [", static_cast<unsigned long long>(report.peakResidentBytes));
+    for (size_t i = 0; i < report.memoryHeaps.size(); i++) {
+        const VulkanMemoryHeapStats& heap = report.memoryHeaps[i];
+        std::fprintf(file, "%s\n      {\"device_local\": %s, \"size\": %llu, \"budget\": %llu, \"usage\": %llu}",
+            i == 0 ? "" : ",",
+            heap.deviceLocal ? "true" : "false",
+            static_cast<unsigned long long>(heap.size),
+            static_cast<unsigned long long>(heap.budget),
+            static_cast<unsigned long long>(heap.usage));
+    }
+    std::fputs(report.memoryHeaps.empty() ? "]\n  }\n}\n" : "\n    ]\n  }\n}\n", file);
+
+    const bool written = (std::ferror(file) == 0);
+    std::fclose(file);
+    if (!written) {
+        LOG_ERROR("Failed to write benchmark output ", path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "vulkan_base/vulkan_base.h"
+#include "frame_pacer.h"
+#include "perf_counters.h"
+#include "simd_math.h"
+#include <cstdint>
+#include <vector>
+
+static constexpr uint32_t BENCHMARK_DEFAULT_FRAME_COUNT = 2000;
+// Frames rendered before measuring, so pipeline creation and static recording do not skew the results.
+static constexpr uint32_t BENCHMARK_WARMUP_FRAMES = 120;
+static constexpr uint64_t BENCHMARK_DEFAULT_SEED = 0x5EED5EED12345678ull;
+static constexpr const char* BENCHMARK_DEFAULT_OUTPUT_PATH = "benchmark.json";
+
+struct BenchmarkConfig {
+    bool enabled;
+    uint32_t frameCount;
+    uint32_t warmupFrames;
+    uint64_t seed;
+    const char* outputPath;
+};
+
+// xorshift64*. Tiny, fast and identical on every platform, unlike the <random> distributions.
+struct XorShiftRandom {
+    uint64_t state;
+};
+
+void seedRandom(XorShiftRandom* random, uint64_t seed);
+uint64_t nextRandom(XorShiftRandom* random);
+// Uniform in [0, 1).
+float nextRandomFloat(XorShiftRandom* random);
+
+// A fixed number of xorshift steps at once. The state update is linear over GF(2), so any number
+// of steps is a 64x64 bit matrix, stored as the images of the 64 unit vectors. Lets parallel
+// generators start where a serial one would be without drawing the numbers in between.
+struct XorShiftJump {
+    uint64_t columns[64];
+};
+
+void makeRandomJump(XorShiftJump* jump, uint64_t steps);
+void jumpRandom(XorShiftRandom* random, const XorShiftJump* jump);
+
+struct FrameTimeStats {
+    uint32_t frameCount;
+    double meanMs;
+    double minMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+FrameTimeStats computeFrameTimeStats(const std::vector<float>& frameTimesMs);
+
+// Flythrough frames whose frustums the math microbenchmarks cull the scene's quads against.
+static constexpr uint32_t BENCHMARK_MATH_FRUSTUM_COUNT = 64;
+// Timed passes over all frustums; the fastest one counts, which filters out preemption.
+static constexpr uint32_t BENCHMARK_MATH_PASSES = 5;
+static constexpr uint32_t BENCHMARK_MATH_MULTIPLY_COUNT = 64 * 1024;
+
+struct MathBenchmarkStats {
+    const char* backend;
+    uint32_t boxCount;
+    double visibleFraction;
+    double cullNsPerBox;
+    double cullScalarNsPerBox;
+    // Boxes on which cullAabbs() and cullAabbsScalar() disagree. Zero unless the compiler fused
+    // multiplies and adds differently in the two paths.
+    uint64_t cullMismatches;
+    double transformNsPerPoint;
+    double transformScalarNsPerPoint;
+    double mat4MultiplyNs;
+};
+
+// Times the SIMD batch routines against their scalar references on the given boxes, culled
+// against and transformed by each of the view projections.
+void runMathBenchmarks(const AabbSoa* boxes, const Mat4* viewProjections, uint32_t viewProjectionCount, MathBenchmarkStats* stats);
+
+struct BenchmarkReport {
+    const char* deviceName;
+    uint32_t width;
+    uint32_t height;
+    VkPresentModeKHR presentMode;
+    BenchmarkConfig config;
+    uint32_t sceneQuadCount;
+    double durationSeconds;
+    FrameTimeStats frameTimes;
+    FramePacerStats pacer;
+    std::vector<VulkanGpuProfilerStats> gpuPasses;
+    std::vector<VulkanMemoryHeapStats> memoryHeaps;
+    uint64_t peakResidentBytes;
+    // Hardware counters of the main thread building the scene and of the render thread rendering
+    // the measured frames. Omitted from the report when neither could be collected.
+    PerfCounterTotals sceneBuildCounters;
+    PerfCounterTotals renderFrameCounters;
+    MathBenchmarkStats math;
+};
+
+// Peak resident set size of the process in bytes, 0 where unknown.
+uint64_t getPeakResidentMemory();
+bool writeBenchmarkReport(const char* path, const BenchmarkReport& report);
@@ -0,0 +1,79 @@
+#include "binary_log.h"
+#include <cstring>
+#include <mutex>
+
+static std::mutex siteMutex;
+static uint32_t siteCount = 0;
+
+uint32_t registerLogSite(LogSite* site, const uint8_t* argTypes, uint32_t argCount) {
+    std::lock_guard<std::mutex> lock(siteMutex);
+    uint32_t id = site->id.load(std::memory_order_relaxed);
+    if (id != 0) {
+        return id;
+    }
+    // Ids wrap only in a binary with more call sites than LOG_MAX_SITES, which decodes badly but safely.
+    id = siteCount % (LOG_MAX_SITES - 1) + 1;
+    siteCount++;
+    site->argTypes = argTypes;
+    site->argCount = static_cast<uint16_t>(argCount);
+    site->id.store(id, std::memory_order_release);
+    return id;
+}
+
+bool decodeLogArgs(const uint8_t* argTypes, uint32_t argCount, const uint8_t* payload, size_t payloadSize, LogTextSink sink, void* userData) {
+    size_t offset = 0;
+    char text[LOG_MAX_NUMBER_SIZE];
+    for (uint32_t i = 0; i < argCount; i++) {
+        if (offset == payloadSize) {
+            return true;
+        }
+        const size_t remaining = payloadSize - offset;
+        switch (argTypes[i]) {
+        case LOG_ARG_CHAR:
+            sink(reinterpret_cast<const char*>(payload + offset), 1, userData);
+            offset += 1;
+            continue;
+        case LOG_ARG_STRING: {
+            uint32_t stringLength = 0;
+            if (remaining < sizeof(stringLength)) {
+                return false;
+            }
+            std::memcpy(&stringLength, payload + offset, sizeof(stringLength));
+            if (remaining - sizeof(stringLength) < stringLength) {
+                return false;
+            }
+            sink(reinterpret_cast<const char*>(payload + offset + sizeof(stringLength)), stringLength, userData);
+            offset += sizeof(stringLength) + stringLength;
+            continue;
+        }
+        case LOG_ARG_INT:
+        case LOG_ARG_UINT:
+        case LOG_ARG_DOUBLE:
+        case LOG_ARG_POINTER:
+            break;
+        default:
+            return false;
+        }
+
+        uint64_t bits = 0;
+        if (remaining < sizeof(bits)) {
+            return false;
+        }
+        std::memcpy(&bits, payload + offset, sizeof(bits));
+        offset += sizeof(bits);
+        char* end = text;
+        if (argTypes[i] == LOG_ARG_INT) {
+            end = formatLogSigned(text, static_cast<long long>(bits));
+        } else if (argTypes[i] == LOG_ARG_UINT) {
+            end = formatLogUnsigned(text, bits);
+        } else if (argTypes[i] == LOG_ARG_DOUBLE) {
+            double value = 0.0;
+            std::memcpy(&value, &bits, sizeof(value));
+            end = formatLogDouble(text, value);
+        } else {
+            end = formatLogPointer(text, bits);
+        }
+        sink(text, static_cast<size_t>(end - text), userData);
+    }
+    return offset == payloadSize;
+}
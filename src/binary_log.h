@@ -0,0 +1,35 @@
+#pragma once
+#include "logger.h"
+#include <cstddef>
+#include <cstdint>
+
+// Binary log files, written by setLogBinaryOutput() and turned into text by log_decoder. A file
+// starts with LOG_FILE_MAGIC, followed by entries. Integers are stored in host byte order.
+static constexpr char LOG_FILE_MAGIC[8] = {'H', 'V', 'L', 'O', 'G', '0', '0', '1'};
+static constexpr uint32_t LOG_MAX_SITES = 1 << 16;
+
+enum LogEntryKind : uint8_t {
+    // Describes a call site before its first record: argCount argument types, then the file name.
+    LOG_ENTRY_SITE = 1,
+    // A deferred message of siteId, followed by its payload.
+    LOG_ENTRY_RECORD,
+    // An already formatted message: the file name, a terminating zero, then the message.
+    LOG_ENTRY_TEXT
+};
+
+struct LogFileEntry {
+    // Including this header.
+    uint32_t size;
+    uint8_t kind;
+    uint8_t level;
+    uint16_t argCount;
+    uint32_t siteId;
+    uint32_t lineNumber;
+};
+static_assert(sizeof(LogFileEntry) == 16, "LogFileEntry is written as is");
+
+typedef void (*LogTextSink)(const char* text, size_t length, void* userData);
+
+// Formats the arguments of one deferred message the way variadicUnpack() would. A payload cut short
+// by LOG_MAX_PAYLOAD_SIZE ends early; returns false when the payload does not match the types.
+bool decodeLogArgs(const uint8_t* argTypes, uint32_t argCount, const uint8_t* payload, size_t payloadSize, LogTextSink sink, void* userData);
@@ -0,0 +1,25 @@
+#include "camera.h"
+#include <cmath>
+
+static constexpr float PI = 3.14159265358979f;
+
+void cameraViewProjection(const Camera* camera, float aspect, Mat4* out) {
+    Mat4 view;
+    Mat4 projection;
+    mat4LookAt(camera->position, camera->target, camera->up, &view);
+    mat4Perspective(camera->fovYRadians, aspect, camera->nearPlane, camera->farPlane, &projection);
+    mat4Multiply(&projection, &view, out);
+}
+
+void cameraFlythrough(Camera* camera, float t, float sceneExtent) {
+    const float angle = t * 2.0f * PI;
+    const float radius = sceneExtent * (0.55f + 0.25f * std::sin(angle * 3.0f));
+    const float height = sceneExtent * (0.35f + 0.15f * std::cos(angle * 2.0f));
+
+    camera->position = vec3(std::cos(angle) * radius, std::sin(angle) * radius, height);
+    camera->target = vec3(std::cos(angle * 2.0f) * sceneExtent * 0.2f, std::sin(angle * 2.0f) * sceneExtent * 0.2f, 0.0f);
+    camera->up = vec3(0.0f, 0.0f, 1.0f);
+    camera->fovYRadians = 60.0f * PI / 180.0f;
+    camera->nearPlane = 0.1f;
+    camera->farPlane = sceneExtent * 4.0f;
+}
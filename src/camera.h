@@ -0,0 +1,19 @@
+#pragma once
+#include "simd_math.h"
+#include <cstdint>
+
+struct Camera {
+    Vec3 position;
+    Vec3 target;
+    Vec3 up;
+    float fovYRadians;
+    float nearPlane;
+    float farPlane;
+};
+
+void cameraViewProjection(const Camera* camera, float aspect, Mat4* out);
+
+// Deterministic flythrough used by the benchmark: t in [0, 1] maps to one pass of the path.
+// The camera circles the origin of the z = 0 plane while its height and look-at point drift,
+// so every frame sees a different part of a scene of the given extent.
+void cameraFlythrough(Camera* camera, float t, float sceneExtent);
@@ -0,0 +1,117 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "frame_arena.h"
+#include "logger.h"
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+struct FrameArenaOverflow {
+    FrameArenaOverflow* next;
+    size_t alignment;
+};
+
+static thread_local FrameArena* threadFrameArena = nullptr;
+
+bool createFrameArena(FrameArena* arena, size_t capacity) {
+    *arena = {};
+    arena->base = new (std::nothrow) uint8_t[capacity];
+    if (arena->base == nullptr) {
+        LOG_ERROR("Failed to allocate frame arena of ", static_cast<unsigned long long>(capacity), " bytes.");
+        return false;
+    }
+    arena->capacity = capacity;
+    return true;
+}
+
+void destroyFrameArena(FrameArena* arena) {
+    resetFrameArena(arena);
+    delete[] arena->base;
+    *arena = {};
+}
+
+static void* allocateOverflow(FrameArena* arena, size_t size, size_t alignment) {
+    if (arena->overflow == nullptr) {
+        LOG_WARN("Frame arena of ", static_cast<unsigned long long>(arena->capacity), " bytes exhausted, falling back to the heap.");
+    }
+    // The header is padded to the alignment, so the allocation behind it stays aligned.
+    const size_t headerSize = std::max(sizeof(FrameArenaOverflow), alignment);
+    const size_t blockAlignment = std::max(alignof(FrameArenaOverflow), alignment);
+    uint8_t* block = static_cast<uint8_t*>(::operator new(headerSize + size, std::align_val_t(blockAlignment)));
+    FrameArenaOverflow* overflow = reinterpret_cast<FrameArenaOverflow*>(block);
+    overflow->next = arena->overflow;
+    overflow->alignment = blockAlignment;
+    arena->overflow = overflow;
+    arena->overflowBytes += size;
+    return block + headerSize;
+}
+
+void* frameArenaAllocate(FrameArena* arena, size_t size, size_t alignment) {
+    assert(arena != nullptr && "No frame arena; call beginFrameArena() on this thread first");
+    const uintptr_t address = reinterpret_cast<uintptr_t>(arena->base) + arena->head;
+    const size_t padding = static_cast<size_t>((alignment - (address & (alignment - 1))) & (alignment - 1));
+    if (arena->base == nullptr || padding + size > arena->capacity - arena->head) {
+        return allocateOverflow(arena, size, alignment);
+    }
+    arena->head += padding;
+    void* pointer = arena->base + arena->head;
+    arena->head += size;
+    arena->peak = std::max(arena->peak, arena->head);
+    return pointer;
+}
+
+void frameArenaFree(FrameArena* arena, void* pointer, size_t size) {
+    uint8_t* bytes = static_cast<uint8_t*>(pointer);
+    if (arena->base != nullptr && bytes >= arena->base && bytes + size == arena->base + arena->head) {
+        arena->head -= size;
+    }
+}
+
+void resetFrameArena(FrameArena* arena) {
+    arena->head = 0;
+    arena->peak = 0;
+    FrameArenaOverflow* overflow = arena->overflow;
+    while (overflow != nullptr) {
+        FrameArenaOverflow* next = overflow->next;
+        ::operator delete(overflow, std::align_val_t(overflow->alignment));
+        overflow = next;
+    }
+    arena->overflow = nullptr;
+    arena->overflowBytes = 0;
+}
+
+bool createFrameArenaRing(FrameArenaRing* ring, uint32_t slotCount, size_t capacity) {
+    *ring = {};
+    ring->slotCount = std::min(std::max(slotCount, 1u), FRAME_ARENA_MAX_SLOTS);
+    for (uint32_t i = 0; i < ring->slotCount; i++) {
+        if (!createFrameArena(&ring->arenas[i], capacity)) {
+            destroyFrameArenaRing(ring);
+            return false;
+        }
+    }
+    return true;
+}
+
+void destroyFrameArenaRing(FrameArenaRing* ring) {
+    for (uint32_t i = 0; i < ring->slotCount; i++) {
+        if (threadFrameArena == &ring->arenas[i]) {
+            threadFrameArena = nullptr;
+        }
+        destroyFrameArena(&ring->arenas[i]);
+    }
+    ring->slotCount = 0;
+}
+
+FrameArena* beginFrameArena(FrameArenaRing* ring, uint32_t slot) {
+    const FrameArena* previous = &ring->arenas[ring->slot];
+    ring->lastFrameBytes = previous->peak;
+    ring->lastFrameOverflowBytes = previous->overflowBytes;
+    ring->slot = slot % ring->slotCount;
+    FrameArena* arena = &ring->arenas[ring->slot];
+    resetFrameArena(arena);
+    threadFrameArena = arena;
+    return arena;
+}
+
+FrameArena* getThreadFrameArena() {
+    return threadFrameArena;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Arenas per thread, one for each frame in flight.
+static constexpr uint32_t FRAME_ARENA_MAX_SLOTS = 4;
+// Per frame and thread. The HUD's quads alone take 72 KiB.
+static constexpr size_t FRAME_ARENA_SIZE = 256 * 1024;
+
+struct FrameArenaOverflow;
+
+// Bump allocator for data that lives for one frame. Allocating is a pointer bump and nothing is
+// freed on its own; resetFrameArena() drops everything at once. When the block is exhausted,
+// allocations fall back to the heap until the next reset, which debug builds report as zero-alloc
+// violations. An arena belongs to one thread; others may read what it holds, but not allocate.
+struct FrameArena {
+    uint8_t* base;
+    size_t capacity;
+    size_t head;
+    // Highest head since the last reset; frees can move head back.
+    size_t peak;
+    // Heap blocks of allocations that did not fit, freed by the next reset.
+    FrameArenaOverflow* overflow;
+    size_t overflowBytes;
+};
+
+bool createFrameArena(FrameArena* arena, size_t capacity);
+void destroyFrameArena(FrameArena* arena);
+// arena must not be null and alignment must be a power of two. Never returns null.
+void* frameArenaAllocate(FrameArena* arena, size_t size, size_t alignment);
+// Gives the memory back only if it is the latest allocation, e.g. when a container allocated last
+// is cleared. A growing vector gets nothing back: it allocates the new buffer before freeing the
+// old one, so every growth step stays in the arena until the reset. Reserve up front instead.
+void frameArenaFree(FrameArena* arena, void* pointer, size_t size);
+void resetFrameArena(FrameArena* arena);
+
+// One thread's arenas, one per frame slot. An arena is reset when its slot comes around again,
+// so data allocated for frame N stays valid while frame N + 1 is built.
+struct FrameArenaRing {
+    FrameArena arenas[FRAME_ARENA_MAX_SLOTS];
+    uint32_t slotCount;
+    uint32_t slot;
+    // Peak use of the slot before the current one, for statistics.
+    size_t lastFrameBytes;
+    size_t lastFrameOverflowBytes;
+};
+
+// slotCount is clamped to FRAME_ARENA_MAX_SLOTS.
+bool createFrameArenaRing(FrameArenaRing* ring, uint32_t slotCount, size_t capacity);
+void destroyFrameArenaRing(FrameArenaRing* ring);
+// Owning thread only. Resets the arena of slot and makes it the calling thread's current arena.
+FrameArena* beginFrameArena(FrameArenaRing* ring, uint32_t slot);
+// The arena of the calling thread's latest beginFrameArena(), null before the first.
+FrameArena* getThreadFrameArena();
+
+template <typename T>
+T* frameArenaNewArray(FrameArena* arena, size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>, "Frame arenas never run destructors");
+    return static_cast<T*>(frameArenaAllocate(arena, count * sizeof(T), alignof(T)));
+}
+
+// STL allocator on top of a frame arena. Assignments take the source's arena along, so a container
+// can be pointed at the next frame's arena by assigning a fresh one to it. Without an arena, e.g.
+// default constructed on a thread that never called beginFrameArena(), it uses the heap.
+template <typename T>
+struct FrameArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    FrameArena* arena;
+
+    FrameArenaAllocator() noexcept : arena(getThreadFrameArena()) {}
+    explicit FrameArenaAllocator(FrameArena* frameArena) noexcept : arena(frameArena) {}
+    template <typename U>
+    FrameArenaAllocator(const FrameArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        if (arena == nullptr) {
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        return static_cast<T*>(frameArenaAllocate(arena, count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* pointer, size_t count) noexcept {
+        if (arena == nullptr) {
+            ::operator delete(pointer, std::align_val_t(alignof(T)));
+            return;
+        }
+        frameArenaFree(arena, pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const FrameArenaAllocator<U>& other) const noexcept { return arena == other.arena; }
+};
+
+// Has to be cleared or reassigned before its arena's slot is reset. Reserve the frame's worst case
+// first; see frameArenaFree() for why growing wastes arena space.
+template <typename T>
+using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
@@ -0,0 +1,110 @@
+#include "frame_pacer.h"
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_timer.h>
+
+static void updateAverage(std::atomic<uint64_t>* average, uint64_t sample) {
+    // 1/16 weight: smooth enough to ignore single spikes, fast enough to follow load changes.
+    const uint64_t current = average->load(std::memory_order_relaxed);
+    if (current == 0) {
+        average->store(sample, std::memory_order_relaxed);
+        return;
+    }
+    const int64_t delta = static_cast<int64_t>(sample) - static_cast<int64_t>(current);
+    average->store(static_cast<uint64_t>(static_cast<int64_t>(current) + delta / 16), std::memory_order_relaxed);
+}
+
+uint64_t framePacerNow() {
+    return SDL_GetTicksNS();
+}
+
+void preciseSleepUntil(uint64_t deadlineNs, uint64_t spinThresholdNs) {
+    uint64_t now = framePacerNow();
+    if (now + spinThresholdNs < deadlineNs) {
+        SDL_DelayNS(deadlineNs - now - spinThresholdNs);
+    }
+    while (framePacerNow() < deadlineNs) {
+        SDL_CPUPauseInstruction();
+    }
+}
+
+void initFramePacer(FramePacer* pacer, double targetFramesPerSecond) {
+    pacer->spinThresholdNs = FRAME_PACER_DEFAULT_SPIN_NS;
+    pacer->lastFrameStartNs = 0;
+    pacer->mainBeginNs = 0;
+    pacer->mainCpuNs.store(0, std::memory_order_relaxed);
+    pacer->renderCpuNs.store(0, std::memory_order_relaxed);
+    pacer->gpuNs.store(0, std::memory_order_relaxed);
+    pacer->latencyNs.store(0, std::memory_order_relaxed);
+    pacer->frameIntervalNs.store(0, std::memory_order_relaxed);
+    pacer->latencyFromPresentWait.store(false, std::memory_order_relaxed);
+    setFramePacerTarget(pacer, targetFramesPerSecond);
+}
+
+void setFramePacerTarget(FramePacer* pacer, double targetFramesPerSecond) {
+    pacer->targetFrameNs = targetFramesPerSecond > 0.0 ? static_cast<uint64_t>(1000000000.0 / targetFramesPerSecond) : 0;
+}
+
+uint64_t framePacerBeginFrame(FramePacer* pacer) {
+    // The slowest of main thread, render thread and GPU bounds the frame rate. Starting the next frame
+    // earlier than that only makes the sampled input older by the time it reaches the screen.
+    uint64_t criticalPathNs = pacer->mainCpuNs.load(std::memory_order_relaxed);
+    const uint64_t renderCpuNs = pacer->renderCpuNs.load(std::memory_order_relaxed);
+    const uint64_t gpuNs = pacer->gpuNs.load(std::memory_order_relaxed);
+    if (renderCpuNs > criticalPathNs) {
+        criticalPathNs = renderCpuNs;
+    }
+    if (gpuNs > criticalPathNs) {
+        criticalPathNs = gpuNs;
+    }
+    const uint64_t intervalNs = criticalPathNs > pacer->targetFrameNs ? criticalPathNs : pacer->targetFrameNs;
+
+    uint64_t now = framePacerNow();
+    if (pacer->lastFrameStartNs != 0) {
+        const uint64_t deadlineNs = pacer->lastFrameStartNs + intervalNs;
+        if (now < deadlineNs) {
+            preciseSleepUntil(deadlineNs, pacer->spinThresholdNs);
+            // Stay on the ideal grid instead of accumulating sleep overshoot.
+            now = deadlineNs;
+        }
+        updateAverage(&pacer->frameIntervalNs, now - pacer->lastFrameStartNs);
+    }
+
+    pacer->lastFrameStartNs = now;
+    pacer->mainBeginNs = framePacerNow();
+    return pacer->mainBeginNs;
+}
+
+void framePacerEndFrame(FramePacer* pacer) {
+    updateAverage(&pacer->mainCpuNs, framePacerNow() - pacer->mainBeginNs);
+}
+
+void framePacerReportRenderCpu(FramePacer* pacer, uint64_t cpuNs) {
+    updateAverage(&pacer->renderCpuNs, cpuNs);
+}
+
+void framePacerReportGpu(FramePacer* pacer, uint64_t gpuNs) {
+    updateAverage(&pacer->gpuNs, gpuNs);
+}
+
+void framePacerReportLatency(FramePacer* pacer, uint64_t latencyNs, bool fromPresentWait) {
+    updateAverage(&pacer->latencyNs, latencyNs);
+    pacer->latencyFromPresentWait.store(fromPresentWait, std::memory_order_relaxed);
+}
+
+FramePacerStats getFramePacerStats(const FramePacer* pacer) {
+    FramePacerStats stats = {};
+    stats.mainCpuMs = static_cast<double>(pacer->mainCpuNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.renderCpuMs = static_cast<double>(pacer->renderCpuNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.gpuMs = static_cast<double>(pacer->gpuNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.criticalPathMs = stats.mainCpuMs;
+    if (stats.renderCpuMs > stats.criticalPathMs) {
+        stats.criticalPathMs = stats.renderCpuMs;
+    }
+    if (stats.gpuMs > stats.criticalPathMs) {
+        stats.criticalPathMs = stats.gpuMs;
+    }
+    stats.frameIntervalMs = static_cast<double>(pacer->frameIntervalNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.latencyMs = static_cast<double>(pacer->latencyNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.latencyFromPresentWait = pacer->latencyFromPresentWait.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Sleeping shorter than this is left to spinning, since OS sleeps overshoot by about a scheduler tick.
+static constexpr uint64_t FRAME_PACER_DEFAULT_SPIN_NS = 1500000;
+
+struct FramePacerStats {
+    double mainCpuMs;
+    double renderCpuMs;
+    double gpuMs;
+    double criticalPathMs;
+    double frameIntervalMs;
+    double latencyMs;
+    bool latencyFromPresentWait;
+};
+
+// Paces the main thread so input is sampled as late as the critical path allows.
+// The main thread calls framePacerBeginFrame() right before polling input and framePacerEndFrame()
+// after handing its packet over. The render thread reports its CPU time, an estimate of the GPU time
+// and the measured input-to-present latency. All timings are exponential moving averages in ns.
+// Each atomic has exactly one writing thread, so relaxed loads and stores are enough.
+struct FramePacer {
+    uint64_t targetFrameNs;
+    uint64_t spinThresholdNs;
+    uint64_t lastFrameStartNs;
+    uint64_t mainBeginNs;
+
+    std::atomic<uint64_t> mainCpuNs;
+    std::atomic<uint64_t> renderCpuNs;
+    std::atomic<uint64_t> gpuNs;
+    std::atomic<uint64_t> latencyNs;
+    std::atomic<uint64_t> frameIntervalNs;
+    std::atomic<bool> latencyFromPresentWait;
+};
+
+uint64_t framePacerNow();
+void preciseSleepUntil(uint64_t deadlineNs, uint64_t spinThresholdNs);
+
+void initFramePacer(FramePacer* pacer, double targetFramesPerSecond);
+void setFramePacerTarget(FramePacer* pacer, double targetFramesPerSecond);
+uint64_t framePacerBeginFrame(FramePacer* pacer);
+void framePacerEndFrame(FramePacer* pacer);
+void framePacerReportRenderCpu(FramePacer* pacer, uint64_t cpuNs);
+void framePacerReportGpu(FramePacer* pacer, uint64_t gpuNs);
+void framePacerReportLatency(FramePacer* pacer, uint64_t latencyNs, bool fromPresentWait);
+FramePacerStats getFramePacerStats(const FramePacer* pacer);
@@ -0,0 +1,126 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "hitch_detector.h"
+#include "logger.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static void hitchWriterMain(HitchDetector* detector) {
+    PROFILE_THREAD_NAME("Hitch writer");
+    std::unique_lock<std::mutex> lock(detector->mutex);
+    for (;;) {
+        detector->wake.wait(lock, [detector] { return detector->capturePending || detector->quit; });
+        if (!detector->capturePending) {
+            return;
+        }
+
+        // Give the other threads time to record the hitch frame. Quitting cuts the wait short.
+        const uint64_t dueNs = detector->capture.triggeredNs + HITCH_CAPTURE_DELAY_NS;
+        const uint64_t nowNs = profilerNow();
+        if (nowNs < dueNs) {
+            detector->wake.wait_for(lock, std::chrono::nanoseconds(dueNs - nowNs), [detector] { return detector->quit; });
+        }
+
+        const HitchCapture capture = detector->capture;
+        lock.unlock();
+        ProfilerHighlight highlight = {capture.label, capture.frameBeginNs, capture.frameEndNs};
+        if (exportChromeTraceWindow(capture.path, capture.windowBeginNs, profilerNow(), &highlight)) {
+            LOG_WARN(capture.label, ", trace written to ", capture.path);
+        }
+        lock.lock();
+        detector->capturePending = false;
+    }
+}
+
+void startHitchDetector(HitchDetector* detector, double threshold, const char* directory) {
+    detector->enabled = threshold > 0.0;
+#ifdef PROFILING_DISABLE
+    // Without profiler zones a capture would hold nothing but the highlight.
+    detector->enabled = false;
+#endif
+    detector->threshold = threshold;
+    detector->directory = directory;
+    detector->head = 0;
+    detector->count = 0;
+    detector->lastFrameBeginNs = 0;
+    detector->lastCaptureNs = 0;
+    detector->captureCount = 0;
+    detector->capturePending = false;
+    detector->quit = false;
+    if (detector->enabled) {
+        detector->writer = std::thread(hitchWriterMain, detector);
+    }
+}
+
+void stopHitchDetector(HitchDetector* detector) {
+    if (!detector->writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(detector->mutex);
+        detector->quit = true;
+    }
+    detector->wake.notify_one();
+    detector->writer.join();
+}
+
+void hitchDetectorSkipFrame(HitchDetector* detector) {
+    detector->lastFrameBeginNs = 0;
+}
+
+bool hitchDetectorBeginFrame(HitchDetector* detector, uint64_t frameBeginNs, uint64_t frameNumber) {
+    if (!detector->enabled) {
+        return false;
+    }
+    const uint64_t previousBeginNs = detector->lastFrameBeginNs;
+    detector->lastFrameBeginNs = frameBeginNs;
+    if (previousBeginNs == 0) {
+        return false;
+    }
+    const float frameMs = static_cast<float>(static_cast<double>(frameBeginNs - previousBeginNs) / 1e6);
+    PROFILE_COUNTER("Frame time us", (frameBeginNs - previousBeginNs) / 1000);
+
+    // The median of the frames before this one, so a hitch cannot raise its own bar.
+    bool hitch = false;
+    float medianMs = 0.0f;
+    if (detector->count >= HITCH_MIN_FRAMES) {
+        std::copy(detector->frameMs, detector->frameMs + detector->count, detector->medianScratch);
+        float* middle = detector->medianScratch + detector->count / 2;
+        std::nth_element(detector->medianScratch, middle, detector->medianScratch + detector->count);
+        medianMs = *middle;
+        hitch = frameMs > medianMs * detector->threshold && frameMs - medianMs > HITCH_MIN_EXCESS_MS;
+    }
+
+    const uint32_t oldest = (detector->count < HITCH_WINDOW_FRAMES) ? 0 : detector->head;
+    const uint64_t windowBeginNs = (detector->count == 0) ? previousBeginNs : detector->frameBeginNs[oldest];
+    detector->frameBeginNs[detector->head] = previousBeginNs;
+    detector->frameMs[detector->head] = frameMs;
+    detector->head = (detector->head + 1) % HITCH_WINDOW_FRAMES;
+    if (detector->count < HITCH_WINDOW_FRAMES) {
+        detector->count++;
+    }
+
+    if (!hitch || (detector->lastCaptureNs != 0 && frameBeginNs - detector->lastCaptureNs < HITCH_COOLDOWN_NS)) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(detector->mutex, std::try_to_lock);
+    // The writer is still busy with the previous capture; never block the main thread on it.
+    if (!lock.owns_lock() || detector->capturePending) {
+        return false;
+    }
+    HitchCapture& capture = detector->capture;
+    capture.windowBeginNs = windowBeginNs;
+    capture.frameBeginNs = previousBeginNs;
+    capture.frameEndNs = frameBeginNs;
+    capture.triggeredNs = frameBeginNs;
+    std::snprintf(capture.path, sizeof(capture.path), "%s/hitch_%u_frame_%llu.json", detector->directory, detector->captureCount, static_cast<unsigned long long>(frameNumber));
+    std::snprintf(capture.label, sizeof(capture.label), "Hitch: frame %llu took %.2f ms, median %.2f ms", static_cast<unsigned long long>(frameNumber), frameMs, medianMs);
+    detector->capturePending = true;
+    detector->captureCount++;
+    detector->lastCaptureNs = frameBeginNs;
+    lock.unlock();
+    detector->wake.notify_one();
+    return true;
+}
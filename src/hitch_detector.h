@@ -0,0 +1,68 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Frames kept for the running median and dumped around a hitch.
+static constexpr uint32_t HITCH_WINDOW_FRAMES = 300;
+// A frame is a hitch when it takes this many times the running median.
+static constexpr double HITCH_DEFAULT_THRESHOLD = 2.5;
+// Frames needed before the median is trusted, so startup never counts as a hitch.
+static constexpr uint32_t HITCH_MIN_FRAMES = 60;
+// Frames only this much above the median are noise, however large the ratio.
+static constexpr double HITCH_MIN_EXCESS_MS = 4.0;
+// No new capture until this long after the previous one, so one bad stretch yields one file.
+static constexpr uint64_t HITCH_COOLDOWN_NS = 5000000000ull;
+// The dump is written this long after the hitch, so the render thread's and the GPU profiler's
+// events of the hitch frame are in the profiler rings by then.
+static constexpr uint64_t HITCH_CAPTURE_DELAY_NS = 250000000ull;
+static constexpr uint32_t HITCH_PATH_SIZE = 512;
+static constexpr uint32_t HITCH_LABEL_SIZE = 128;
+
+// A hitch waiting for the writer thread.
+struct HitchCapture {
+    uint64_t windowBeginNs;
+    uint64_t frameBeginNs;
+    uint64_t frameEndNs;
+    uint64_t triggeredNs;
+    char path[HITCH_PATH_SIZE];
+    char label[HITCH_LABEL_SIZE];
+};
+
+// Watches frame intervals on the main thread. The profiler rings already hold the recent zones and
+// counters of every thread, so the detector only remembers frame boundaries. A hitch hands the
+// window to a writer thread, which exports it with exportChromeTraceWindow() and highlights the
+// hitch frame; the main thread never touches the disk.
+struct HitchDetector {
+    bool enabled;
+    double threshold;
+    const char* directory;
+    uint64_t frameBeginNs[HITCH_WINDOW_FRAMES];
+    float frameMs[HITCH_WINDOW_FRAMES];
+    float medianScratch[HITCH_WINDOW_FRAMES];
+    uint32_t head;
+    uint32_t count;
+    uint64_t lastFrameBeginNs;
+    uint64_t lastCaptureNs;
+    uint32_t captureCount;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // Guarded by mutex.
+    bool capturePending;
+    bool quit;
+    HitchCapture capture;
+};
+
+// threshold <= 0 disables the detector. Files go to directory as hitch_<n>_frame_<frame>.json.
+void startHitchDetector(HitchDetector* detector, double threshold, const char* directory);
+// Writes a capture that is still pending, then joins the writer.
+void stopHitchDetector(HitchDetector* detector);
+// Main thread, once per frame with profilerNow() at the frame's begin, so frames line up with the
+// profiler's events. frameNumber names the frame that just ended. Returns true when that frame
+// was a hitch and a capture was queued.
+bool hitchDetectorBeginFrame(HitchDetector* detector, uint64_t frameBeginNs, uint64_t frameNumber);
+// Forgets the open frame, for pauses that are not hitches such as a minimized window.
+void hitchDetectorSkipFrame(HitchDetector* detector);
@@ -0,0 +1,295 @@
+#include "hud.h"
+#include "hud_font.h"
+#include <SDL3/SDL.h>
+#include <cstring>
+
+// Printable ASCII from ' ' to '~' in reading order, followed by one opaque cell for rectangles.
+static constexpr uint32_t ATLAS_FIRST_CHAR = HUD_FONT_FIRST_CHAR;
+static constexpr uint32_t ATLAS_CHAR_COUNT = HUD_FONT_CHAR_COUNT;
+static constexpr uint32_t ATLAS_SOLID_CELL = ATLAS_CHAR_COUNT;
+static constexpr uint32_t ATLAS_COLUMNS = 16;
+static constexpr uint32_t ATLAS_ROWS = 6;
+static constexpr uint32_t ATLAS_WIDTH = ATLAS_COLUMNS * HUD_GLYPH_SIZE;
+static constexpr uint32_t ATLAS_HEIGHT = ATLAS_ROWS * HUD_GLYPH_SIZE;
+
+static_assert(ATLAS_SOLID_CELL < ATLAS_COLUMNS * ATLAS_ROWS, "HUD atlas too small");
+
+// White glyphs on transparent texels, so the quad color tints them.
+static void bakeFontAtlas(uint8_t* pixels) {
+    std::memset(pixels, 0, ATLAS_WIDTH * ATLAS_HEIGHT * 4);
+    for (uint32_t cell = 0; cell <= ATLAS_SOLID_CELL; cell++) {
+        const uint32_t cellX = (cell % ATLAS_COLUMNS) * HUD_GLYPH_SIZE;
+        const uint32_t cellY = (cell / ATLAS_COLUMNS) * HUD_GLYPH_SIZE;
+        for (uint32_t y = 0; y < HUD_GLYPH_SIZE; y++) {
+            uint8_t rowBits = 0xFF;
+            if (cell != ATLAS_SOLID_CELL) {
+                rowBits = HUD_FONT_GLYPHS[cell * HUD_GLYPH_SIZE + y];
+            }
+            for (uint32_t x = 0; x < HUD_GLYPH_SIZE; x++) {
+                // Bit 0 is the leftmost pixel.
+                if ((rowBits & (1u << x)) == 0) {
+                    continue;
+                }
+                uint8_t* pixel = pixels + ((cellY + y) * ATLAS_WIDTH + cellX + x) * 4;
+                pixel[0] = 255;
+                pixel[1] = 255;
+                pixel[2] = 255;
+                pixel[3] = 255;
+            }
+        }
+    }
+}
+
+bool createHud(VulkanContext* context, Hud* hud) {
+    *hud = {};
+
+    std::vector<uint8_t> atlasPixels(ATLAS_WIDTH * ATLAS_HEIGHT * 4);
+    bakeFontAtlas(atlasPixels.data());
+    if (!uploadToDeviceLocalImageRGBA8(context, atlasPixels.data(), ATLAS_WIDTH, ATLAS_HEIGHT, &hud->atlasImage, &hud->atlasMemory, &hud->atlasImageView)) {
+        LOG_ERROR("Failed to upload HUD font atlas.");
+        return false;
+    }
+    VK_NAME(context, VK_OBJECT_TYPE_IMAGE, hud->atlasImage, "HUD font atlas");
+    VK_NAME(context, VK_OBJECT_TYPE_IMAGE_VIEW, hud->atlasImageView, "HUD font atlas");
+
+    // Glyphs are drawn at integer scales on pixel boundaries, so nearest sampling never blurs them.
+    VkSamplerCreateInfo samplerCreateInfo = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+    samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (VK(vkCreateSampler(context->device, &samplerCreateInfo, context->allocator, &hud->sampler)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create HUD sampler.");
+        destroyHud(context, hud);
+        return false;
+    }
+
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutCreateInfo.bindingCount = 1;
+    layoutCreateInfo.pBindings = &binding;
+    if (VK(vkCreateDescriptorSetLayout(context->device, &layoutCreateInfo, context->allocator, &hud->descriptorSetLayout)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create HUD descriptor set layout.");
+        destroyHud(context, hud);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+    VkDescriptorPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolCreateInfo.maxSets = 1;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &poolSize;
+    if (VK(vkCreateDescriptorPool(context->device, &poolCreateInfo, context->allocator, &hud->descriptorPool)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create HUD descriptor pool.");
+        destroyHud(context, hud);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo setAllocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    setAllocateInfo.descriptorPool = hud->descriptorPool;
+    setAllocateInfo.descriptorSetCount = 1;
+    setAllocateInfo.pSetLayouts = &hud->descriptorSetLayout;
+    if (VK(vkAllocateDescriptorSets(context->device, &setAllocateInfo, &hud->descriptorSet)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to allocate HUD descriptor set.");
+        destroyHud(context, hud);
+        return false;
+    }
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.sampler = hud->sampler;
+    imageInfo.imageView = hud->atlasImageView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = hud->descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(context->device, 1, &write, 0, nullptr);
+    return true;
+}
+
+void destroyHud(VulkanContext* context, Hud* hud) {
+    destroyHudSwapchainResources(context, hud);
+    if (hud->descriptorPool != VK_NULL_HANDLE) {
+        VK(vkDestroyDescriptorPool(context->device, hud->descriptorPool, context->allocator));
+        hud->descriptorPool = VK_NULL_HANDLE;
+        hud->descriptorSet = VK_NULL_HANDLE;
+    }
+    if (hud->descriptorSetLayout != VK_NULL_HANDLE) {
+        VK(vkDestroyDescriptorSetLayout(context->device, hud->descriptorSetLayout, context->allocator));
+        hud->descriptorSetLayout = VK_NULL_HANDLE;
+    }
+    if (hud->sampler != VK_NULL_HANDLE) {
+        VK(vkDestroySampler(context->device, hud->sampler, context->allocator));
+        hud->sampler = VK_NULL_HANDLE;
+    }
+    if (hud->atlasImageView != VK_NULL_HANDLE) {
+        destroyImageView(context, &hud->atlasImageView);
+    }
+    if (hud->atlasImage != VK_NULL_HANDLE) {
+        destroyImage(context, &hud->atlasImage, &hud->atlasMemory);
+    }
+}
+
+bool createHudSwapchainResources(VulkanContext* context, Hud* hud, VkFormat format, uint32_t width, uint32_t height) {
+    hud->renderPass = createRenderPass(context, format, VK_ATTACHMENT_LOAD_OP_LOAD);
+    if (hud->renderPass == VK_NULL_HANDLE) {
+        LOG_ERROR("Failed to create HUD render pass.");
+        return false;
+    }
+    VK_NAME(context, VK_OBJECT_TYPE_RENDER_PASS, hud->renderPass, "HUD render pass");
+
+    hud->pipeline = createOverlayPipeline(
+        context,
+        "../shaders/hud_vert.spv",
+        "../shaders/hud_frag.spv",
+        hud->renderPass,
+        width,
+        height,
+        hud->descriptorSetLayout
+    );
+    if (hud->pipeline.pipeline == VK_NULL_HANDLE || hud->pipeline.pipelineLayout == VK_NULL_HANDLE) {
+        LOG_ERROR("Failed to create HUD pipeline.");
+        destroyHudSwapchainResources(context, hud);
+        return false;
+    }
+    return true;
+}
+
+void destroyHudSwapchainResources(VulkanContext* context, Hud* hud) {
+    if (hud->pipeline.pipeline != VK_NULL_HANDLE || hud->pipeline.pipelineLayout != VK_NULL_HANDLE) {
+        destroyPipeline(context, &hud->pipeline);
+        hud->pipeline = {};
+    }
+    if (hud->renderPass != VK_NULL_HANDLE) {
+        destroyRenderPass(context, hud->renderPass);
+        hud->renderPass = VK_NULL_HANDLE;
+    }
+}
+
+void hudBeginFrame(Hud* hud, FrameArena* arena, uint32_t width, uint32_t height) {
+    hud->quads = FrameVector<VulkanOverlayQuad>(FrameArenaAllocator<VulkanOverlayQuad>(arena));
+    hud->quads.reserve(HUD_MAX_QUADS);
+    hud->pixelToNdcX = 2.0f / static_cast<float>(width);
+    hud->pixelToNdcY = 2.0f / static_cast<float>(height);
+    hud->quadBuffer = VK_NULL_HANDLE;
+    hud->quadOffset = 0;
+    hud->quadCount = 0;
+}
+
+static void pushQuad(Hud* hud, float x, float y, float width, float height, uint32_t cell, uint32_t color) {
+    if (hud->quads.size() >= HUD_MAX_QUADS) {
+        return;
+    }
+    const float cellU = static_cast<float>(HUD_GLYPH_SIZE) / static_cast<float>(ATLAS_WIDTH);
+    const float cellV = static_cast<float>(HUD_GLYPH_SIZE) / static_cast<float>(ATLAS_HEIGHT);
+    const float u = static_cast<float>(cell % ATLAS_COLUMNS) * cellU;
+    const float v = static_cast<float>(cell / ATLAS_COLUMNS) * cellV;
+
+    VulkanOverlayQuad quad;
+    quad.rect[0] = x * hud->pixelToNdcX - 1.0f;
+    quad.rect[1] = y * hud->pixelToNdcY - 1.0f;
+    quad.rect[2] = (x + width) * hud->pixelToNdcX - 1.0f;
+    quad.rect[3] = (y + height) * hud->pixelToNdcY - 1.0f;
+    quad.uvRect[0] = u;
+    quad.uvRect[1] = v;
+    quad.uvRect[2] = u + cellU;
+    quad.uvRect[3] = v + cellV;
+    quad.color = color;
+    hud->quads.push_back(quad);
+}
+
+void hudRect(Hud* hud, float x, float y, float width, float height, uint32_t color) {
+    pushQuad(hud, x, y, width, height, ATLAS_SOLID_CELL, color);
+}
+
+float hudText(Hud* hud, float x, float y, const char* text, uint32_t color) {
+    const float advance = static_cast<float>(HUD_GLYPH_SIZE * HUD_GLYPH_SCALE);
+    for (const char* c = text; *c != '\0'; c++) {
+        const uint32_t character = static_cast<uint8_t>(*c);
+        if (character > ATLAS_FIRST_CHAR && character < ATLAS_FIRST_CHAR + ATLAS_CHAR_COUNT) {
+            pushQuad(hud, x, y, advance, advance, character - ATLAS_FIRST_CHAR, color);
+        }
+        x += advance;
+    }
+    return x;
+}
+
+void hudPushFrameTime(Hud* hud, float frameMs) {
+    hud->frameTimesMs[hud->frameTimeHead] = frameMs;
+    hud->frameTimeHead = (hud->frameTimeHead + 1) % HUD_GRAPH_FRAMES;
+}
+
+void hudFrameTimeGraph(Hud* hud, float x, float y, float width, float height, float targetMs) {
+    float scaleMs = targetMs * 2.0f;
+    for (uint32_t i = 0; i < HUD_GRAPH_FRAMES; i++) {
+        if (hud->frameTimesMs[i] > scaleMs) {
+            scaleMs = hud->frameTimesMs[i];
+        }
+    }
+
+    hudRect(hud, x, y, width, height, hudColor(0, 0, 0, 160));
+    const float barWidth = width / static_cast<float>(HUD_GRAPH_FRAMES);
+    for (uint32_t i = 0; i < HUD_GRAPH_FRAMES; i++) {
+        const float frameMs = hud->frameTimesMs[(hud->frameTimeHead + i) % HUD_GRAPH_FRAMES];
+        if (frameMs <= 0.0f) {
+            continue;
+        }
+        const float barHeight = height * frameMs / scaleMs;
+        const uint32_t color = (frameMs > targetMs) ? hudColor(230, 70, 50, 230) : hudColor(80, 210, 90, 230);
+        hudRect(hud, x + barWidth * static_cast<float>(i), y + height - barHeight, barWidth, barHeight, color);
+    }
+    const float targetY = y + height - height * targetMs / scaleMs;
+    hudRect(hud, x, targetY, width, 1.0f, hudColor(255, 255, 255, 140));
+}
+
+bool hudEndFrame(Hud* hud, VulkanFrameRing* ring) {
+    bool ok = true;
+    if (!hud->quads.empty()) {
+        const VkDeviceSize size = sizeof(VulkanOverlayQuad) * hud->quads.size();
+        VulkanFrameRingAllocation allocation = {};
+        ok = allocateFrameRing(ring, size, 0, &allocation);
+        if (ok) {
+            std::memcpy(allocation.data, hud->quads.data(), static_cast<size_t>(size));
+            hud->quadBuffer = allocation.buffer;
+            hud->quadOffset = allocation.offset;
+            hud->quadCount = static_cast<uint32_t>(hud->quads.size());
+        }
+    }
+    // The quads were the latest allocation, so the rest of the frame gets their arena space back.
+    // Between frames the HUD holds nothing of any arena.
+    hud->quads = FrameVector<VulkanOverlayQuad>(FrameArenaAllocator<VulkanOverlayQuad>(nullptr));
+    return ok;
+}
+
+void recordHud(Hud* hud, VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, uint32_t width, uint32_t height) {
+    if (hud->quadCount == 0) {
+        return;
+    }
+
+    VkRenderPassBeginInfo beginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+    beginInfo.renderPass = hud->renderPass;
+    beginInfo.framebuffer = framebuffer;
+    beginInfo.renderArea = {{0, 0}, {width, height}};
+    vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, hud->pipeline.pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, hud->pipeline.pipelineLayout, 0, 1, &hud->descriptorSet, 0, nullptr);
+
+    VkViewport viewport = {0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    VkRect2D scissor = {{0, 0}, {width, height}};
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &hud->quadBuffer, &hud->quadOffset);
+    vkCmdDraw(commandBuffer, 6, hud->quadCount, 0, 0);
+
+    vkCmdEndRenderPass(commandBuffer);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "vulkan_base/vulkan_base.h"
+#include "frame_arena.h"
+#include <cstdint>
+#include <vector>
+
+// Quads per frame. At 36 bytes each the worst case stays well inside a frame ring segment.
+static constexpr uint32_t HUD_MAX_QUADS = 2048;
+// Frames shown by the frame time graph.
+static constexpr uint32_t HUD_GRAPH_FRAMES = 120;
+// The atlas holds 8x8 glyphs; an integer scale keeps nearest sampling crisp.
+static constexpr uint32_t HUD_GLYPH_SIZE = 8;
+static constexpr uint32_t HUD_GLYPH_SCALE = 2;
+static constexpr float HUD_LINE_HEIGHT = static_cast<float>(HUD_GLYPH_SIZE * HUD_GLYPH_SCALE + 2);
+
+// Screen-space performance overlay drawn with a single instanced draw. Text comes from an 8x8
+// bitmap font baked into an atlas at startup, and rectangles sample an opaque atlas cell, so
+// everything shares one pipeline and one descriptor set. Quads are collected on the CPU between
+// hudBeginFrame() and hudEndFrame(), which copies them into the frame ring in one go. They live in
+// the frame arena passed to hudBeginFrame().
+struct Hud {
+    VkImage atlasImage;
+    VkDeviceMemory atlasMemory;
+    VkImageView atlasImageView;
+    VkSampler sampler;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    // Swapchain dependent, see createHudSwapchainResources().
+    VkRenderPass renderPass;
+    VulkanPipeline pipeline;
+
+    FrameVector<VulkanOverlayQuad> quads;
+    float pixelToNdcX;
+    float pixelToNdcY;
+    // Where hudEndFrame() put this frame's quads.
+    VkBuffer quadBuffer;
+    VkDeviceSize quadOffset;
+    uint32_t quadCount;
+
+    float frameTimesMs[HUD_GRAPH_FRAMES];
+    uint32_t frameTimeHead;
+};
+
+bool createHud(VulkanContext* context, Hud* hud);
+void destroyHud(VulkanContext* context, Hud* hud);
+// The render pass loads the attachment, so it is compatible with the scene's framebuffers.
+bool createHudSwapchainResources(VulkanContext* context, Hud* hud, VkFormat format, uint32_t width, uint32_t height);
+void destroyHudSwapchainResources(VulkanContext* context, Hud* hud);
+
+inline uint32_t hudColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    return static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) | (static_cast<uint32_t>(b) << 16) | (static_cast<uint32_t>(a) << 24);
+}
+
+// Coordinates are in pixels from the top left corner of a width x height target.
+void hudBeginFrame(Hud* hud, FrameArena* arena, uint32_t width, uint32_t height);
+void hudRect(Hud* hud, float x, float y, float width, float height, uint32_t color);
+// Returns the x after the last character. Characters outside printable ASCII are skipped.
+float hudText(Hud* hud, float x, float y, const char* text, uint32_t color);
+void hudPushFrameTime(Hud* hud, float frameMs);
+// Bars of the recorded frame times, oldest on the left. Bars above targetMs are highlighted.
+void hudFrameTimeGraph(Hud* hud, float x, float y, float width, float height, float targetMs);
+// Quads that do not fit into HUD_MAX_QUADS were already dropped; this fails only when the ring is full.
+bool hudEndFrame(Hud* hud, VulkanFrameRing* ring);
+// Records nothing when the frame has no quads.
+void recordHud(Hud* hud, VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, uint32_t width, uint32_t height);
@@ -0,0 +1,351 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "job_system.h"
+#include "logger.h"
+#include "profiler.h"
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static constexpr uint32_t JOB_NO_THREAD = UINT32_MAX;
+static constexpr int64_t JOB_DEQUE_MASK = JOB_DEQUE_CAPACITY - 1;
+static_assert((JOB_DEQUE_CAPACITY & (JOB_DEQUE_CAPACITY - 1)) == 0, "JOB_DEQUE_CAPACITY must be a power of two");
+
+// Index of the calling thread in its job system, JOB_NO_THREAD for threads outside of it.
+static thread_local uint32_t jobThreadIndex = JOB_NO_THREAD;
+// Victim selection only has to spread thieves out, so a per-thread xorshift is plenty.
+static thread_local uint32_t jobStealRandom = 0;
+// Hands every thread that steals a distinct seed, including threads outside of any job system.
+static std::atomic<uint32_t> jobStealSeedCount{0};
+
+// Owner only. Fails when the deque is full.
+static bool pushJob(JobDeque* deque, Job* job) {
+    const int64_t bottom = deque->bottom.load(std::memory_order_relaxed);
+    const int64_t top = deque->top.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<int64_t>(JOB_DEQUE_CAPACITY)) {
+        return false;
+    }
+    deque->jobs[bottom & JOB_DEQUE_MASK].store(job, std::memory_order_relaxed);
+    deque->bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+// Owner only. The bottom is taken back before top is read, so a thief racing for the last job
+// either sees it gone or wins the CAS on top.
+static Job* popJob(JobDeque* deque) {
+    const int64_t bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = deque->top.load(std::memory_order_relaxed);
+    if (top > bottom) {
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = deque->jobs[bottom & JOB_DEQUE_MASK].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        if (!deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+// Any thread. Returns nullptr when the deque is empty or another thread took the job first.
+static Job* stealJob(JobDeque* deque) {
+    int64_t top = deque->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = deque->bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return nullptr;
+    }
+    Job* job = deque->jobs[top & JOB_DEQUE_MASK].load(std::memory_order_relaxed);
+    if (!deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+static Job* takeInjectedJob(JobSystem* system, uint32_t priority) {
+    if (system->injectedTotal.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(system->injectionMutex);
+    if (system->injectedCount[priority] == 0) {
+        return nullptr;
+    }
+    Job* job = system->injected[priority][system->injectedHead[priority]];
+    system->injectedHead[priority] = (system->injectedHead[priority] + 1) % JOB_DEQUE_CAPACITY;
+    system->injectedCount[priority]--;
+    system->injectedTotal.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+// Wakes up to count sleepers. Idle workers and counter waiters both run jobs, so any sleeper can
+// take new work; waking more than there are jobs would only have the rest scan every deque
+// JOB_IDLE_SPINS times and fall asleep again.
+static void wakeSleepingThreads(JobSystem* system, uint32_t count) {
+    // Pairs with the fence in sleepUntilSignalled(): either the sleeper sees the new work, or
+    // this sees the sleeper.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint32_t sleeping = system->sleepingThreads.load(std::memory_order_relaxed);
+    if (sleeping == 0) {
+        return;
+    }
+    // The bump alone stops sleepers that have not reached wait() yet.
+    system->wakeSignal.fetch_add(1, std::memory_order_release);
+    if (count >= sleeping) {
+        system->wakeSignal.notify_all();
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        system->wakeSignal.notify_one();
+    }
+}
+
+static Job* findJob(JobSystem* system, uint32_t self) {
+    const uint32_t threadCount = system->workerCount + 1;
+    for (uint32_t priority = 0; priority < JOB_PRIORITY_COUNT; priority++) {
+        if (self != JOB_NO_THREAD) {
+            if (Job* job = popJob(&system->workers[self]->deques[priority])) {
+                return job;
+            }
+        }
+        if (Job* job = takeInjectedJob(system, priority)) {
+            return job;
+        }
+        // The multiplier is odd, so a nonzero count never gives the zero state xorshift is stuck in.
+        uint32_t random = jobStealRandom != 0 ? jobStealRandom : (jobStealSeedCount.fetch_add(1, std::memory_order_relaxed) + 1) * 0x9E3779B9u;
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        jobStealRandom = random;
+        const uint32_t first = random % threadCount;
+        for (uint32_t i = 0; i < threadCount; i++) {
+            const uint32_t victim = (first + i) % threadCount;
+            if (victim == self) {
+                continue;
+            }
+            if (Job* job = stealJob(&system->workers[victim]->deques[priority])) {
+                return job;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void finishJobCounter(JobSystem* system, JobCounter* counter) {
+    // Once pending reaches zero the owner may free the counter, so it is read before.
+    Job* continuation = counter->continuation;
+    if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (continuation != nullptr) {
+            submitJobs(system, continuation, 1, JOB_PRIORITY_NORMAL, nullptr);
+        }
+        // Whoever waits on the counter may be any of the sleepers.
+        wakeSleepingThreads(system, UINT32_MAX);
+    }
+}
+
+static void runJob(JobSystem* system, Job* job) {
+    // A coroutine resumed by the job may free the job's memory before the function returns.
+    JobCounter* counter = job->counter;
+    {
+        PROFILE_SCOPE(job->name);
+        job->function(job->data);
+    }
+    if (counter != nullptr) {
+        finishJobCounter(system, counter);
+    }
+}
+
+// Sleeps until wakeSignal changes, unless done() turns true or work shows up in the meantime.
+template <typename Done>
+static void sleepUntilSignalled(JobSystem* system, uint32_t self, Done done, Job** job) {
+    const uint32_t signal = system->wakeSignal.load(std::memory_order_acquire);
+    system->sleepingThreads.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!done()) {
+        *job = findJob(system, self);
+        if (*job == nullptr) {
+            system->wakeSignal.wait(signal, std::memory_order_acquire);
+        }
+    }
+    system->sleepingThreads.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static void pinThreadToCore(std::thread* thread, uint32_t core) {
+#if defined(_WIN32)
+    if (SetThreadAffinityMask(static_cast<HANDLE>(thread->native_handle()), 1ull << (core % 64)) == 0) {
+        LOG_WARN("Failed to pin job worker to core ", core);
+    }
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    if (pthread_setaffinity_np(thread->native_handle(), sizeof(cpus), &cpus) != 0) {
+        LOG_WARN("Failed to pin job worker to core ", core);
+    }
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+static void jobWorkerMain(JobSystem* system, uint32_t self) {
+    PROFILE_THREAD_NAME(system->workers[self]->name);
+    jobThreadIndex = self;
+    uint32_t idleSpins = 0;
+    while (!system->quit.load(std::memory_order_acquire)) {
+        Job* job = findJob(system, self);
+        if (job == nullptr && ++idleSpins >= JOB_IDLE_SPINS) {
+            sleepUntilSignalled(system, self, [system] { return system->quit.load(std::memory_order_acquire); }, &job);
+        }
+        if (job == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        idleSpins = 0;
+        runJob(system, job);
+    }
+}
+
+uint32_t getDefaultJobWorkerCount() {
+    const uint32_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+bool startJobSystem(JobSystem* system, uint32_t workerCount, bool pinThreads) {
+    system->workerCount = workerCount < JOB_MAX_WORKERS ? workerCount : JOB_MAX_WORKERS;
+    for (uint32_t priority = 0; priority < JOB_PRIORITY_COUNT; priority++) {
+        system->injectedHead[priority] = 0;
+        system->injectedCount[priority] = 0;
+    }
+    system->injectedTotal.store(0, std::memory_order_relaxed);
+    system->wakeSignal.store(0, std::memory_order_relaxed);
+    system->sleepingThreads.store(0, std::memory_order_relaxed);
+    system->quit.store(false, std::memory_order_relaxed);
+    for (uint32_t i = 0; i <= system->workerCount; i++) {
+        JobWorker* worker = new JobWorker();
+        for (JobDeque& deque : worker->deques) {
+            deque.top.store(0, std::memory_order_relaxed);
+            deque.bottom.store(0, std::memory_order_relaxed);
+        }
+        std::snprintf(worker->name, sizeof(worker->name), "Job worker %u", i);
+        system->workers[i] = worker;
+    }
+
+    jobThreadIndex = 0;
+    for (uint32_t i = 1; i <= system->workerCount; i++) {
+        system->workers[i]->thread = std::thread(jobWorkerMain, system, i);
+        if (pinThreads) {
+            pinThreadToCore(&system->workers[i]->thread, i);
+        }
+    }
+    LOG_INFO("Job system: ", system->workerCount, " workers", pinThreads ? ", pinned" : "");
+    return true;
+}
+
+void stopJobSystem(JobSystem* system) {
+    system->quit.store(true, std::memory_order_release);
+    system->wakeSignal.fetch_add(1, std::memory_order_release);
+    system->wakeSignal.notify_all();
+    // Every worker steals from every other one, so none is freed before all have stopped.
+    for (uint32_t i = 0; i <= system->workerCount; i++) {
+        if (system->workers[i]->thread.joinable()) {
+            system->workers[i]->thread.join();
+        }
+    }
+    for (uint32_t i = 0; i <= system->workerCount; i++) {
+        delete system->workers[i];
+        system->workers[i] = nullptr;
+    }
+    system->workerCount = 0;
+    jobThreadIndex = JOB_NO_THREAD;
+}
+
+void submitJobs(JobSystem* system, Job* jobs, uint32_t count, JobPriority priority, JobCounter* counter) {
+    if (counter != nullptr) {
+        counter->pending.fetch_add(count, std::memory_order_relaxed);
+    }
+    const uint32_t self = jobThreadIndex;
+    for (uint32_t i = 0; i < count; i++) {
+        Job* job = &jobs[i];
+        job->counter = counter;
+        bool queued = false;
+        if (self != JOB_NO_THREAD) {
+            queued = pushJob(&system->workers[self]->deques[priority], job);
+        } else {
+            std::lock_guard<std::mutex> lock(system->injectionMutex);
+            if (system->injectedCount[priority] < JOB_DEQUE_CAPACITY) {
+                system->injected[priority][(system->injectedHead[priority] + system->injectedCount[priority]) % JOB_DEQUE_CAPACITY] = job;
+                system->injectedCount[priority]++;
+                system->injectedTotal.fetch_add(1, std::memory_order_release);
+                queued = true;
+            }
+        }
+        if (!queued) {
+            runJob(system, job);
+        }
+    }
+    wakeSleepingThreads(system, count);
+}
+
+void waitForCounter(JobSystem* system, JobCounter* counter) {
+    const uint32_t self = jobThreadIndex;
+    auto done = [counter] { return counter->pending.load(std::memory_order_acquire) == 0; };
+    uint32_t idleSpins = 0;
+    while (!done()) {
+        Job* job = findJob(system, self);
+        if (job == nullptr && ++idleSpins >= JOB_IDLE_SPINS) {
+            sleepUntilSignalled(system, self, done, &job);
+        }
+        if (job == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        idleSpins = 0;
+        runJob(system, job);
+    }
+}
+
+struct ParallelForBatch {
+    JobRangeFunction function;
+    void* data;
+    uint32_t begin;
+    uint32_t end;
+};
+
+static void runParallelForBatch(void* data) {
+    const ParallelForBatch* batch = static_cast<const ParallelForBatch*>(data);
+    batch->function(batch->data, batch->begin, batch->end);
+}
+
+void parallelFor(JobSystem* system, uint32_t count, uint32_t batchSize, JobRangeFunction function, void* data, const char* name) {
+    if (count == 0) {
+        return;
+    }
+    if (batchSize == 0) {
+        batchSize = 1;
+    }
+    if ((count + batchSize - 1) / batchSize > JOB_MAX_PARALLEL_BATCHES) {
+        batchSize = (count + JOB_MAX_PARALLEL_BATCHES - 1) / JOB_MAX_PARALLEL_BATCHES;
+    }
+    const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+
+    ParallelForBatch batches[JOB_MAX_PARALLEL_BATCHES];
+    Job jobs[JOB_MAX_PARALLEL_BATCHES];
+    for (uint32_t i = 0; i < batchCount; i++) {
+        const uint32_t begin = i * batchSize;
+        batches[i] = {function, data, begin, count - begin < batchSize ? count : begin + batchSize};
+        jobs[i] = {runParallelForBatch, &batches[i], name, nullptr};
+    }
+    JobCounter counter = {};
+    submitJobs(system, jobs, batchCount, JOB_PRIORITY_NORMAL, &counter);
+    waitForCounter(system, &counter);
+}
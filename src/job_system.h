@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+static constexpr uint32_t JOB_MAX_WORKERS = 64;
+// Jobs one deque holds. A push into a full deque runs the job right away instead.
+static constexpr uint32_t JOB_DEQUE_CAPACITY = 4096;
+// Failed attempts to find work before an idle thread goes to sleep.
+static constexpr uint32_t JOB_IDLE_SPINS = 64;
+// parallelFor() keeps its jobs on the stack, so the batch count is bounded.
+static constexpr uint32_t JOB_MAX_PARALLEL_BATCHES = 256;
+
+// Work is always taken from the highest priority that has any, first from the thread's own
+// deque, then from other threads'.
+enum JobPriority {
+    JOB_PRIORITY_HIGH,
+    JOB_PRIORITY_NORMAL,
+    JOB_PRIORITY_LOW,
+    JOB_PRIORITY_COUNT,
+};
+
+typedef void (*JobFunction)(void* data);
+typedef void (*JobRangeFunction)(void* data, uint32_t begin, uint32_t end);
+struct Job;
+
+// Counts the unfinished jobs of one submission, or of several that share it, for fork-join.
+struct JobCounter {
+    std::atomic<uint32_t> pending;
+    // Submitted by whoever takes pending to zero. Has to be set before the first job is submitted,
+    // since finishers read it before their decrement; afterwards the counter may already be gone.
+    Job* continuation;
+};
+
+// The caller owns the memory of a job, and it has to stay alive until the job's counter reaches
+// zero. Fork-join code keeps its jobs on the stack, so submitting never allocates.
+struct Job {
+    JobFunction function;
+    void* data;
+    // Profiler zone of the job; must outlive the profiler export like every zone name.
+    const char* name;
+    // Null for jobs nobody waits for, such as resuming a coroutine.
+    JobCounter* counter;
+};
+
+// Chase-Lev work-stealing deque with a fixed capacity. The owning thread pushes and pops at the
+// bottom, any other thread steals from the top.
+struct JobDeque {
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    alignas(64) std::atomic<Job*> jobs[JOB_DEQUE_CAPACITY];
+};
+
+struct JobWorker {
+    JobDeque deques[JOB_PRIORITY_COUNT];
+    std::thread thread;
+    char name[32];
+};
+
+// Thread 0 is the thread that called startJobSystem(); it runs jobs while it waits on a counter.
+// Threads 1..workerCount are dedicated workers. Any other thread submits through the shared
+// injection queue, which is locked but only touched by threads that are not part of the system.
+struct JobSystem {
+    uint32_t workerCount;
+    JobWorker* workers[JOB_MAX_WORKERS + 1];
+
+    std::mutex injectionMutex;
+    Job* injected[JOB_PRIORITY_COUNT][JOB_DEQUE_CAPACITY];
+    uint32_t injectedHead[JOB_PRIORITY_COUNT];
+    uint32_t injectedCount[JOB_PRIORITY_COUNT];
+    std::atomic<uint32_t> injectedTotal;
+
+    // Idle workers and threads waiting on a counter sleep on wakeSignal. Submissions and finished
+    // counters only bump it while sleepingThreads says someone is asleep; a submission wakes one
+    // sleeper per job, a finished counter all of them.
+    std::atomic<uint32_t> wakeSignal;
+    std::atomic<uint32_t> sleepingThreads;
+    std::atomic<bool> quit;
+};
+
+// workerCount is clamped to JOB_MAX_WORKERS; 0 runs every job on the threads that wait for them.
+// pinThreads binds worker i to core i, leaving core 0 to the calling thread.
+bool startJobSystem(JobSystem* system, uint32_t workerCount, bool pinThreads);
+// Jobs still queued are not run. Call it once every counter has been waited on.
+void stopJobSystem(JobSystem* system);
+// Worker count for this machine: one thread per core besides the calling one.
+uint32_t getDefaultJobWorkerCount();
+
+// Adds count to counter before the jobs become visible, so a single counter can cover several
+// submissions. counter may be null.
+void submitJobs(JobSystem* system, Job* jobs, uint32_t count, JobPriority priority, JobCounter* counter);
+// Counts one unit of work done outside of a job, e.g. a coroutine that finished.
+void finishJobCounter(JobSystem* system, JobCounter* counter);
+// Runs queued jobs on the calling thread until counter reaches zero, then sleeps if none are left.
+void waitForCounter(JobSystem* system, JobCounter* counter);
+// Splits [0, count) into batches of at least batchSize and waits for all of them. The calling
+// thread runs batches too.
+void parallelFor(JobSystem* system, uint32_t count, uint32_t batchSize, JobRangeFunction function, void* data, const char* name);
@@ -0,0 +1,151 @@
+#include "binary_log.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Turns a binary log written with --binary-log back into the console backend's lines, with
+// warnings and errors tagged instead of colored.
+// Usage: HikariVoxLogDecoder FILE [OUTPUT]
+
+struct DecoderSite {
+    bool known;
+    uint8_t level;
+    uint32_t lineNumber;
+    std::vector<uint8_t> argTypes;
+    std::string file;
+};
+
+static void appendDecoded(const char* text, size_t length, void* userData) {
+    static_cast<std::string*>(userData)->append(text, length);
+}
+
+static void appendLineBegin(std::string& line, uint8_t level, const char* file, size_t fileLength, uint32_t lineNumber) {
+    line.clear();
+    if (level == LOG_LEVEL_WARN) {
+        line.append("WARN ");
+    } else if (level == LOG_LEVEL_ERROR) {
+        line.append("ERROR ");
+    }
+    line.append("[");
+    line.append(file, fileLength);
+    if (lineNumber != 0) {
+        line.append(":");
+        line.append(std::to_string(lineNumber));
+    }
+    line.append("]: ");
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>* data) {
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t chunk[64 * 1024];
+    size_t read = 0;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data->insert(data->end(), chunk, chunk + read);
+    }
+    const bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "Usage: HikariVoxLogDecoder FILE [OUTPUT]\n");
+        return 2;
+    }
+    std::vector<uint8_t> data;
+    if (!readFile(argv[1], &data)) {
+        std::fprintf(stderr, "Failed to read %s\n", argv[1]);
+        return 1;
+    }
+    if (data.size() < sizeof(LOG_FILE_MAGIC) || std::memcmp(data.data(), LOG_FILE_MAGIC, sizeof(LOG_FILE_MAGIC)) != 0) {
+        std::fprintf(stderr, "%s is not a binary log\n", argv[1]);
+        return 1;
+    }
+    FILE* output = stdout;
+    if (argc == 3) {
+        output = std::fopen(argv[2], "wb");
+        if (output == nullptr) {
+            std::fprintf(stderr, "Failed to open %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    std::vector<DecoderSite> sites;
+    std::string line;
+    size_t offset = sizeof(LOG_FILE_MAGIC);
+    uint64_t recordCount = 0;
+    uint64_t badRecordCount = 0;
+    while (offset < data.size()) {
+        LogFileEntry entry;
+        if (data.size() - offset < sizeof(entry)) {
+            break;
+        }
+        std::memcpy(&entry, data.data() + offset, sizeof(entry));
+        if (entry.size < sizeof(entry) || entry.size > data.size() - offset) {
+            break;
+        }
+        const uint8_t* body = data.data() + offset + sizeof(entry);
+        const size_t bodySize = entry.size - sizeof(entry);
+        offset += entry.size;
+
+        if (entry.kind == LOG_ENTRY_SITE) {
+            if (entry.argCount > bodySize || entry.siteId >= LOG_MAX_SITES) {
+                badRecordCount++;
+                continue;
+            }
+            if (entry.siteId >= sites.size()) {
+                sites.resize(entry.siteId + 1);
+            }
+            DecoderSite& site = sites[entry.siteId];
+            site.known = true;
+            site.level = entry.level;
+            site.lineNumber = entry.lineNumber;
+            site.argTypes.assign(body, body + entry.argCount);
+            site.file.assign(reinterpret_cast<const char*>(body + entry.argCount), bodySize - entry.argCount);
+            continue;
+        }
+
+        if (entry.kind == LOG_ENTRY_RECORD) {
+            if (entry.siteId >= sites.size() || !sites[entry.siteId].known) {
+                badRecordCount++;
+                continue;
+            }
+            const DecoderSite& site = sites[entry.siteId];
+            appendLineBegin(line, site.level, site.file.data(), site.file.size(), site.lineNumber);
+            if (!decodeLogArgs(site.argTypes.data(), static_cast<uint32_t>(site.argTypes.size()), body, bodySize, appendDecoded, &line)) {
+                badRecordCount++;
+            }
+        } else if (entry.kind == LOG_ENTRY_TEXT) {
+            const void* fileEnd = std::memchr(body, '\0', bodySize);
+            if (fileEnd == nullptr) {
+                badRecordCount++;
+                continue;
+            }
+            const size_t fileLength = static_cast<const uint8_t*>(fileEnd) - body;
+            appendLineBegin(line, entry.level, reinterpret_cast<const char*>(body), fileLength, entry.lineNumber);
+            line.append(reinterpret_cast<const char*>(body + fileLength + 1), bodySize - fileLength - 1);
+        } else {
+            badRecordCount++;
+            continue;
+        }
+        line.append("\n");
+        std::fwrite(line.data(), 1, line.size(), output);
+        recordCount++;
+    }
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    if (offset < data.size()) {
+        // A crash can end the file in the middle of an entry.
+        std::fprintf(stderr, "Log ends with %llu bytes of a truncated entry\n", static_cast<unsigned long long>(data.size() - offset));
+    }
+    if (badRecordCount != 0) {
+        std::fprintf(stderr, "%llu of %llu entries could not be decoded\n", static_cast<unsigned long long>(badRecordCount), static_cast<unsigned long long>(recordCount + badRecordCount));
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "logger.h"
+#include <chrono>
+#include <cstring>
+
+// Runtime filtering of log call sites. Settings are per category and rarely change, so instead of
+// looking them up on every call, each site caches its flags together with the epoch they were
+// computed in. Changing a setting bumps the epoch, and every site refreshes on its next call.
+
+std::atomic<uint32_t> logFilterEpoch{1};
+
+static std::atomic<uint16_t> categoryLevels[LOG_CATEGORY_COUNT] = {
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    // The layers' info messages are rarely useful, --log-level validation=info brings them back.
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+};
+static std::atomic<bool> categoryThrottled[LOG_CATEGORY_COUNT] = {
+    false,
+    false,
+    // Drivers repeat the same validation message every frame.
+    true,
+    false,
+};
+static std::atomic<uint64_t> suppressedCount{0};
+
+static const char* const CATEGORY_NAMES[LOG_CATEGORY_COUNT] = {
+    "general",
+    "vulkan",
+    "validation",
+    "perf",
+};
+
+static const char* const LEVEL_NAMES[] = {
+    "info",
+    "warn",
+    "error",
+    "off",
+};
+
+static void bumpFilterEpoch() {
+    uint32_t epoch = logFilterEpoch.load(std::memory_order_relaxed) + 1;
+    // The epoch has to fit above the flag bits, and 0 is what a fresh site holds.
+    if ((epoch << LOG_SITE_EPOCH_SHIFT >> LOG_SITE_EPOCH_SHIFT) != epoch || epoch == 0) {
+        epoch = 1;
+    }
+    logFilterEpoch.store(epoch, std::memory_order_relaxed);
+}
+
+void setLogLevel(LogCategory category, LogLevel minimumLevel) {
+    categoryLevels[category].store(minimumLevel, std::memory_order_relaxed);
+    bumpFilterEpoch();
+}
+
+LogLevel getLogLevel(LogCategory category) {
+    return static_cast<LogLevel>(categoryLevels[category].load(std::memory_order_relaxed));
+}
+
+void setLogThrottle(LogCategory category, bool throttle) {
+    categoryThrottled[category].store(throttle, std::memory_order_relaxed);
+    bumpFilterEpoch();
+}
+
+static bool findName(const char* const* names, uint32_t count, const char* name, size_t length, uint32_t* index) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (std::strlen(names[i]) == length && std::strncmp(names[i], name, length) == 0) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool applyLogSetting(const char* setting) {
+    const char* separator = std::strchr(setting, '=');
+    const char* levelName = (separator != nullptr) ? separator + 1 : setting;
+    uint32_t level = 0;
+    if (!findName(LEVEL_NAMES, static_cast<uint32_t>(sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0])), levelName, std::strlen(levelName), &level)) {
+        return false;
+    }
+    if (separator == nullptr) {
+        for (uint32_t i = 0; i < LOG_CATEGORY_COUNT; i++) {
+            setLogLevel(static_cast<LogCategory>(i), static_cast<LogLevel>(level));
+        }
+        return true;
+    }
+    uint32_t category = 0;
+    if (!findName(CATEGORY_NAMES, LOG_CATEGORY_COUNT, setting, static_cast<size_t>(separator - setting), &category)) {
+        return false;
+    }
+    setLogLevel(static_cast<LogCategory>(category), static_cast<LogLevel>(level));
+    return true;
+}
+
+uint64_t getLogSuppressedCount() {
+    return suppressedCount.load(std::memory_order_relaxed);
+}
+
+uint32_t refreshLogSite(LogSite* site) {
+    const uint32_t epoch = logFilterEpoch.load(std::memory_order_relaxed);
+    uint32_t filter = epoch << LOG_SITE_EPOCH_SHIFT;
+    if (site->level >= categoryLevels[site->category].load(std::memory_order_relaxed)) {
+        filter |= LOG_SITE_ENABLED;
+    }
+    if (categoryThrottled[site->category].load(std::memory_order_relaxed)) {
+        filter |= LOG_SITE_THROTTLED;
+    }
+    site->filter.store(filter, std::memory_order_relaxed);
+    return filter;
+}
+
+static uint64_t hashMessage(const void* message, size_t messageSize) {
+    // FNV-1a, 64 bit.
+    const uint8_t* bytes = static_cast<const uint8_t*>(message);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < messageSize; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void logSuppressedNote(const LogSite* site, uint32_t suppressed) {
+    static constexpr char NOTE_SUFFIX[] = " similar messages suppressed";
+    char note[LOG_MAX_NUMBER_SIZE + sizeof(NOTE_SUFFIX)];
+    char* end = formatLogUnsigned(note, suppressed);
+    std::memcpy(end, NOTE_SUFFIX, sizeof(NOTE_SUFFIX) - 1);
+    const size_t length = static_cast<size_t>(end - note) + sizeof(NOTE_SUFFIX) - 1;
+    if (site->level == LOG_LEVEL_ERROR) {
+        logError(site->lineNumber, site->file, note, length);
+    } else if (site->level == LOG_LEVEL_WARN) {
+        logWarn(site->lineNumber, site->file, note, length);
+    } else {
+        logInfo(site->lineNumber, site->file, note, length);
+    }
+}
+
+bool admitLogMessage(LogSite* site, const void* message, size_t messageSize) {
+    const uint64_t nowNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    const uint64_t hash = hashMessage(message, messageSize);
+
+    const uint64_t lastAdmittedNs = site->lastAdmittedNs.load(std::memory_order_relaxed);
+    bool admit = !(hash == site->lastHash.load(std::memory_order_relaxed) && lastAdmittedNs != 0 && nowNs - lastAdmittedNs < LOG_DEDUP_WINDOW_NS);
+    if (admit) {
+        if (nowNs - site->rateWindowNs.load(std::memory_order_relaxed) >= LOG_RATE_WINDOW_NS) {
+            site->rateWindowNs.store(nowNs, std::memory_order_relaxed);
+            site->rateCount.store(0, std::memory_order_relaxed);
+        }
+        admit = site->rateCount.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT_MESSAGES;
+    }
+    if (!admit) {
+        site->suppressed.fetch_add(1, std::memory_order_relaxed);
+        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    site->lastHash.store(hash, std::memory_order_relaxed);
+    site->lastAdmittedNs.store(nowNs, std::memory_order_relaxed);
+    const uint32_t suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+    if (suppressed != 0) {
+        logSuppressedNote(site, suppressed);
+    }
+    return true;
+}
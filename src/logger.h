@@ -1,38 +1,145 @@
 #pragma once
 #include <string.h>
 #include <stdint.h>
-#include <sstream>
+#include <atomic>
+#include <charconv>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 //TODO: Windows UTF-16 to UTF-8
 //TODO: Variadic args
 //TODO: Extern templates
-//TODO: std::string printing
 
 //#define LOGGING_DISABLE_INFO
 //#define LOGGING_DISABLE_WARN
 //#define LOGGING_DISABLE_ERROR
+// Formats every message into a string at the call site instead of deferring it, see LOG_AT_SITE.
+//#define LOGGING_IMMEDIATE
 
 //#define LOG_DEBUG(message) logDebug(message, __LINE__, __FILE__)
 
+// Category of the plain LOG_* macros. Define it before the first include to change it for a file.
+#ifndef LOG_DEFAULT_CATEGORY
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_GENERAL
+#endif
+
 #ifdef LOGGING_DISABLE_INFO
-#define LOG_INFO(...)
+#define LOG_CAT_INFO(category, ...)
 #else
-#define LOG_INFO(...) _logInfo(__LINE__, __FILE__, __VA_ARGS__)
+#define LOG_CAT_INFO(category, ...) LOG_AT_SITE(category, LOG_LEVEL_INFO, __VA_ARGS__)
 #endif
 
 #ifdef LOGGING_DISABLE_WARN
-#define LOG_WARN(...)
+#define LOG_CAT_WARN(category, ...)
 #else
-#define LOG_WARN(...) _logWarn(__LINE__, __FILE__, __VA_ARGS__)
+#define LOG_CAT_WARN(category, ...) LOG_AT_SITE(category, LOG_LEVEL_WARN, __VA_ARGS__)
 #endif
 
 #ifdef LOGGING_DISABLE_ERROR
-#define LOG_ERROR(...)
+#define LOG_CAT_ERROR(category, ...)
+#else
+#define LOG_CAT_ERROR(category, ...) LOG_AT_SITE(category, LOG_LEVEL_ERROR, __VA_ARGS__)
+#endif
+
+#define LOG_INFO(...) LOG_CAT_INFO(LOG_DEFAULT_CATEGORY, __VA_ARGS__)
+#define LOG_WARN(...) LOG_CAT_WARN(LOG_DEFAULT_CATEGORY, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_CAT_ERROR(LOG_DEFAULT_CATEGORY, __VA_ARGS__)
+
+#ifdef LOGGING_IMMEDIATE
+#define LOG_EMIT(site, ...) _logImmediate(&site, __VA_ARGS__)
 #else
-#define LOG_ERROR(...) _logError(__LINE__, __FILE__, __VA_ARGS__)
+#define LOG_EMIT(site, ...) _logDeferred(&site, __VA_ARGS__)
 #endif
 
+// Every call site owns a constant-initialized LogSite, so its file, line, level and argument types
+// are known once and never travel with a message. A call only copies the raw argument bytes; the
+// backend turns them into text later, or writes them out as they are for log_decoder. Filtered
+// sites return before their arguments are even evaluated.
+#define LOG_AT_SITE(category, level, ...) do { \
+    static LogSite _logSite = {__FILE__, __LINE__, level, category}; \
+    if (logSiteEnabled(&_logSite)) { \
+        LOG_EMIT(_logSite, __VA_ARGS__); \
+    } \
+} while (0)
+
+enum LogLevel : uint16_t {
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    // Only as a category's minimum level, silences it.
+    LOG_LEVEL_OFF
+};
+
+enum LogCategory : uint16_t {
+    LOG_CATEGORY_GENERAL,
+    LOG_CATEGORY_VULKAN,
+    // Messages of the Vulkan validation layers.
+    LOG_CATEGORY_VALIDATION,
+    // Profiler, GPU timings, benchmark and hitch reports.
+    LOG_CATEGORY_PERF,
+    LOG_CATEGORY_COUNT
+};
+
+// How an argument is formatted, and stored in a deferred payload. Numbers take 8 bytes, strings a
+// 32-bit length followed by their bytes.
+enum LogArgType : uint8_t {
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_CHAR,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING
+};
+
+// Longer payloads are cut; the arguments that no longer fit are left out.
+static constexpr uint32_t LOG_MAX_PAYLOAD_SIZE = 4096;
+
+// A throttled site drops a message identical to the last one it let through for this long.
+static constexpr uint64_t LOG_DEDUP_WINDOW_NS = 10000000000ull;
+// Messages a throttled site may log per window; the rest of the window is dropped.
+static constexpr uint32_t LOG_RATE_LIMIT_MESSAGES = 20;
+static constexpr uint64_t LOG_RATE_WINDOW_NS = 1000000000ull;
+
+// Bits of LogSite::filter below the epoch.
+static constexpr uint32_t LOG_SITE_ENABLED = 1;
+static constexpr uint32_t LOG_SITE_THROTTLED = 2;
+static constexpr uint32_t LOG_SITE_EPOCH_SHIFT = 2;
+
+struct LogSite {
+    const char* file;
+    uint32_t lineNumber;
+    uint16_t level;
+    uint16_t category;
+    // Filled in by registerLogSite() on the first call. Everything from here on starts out zero,
+    // so the LOG_* macros only spell out the members above.
+    uint16_t argCount = 0;
+    const uint8_t* argTypes = nullptr;
+    // 0 until registered, then unique per call site.
+    std::atomic<uint32_t> id{0};
+    // Owned by the backend, e.g. whether a binary log already describes this site.
+    bool described = false;
+
+    // LOG_SITE_* flags cached from the category settings, valid while the epoch in the upper bits
+    // matches logFilterEpoch. 0 never matches, so every site looks its flags up on the first call.
+    std::atomic<uint32_t> filter{0};
+    // Throttling state, see admitLogMessage(). Relaxed atomics: threads racing on one site can let
+    // a duplicate through or miscount, but never corrupt anything.
+    std::atomic<uint64_t> lastHash{0};
+    std::atomic<uint64_t> lastAdmittedNs{0};
+    std::atomic<uint64_t> rateWindowNs{0};
+    std::atomic<uint32_t> rateCount{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+
+// What a buffering backend does when a thread logs faster than its output can keep up.
+enum LogOverflowPolicy {
+    // Discard the message and count it. Logging never waits.
+    LOG_OVERFLOW_DROP,
+    // Wait for the backend to make room. Nothing is lost, but the logging thread can stall.
+    LOG_OVERFLOW_BLOCK
+};
+
 // Logger backends only have to supply these functions:
 void initLogger(void);
 //void log(const char* message, size_t messageLength, size_t lineNumber, const char* file);
@@ -41,159 +148,252 @@ void logInfo(size_t lineNumber, const char* file, const char* message, size_t me
 void logWarn(size_t lineNumber, const char* file, const char* message, size_t messageLength);
 void logError(size_t lineNumber, const char* file, const char* message, size_t messageLength);
 void exitLogger(void);
+// Writes everything logged so far before returning. Backends without buffering just flush.
+void flushLogger(void);
+void setLogOverflowPolicy(LogOverflowPolicy policy);
+// A message of a registered site, payload holds its arguments as described by site->argTypes.
+void logDeferred(const LogSite* site, const uint8_t* payload, size_t payloadSize);
+// Writes all further output to path in the binary log format instead of text. Returns false when
+// the file cannot be created or the backend only writes text.
+bool setLogBinaryOutput(const char* path);
 
-// int, long, long long, float, double, long double
+// Shared by all backends, see binary_log.cpp. Returns the site's id.
+uint32_t registerLogSite(LogSite* site, const uint8_t* argTypes, uint32_t argCount);
 
-inline void variadicUnpack(std::string& buf) {}
+// Runtime filtering, see log_filter.cpp. Settings apply to sites on their next call.
+// Messages below minimumLevel are skipped before their arguments are evaluated.
+void setLogLevel(LogCategory category, LogLevel minimumLevel);
+LogLevel getLogLevel(LogCategory category);
+// Throttled categories drop a message that repeats the previous one of its site within
+// LOG_DEDUP_WINDOW_NS, and more than LOG_RATE_LIMIT_MESSAGES per site and second.
+void setLogThrottle(LogCategory category, bool throttle);
+// "level" for all categories or "category=level", e.g. "validation=error". Levels are info, warn,
+// error and off. Returns false for unknown names.
+bool applyLogSetting(const char* setting);
+// Messages dropped by throttling since startup.
+uint64_t getLogSuppressedCount();
 
-template<typename... Args>
-void variadicUnpack(std::string& buf, int arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, unsigned arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, long arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, unsigned long arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, long long arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, unsigned long long arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, float arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, double arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, long double arg, Args... args);
+extern std::atomic<uint32_t> logFilterEpoch;
+uint32_t refreshLogSite(LogSite* site);
+// False when the message should be dropped. Called with the encoded or formatted message.
+bool admitLogMessage(LogSite* site, const void* message, size_t messageSize);
 
-template<typename... Args>
-void variadicUnpack(std::string& buf, const char* arg, Args... args);
-template<typename T, typename... Args>
-void variadicUnpack(std::string& buf, T arg, Args... args);
-template<typename... Args>
-void variadicUnpack(std::string& buf, void* arg, Args... args);
-
-template<typename T, typename... Args>
-inline void variadicUnpack(std::string& buf, T arg, Args... args) {
-    //TODO: Remove stringstream
-    std::ostringstream oss;
-    oss << arg;
-    buf.append(oss.str());
-    variadicUnpack(buf, args...);
+inline bool logSiteEnabled(LogSite* site) {
+    uint32_t filter = site->filter.load(std::memory_order_relaxed);
+    if ((filter >> LOG_SITE_EPOCH_SHIFT) != logFilterEpoch.load(std::memory_order_relaxed)) {
+        filter = refreshLogSite(site);
+    }
+    return (filter & LOG_SITE_ENABLED) != 0;
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, void* arg, Args... args) {
-    //TODO: Remove stringstream
-    std::ostringstream oss;
-    oss << arg;
-    buf.append(oss.str());
-    variadicUnpack(buf, args...);
+template<typename T>
+constexpr LogArgType logArgType() {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, char> || std::is_same_v<U, signed char> || std::is_same_v<U, unsigned char>) {
+        return LOG_ARG_CHAR;
+    } else if constexpr (std::is_same_v<U, bool>) {
+        return LOG_ARG_UINT;
+    } else if constexpr (std::is_enum_v<U>) {
+        return std::is_signed_v<std::underlying_type_t<U>> ? LOG_ARG_INT : LOG_ARG_UINT;
+    } else if constexpr (std::is_integral_v<U>) {
+        return std::is_signed_v<U> ? LOG_ARG_INT : LOG_ARG_UINT;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return LOG_ARG_DOUBLE;
+    } else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) {
+        return LOG_ARG_STRING;
+    } else if constexpr (std::is_pointer_v<U>) {
+        return LOG_ARG_POINTER;
+    } else {
+        static_assert(std::is_convertible_v<const U&, std::string_view>, "Log arguments are numbers, enums, pointers and strings; convert other types at the call site.");
+        return LOG_ARG_STRING;
+    }
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, char* arg, Args... args) {
-    buf.append((const char*)arg);
-    variadicUnpack(buf, args...);
+// Compilers turn a memcpy of bounded but unknown length into rep movs, whose startup cost is larger
+// than the whole copy for the short strings logged here, so the bytes are copied by hand.
+inline void copyLogBytes(char* out, const char* text, size_t length) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, text + i, sizeof(word));
+        memcpy(out + i, &word, sizeof(word));
+    }
+    for (; i < length; i++) {
+        out[i] = text[i];
+    }
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, const char* arg, Args... args) {
-    buf.append(arg);
-    variadicUnpack(buf, args...);
-}
+// Numbers are formatted with std::to_chars, which neither allocates nor looks at the locale. The
+// output matches the old std::to_string() based formatting: integers in decimal, floating point
+// values in fixed notation with 6 decimals and pointers in hex.
+static constexpr uint32_t LOG_MAX_NUMBER_SIZE = 320;
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, int arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+inline char* formatLogSigned(char* first, long long value) {
+    return std::to_chars(first, first + LOG_MAX_NUMBER_SIZE, value).ptr;
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, unsigned arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+inline char* formatLogUnsigned(char* first, unsigned long long value) {
+    return std::to_chars(first, first + LOG_MAX_NUMBER_SIZE, value).ptr;
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, long arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+inline char* formatLogDouble(char* first, double value) {
+    return std::to_chars(first, first + LOG_MAX_NUMBER_SIZE, value, std::chars_format::fixed, 6).ptr;
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, unsigned long arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+inline char* formatLogPointer(char* first, unsigned long long address) {
+    first[0] = '0';
+    first[1] = 'x';
+    return std::to_chars(first + 2, first + LOG_MAX_NUMBER_SIZE, address, 16).ptr;
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, long long arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
-}
+// Messages are formatted on the stack. Whatever does not fit is cut off.
+static constexpr uint32_t LOG_FORMAT_BUFFER_SIZE = 4096;
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, unsigned long long arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
-}
+struct LogFormatBuffer {
+    char data[LOG_FORMAT_BUFFER_SIZE];
+    uint32_t length;
+};
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, float arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+inline void appendLogText(LogFormatBuffer* buffer, const char* text, size_t length) {
+    const size_t room = LOG_FORMAT_BUFFER_SIZE - buffer->length;
+    if (length > room) {
+        length = room;
+    }
+    copyLogBytes(buffer->data + buffer->length, text, length);
+    buffer->length += static_cast<uint32_t>(length);
 }
 
-template<typename... Args>
-inline void variadicUnpack(std::string& buf, double arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+template<typename T>
+inline void appendLogArg(LogFormatBuffer* buffer, const T& arg) {
+    using U = std::decay_t<T>;
+    constexpr LogArgType type = logArgType<T>();
+    if constexpr (type == LOG_ARG_CHAR) {
+        const char value = static_cast<char>(arg);
+        appendLogText(buffer, &value, 1);
+    } else if constexpr (type == LOG_ARG_STRING) {
+        if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) {
+            const char* text = arg;
+            if (text == nullptr) {
+                text = "(null)";
+            }
+            appendLogText(buffer, text, strlen(text));
+        } else {
+            const std::string_view text = arg;
+            appendLogText(buffer, text.data(), text.size());
+        }
+    } else {
+        char number[LOG_MAX_NUMBER_SIZE];
+        char* end = number;
+        if constexpr (type == LOG_ARG_INT) {
+            end = formatLogSigned(number, static_cast<long long>(arg));
+        } else if constexpr (type == LOG_ARG_UINT) {
+            end = formatLogUnsigned(number, static_cast<unsigned long long>(arg));
+        } else if constexpr (type == LOG_ARG_DOUBLE) {
+            end = formatLogDouble(number, static_cast<double>(arg));
+        } else {
+            end = formatLogPointer(number, reinterpret_cast<uintptr_t>(arg));
+        }
+        appendLogText(buffer, number, static_cast<size_t>(end - number));
+    }
 }
 
 template<typename... Args>
-inline void variadicUnpack(std::string& buf, long double arg, Args... args) {
-    buf.append(std::to_string(arg));
-    variadicUnpack(buf, args...);
+inline void variadicUnpack(LogFormatBuffer* buffer, const Args &... args) {
+    (appendLogArg(buffer, args), ...);
 }
 
 template<typename... Args>
-inline void _logInfo(size_t lineNumber, const char* file, const Args &... args) {
-    std::string buf;
-    variadicUnpack(buf, args...);
-    logInfo(lineNumber, file, buf.c_str(), buf.size());
+inline void _logImmediate(LogSite* site, const Args &... args) {
+    LogFormatBuffer buffer;
+    buffer.length = 0;
+    variadicUnpack(&buffer, args...);
+    if ((site->filter.load(std::memory_order_relaxed) & LOG_SITE_THROTTLED) != 0 && !admitLogMessage(site, buffer.data, buffer.length)) {
+        return;
+    }
+    if (site->level == LOG_LEVEL_ERROR) {
+        logError(site->lineNumber, site->file, buffer.data, buffer.length);
+    } else if (site->level == LOG_LEVEL_WARN) {
+        logWarn(site->lineNumber, site->file, buffer.data, buffer.length);
+    } else {
+        logInfo(site->lineNumber, site->file, buffer.data, buffer.length);
+    }
 }
 
-// Faster shortcut if no variadic arguments are used
-template<size_t N>
-inline void _logInfo(size_t lineNumber, const char* file, const char (& message)[N]) {
-    //logInfo(0, 0, "Correct", 0);
-    logInfo(lineNumber, file, message, N-1);
-}
+struct LogPayload {
+    uint8_t data[LOG_MAX_PAYLOAD_SIZE];
+    uint32_t size;
+    // Set once an argument did not fit, later arguments are skipped.
+    bool full;
+};
 
-template<typename... Args>
-inline void _logWarn(size_t lineNumber, const char* file, const Args &... args) {
-    std::string buf;
-    variadicUnpack(buf, args...);
-    logWarn(lineNumber, file, buf.c_str(), buf.size());
+inline void encodeLogValue(LogPayload* payload, const void* value, uint32_t size) {
+    if (payload->full || payload->size + size > LOG_MAX_PAYLOAD_SIZE) {
+        payload->full = true;
+        return;
+    }
+    memcpy(payload->data + payload->size, value, size);
+    payload->size += size;
 }
 
-// Faster shortcut if no variadic arguments are used
-template<size_t N>
-inline void _logWarn(size_t lineNumber, const char* file, const char (& message)[N]) {
-    //logInfo(0, 0, "Correct", 0);
-    logWarn(lineNumber, file, message, N-1);
+inline void encodeLogString(LogPayload* payload, const char* text, size_t length) {
+    if (payload->full || payload->size + sizeof(uint32_t) > LOG_MAX_PAYLOAD_SIZE) {
+        payload->full = true;
+        return;
+    }
+    const uint32_t room = LOG_MAX_PAYLOAD_SIZE - payload->size - static_cast<uint32_t>(sizeof(uint32_t));
+    if (length > room) {
+        length = room;
+        payload->full = true;
+    }
+    const uint32_t stored = static_cast<uint32_t>(length);
+    memcpy(payload->data + payload->size, &stored, sizeof(stored));
+    copyLogBytes(reinterpret_cast<char*>(payload->data + payload->size + sizeof(stored)), text, length);
+    payload->size += static_cast<uint32_t>(sizeof(stored)) + stored;
 }
 
-template<typename... Args>
-inline void _logError(size_t lineNumber, const char* file, const Args &... args) {
-    std::string buf;
-    variadicUnpack(buf, args...);
-    logError(lineNumber, file, buf.c_str(), buf.size());
+template<typename T>
+inline void encodeLogArg(LogPayload* payload, const T& arg) {
+    using U = std::decay_t<T>;
+    constexpr LogArgType type = logArgType<T>();
+    if constexpr (type == LOG_ARG_CHAR) {
+        const char value = static_cast<char>(arg);
+        encodeLogValue(payload, &value, 1);
+    } else if constexpr (type == LOG_ARG_INT) {
+        const int64_t value = static_cast<int64_t>(arg);
+        encodeLogValue(payload, &value, sizeof(value));
+    } else if constexpr (type == LOG_ARG_UINT) {
+        const uint64_t value = static_cast<uint64_t>(arg);
+        encodeLogValue(payload, &value, sizeof(value));
+    } else if constexpr (type == LOG_ARG_DOUBLE) {
+        const double value = static_cast<double>(arg);
+        encodeLogValue(payload, &value, sizeof(value));
+    } else if constexpr (type == LOG_ARG_POINTER) {
+        const uint64_t value = reinterpret_cast<uintptr_t>(arg);
+        encodeLogValue(payload, &value, sizeof(value));
+    } else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) {
+        const char* text = arg;
+        if (text == nullptr) {
+            text = "(null)";
+        }
+        encodeLogString(payload, text, strlen(text));
+    } else {
+        const std::string_view text = arg;
+        encodeLogString(payload, text.data(), text.size());
+    }
 }
 
-// Faster shortcut if no variadic arguments are used
-template<size_t N>
-inline void _logError(size_t lineNumber, const char* file, const char (& message)[N]) {
-    //logInfo(0, 0, "Correct", 0);
-    logError(lineNumber, file, message, N-1);
+template<typename... Args>
+inline void _logDeferred(LogSite* site, const Args &... args) {
+    static constexpr uint8_t argTypes[] = {logArgType<Args>()...};
+    if (site->id.load(std::memory_order_acquire) == 0) {
+        registerLogSite(site, argTypes, sizeof...(Args));
+    }
+    LogPayload payload;
+    payload.size = 0;
+    payload.full = false;
+    (encodeLogArg(&payload, args), ...);
+    if ((site->filter.load(std::memory_order_relaxed) & LOG_SITE_THROTTLED) != 0 && !admitLogMessage(site, payload.data, payload.size)) {
+        return;
+    }
+    logDeferred(site, payload.data, payload.size);
 }
@@ -3,9 +3,29 @@
 #include <SDL3/SDL_main.h>
 #include "logger.h"
 #include "vulkan_base/vulkan_base.h"
+#include "spsc_queue.h"
+#include "frame_pacer.h"
+#include "profiler.h"
+#include "camera.h"
+#include "benchmark.h"
+#include "regression.h"
+#include "perf_counters.h"
+#include "hud.h"
+#include "hitch_detector.h"
+#include "alloc_tracker.h"
+#include "job_system.h"
+#include "async_io.h"
+#include "task.h"
+#include "frame_arena.h"
+#include "slab_allocator.h"
 #include <SDL3/SDL_vulkan.h>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <thread>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <climits>
 #define STBI_NO_STDIO
@@ -14,8 +34,31 @@
 #include "../libs/SDL/src/video/stb_image.h"
 
 static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+// Packets the main thread may run ahead of the render thread.
+static constexpr uint32_t FRAME_PACKET_QUEUE_SIZE = 2;
 static constexpr uint32_t BASE_RENDER_WIDTH = 1240;
 static constexpr uint32_t BASE_RENDER_HEIGHT = 720;
+// Transient per-frame data (uniforms, dynamic vertices) lives in this much of the frame ring per frame in flight.
+static constexpr VkDeviceSize FRAME_RING_SIZE = 256 * 1024;
+// Frame rate cap in frames per second. 0 leaves the rate to the present mode and the critical path.
+static constexpr double FRAME_RATE_LIMIT = 0.0;
+// How often the frame pacer statistics are logged.
+static constexpr uint64_t FRAME_PACER_LOG_INTERVAL_NS = 10000000000ull;
+// Written when F2 is pressed.
+static constexpr const char* PROFILER_TRACE_PATH = "hikarivox_trace.json";
+// The HUD is toggled with F1. Its frame time graph marks frames slower than this.
+static constexpr float HUD_TARGET_FRAME_MS = 1000.0f / 60.0f;
+// Memory heap budgets are queried from the driver only this often.
+static constexpr uint64_t HUD_MEMORY_REFRESH_FRAMES = 30;
+static constexpr float HUD_PANEL_WIDTH = 600.0f;
+// Timestamp scopes available per frame to the GPU profiler.
+static constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 32;
+// Presents tracked for latency measurement with VK_KHR_present_wait. Must exceed the wait distance.
+static constexpr uint32_t PRESENT_HISTORY_SIZE = 4;
+// Replay pre-recorded secondary command buffers instead of re-recording the scene every frame.
+static constexpr bool USE_STATIC_COMMAND_BUFFERS = true;
+// The driver's host allocations are small and frequent, so they come from the slab allocator.
+static constexpr VulkanHostAllocatorBackend HOST_ALLOCATOR_BACKEND = {slabAllocate, slabFree};
 static constexpr const char* IMAGE_PATH_CANDIDATES[] = {
     "../assets/texture.png",
     "../libs/SDL/examples/renderer/06-textures/thumbnail.png",
@@ -27,6 +70,12 @@ struct Vertex {
     float color[3];
 };
 
+// Mirrors the FrameConstants block in triangle_vert.glsl (std140).
+struct FrameConstants {
+    Mat4 viewProjection;
+    float time[4];
+};
+
 static constexpr std::array<Vertex, 4> TRIANGLE_VERTICES = {{
     {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
     {{ 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
@@ -39,6 +88,82 @@ static constexpr std::array<uint16_t, 6> TRIANGLE_INDICES = {{
     2, 3, 0
 }};
 
+// Headless mode renders into this many application-owned images instead of a swapchain.
+static constexpr uint32_t HEADLESS_IMAGE_COUNT = 3;
+static constexpr VkFormat HEADLESS_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
+// Frames rendered by a headless run that is not a benchmark and has no --frames.
+static constexpr uint32_t HEADLESS_DEFAULT_FRAME_COUNT = 60;
+
+// Benchmark scene: a grid of randomly sized and coloured quads on the z = 0 plane.
+// 96 * 96 cells keep the vertex count below the 16-bit index limit.
+static constexpr uint32_t BENCHMARK_GRID_SIZE = 96;
+static constexpr float BENCHMARK_CELL_SIZE = 1.0f;
+// Grid rows built by one job. Every band starts its random stream where the serial loop would be,
+// so the scene depends on the seed only and not on the worker count.
+static constexpr uint32_t SCENE_BAND_ROWS = 8;
+static constexpr uint32_t SCENE_RANDOMS_PER_CELL = 5;
+
+// Geometry of one band with band-local indices, rebased while the bands are merged.
+struct SceneBand {
+    XorShiftRandom random;
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    uint32_t firstVertex;
+    uint32_t firstIndex;
+};
+
+struct CommandLineOptions {
+    BenchmarkConfig benchmark;
+    bool headless;
+    // Stop after this many frames; 0 runs until the window is closed.
+    uint32_t frameLimit;
+    // Written as PNG after the last frame when set.
+    const char* readbackPath;
+    bool regression;
+    const char* goldenDir;
+    // Replace the golden images with this run's frames instead of comparing against them.
+    bool updateGolden;
+    // Start with the HUD visible.
+    bool hud;
+    // Multiple of the median frame time that counts as a hitch. 0 disables, negative picks the default.
+    double hitchThreshold;
+    const char* hitchDir;
+    // Wait for the log writer instead of dropping messages when a thread's log ring is full.
+    bool logBlock;
+    // Binary log file, decoded offline with HikariVoxLogDecoder.
+    const char* binaryLogPath;
+    // Job worker threads; negative picks one per core besides the main thread.
+    int32_t jobWorkers;
+    bool pinJobWorkers;
+    // What a heap allocation in a zero-alloc region does besides being counted, debug builds only.
+    AllocViolationAction zeroAllocAction;
+};
+
+// Everything the render thread needs for one frame. Built by the main thread right after
+// polling events, so the render thread never touches SDL events or simulation state.
+struct FramePacket {
+    uint64_t frameNumber;
+    // When the main thread started sampling input for this frame.
+    uint64_t inputTimeNs;
+    float time;
+    float greenChannel;
+    // Position on the camera flythrough in [0, 1]; negative renders with an identity view projection.
+    float cameraT;
+    // Slot in regressionCaptures that receives this frame's image, -1 for none.
+    int32_t captureIndex;
+    bool hudVisible;
+    bool resized;
+    bool quit;
+};
+
+// Per-frame values read by the render graph pass callbacks while the frame is recorded.
+struct FrameRecordState {
+    uint32_t frame;
+    uint32_t imageIndex;
+    VkDeviceSize frameConstantsOffset;
+    VkClearColorValue clearColor;
+};
+
 struct ApplicationState {
     SDL_Window* window;
     VulkanContext* context;
@@ -46,6 +171,9 @@ struct ApplicationState {
     VulkanSwapChain swapchain;
     VkRenderPass renderPass;
     std::vector<VkFramebuffer> framebuffers;
+    RenderGraph frameGraph;
+    RenderGraphResource backbuffer;
+    FrameRecordState recordState;
     VulkanPipeline pipeline;
     std::vector<VkCommandPool> commandPools;
     std::vector<VkCommandBuffer> commandBuffers;
@@ -53,6 +181,24 @@ struct ApplicationState {
     std::vector<VkSemaphore> acquireSemaphores;
     std::vector<VkSemaphore> releaseSemaphores;
     std::vector<VkFence> imagesInFlight;
+    VulkanStaticCommands staticCommands;
+    bool useStaticCommands;
+    VulkanFrameRing frameRing;
+    BenchmarkConfig benchmark;
+    bool headless;
+    uint32_t frameLimit;
+    const char* readbackPath;
+    bool regression;
+    const char* goldenDir;
+    bool updateGolden;
+    VkPresentModeKHR presentMode;
+    std::vector<Vertex> sceneVertices;
+    std::vector<uint16_t> sceneIndices;
+    std::vector<SceneBand> sceneBands;
+    // Random numbers drawn by one band, independent of the seed.
+    XorShiftJump sceneBandJump;
+    uint32_t sceneQuadCount;
+    float sceneExtent;
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory;
     uint32_t vertexCount;
@@ -66,10 +212,81 @@ struct ApplicationState {
     uint32_t textureHeight;
     uint32_t framesInFlight;
     uint32_t currentFrame;
+    // Render thread only.
     bool framebufferResized;
+    uint32_t nextOffscreenImage;
+    uint32_t lastPresentedImage;
+    std::vector<uint64_t> frameInputNs;
+    std::vector<uint64_t> frameSubmitNs;
+    uint64_t lastGpuCompleteNs;
+    uint64_t nextPresentId;
+    uint64_t swapchainFirstPresentId;
+    uint64_t presentInputNs[PRESENT_HISTORY_SIZE];
+    VulkanGpuProfiler gpuProfiler;
+    uint64_t lastGpuProfilerLogNs;
+    std::vector<ImageBGRA8> regressionCaptures;
+    std::vector<float> recordTimesMs;
+    // Transient CPU data of the render thread, one arena per frame in flight.
+    FrameArenaRing renderFrameArenas;
+    // Made by the readbacks themselves, so they do not count against the allocation budget.
+    uint64_t captureAllocations;
+    PerfCounterTotals renderFrameCounters;
+    uint64_t lastHostAllocationCount;
+    Hud hud;
+    uint64_t lastRenderFrameBeginNs;
+    uint64_t lastUploadedBytes;
+    // Staged uploads plus frame ring bytes of the previous frame.
+    uint64_t lastFrameUploadBytes;
+    uint32_t lastHudQuadCount;
+    double lastHudBuildMs;
+    // Heap allocations of the render thread's previous frame, counted in debug builds only.
+    uint64_t lastRenderFrameHeapAllocations;
+    VulkanMemoryHeapStats hudHeaps[VK_MAX_MEMORY_HEAPS];
+    uint32_t hudHeapCount;
+
+    // Main thread only.
+    uint64_t frameNumber;
+    float greenChannel;
+    bool resizePending;
+    uint64_t lastPacerLogNs;
+    std::vector<float> benchmarkFrameTimesMs;
+    uint64_t benchmarkStartNs;
+    uint64_t benchmarkEndNs;
+    uint64_t initDeviceAllocations;
+    PerfCounterTotals sceneBuildCounters;
+    bool hudVisible;
+    HitchDetector hitchDetector;
+    // Loads the texture while the rest of the scene resources are created; joined by finishImageLoad().
+    Task<bool> imageLoad;
+    JobCounter imageLoadCounter;
+
+    // Shared between the main and the render thread.
+    JobSystem jobs;
+    AsyncIo asyncIo;
+    FramePacer framePacer;
+    SpscQueue<FramePacket, FRAME_PACKET_QUEUE_SIZE> framePackets;
+    std::thread renderThread;
+    std::atomic<bool> renderThreadFailed;
+    std::atomic<int> windowPixelWidth;
+    std::atomic<int> windowPixelHeight;
+    // Written by the main thread, shown by the render thread's HUD.
+    std::atomic<uint64_t> lastMainFrameHeapAllocations;
 };
 
+void publishWindowSize(ApplicationState* app) {
+    int width = static_cast<int>(BASE_RENDER_WIDTH);
+    int height = static_cast<int>(BASE_RENDER_HEIGHT);
+    if (app->window != nullptr) {
+        SDL_GetWindowSizeInPixels(app->window, &width, &height);
+    }
+    app->windowPixelWidth.store(width, std::memory_order_relaxed);
+    app->windowPixelHeight.store(height, std::memory_order_relaxed);
+}
+
+// Main thread only. Window changes are published through the window size atomics and
+// forwarded to the render thread with the next frame packet.
 bool handleMessage(ApplicationState* app) {
+    PROFILE_FUNCTION();
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
@@ -77,7 +294,20 @@ bool handleMessage(ApplicationState* app) {
                 return false;
             case SDL_EVENT_WINDOW_RESIZED:
             case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
-                app->framebufferResized = true;
+            case SDL_EVENT_WINDOW_RESTORED:
+                publishWindowSize(app);
+                app->resizePending = true;
+                break;
+            case SDL_EVENT_WINDOW_MINIMIZED:
+                publishWindowSize(app);
+                break;
+            case SDL_EVENT_KEY_DOWN:
+                if (event.key.key == SDLK_F1 && !event.key.repeat) {
+                    app->hudVisible = !app->hudVisible;
+                }
+                if (event.key.key == SDLK_F2 && !event.key.repeat) {
+                    exportChromeTrace(PROFILER_TRACE_PATH);
+                }
                 break;
             default:
                 break;
@@ -86,11 +316,98 @@ bool handleMessage(ApplicationState* app) {
     return true;
 }
 
+// Job function, one call per range of bands. Draws exactly SCENE_RANDOMS_PER_CELL numbers per cell.
+void buildSceneBands(void* data, uint32_t begin, uint32_t end) {
+    ApplicationState* app = static_cast<ApplicationState*>(data);
+    for (uint32_t bandIndex = begin; bandIndex < end; bandIndex++) {
+        SceneBand& band = app->sceneBands[bandIndex];
+        XorShiftRandom random = band.random;
+        band.vertices.clear();
+        band.indices.clear();
+        const uint32_t rowBegin = bandIndex * SCENE_BAND_ROWS;
+        const uint32_t rowEnd = std::min(rowBegin + SCENE_BAND_ROWS, BENCHMARK_GRID_SIZE);
+        for (uint32_t y = rowBegin; y < rowEnd; y++) {
+            for (uint32_t x = 0; x < BENCHMARK_GRID_SIZE; x++) {
+                // Draw every random number even for skipped cells, so the layout only depends on the seed.
+                const float keep = nextRandomFloat(&random);
+                const float halfSize = BENCHMARK_CELL_SIZE * (0.15f + 0.35f * nextRandomFloat(&random));
+                const float color[3] = {nextRandomFloat(&random), nextRandomFloat(&random), nextRandomFloat(&random)};
+                if (keep > 0.8f) {
+                    continue;
+                }
+
+                const float centerX = (static_cast<float>(x) + 0.5f) * BENCHMARK_CELL_SIZE - app->sceneExtent;
+                const float centerY = (static_cast<float>(y) + 0.5f) * BENCHMARK_CELL_SIZE - app->sceneExtent;
+                const uint16_t firstVertex = static_cast<uint16_t>(band.vertices.size());
+                band.vertices.push_back({{centerX - halfSize, centerY - halfSize}, {color[0], color[1], color[2]}});
+                band.vertices.push_back({{centerX + halfSize, centerY - halfSize}, {color[0], color[1], color[2]}});
+                band.vertices.push_back({{centerX + halfSize, centerY + halfSize}, {color[0], color[1], color[2]}});
+                band.vertices.push_back({{centerX - halfSize, centerY + halfSize}, {color[0], color[1], color[2]}});
+                for (uint16_t index : TRIANGLE_INDICES) {
+                    band.indices.push_back(static_cast<uint16_t>(firstVertex + index));
+                }
+            }
+        }
+    }
+}
+
+// Job function. Copies bands into the scene arrays at the offsets buildScene() summed up.
+void mergeSceneBands(void* data, uint32_t begin, uint32_t end) {
+    ApplicationState* app = static_cast<ApplicationState*>(data);
+    for (uint32_t bandIndex = begin; bandIndex < end; bandIndex++) {
+        const SceneBand& band = app->sceneBands[bandIndex];
+        std::copy(band.vertices.begin(), band.vertices.end(), app->sceneVertices.begin() + band.firstVertex);
+        uint16_t* indices = app->sceneIndices.data() + band.firstIndex;
+        for (size_t i = 0; i < band.indices.size(); i++) {
+            indices[i] = static_cast<uint16_t>(band.firstVertex + band.indices[i]);
+        }
+    }
+}
+
+// Fills the scene geometry: the default quad, or the fixed-seed grid in benchmark and regression mode.
+void buildScene(ApplicationState* app) {
+    app->sceneVertices.clear();
+    app->sceneIndices.clear();
+    app->sceneQuadCount = 0;
+
+    if (!app->benchmark.enabled && !app->regression) {
+        app->sceneVertices.assign(TRIANGLE_VERTICES.begin(), TRIANGLE_VERTICES.end());
+        app->sceneIndices.assign(TRIANGLE_INDICES.begin(), TRIANGLE_INDICES.end());
+        app->sceneQuadCount = 1;
+        app->sceneExtent = 1.0f;
+        return;
+    }
+
+    XorShiftRandom random = {};
+    seedRandom(&random, app->benchmark.seed);
+    app->sceneExtent = BENCHMARK_GRID_SIZE * BENCHMARK_CELL_SIZE * 0.5f;
+    const uint32_t bandCount = (BENCHMARK_GRID_SIZE + SCENE_BAND_ROWS - 1) / SCENE_BAND_ROWS;
+    app->sceneBands.resize(bandCount);
+    for (uint32_t i = 0; i < bandCount; i++) {
+        app->sceneBands[i].random = random;
+        jumpRandom(&random, &app->sceneBandJump);
+    }
+    parallelFor(&app->jobs, bandCount, 1, buildSceneBands, app, "Build scene band");
+
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    for (SceneBand& band : app->sceneBands) {
+        band.firstVertex = vertexCount;
+        band.firstIndex = indexCount;
+        vertexCount += static_cast<uint32_t>(band.vertices.size());
+        indexCount += static_cast<uint32_t>(band.indices.size());
+    }
+    app->sceneVertices.resize(vertexCount);
+    app->sceneIndices.resize(indexCount);
+    app->sceneQuadCount = vertexCount / 4;
+    parallelFor(&app->jobs, bandCount, 1, mergeSceneBands, app, "Merge scene band");
+}
+
 bool createVertexResources(ApplicationState* app) {
-    const VkDeviceSize vertexBufferSize = sizeof(Vertex) * TRIANGLE_VERTICES.size();
+    const VkDeviceSize vertexBufferSize = sizeof(Vertex) * app->sceneVertices.size();
     if (!uploadToDeviceLocalBuffer(
             app->context,
-            TRIANGLE_VERTICES.data(),
+            app->sceneVertices.data(),
             vertexBufferSize,
             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             &app->vertexBuffer,
@@ -98,8 +415,9 @@ bool createVertexResources(ApplicationState* app) {
         LOG_ERROR("Failed to upload vertex data to GPU buffer.");
         return false;
     }
+    VK_NAME(app->context, VK_OBJECT_TYPE_BUFFER, app->vertexBuffer, "Scene vertices");
 
-    app->vertexCount = static_cast<uint32_t>(TRIANGLE_VERTICES.size());
+    app->vertexCount = static_cast<uint32_t>(app->sceneVertices.size());
     return true;
 }
 
@@ -109,10 +427,10 @@ void destroyVertexResources(ApplicationState* app) {
 }
 
 bool createIndexResources(ApplicationState* app) {
-    const VkDeviceSize indexBufferSize = sizeof(uint16_t) * TRIANGLE_INDICES.size();
+    const VkDeviceSize indexBufferSize = sizeof(uint16_t) * app->sceneIndices.size();
     if (!uploadToDeviceLocalBuffer(
             app->context,
-            TRIANGLE_INDICES.data(),
+            app->sceneIndices.data(),
             indexBufferSize,
             VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
             &app->indexBuffer,
@@ -120,8 +438,9 @@ bool createIndexResources(ApplicationState* app) {
         LOG_ERROR("Failed to upload index data to GPU buffer.");
         return false;
     }
+    VK_NAME(app->context, VK_OBJECT_TYPE_BUFFER, app->indexBuffer, "Scene indices");
 
-    app->indexCount = static_cast<uint32_t>(TRIANGLE_INDICES.size());
+    app->indexCount = static_cast<uint32_t>(app->sceneIndices.size());
     return true;
 }
 
@@ -130,42 +449,35 @@ void destroyIndexResources(ApplicationState* app) {
     app->indexCount = 0;
 }
 
-bool createImageResources(ApplicationState* app) {
+// Reads on the I/O thread, decodes on a job worker and waits for the upload fence on the I/O thread
+// again, so the texture loads while the main thread creates the other scene resources.
+Task<bool> loadImageResources(ApplicationState* app) {
     int imageWidth = 0;
     int imageHeight = 0;
     int imageChannels = 0;
     stbi_uc* pixels = nullptr;
     const char* loadedPath = nullptr;
-    void* fileBytes = nullptr;
-    size_t fileSize = 0;
+    std::vector<uint8_t> fileBytes;
 
     for (uint32_t i = 0; i < ARRAY_COUNT(IMAGE_PATH_CANDIDATES); ++i) {
         const char* candidatePath = IMAGE_PATH_CANDIDATES[i];
-        fileBytes = SDL_LoadFile(candidatePath, &fileSize);
-        if (fileBytes == nullptr || fileSize == 0) {
-            if (fileBytes != nullptr) {
-                SDL_free(fileBytes);
-                fileBytes = nullptr;
-            }
+        if (!co_await readFileAsync(&app->asyncIo, candidatePath, &fileBytes) || fileBytes.empty()) {
             continue;
         }
-
-        if (fileSize > static_cast<size_t>(INT_MAX)) {
-            SDL_free(fileBytes);
-            fileBytes = nullptr;
+        if (fileBytes.size() > static_cast<size_t>(INT_MAX)) {
             continue;
         }
 
+        // Resumed by a job, so this already runs on a worker.
+        PROFILE_SCOPE("Decode image");
         pixels = stbi_load_from_memory(
-            static_cast<const stbi_uc*>(fileBytes),
-            static_cast<int>(fileSize),
+            fileBytes.data(),
+            static_cast<int>(fileBytes.size()),
             &imageWidth,
             &imageHeight,
             &imageChannels,
             STBI_rgb_alpha
         );
-        SDL_free(fileBytes);
-        fileBytes = nullptr;
         if (pixels != nullptr) {
             loadedPath = candidatePath;
             break;
@@ -174,29 +486,52 @@ bool createImageResources(ApplicationState* app) {
 
     if (pixels == nullptr) {
         LOG_ERROR("Failed to load image file from all candidate paths.");
-        return false;
+        co_return false;
     }
 
-    const bool uploadOk = uploadToDeviceLocalImageRGBA8(
+    VulkanPendingUpload upload = {};
+    const bool uploadStarted = beginUploadToDeviceLocalImageRGBA8(
         app->context,
         pixels,
         static_cast<uint32_t>(imageWidth),
         static_cast<uint32_t>(imageHeight),
         &app->textureImage,
         &app->textureImageMemory,
-        &app->textureImageView
+        &app->textureImageView,
+        &upload
     );
     stbi_image_free(pixels);
 
+    if (!uploadStarted) {
+        LOG_ERROR("Failed to upload loaded image to GPU.");
+        co_return false;
+    }
+    const bool uploadOk = co_await waitForFenceAsync(&app->asyncIo, app->context->device, upload.fence);
+    finishUpload(app->context, &upload);
     if (!uploadOk) {
         LOG_ERROR("Failed to upload loaded image to GPU.");
-        return false;
+        co_return false;
     }
+    VK_NAME(app->context, VK_OBJECT_TYPE_IMAGE, app->textureImage, loadedPath);
+    VK_NAME(app->context, VK_OBJECT_TYPE_IMAGE_VIEW, app->textureImageView, loadedPath);
 
     app->textureWidth = static_cast<uint32_t>(imageWidth);
     app->textureHeight = static_cast<uint32_t>(imageHeight);
     LOG_INFO("Loaded image: ", loadedPath, " (", imageWidth, "x", imageHeight, ")");
-    return true;
+    co_return true;
+}
+
+void startImageLoad(ApplicationState* app) {
+    app->imageLoad = loadImageResources(app);
+    startTask(&app->jobs, &app->imageLoad, &app->imageLoadCounter);
+}
+
+// Main thread only. Has to run before anything the load uses is destroyed, on failure paths too.
+bool finishImageLoad(ApplicationState* app) {
+    waitForCounter(&app->jobs, &app->imageLoadCounter);
+    const bool loaded = app->imageLoad.result();
+    app->imageLoad = {};
+    return loaded;
 }
 
 void destroyImageResources(ApplicationState* app) {
@@ -206,12 +541,129 @@ void destroyImageResources(ApplicationState* app) {
     app->textureHeight = 0;
 }
 
+// Everything in here only depends on the swapchain and the static scene resources,
+// so it can be baked into a secondary command buffer and replayed until either changes.
+// The frame constants are always the first allocation in a frame ring segment, so their offset
+// only depends on the frame slot and stays valid for the recorded secondary buffer of that slot.
+void recordStaticDraws(ApplicationState* app, VkCommandBuffer commandBuffer, VkDeviceSize frameConstantsOffset) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.pipeline);
+
+    const uint32_t dynamicOffset = static_cast<uint32_t>(frameConstantsOffset);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.pipelineLayout, 0, 1, &app->frameRing.uniformSet, 1, &dynamicOffset);
+
+    // Keep content fixed at BASE_RENDER size when the window grows.
+    // If window is smaller than the base size, uniformly scale down to fit.
+    const float scaleX = static_cast<float>(app->swapchain.width) / static_cast<float>(BASE_RENDER_WIDTH);
+    const float scaleY = static_cast<float>(app->swapchain.height) / static_cast<float>(BASE_RENDER_HEIGHT);
+    float renderScale = (scaleX < scaleY) ? scaleX : scaleY;
+    if (renderScale > 1.0f) {
+        renderScale = 1.0f;
+    }
+
+    uint32_t viewportWidth = static_cast<uint32_t>(static_cast<float>(BASE_RENDER_WIDTH) * renderScale);
+    uint32_t viewportHeight = static_cast<uint32_t>(static_cast<float>(BASE_RENDER_HEIGHT) * renderScale);
+    if (viewportWidth == 0) {
+        viewportWidth = 1;
+    }
+    if (viewportHeight == 0) {
+        viewportHeight = 1;
+    }
+
+    const int32_t viewportOffsetX = static_cast<int32_t>((app->swapchain.width - viewportWidth) / 2);
+    const int32_t viewportOffsetY = static_cast<int32_t>((app->swapchain.height - viewportHeight) / 2);
+
+    VkViewport viewport = {};
+    viewport.x = static_cast<float>(viewportOffsetX);
+    viewport.y = static_cast<float>(viewportOffsetY);
+    viewport.width = static_cast<float>(viewportWidth);
+    viewport.height = static_cast<float>(viewportHeight);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = {viewportOffsetX, viewportOffsetY};
+    scissor.extent = {viewportWidth, viewportHeight};
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    VkDeviceSize vertexBufferOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &app->vertexBuffer, &vertexBufferOffset);
+    vkCmdBindIndexBuffer(commandBuffer, app->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    vkCmdDrawIndexed(commandBuffer, app->indexCount, 1, 0, 0, 0);
+}
+
+void recordMainPass(VkCommandBuffer commandBuffer, void* userData) {
+    ApplicationState* app = static_cast<ApplicationState*>(userData);
+    const FrameRecordState& state = app->recordState;
+
+    VkClearValue clearValue = {};
+    clearValue.color = state.clearColor;
+    VkRenderPassBeginInfo beginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+    beginInfo.renderPass = app->renderPass;
+    beginInfo.framebuffer = app->framebuffers[state.imageIndex];
+    beginInfo.renderArea = {{0, 0}, {app->swapchain.width, app->swapchain.height} };
+    beginInfo.clearValueCount = 1;
+    beginInfo.pClearValues = &clearValue;
+
+    if (app->useStaticCommands) {
+        // The frame fence was waited on before recording, so this slot's secondary buffer is no longer pending.
+        if (!staticCommandsUpToDate(&app->staticCommands, state.frame)) {
+            VkCommandBuffer staticCommandBuffer = beginStaticCommands(app->context, &app->staticCommands, state.frame, app->renderPass, 0);
+            recordStaticDraws(app, staticCommandBuffer, state.frameConstantsOffset);
+            endStaticCommands(app->context, &app->staticCommands, state.frame);
+        }
+
+        vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(commandBuffer, 1, &app->staticCommands.commandBuffers[state.frame]);
+    } else {
+        vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordStaticDraws(app, commandBuffer, state.frameConstantsOffset);
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void recordHudPass(VkCommandBuffer commandBuffer, void* userData) {
+    ApplicationState* app = static_cast<ApplicationState*>(userData);
+    recordHud(&app->hud, commandBuffer, app->framebuffers[app->recordState.imageIndex], app->swapchain.width, app->swapchain.height);
+}
+
+// The swapchain image is imported fresh from acquire each frame and handed back for present;
+// every layout change in between is derived from the pass declarations.
+bool buildFrameGraph(ApplicationState* app) {
+    RenderGraphImageDesc backbufferDesc = {};
+    backbufferDesc.width = app->swapchain.width;
+    backbufferDesc.height = app->swapchain.height;
+    backbufferDesc.format = app->swapchain.format;
+    backbufferDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    backbufferDesc.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    backbufferDesc.mipLevels = 1;
+    backbufferDesc.arrayLayers = 1;
+    // Offscreen images end the frame ready to be copied out for readback instead of presented.
+    const VulkanResourceAccess finalAccess = app->swapchain.offscreen ? VULKAN_ACCESS_TRANSFER_READ : VULKAN_ACCESS_PRESENT;
+    app->backbuffer = renderGraphImportImage(&app->frameGraph, "backbuffer", backbufferDesc, VULKAN_ACCESS_ACQUIRE, finalAccess);
+
+    const uint32_t mainPass = renderGraphAddPass(&app->frameGraph, "main", recordMainPass, app);
+    renderGraphUse(&app->frameGraph, mainPass, app->backbuffer, VULKAN_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+    // Draws on top of the main pass. Records nothing while the HUD is hidden.
+    const uint32_t hudPass = renderGraphAddPass(&app->frameGraph, "hud", recordHudPass, app);
+    renderGraphUse(&app->frameGraph, hudPass, app->backbuffer, VULKAN_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+    return compileRenderGraph(app->context, &app->frameGraph);
+}
+
 void destroySwapchainResources(ApplicationState* app) {
+    destroyRenderGraph(app->context, &app->frameGraph);
+    app->backbuffer = RENDER_GRAPH_INVALID_RESOURCE;
+
     for (uint32_t i = 0; i < app->framebuffers.size(); i++) {
-        VK(vkDestroyFramebuffer(app->context->device, app->framebuffers[i], nullptr));
+        VK(vkDestroyFramebuffer(app->context->device, app->framebuffers[i], app->context->allocator));
     }
     app->framebuffers.clear();
 
+    destroyHudSwapchainResources(app->context, &app->hud);
+
     if (app->pipeline.pipeline != VK_NULL_HANDLE || app->pipeline.pipelineLayout != VK_NULL_HANDLE) {
         destroyPipeline(app->context, &app->pipeline);
         app->pipeline = {};
@@ -226,7 +678,7 @@ void destroySwapchainResources(ApplicationState* app) {
 
     for (uint32_t i = 0; i < app->releaseSemaphores.size(); i++) {
         if (app->releaseSemaphores[i] != VK_NULL_HANDLE) {
-            VK(vkDestroySemaphore(app->context->device, app->releaseSemaphores[i], nullptr));
+            VK(vkDestroySemaphore(app->context->device, app->releaseSemaphores[i], app->context->allocator));
         }
     }
     app->releaseSemaphores.clear();
@@ -234,18 +686,29 @@ void destroySwapchainResources(ApplicationState* app) {
 }
 
 bool createSwapchainResources(ApplicationState* app) {
-    app->swapchain = createSwapChain(app->context, app->surface, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-    if (app->swapchain.swapChain == VK_NULL_HANDLE) {
+    if (app->headless) {
+        app->swapchain = createOffscreenSwapChain(
+            app->context,
+            static_cast<uint32_t>(app->windowPixelWidth.load(std::memory_order_relaxed)),
+            static_cast<uint32_t>(app->windowPixelHeight.load(std::memory_order_relaxed)),
+            HEADLESS_FORMAT,
+            HEADLESS_IMAGE_COUNT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    } else {
+        app->swapchain = createSwapChain(app->context, app->surface, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, app->presentMode);
+    }
+    if (app->swapchain.images.empty()) {
         LOG_ERROR("Failed to create swapchain.");
         return false;
     }
 
-    app->renderPass = createRenderPass(app->context, app->swapchain.format);
+    app->renderPass = createRenderPass(app->context, app->swapchain.format, VK_ATTACHMENT_LOAD_OP_CLEAR);
     if (app->renderPass == VK_NULL_HANDLE) {
         LOG_ERROR("Failed to create render pass.");
         destroySwapChain(app->context, &app->swapchain);
         return false;
     }
+    VK_NAME(app->context, VK_OBJECT_TYPE_RENDER_PASS, app->renderPass, "Main render pass");
 
     app->framebuffers.resize(app->swapchain.images.size());
     for (uint32_t i = 0; i < app->swapchain.images.size(); i++) {
@@ -256,7 +719,8 @@ bool createSwapchainResources(ApplicationState* app) {
         createInfo.width = app->swapchain.width;
         createInfo.height = app->swapchain.height;
         createInfo.layers = 1;
-        VKA(vkCreateFramebuffer(app->context->device, &createInfo, 0, &app->framebuffers[i]))
+        VKA(vkCreateFramebuffer(app->context->device, &createInfo, app->context->allocator, &app->framebuffers[i]))
+        VK_NAME(app->context, VK_OBJECT_TYPE_FRAMEBUFFER, app->framebuffers[i], "Main framebuffer");
     }
 
     app->pipeline = createPipeline(
@@ -265,12 +729,13 @@ bool createSwapchainResources(ApplicationState* app) {
         "../shaders/triangle_frag.spv",
         app->renderPass,
         app->swapchain.width,
-        app->swapchain.height
+        app->swapchain.height,
+        app->frameRing.uniformSetLayout
     );
     if (app->pipeline.pipeline == VK_NULL_HANDLE || app->pipeline.pipelineLayout == VK_NULL_HANDLE) {
         LOG_ERROR("Failed to create graphics pipeline.");
         for (uint32_t i = 0; i < app->framebuffers.size(); i++) {
-            VK(vkDestroyFramebuffer(app->context->device, app->framebuffers[i], nullptr));
+            VK(vkDestroyFramebuffer(app->context->device, app->framebuffers[i], app->context->allocator));
         }
         app->framebuffers.clear();
         destroyRenderPass(app->context, app->renderPass);
@@ -279,29 +744,41 @@ bool createSwapchainResources(ApplicationState* app) {
         return false;
     }
 
+    // Shares the main framebuffers; its render pass only differs in the load op.
+    if (!createHudSwapchainResources(app->context, &app->hud, app->swapchain.format, app->swapchain.width, app->swapchain.height)) {
+        destroySwapchainResources(app);
+        return false;
+    }
+
     VkSemaphoreCreateInfo semaphoreCreateInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
     app->releaseSemaphores.resize(app->swapchain.images.size(), VK_NULL_HANDLE);
     for (uint32_t i = 0; i < app->swapchain.images.size(); i++) {
-        VKA(vkCreateSemaphore(app->context->device, &semaphoreCreateInfo, nullptr, &app->releaseSemaphores[i]));
+        VKA(vkCreateSemaphore(app->context->device, &semaphoreCreateInfo, app->context->allocator, &app->releaseSemaphores[i]));
+        VK_NAME(app->context, VK_OBJECT_TYPE_SEMAPHORE, app->releaseSemaphores[i], "Release semaphore");
     }
 
     app->imagesInFlight.assign(app->swapchain.images.size(), VK_NULL_HANDLE);
+
+    if (!buildFrameGraph(app)) {
+        LOG_ERROR("Failed to compile frame graph.");
+        destroySwapchainResources(app);
+        return false;
+    }
     return true;
 }
 
+// Render thread only.
 bool recreateSwapchain(ApplicationState* app) {
-    int width = 0;
-    int height = 0;
-    SDL_GetWindowSizeInPixels(app->window, &width, &height);
-    while (width == 0 || height == 0) {
-        if (!handleMessage(app)) {
-            return false;
-        }
-        SDL_Delay(10);
-        SDL_GetWindowSizeInPixels(app->window, &width, &height);
+    PROFILE_FUNCTION();
+    // A minimized window has nothing to present to. Keep the resize pending until the
+    // main thread publishes a usable size again.
+    if (app->windowPixelWidth.load(std::memory_order_relaxed) == 0 || app->windowPixelHeight.load(std::memory_order_relaxed) == 0) {
+        app->framebufferResized = true;
+        return true;
     }
 
-    VKA(vkDeviceWaitIdle(app->context->device));
+    ALLOW_ALLOC_SCOPE();
+    waitForDeviceIdle(app->context);
     destroySwapchainResources(app);
 
     if (!createSwapchainResources(app)) {
@@ -309,37 +786,40 @@ bool recreateSwapchain(ApplicationState* app) {
         return false;
     }
 
+    // Viewport, pipeline and render pass all changed, so the baked draws are stale.
+    invalidateStaticCommands(&app->staticCommands);
+    // Present ids of the old swapchain can no longer be waited on.
+    app->swapchainFirstPresentId = app->nextPresentId;
     app->framebufferResized = false;
     return true;
 }
 
-bool initApplication(ApplicationState* app) {
-    app->window = nullptr;
-    app->context = nullptr;
-    app->surface = VK_NULL_HANDLE;
-    app->swapchain = {};
-    app->renderPass = VK_NULL_HANDLE;
-    app->pipeline = {};
-    app->vertexBuffer = VK_NULL_HANDLE;
-    app->vertexBufferMemory = VK_NULL_HANDLE;
-    app->vertexCount = 0;
-    app->indexBuffer = VK_NULL_HANDLE;
-    app->indexBufferMemory = VK_NULL_HANDLE;
-    app->indexCount = 0;
-    app->textureImage = VK_NULL_HANDLE;
-    app->textureImageMemory = VK_NULL_HANDLE;
-    app->textureImageView = VK_NULL_HANDLE;
-    app->textureWidth = 0;
-    app->textureHeight = 0;
-    app->commandPools.clear();
-    app->commandBuffers.clear();
-    app->inFlightFences.clear();
-    app->acquireSemaphores.clear();
-    app->releaseSemaphores.clear();
-    app->imagesInFlight.clear();
-    app->framesInFlight = MAX_FRAMES_IN_FLIGHT;
-    app->currentFrame = 0;
-    app->framebufferResized = false;
+void destroySurface(ApplicationState* app) {
+    if (app->surface != VK_NULL_HANDLE) {
+        VK(vkDestroySurfaceKHR(app->context->instance, app->surface, app->context->allocator));
+        app->surface = VK_NULL_HANDLE;
+    }
+}
+
+// Windowed: an SDL window, the instance extensions SDL needs for it and a surface.
+// Headless: no window and neither surface nor swapchain extensions, so it also runs without a
+// display server, e.g. on lavapipe. Only the event subsystem is initialised to receive quit requests.
+bool createWindowAndContext(ApplicationState* app) {
+    if (app->headless) {
+        if (!SDL_Init(SDL_INIT_EVENTS)) {
+            LOG_ERROR("SDL_Init failed: ", SDL_GetError());
+            return false;
+        }
+        publishWindowSize(app);
+
+        app->context = initVulkan(0, nullptr, 0, nullptr, &HOST_ALLOCATOR_BACKEND);
+        if (app->context == nullptr) {
+            LOG_ERROR("Vulkan initialization failed.");
+            SDL_Quit();
+            return false;
+        }
+        return true;
+    }
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         LOG_ERROR("SDL_Init failed: ", SDL_GetError());
@@ -358,6 +838,7 @@ bool initApplication(ApplicationState* app) {
         SDL_Quit();
         return false;
     }
+    publishWindowSize(app);
 
     uint32_t instanceExtensionCount = 0;
     const char* const* enabledInstanceExtensions = SDL_Vulkan_GetInstanceExtensions(&instanceExtensionCount);
@@ -372,7 +853,7 @@ bool initApplication(ApplicationState* app) {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
-    app->context = initVulkan(instanceExtensionCount, enabledInstanceExtensions, ARRAY_COUNT(deviceExtensions), deviceExtensions);
+    app->context = initVulkan(instanceExtensionCount, enabledInstanceExtensions, ARRAY_COUNT(deviceExtensions), deviceExtensions, &HOST_ALLOCATOR_BACKEND);
     if (app->context == nullptr) {
         LOG_ERROR("Vulkan initialization failed.");
         SDL_DestroyWindow(app->window);
@@ -380,7 +861,7 @@ bool initApplication(ApplicationState* app) {
         return false;
     }
 
-    if (!SDL_Vulkan_CreateSurface(app->window, app->context->instance, nullptr, &app->surface)) {
+    if (!SDL_Vulkan_CreateSurface(app->window, app->context->instance, app->context->allocator, &app->surface)) {
         LOG_ERROR("SDL_Vulkan_CreateSurface failed: ", SDL_GetError());
         exitVulkan(app->context);
         SDL_DestroyWindow(app->window);
@@ -388,8 +869,131 @@ bool initApplication(ApplicationState* app) {
         return false;
     }
 
+    return true;
+}
+
+bool initApplication(ApplicationState* app, const CommandLineOptions& options) {
+    app->window = nullptr;
+    app->context = nullptr;
+    app->surface = VK_NULL_HANDLE;
+    app->swapchain = {};
+    app->renderPass = VK_NULL_HANDLE;
+    app->frameGraph = {};
+    app->backbuffer = RENDER_GRAPH_INVALID_RESOURCE;
+    app->recordState = {};
+    app->pipeline = {};
+    app->vertexBuffer = VK_NULL_HANDLE;
+    app->vertexBufferMemory = VK_NULL_HANDLE;
+    app->vertexCount = 0;
+    app->indexBuffer = VK_NULL_HANDLE;
+    app->indexBufferMemory = VK_NULL_HANDLE;
+    app->indexCount = 0;
+    app->textureImage = VK_NULL_HANDLE;
+    app->textureImageMemory = VK_NULL_HANDLE;
+    app->textureImageView = VK_NULL_HANDLE;
+    app->textureWidth = 0;
+    app->textureHeight = 0;
+    app->commandPools.clear();
+    app->commandBuffers.clear();
+    app->inFlightFences.clear();
+    app->acquireSemaphores.clear();
+    app->releaseSemaphores.clear();
+    app->imagesInFlight.clear();
+    app->staticCommands = {};
+    app->useStaticCommands = USE_STATIC_COMMAND_BUFFERS;
+    app->frameRing = {};
+    app->framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    app->currentFrame = 0;
+    app->framebufferResized = false;
+    app->nextOffscreenImage = 0;
+    app->lastPresentedImage = UINT32_MAX;
+    app->frameNumber = 0;
+    app->greenChannel = 0.0f;
+    app->resizePending = false;
+    app->renderThreadFailed = false;
+    app->lastGpuCompleteNs = 0;
+    app->nextPresentId = 1;
+    app->swapchainFirstPresentId = 1;
+    std::memset(app->presentInputNs, 0, sizeof(app->presentInputNs));
+    app->gpuProfiler = {};
+    app->lastGpuProfilerLogNs = 0;
+    app->lastPacerLogNs = 0;
+    app->benchmark = options.benchmark;
+    app->headless = options.headless;
+    app->frameLimit = options.frameLimit;
+    app->readbackPath = options.readbackPath;
+    app->regression = options.regression;
+    app->goldenDir = options.goldenDir;
+    app->updateGolden = options.updateGolden;
+    app->regressionCaptures.assign(app->regression ? REGRESSION_CASE_COUNT : 0, ImageBGRA8{});
+    app->recordTimesMs.clear();
+    app->recordTimesMs.reserve(app->frameLimit);
+    app->captureAllocations = 0;
+    app->lastHostAllocationCount = 0;
+    app->hud = {};
+    app->hudVisible = options.hud;
+    app->lastRenderFrameBeginNs = 0;
+    app->lastUploadedBytes = 0;
+    app->lastFrameUploadBytes = 0;
+    app->lastHudQuadCount = 0;
+    app->lastHudBuildMs = 0.0;
+    app->hudHeapCount = 0;
+    app->initDeviceAllocations = 0;
+    // The benchmark measures throughput, so neither vsync nor the frame cap may limit it.
+    app->presentMode = app->benchmark.enabled ? VK_PRESENT_MODE_IMMEDIATE_KHR : VK_PRESENT_MODE_FIFO_KHR;
+    app->benchmarkFrameTimesMs.clear();
+    app->benchmarkStartNs = 0;
+    app->benchmarkEndNs = 0;
+    initFramePacer(&app->framePacer, app->benchmark.enabled ? 0.0 : FRAME_RATE_LIMIT);
+    app->sceneBuildCounters = {};
+    app->renderFrameCounters = {};
+    makeRandomJump(&app->sceneBandJump, static_cast<uint64_t>(SCENE_BAND_ROWS) * BENCHMARK_GRID_SIZE * SCENE_RANDOMS_PER_CELL);
+    if (app->benchmark.enabled) {
+        PerfCounters counters = {};
+        openPerfCounters(&counters);
+        {
+            // Counts the calling thread only, which builds its share of the bands and merges.
+            PerfCounterScope scope(&counters, &app->sceneBuildCounters);
+            buildScene(app);
+        }
+        closePerfCounters(&counters);
+    } else {
+        buildScene(app);
+    }
+    if (app->benchmark.enabled) {
+        app->benchmarkFrameTimesMs.reserve(app->benchmark.frameCount);
+        LOG_INFO("Benchmark: ", app->benchmark.frameCount, " frames, ", app->sceneQuadCount, " quads, seed ", static_cast<unsigned long long>(app->benchmark.seed));
+    }
+
+    if (!createWindowAndContext(app)) {
+        return false;
+    }
+
+    if (!createFrameRing(app->context, FRAME_RING_SIZE, app->framesInFlight, sizeof(FrameConstants), &app->frameRing)) {
+        destroySurface(app);
+        exitVulkan(app->context);
+        SDL_DestroyWindow(app->window);
+        SDL_Quit();
+        return false;
+    }
+
+    if (!createHud(app->context, &app->hud)) {
+        destroyFrameRing(app->context, &app->frameRing);
+        destroySurface(app);
+        exitVulkan(app->context);
+        SDL_DestroyWindow(app->window);
+        SDL_Quit();
+        return false;
+    }
+
+    startImageLoad(app);
+
     if (!createSwapchainResources(app)) {
-        VK(vkDestroySurfaceKHR(app->context->instance, app->surface, nullptr));
+        finishImageLoad(app);
+        destroyImageResources(app);
+        destroyHud(app->context, &app->hud);
+        destroyFrameRing(app->context, &app->frameRing);
+        destroySurface(app);
         exitVulkan(app->context);
         SDL_DestroyWindow(app->window);
         SDL_Quit();
@@ -397,8 +1001,12 @@ bool initApplication(ApplicationState* app) {
     }
 
     if (!createVertexResources(app)) {
+        finishImageLoad(app);
+        destroyImageResources(app);
         destroySwapchainResources(app);
-        VK(vkDestroySurfaceKHR(app->context->instance, app->surface, nullptr));
+        destroyHud(app->context, &app->hud);
+        destroyFrameRing(app->context, &app->frameRing);
+        destroySurface(app);
         exitVulkan(app->context);
         SDL_DestroyWindow(app->window);
         SDL_Quit();
@@ -406,20 +1014,27 @@ bool initApplication(ApplicationState* app) {
     }
 
     if (!createIndexResources(app)) {
+        finishImageLoad(app);
+        destroyImageResources(app);
         destroyVertexResources(app);
         destroySwapchainResources(app);
-        VK(vkDestroySurfaceKHR(app->context->instance, app->surface, nullptr));
+        destroyHud(app->context, &app->hud);
+        destroyFrameRing(app->context, &app->frameRing);
+        destroySurface(app);
         exitVulkan(app->context);
         SDL_DestroyWindow(app->window);
         SDL_Quit();
         return false;
     }
 
-    if (!createImageResources(app)) {
+    if (!finishImageLoad(app)) {
+        destroyImageResources(app);
         destroyIndexResources(app);
         destroyVertexResources(app);
         destroySwapchainResources(app);
-        VK(vkDestroySurfaceKHR(app->context->instance, app->surface, nullptr));
+        destroyHud(app->context, &app->hud);
+        destroyFrameRing(app->context, &app->frameRing);
+        destroySurface(app);
         exitVulkan(app->context);
         SDL_DestroyWindow(app->window);
         SDL_Quit();
@@ -430,186 +1045,686 @@ bool initApplication(ApplicationState* app) {
     app->commandBuffers.resize(app->framesInFlight, VK_NULL_HANDLE);
     app->inFlightFences.resize(app->framesInFlight, VK_NULL_HANDLE);
     app->acquireSemaphores.resize(app->framesInFlight, VK_NULL_HANDLE);
+    app->frameInputNs.assign(app->framesInFlight, 0);
+    app->frameSubmitNs.assign(app->framesInFlight, 0);
 
     {
         VkSemaphoreCreateInfo semaphoreCreateInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
         for (uint32_t frame = 0; frame < app->framesInFlight; frame++) {
-            VKA(vkCreateSemaphore(app->context->device, &semaphoreCreateInfo, nullptr, &app->acquireSemaphores[frame]));
+            VKA(vkCreateSemaphore(app->context->device, &semaphoreCreateInfo, app->context->allocator, &app->acquireSemaphores[frame]));
+            VK_NAME(app->context, VK_OBJECT_TYPE_SEMAPHORE, app->acquireSemaphores[frame], "Acquire semaphore");
         }
     }
 
     for (uint32_t frame = 0; frame < app->framesInFlight; frame++) {
         VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
         fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-        VK(vkCreateFence(app->context->device, &fenceCreateInfo, nullptr, &app->inFlightFences[frame]));
+        VK(vkCreateFence(app->context->device, &fenceCreateInfo, app->context->allocator, &app->inFlightFences[frame]));
 
         VkCommandPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
         poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
         poolCreateInfo.queueFamilyIndex = app->context->graphicsQueue.familyIndex;
-        VKA(vkCreateCommandPool(app->context->device, &poolCreateInfo, 0, &app->commandPools[frame]));
+        VKA(vkCreateCommandPool(app->context->device, &poolCreateInfo, app->context->allocator, &app->commandPools[frame]));
 
         VkCommandBufferAllocateInfo bufferAllocateInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
         bufferAllocateInfo.commandPool = app->commandPools[frame];
         bufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         bufferAllocateInfo.commandBufferCount = 1;
         VKA(vkAllocateCommandBuffers(app->context->device, &bufferAllocateInfo, &app->commandBuffers[frame]));
+        VK_NAME(app->context, VK_OBJECT_TYPE_FENCE, app->inFlightFences[frame], "Frame fence");
+        VK_NAME(app->context, VK_OBJECT_TYPE_COMMAND_BUFFER, app->commandBuffers[frame], "Frame commands");
+    }
+
+    if (app->useStaticCommands && !createStaticCommands(app->context, app->framesInFlight, &app->staticCommands)) {
+        LOG_WARN("Static command buffers unavailable. Falling back to per-frame recording.");
+        app->useStaticCommands = false;
+    }
+
+    if (!createGpuProfiler(app->context, app->framesInFlight, GPU_PROFILER_MAX_SCOPES, &app->gpuProfiler)) {
+        LOG_WARN("GPU profiler unavailable.");
+        app->gpuProfiler = {};
     }
 
+    app->initDeviceAllocations = app->context->deviceAllocationCount;
+
+    // Benchmark and regression runs measure themselves; writing captures would only disturb them.
+    double hitchThreshold = options.hitchThreshold;
+    if (hitchThreshold < 0.0) {
+        hitchThreshold = (app->benchmark.enabled || app->regression) ? 0.0 : HITCH_DEFAULT_THRESHOLD;
+    }
+    startHitchDetector(&app->hitchDetector, hitchThreshold, options.hitchDir);
     return true;
 }
 
-void renderApplication(ApplicationState* app) {
-    while (handleMessage(app)) {
-        static float greenChannel = 0.0f;
-        greenChannel += 0.01f;
-        if (greenChannel > 1.0f) greenChannel = 0.0f;
+// Render thread only. Waits for the frame slot to be reusable and feeds the frame pacer with what
+// the fence tells about the previous submission of that slot. Without timestamp queries the GPU time
+// is estimated as the time from when the GPU could start the submission to when the fence was seen
+// signalled. A fence that is already signalled means the GPU is off the critical path; that counts
+// as zero so a stale estimate cannot hold the pacer back. With the GPU profiler enabled the measured
+// frame time is reported instead, see renderFrame().
+bool waitForFrameSlot(ApplicationState* app, uint32_t frame) {
+    PROFILE_FUNCTION();
+    VkFence frameFence = app->inFlightFences[frame];
+    const uint64_t submitNs = app->frameSubmitNs[frame];
+    const bool alreadySignalled = (VK(vkGetFenceStatus(app->context->device, frameFence)) == VK_SUCCESS);
+    if (!alreadySignalled) {
+        VKA(vkWaitForFences(app->context->device, 1, &frameFence, VK_TRUE, UINT64_MAX));
+    }
+    if (submitNs == 0) {
+        return true;
+    }
 
-        if (app->framebufferResized) {
-            if (!recreateSwapchain(app)) {
-                break;
-            }
-            continue;
-        }
+    const uint64_t observedNs = framePacerNow();
+    const uint64_t gpuStartNs = submitNs > app->lastGpuCompleteNs ? submitNs : app->lastGpuCompleteNs;
+    if (!app->gpuProfiler.enabled) {
+        framePacerReportGpu(&app->framePacer, alreadySignalled ? 0 : observedNs - gpuStartNs);
+    }
+    app->lastGpuCompleteNs = observedNs;
+    app->frameSubmitNs[frame] = 0;
 
-        const uint32_t frame = app->currentFrame;
-        VkFence frameFence = app->inFlightFences[frame];
-        VkCommandPool frameCommandPool = app->commandPools[frame];
-        VkCommandBuffer frameCommandBuffer = app->commandBuffers[frame];
-        VkSemaphore acquireSemaphore = app->acquireSemaphores[frame];
+    if (!app->context->presentWaitEnabled) {
+        framePacerReportLatency(&app->framePacer, observedNs - app->frameInputNs[frame], false);
+    }
+    return true;
+}
 
-        VKA(vkWaitForFences(app->context->device, 1, &frameFence, VK_TRUE, UINT64_MAX));
+// Render thread only. With VK_KHR_present_wait, blocks until the present from two frames ago is on
+// screen. That keeps at most one present queued, which bounds latency, and the return time of the
+// wait is the real input-to-present latency of that frame.
+void waitForPreviousPresent(ApplicationState* app) {
+    PROFILE_FUNCTION();
+    if (!app->context->presentWaitEnabled || app->nextPresentId < app->swapchainFirstPresentId + 2) {
+        return;
+    }
 
-        uint32_t imageIndex = 0;
-        VkResult acquireResult = VK(vkAcquireNextImageKHR(
-            app->context->device,
-            app->swapchain.swapChain,
-            UINT64_MAX,
-            acquireSemaphore,
-            nullptr,
-            &imageIndex
-        ));
-        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
-            if (!recreateSwapchain(app)) {
-                break;
-            }
+    const uint64_t presentId = app->nextPresentId - 2;
+    // Bounded so a present that never completes (occluded window) cannot hang the render thread.
+    const VkResult result = app->context->vkWaitForPresentKHR(app->context->device, app->swapchain.swapChain, presentId, 100000000);
+    if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+        const uint64_t presentedNs = framePacerNow();
+        framePacerReportLatency(&app->framePacer, presentedNs - app->presentInputNs[presentId % PRESENT_HISTORY_SIZE], true);
+    } else if (result != VK_TIMEOUT && result != VK_ERROR_OUT_OF_DATE_KHR) {
+        LOG_WARN("vkWaitForPresentKHR failed: ", static_cast<int>(result));
+    }
+}
+
+// Render thread only. Swapchain images are acquired and signal acquireSemaphore. Offscreen images
+// are used round robin and are ready as soon as the fence in imagesInFlight says so.
+VkResult acquireFrameImage(ApplicationState* app, VkSemaphore acquireSemaphore, uint32_t* imageIndex) {
+    if (app->swapchain.offscreen) {
+        *imageIndex = app->nextOffscreenImage;
+        app->nextOffscreenImage = (app->nextOffscreenImage + 1) % static_cast<uint32_t>(app->swapchain.images.size());
+        return VK_SUCCESS;
+    }
+
+    PROFILE_SCOPE("vkAcquireNextImageKHR");
+    return VK(vkAcquireNextImageKHR(
+        app->context->device,
+        app->swapchain.swapChain,
+        UINT64_MAX,
+        acquireSemaphore,
+        nullptr,
+        imageIndex
+    ));
+}
+
+// Render thread only. Offscreen images have nothing to present to; the last one is kept for readback.
+VkResult presentFrameImage(ApplicationState* app, uint32_t imageIndex, VkSemaphore releaseSemaphore, uint64_t inputTimeNs) {
+    app->lastPresentedImage = imageIndex;
+    if (app->swapchain.offscreen) {
+        return VK_SUCCESS;
+    }
+
+    VkPresentInfoKHR presentInfo = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &app->swapchain.swapChain;
+    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &releaseSemaphore;
+
+    const uint64_t presentId = app->nextPresentId;
+    VkPresentIdKHR presentIdInfo = {VK_STRUCTURE_TYPE_PRESENT_ID_KHR};
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &presentId;
+    if (app->context->presentWaitEnabled) {
+        presentInfo.pNext = &presentIdInfo;
+        app->presentInputNs[presentId % PRESENT_HISTORY_SIZE] = inputTimeNs;
+        app->nextPresentId++;
+    }
+
+    PROFILE_SCOPE("vkQueuePresentKHR");
+    std::lock_guard<std::mutex> lock(app->context->graphicsQueueMutex);
+    return VK(vkQueuePresentKHR(app->context->graphicsQueue.queue, &presentInfo));
+}
+
+// Render thread only. Waits for the frame and copies its offscreen image out. The readback submits
+// under the graphics queue lock like every other queue use.
+bool captureFrameImage(ApplicationState* app, VkFence frameFence, uint32_t imageIndex, ImageBGRA8* capture) {
+    PROFILE_FUNCTION();
+    ALLOW_ALLOC_SCOPE();
+    VKA(vkWaitForFences(app->context->device, 1, &frameFence, VK_TRUE, UINT64_MAX));
+    const uint64_t allocationsBefore = app->context->deviceAllocationCount;
+    capture->width = app->swapchain.width;
+    capture->height = app->swapchain.height;
+    const bool readOk = readbackImage(app->context, app->swapchain.images[imageIndex], app->swapchain.width, app->swapchain.height, &capture->pixels);
+    app->captureAllocations += app->context->deviceAllocationCount - allocationsBefore;
+    if (!readOk) {
+        LOG_ERROR("Failed to read back regression frame.");
+    }
+    return readOk;
+}
+
+// Render thread only. Puts the driver's host memory and its allocations since the previous frame
+// into the profiler trace, so per-frame driver allocations stand out.
+void reportHostAllocations(ApplicationState* app) {
+    const VulkanHostAllocationStats stats = getVulkanHostAllocationStats(&app->context->hostAllocator);
+    PROFILE_COUNTER("Vulkan host bytes", stats.totalLiveBytes);
+    PROFILE_COUNTER("Vulkan host allocations per frame", stats.totalAllocationCount - app->lastHostAllocationCount);
+    app->lastHostAllocationCount = stats.totalAllocationCount;
+}
+
+// Render thread only. Lays out the HUD from statistics the render thread already keeps, so
+// nothing in here waits on the GPU. The memory heaps are the only driver query and are cached.
+void buildHud(ApplicationState* app, uint64_t frameNumber) {
+    PROFILE_FUNCTION();
+    const uint64_t buildBeginNs = framePacerNow();
+    Hud* hud = &app->hud;
+    if (app->hudHeapCount == 0 || frameNumber % HUD_MEMORY_REFRESH_FRAMES == 0) {
+        app->hudHeapCount = getMemoryHeapStats(app->context, app->hudHeaps, VK_MAX_MEMORY_HEAPS);
+    }
+
+    uint32_t deviceHeapCount = 0;
+    for (uint32_t i = 0; i < app->hudHeapCount; i++) {
+        deviceHeapCount += app->hudHeaps[i].deviceLocal ? 1 : 0;
+    }
+    const uint32_t gpuScopeCount = getGpuProfilerScopeCount(&app->gpuProfiler);
+    const float graphHeight = 64.0f;
+    const float margin = 8.0f;
+    const uint32_t lineCount = 9 + gpuScopeCount + deviceHeapCount;
+    const float panelHeight = margin * 3.0f + graphHeight + HUD_LINE_HEIGHT * static_cast<float>(lineCount);
+
+    const uint32_t textColor = hudColor(235, 235, 235, 255);
+    const uint32_t dimColor = hudColor(170, 170, 170, 255);
+    hudRect(hud, margin, margin, HUD_PANEL_WIDTH, panelHeight, hudColor(0, 0, 0, 140));
+    const float x = margin * 2.0f;
+    float y = margin * 2.0f;
+    char line[128];
+
+    const FramePacerStats pacer = getFramePacerStats(&app->framePacer);
+    const double fps = pacer.frameIntervalMs > 0.0 ? 1000.0 / pacer.frameIntervalMs : 0.0;
+    std::snprintf(line, sizeof(line), "Frame %6.2f ms %6.1f fps  HUD %.3f ms", pacer.frameIntervalMs, fps, app->lastHudBuildMs);
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    hudFrameTimeGraph(hud, x, y, HUD_PANEL_WIDTH - margin * 2.0f, graphHeight, HUD_TARGET_FRAME_MS);
+    y += graphHeight + margin;
+
+    std::snprintf(line, sizeof(line), "CPU main %.2f ms  render %.2f ms", pacer.mainCpuMs, pacer.renderCpuMs);
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "GPU %.2f ms  latency %.2f ms", pacer.gpuMs, pacer.latencyMs);
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    for (uint32_t i = 0; i < gpuScopeCount; i++) {
+        VulkanGpuProfilerStats stats = {};
+        getGpuProfilerStats(&app->gpuProfiler, i, &stats);
+        std::snprintf(line, sizeof(line), "  %-12s %6.3f ms  p95 %6.3f ms", stats.name, stats.averageMs, stats.p95Ms);
+        hudText(hud, x, y, line, dimColor);
+        y += HUD_LINE_HEIGHT;
+    }
+
+    // The scene is one indexed draw; the HUD adds one more while it has quads.
+    const uint32_t drawCount = 1 + (app->lastHudQuadCount > 0 ? 1 : 0);
+    const uint32_t triangleCount = app->indexCount / 3 + app->lastHudQuadCount * 2;
+    std::snprintf(line, sizeof(line), "Draws %u  triangles %u", drawCount, triangleCount);
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "Upload %.1f KiB/frame", static_cast<double>(app->lastFrameUploadBytes) / 1024.0);
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    for (uint32_t i = 0; i < app->hudHeapCount; i++) {
+        const VulkanMemoryHeapStats& heap = app->hudHeaps[i];
+        if (!heap.deviceLocal) {
             continue;
         }
-        if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
-            LOG_ERROR("vkAcquireNextImageKHR failed: ", static_cast<int>(acquireResult));
-            break;
-        }
-        const bool swapchainSuboptimal = (acquireResult == VK_SUBOPTIMAL_KHR);
-
-        if (app->imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-            VKA(vkWaitForFences(app->context->device, 1, &app->imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX));
+        if (heap.budget != 0) {
+            std::snprintf(line, sizeof(line), "VRAM heap %u %.0f / %.0f MiB", i, static_cast<double>(heap.usage) / (1024.0 * 1024.0), static_cast<double>(heap.budget) / (1024.0 * 1024.0));
+        } else {
+            std::snprintf(line, sizeof(line), "VRAM heap %u %.0f MiB, no budget", i, static_cast<double>(heap.size) / (1024.0 * 1024.0));
         }
-        app->imagesInFlight[imageIndex] = frameFence;
+        hudText(hud, x, y, line, textColor);
+        y += HUD_LINE_HEIGHT;
+    }
+    const VulkanHostAllocationStats hostStats = getVulkanHostAllocationStats(&app->context->hostAllocator);
+    std::snprintf(line, sizeof(line), "Device allocations %llu  driver host %.1f KiB",
+        static_cast<unsigned long long>(app->context->deviceAllocationCount), static_cast<double>(hostStats.totalLiveBytes) / 1024.0);
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "Frame packets queued %u / %u  log suppressed %llu", spscSize(&app->framePackets), FRAME_PACKET_QUEUE_SIZE,
+        static_cast<unsigned long long>(getLogSuppressedCount()));
+    hudText(hud, x, y, line, textColor);
+    y += HUD_LINE_HEIGHT;
+    // The render thread's count is of the frame before this one, since this frame is still running.
+    std::snprintf(line, sizeof(line), "Heap allocs main %llu  render %llu  zero-alloc violations %llu",
+        static_cast<unsigned long long>(app->lastMainFrameHeapAllocations.load(std::memory_order_relaxed)),
+        static_cast<unsigned long long>(app->lastRenderFrameHeapAllocations), static_cast<unsigned long long>(getZeroAllocViolationCount()));
+    hudText(hud, x, y, line, getZeroAllocViolationCount() != 0 ? hudColor(255, 96, 96, 255) : textColor);
+    y += HUD_LINE_HEIGHT;
+    const FrameArenaRing* arenas = &app->renderFrameArenas;
+    std::snprintf(line, sizeof(line), "Frame arena %.1f / %.1f KiB  overflow %.1f KiB",
+        static_cast<double>(arenas->lastFrameBytes) / 1024.0, static_cast<double>(FRAME_ARENA_SIZE) / 1024.0,
+        static_cast<double>(arenas->lastFrameOverflowBytes) / 1024.0);
+    hudText(hud, x, y, line, arenas->lastFrameOverflowBytes != 0 ? hudColor(255, 96, 96, 255) : textColor);
+
+    app->lastHudBuildMs = static_cast<double>(framePacerNow() - buildBeginNs) / 1e6;
+}
 
-        VkSemaphore releaseSemaphore = app->releaseSemaphores[imageIndex];
+// Render thread only. Returns false on errors that should end the application.
+bool renderFrame(ApplicationState* app, const FramePacket& packet) {
+    PROFILE_FUNCTION();
+    const float greenChannel = packet.greenChannel;
+    if (packet.resized) {
+        app->framebufferResized = true;
+    }
 
+    if (app->framebufferResized) {
+        return recreateSwapchain(app);
+    }
+    // Everything a frame needs is reserved up front. Swapchain rebuilds and readbacks allow
+    // allocations themselves.
+    ZERO_ALLOC_SCOPE(packet.frameNumber >= ZERO_ALLOC_WARMUP_FRAMES ? "Render frame" : nullptr);
+
+    const uint32_t frame = app->currentFrame;
+    VkFence frameFence = app->inFlightFences[frame];
+    VkCommandPool frameCommandPool = app->commandPools[frame];
+    VkCommandBuffer frameCommandBuffer = app->commandBuffers[frame];
+    VkSemaphore acquireSemaphore = app->acquireSemaphores[frame];
+
+    // Time spent blocked on the GPU or the presentation engine is not part of the render thread's cost.
+    const uint64_t frameBeginNs = framePacerNow();
+    uint64_t blockedNs = 0;
+    uint64_t blockBeginNs = frameBeginNs;
+    if (!waitForFrameSlot(app, frame)) {
+        return false;
+    }
+    waitForPreviousPresent(app);
+    blockedNs += framePacerNow() - blockBeginNs;
 
-        VKA(vkResetCommandPool(app->context->device, frameCommandPool, 0));
+    if (app->lastRenderFrameBeginNs != 0) {
+        hudPushFrameTime(&app->hud, static_cast<float>(static_cast<double>(frameBeginNs - app->lastRenderFrameBeginNs) / 1e6));
+    }
+    app->lastRenderFrameBeginNs = frameBeginNs;
 
-        VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        VKA(vkBeginCommandBuffer(frameCommandBuffer, &beginInfo));
-        {
-            VkClearValue clearValue = {};
-            clearValue.color = {{0.5f, greenChannel, 0.5f, 1.0f}};
-            VkRenderPassBeginInfo beginInfo = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-            beginInfo.renderPass = app->renderPass;
-            beginInfo.framebuffer = app->framebuffers[imageIndex];
-            beginInfo.renderArea = {{0, 0}, {app->swapchain.width, app->swapchain.height} };
-            beginInfo.clearValueCount = 1;
-            beginInfo.pClearValues = &clearValue;
-            vkCmdBeginRenderPass(frameCommandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-
-            vkCmdBindPipeline(frameCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.pipeline);
-
-            // Keep content fixed at BASE_RENDER size when the window grows.
-            // If window is smaller than the base size, uniformly scale down to fit.
-            const float scaleX = static_cast<float>(app->swapchain.width) / static_cast<float>(BASE_RENDER_WIDTH);
-            const float scaleY = static_cast<float>(app->swapchain.height) / static_cast<float>(BASE_RENDER_HEIGHT);
-            float renderScale = (scaleX < scaleY) ? scaleX : scaleY;
-            if (renderScale > 1.0f) {
-                renderScale = 1.0f;
-            }
+    beginFrameRing(&app->frameRing, frame);
+    FrameArena* frameArena = beginFrameArena(&app->renderFrameArenas, frame);
 
-            uint32_t viewportWidth = static_cast<uint32_t>(static_cast<float>(BASE_RENDER_WIDTH) * renderScale);
-            uint32_t viewportHeight = static_cast<uint32_t>(static_cast<float>(BASE_RENDER_HEIGHT) * renderScale);
-            if (viewportWidth == 0) {
-                viewportWidth = 1;
-            }
-            if (viewportHeight == 0) {
-                viewportHeight = 1;
-            }
+    VulkanFrameRingAllocation frameConstantsAllocation = {};
+    if (!allocateFrameRing(&app->frameRing, sizeof(FrameConstants), 0, &frameConstantsAllocation)) {
+        LOG_ERROR("Frame ring exhausted while allocating frame constants.");
+        return false;
+    }
+    {
+        FrameConstants* frameConstants = static_cast<FrameConstants*>(frameConstantsAllocation.data);
+        std::memset(frameConstants, 0, sizeof(FrameConstants));
+        if (packet.cameraT >= 0.0f) {
+            Camera camera = {};
+            cameraFlythrough(&camera, packet.cameraT, app->sceneExtent);
+            cameraViewProjection(&camera, static_cast<float>(BASE_RENDER_WIDTH) / static_cast<float>(BASE_RENDER_HEIGHT), &frameConstants->viewProjection);
+        } else {
+            mat4Identity(&frameConstants->viewProjection);
+        }
+        frameConstants->time[0] = packet.time;
+        frameConstants->time[1] = greenChannel;
+    }
 
-            const int32_t viewportOffsetX = static_cast<int32_t>((app->swapchain.width - viewportWidth) / 2);
-            const int32_t viewportOffsetY = static_cast<int32_t>((app->swapchain.height - viewportHeight) / 2);
+    hudBeginFrame(&app->hud, frameArena, app->swapchain.width, app->swapchain.height);
+    if (packet.hudVisible) {
+        buildHud(app, packet.frameNumber);
+    }
+    if (!hudEndFrame(&app->hud, &app->frameRing)) {
+        LOG_WARN("Frame ring exhausted, HUD skipped.");
+    }
+    app->lastHudQuadCount = app->hud.quadCount;
 
-            VkViewport viewport = {};
-            viewport.x = static_cast<float>(viewportOffsetX);
-            viewport.y = static_cast<float>(viewportOffsetY);
-            viewport.width = static_cast<float>(viewportWidth);
-            viewport.height = static_cast<float>(viewportHeight);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(frameCommandBuffer, 0, 1, &viewport);
+    uint32_t imageIndex = 0;
+    blockBeginNs = framePacerNow();
+    VkResult acquireResult = acquireFrameImage(app, acquireSemaphore, &imageIndex);
+    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+        return recreateSwapchain(app);
+    }
+    if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+        LOG_ERROR("vkAcquireNextImageKHR failed: ", static_cast<int>(acquireResult));
+        return false;
+    }
+    const bool swapchainSuboptimal = (acquireResult == VK_SUBOPTIMAL_KHR);
 
-            VkRect2D scissor = {};
-            scissor.offset = {viewportOffsetX, viewportOffsetY};
-            scissor.extent = {viewportWidth, viewportHeight};
-            vkCmdSetScissor(frameCommandBuffer, 0, 1, &scissor);
+    if (app->imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+        VKA(vkWaitForFences(app->context->device, 1, &app->imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX));
+    }
+    app->imagesInFlight[imageIndex] = frameFence;
+    blockedNs += framePacerNow() - blockBeginNs;
 
-            VkDeviceSize vertexBufferOffset = 0;
-            vkCmdBindVertexBuffers(frameCommandBuffer, 0, 1, &app->vertexBuffer, &vertexBufferOffset);
-            vkCmdBindIndexBuffer(frameCommandBuffer, app->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
-            vkCmdDrawIndexed(frameCommandBuffer, app->indexCount, 1, 0, 0, 0);
+    VkSemaphore releaseSemaphore = app->releaseSemaphores[imageIndex];
 
 
+    VKA(vkResetCommandPool(app->context->device, frameCommandPool, 0));
 
+    app->recordState.frame = frame;
+    app->recordState.imageIndex = imageIndex;
+    app->recordState.frameConstantsOffset = frameConstantsAllocation.offset;
+    app->recordState.clearColor = {{0.5f, greenChannel, 0.5f, 1.0f}};
+    setRenderGraphImportedImage(&app->frameGraph, app->backbuffer, app->swapchain.images[imageIndex], app->swapchain.imageViews[imageIndex]);
 
-            vkCmdEndRenderPass(frameCommandBuffer);
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    {
+        PROFILE_SCOPE("Record frame");
+        const uint64_t recordBeginNs = framePacerNow();
+        VKA(vkBeginCommandBuffer(frameCommandBuffer, &beginInfo));
+        beginGpuProfilerFrame(app->context, &app->gpuProfiler, frameCommandBuffer, frame);
+        if (app->gpuProfiler.lastFrameValid) {
+            framePacerReportGpu(&app->framePacer, static_cast<uint64_t>(app->gpuProfiler.lastFrameMs * 1e6));
         }
+        executeRenderGraph(app->context, &app->frameGraph, frameCommandBuffer, &app->gpuProfiler);
         VKA(vkEndCommandBuffer(frameCommandBuffer));
+        if (app->regression && packet.frameNumber >= REGRESSION_WARMUP_FRAMES) {
+            app->recordTimesMs.push_back(static_cast<float>(static_cast<double>(framePacerNow() - recordBeginNs) / 1e6));
+        }
+    }
 
 
-        VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &frameCommandBuffer;
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = &acquireSemaphore;
-        VkPipelineStageFlags waitMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        submitInfo.pWaitDstStageMask = &waitMask;
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &releaseSemaphore;
-        VKA(vkResetFences(app->context->device, 1, &frameFence));
+    // Offscreen frames neither wait for an acquire nor signal a present.
+    const uint32_t presentSemaphoreCount = app->swapchain.offscreen ? 0 : 1;
+    VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frameCommandBuffer;
+    submitInfo.waitSemaphoreCount = presentSemaphoreCount;
+    submitInfo.pWaitSemaphores = &acquireSemaphore;
+    VkPipelineStageFlags waitMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    submitInfo.pWaitDstStageMask = &waitMask;
+    submitInfo.signalSemaphoreCount = presentSemaphoreCount;
+    submitInfo.pSignalSemaphores = &releaseSemaphore;
+    VKA(vkResetFences(app->context->device, 1, &frameFence));
+    {
+        PROFILE_SCOPE("vkQueueSubmit");
+        std::lock_guard<std::mutex> lock(app->context->graphicsQueueMutex);
         VKA(vkQueueSubmit(app->context->graphicsQueue.queue, 1, &submitInfo, frameFence));
+    }
+    app->frameSubmitNs[frame] = framePacerNow();
+    app->frameInputNs[frame] = packet.inputTimeNs;
 
 
 
-        VkPresentInfoKHR presentInfo = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
-        presentInfo.swapchainCount = 1;
-        presentInfo.pSwapchains = &app->swapchain.swapChain;
-        presentInfo.pImageIndices = &imageIndex;
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &releaseSemaphore;
-        VkResult presentResult = VK(vkQueuePresentKHR(app->context->graphicsQueue.queue, &presentInfo));
-        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || swapchainSuboptimal || app->framebufferResized) {
-            if (!recreateSwapchain(app)) {
-                break;
+    blockBeginNs = framePacerNow();
+    VkResult presentResult = presentFrameImage(app, imageIndex, releaseSemaphore, packet.inputTimeNs);
+    blockedNs += framePacerNow() - blockBeginNs;
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || swapchainSuboptimal || app->framebufferResized) {
+        if (!recreateSwapchain(app)) {
+            return false;
+        }
+    } else if (presentResult != VK_SUCCESS) {
+        LOG_ERROR("vkQueuePresentKHR failed: ", static_cast<int>(presentResult));
+        return false;
+    }
+
+    if (packet.captureIndex >= 0) {
+        blockBeginNs = framePacerNow();
+        if (!captureFrameImage(app, frameFence, imageIndex, &app->regressionCaptures[packet.captureIndex])) {
+            return false;
+        }
+        blockedNs += framePacerNow() - blockBeginNs;
+    }
+
+    framePacerReportRenderCpu(&app->framePacer, framePacerNow() - frameBeginNs - blockedNs);
+    reportHostAllocations(app);
+    app->lastFrameUploadBytes = (app->context->uploadedBytes - app->lastUploadedBytes) + (app->frameRing.head - app->frameRing.frameBegin);
+    app->lastUploadedBytes = app->context->uploadedBytes;
+    app->currentFrame = (app->currentFrame + 1) % app->framesInFlight;
+    return true;
+}
+
+// Render thread only, since the profiler is only touched while recording.
+void logGpuProfilerStats(ApplicationState* app) {
+    const uint64_t now = framePacerNow();
+    if (!app->gpuProfiler.enabled || now - app->lastGpuProfilerLogNs < FRAME_PACER_LOG_INTERVAL_NS) {
+        return;
+    }
+    app->lastGpuProfilerLogNs = now;
+
+    for (uint32_t i = 0; i < getGpuProfilerScopeCount(&app->gpuProfiler); i++) {
+        VulkanGpuProfilerStats stats = {};
+        if (getGpuProfilerStats(&app->gpuProfiler, i, &stats) && stats.sampleCount > 0) {
+            LOG_INFO("GPU pass ", stats.name, ": avg ", stats.averageMs, " ms, p50 ", stats.p50Ms,
+                " ms, p95 ", stats.p95Ms, " ms, p99 ", stats.p99Ms, " ms");
+        }
+    }
+}
+
+void renderThreadMain(ApplicationState* app) {
+    PROFILE_THREAD_NAME("Render");
+    // Counters only count the thread that opened them, so they are opened here.
+    PerfCounters perfCounters = {};
+    if (app->benchmark.enabled) {
+        openPerfCounters(&perfCounters);
+    }
+
+    FramePacket packet = {};
+    bool failed = false;
+    if (!createFrameArenaRing(&app->renderFrameArenas, app->framesInFlight, FRAME_ARENA_SIZE)) {
+        failed = true;
+        app->renderThreadFailed.store(true, std::memory_order_release);
+    }
+    for (;;) {
+        spscPop(&app->framePackets, &packet);
+        if (packet.quit) {
+            break;
+        }
+        // After a failure keep draining packets so the main thread never blocks on a full queue.
+        if (!failed) {
+            const bool measured = perfCounters.available && packet.frameNumber >= app->benchmark.warmupFrames;
+            PerfCounterScope scope(measured ? &perfCounters : nullptr, &app->renderFrameCounters);
+            const uint64_t allocationsBefore = getThreadAllocationCounters().allocations;
+            if (!renderFrame(app, packet)) {
+                failed = true;
+                app->renderThreadFailed.store(true, std::memory_order_release);
             }
-        } else if (presentResult != VK_SUCCESS) {
-            LOG_ERROR("vkQueuePresentKHR failed: ", static_cast<int>(presentResult));
+            app->lastRenderFrameHeapAllocations = getThreadAllocationCounters().allocations - allocationsBefore;
+            PROFILE_COUNTER("Heap allocations render thread", app->lastRenderFrameHeapAllocations);
+            PROFILE_COUNTER("Frame arena bytes render thread", app->renderFrameArenas.arenas[app->renderFrameArenas.slot].peak);
+        }
+        if (!failed) {
+            logGpuProfilerStats(app);
+        }
+    }
+    destroyFrameArenaRing(&app->renderFrameArenas);
+    closePerfCounters(&perfCounters);
+}
+
+void logFramePacerStats(ApplicationState* app) {
+    const uint64_t now = framePacerNow();
+    if (now - app->lastPacerLogNs < FRAME_PACER_LOG_INTERVAL_NS) {
+        return;
+    }
+    app->lastPacerLogNs = now;
+
+    const FramePacerStats stats = getFramePacerStats(&app->framePacer);
+    LOG_INFO("Frame ", stats.frameIntervalMs, " ms (main ", stats.mainCpuMs, " ms, render ", stats.renderCpuMs,
+        " ms, gpu ", stats.gpuMs, " ms), latency ", stats.latencyMs, " ms", stats.latencyFromPresentWait ? " (present wait)" : " (estimated)");
+}
+
+// Main thread only. Records the interval since the previous frame once the warmup is over and
+// returns false when the configured number of frames has been measured.
+bool advanceBenchmark(ApplicationState* app, uint64_t frameBeginNs) {
+    if (app->frameNumber == app->benchmark.warmupFrames) {
+        app->benchmarkStartNs = frameBeginNs;
+    } else if (app->frameNumber > app->benchmark.warmupFrames) {
+        app->benchmarkFrameTimesMs.push_back(static_cast<float>(static_cast<double>(frameBeginNs - app->benchmarkEndNs) / 1e6));
+    }
+    app->benchmarkEndNs = frameBeginNs;
+    return app->benchmarkFrameTimesMs.size() < app->benchmark.frameCount;
+}
+
+// The scene's quads as boxes, seen from frames spread over the flythrough the benchmark renders.
+void runSceneMathBenchmarks(ApplicationState* app, MathBenchmarkStats* stats) {
+    const uint32_t boxCount = app->sceneQuadCount;
+    // The quads lie flat on z = 0.
+    std::vector<float> minX(boxCount);
+    std::vector<float> minY(boxCount);
+    std::vector<float> minZ(boxCount, 0.0f);
+    std::vector<float> maxX(boxCount);
+    std::vector<float> maxY(boxCount);
+    std::vector<float> maxZ(boxCount, 0.0f);
+    for (uint32_t i = 0; i < boxCount; i++) {
+        const Vertex* quad = &app->sceneVertices[i * 4];
+        minX[i] = maxX[i] = quad[0].position[0];
+        minY[i] = maxY[i] = quad[0].position[1];
+        for (uint32_t corner = 1; corner < 4; corner++) {
+            minX[i] = std::min(minX[i], quad[corner].position[0]);
+            minY[i] = std::min(minY[i], quad[corner].position[1]);
+            maxX[i] = std::max(maxX[i], quad[corner].position[0]);
+            maxY[i] = std::max(maxY[i], quad[corner].position[1]);
+        }
+    }
+    const AabbSoa boxes = {minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), boxCount};
+
+    Mat4 viewProjections[BENCHMARK_MATH_FRUSTUM_COUNT];
+    for (uint32_t i = 0; i < BENCHMARK_MATH_FRUSTUM_COUNT; i++) {
+        Camera camera = {};
+        cameraFlythrough(&camera, static_cast<float>(i) / BENCHMARK_MATH_FRUSTUM_COUNT, app->sceneExtent);
+        cameraViewProjection(&camera, static_cast<float>(BASE_RENDER_WIDTH) / static_cast<float>(BASE_RENDER_HEIGHT), &viewProjections[i]);
+    }
+    runMathBenchmarks(&boxes, viewProjections, BENCHMARK_MATH_FRUSTUM_COUNT, stats);
+}
+
+// Called after the render thread has been joined, so the GPU profiler can be read from here.
+bool writeBenchmarkResults(ApplicationState* app) {
+    if (app->benchmarkFrameTimesMs.size() < app->benchmark.frameCount) {
+        LOG_ERROR("Benchmark aborted after ", static_cast<unsigned long long>(app->benchmarkFrameTimesMs.size()), " of ", app->benchmark.frameCount, " frames.");
+        return false;
+    }
+
+    BenchmarkReport report = {};
+    report.deviceName = app->context->physicalDeviceProperties.deviceName;
+    report.width = app->swapchain.width;
+    report.height = app->swapchain.height;
+    report.presentMode = app->swapchain.presentMode;
+    report.config = app->benchmark;
+    report.sceneQuadCount = app->sceneQuadCount;
+    report.durationSeconds = static_cast<double>(app->benchmarkEndNs - app->benchmarkStartNs) / 1e9;
+    report.frameTimes = computeFrameTimeStats(app->benchmarkFrameTimesMs);
+    report.pacer = getFramePacerStats(&app->framePacer);
+    for (uint32_t i = 0; i < getGpuProfilerScopeCount(&app->gpuProfiler); i++) {
+        VulkanGpuProfilerStats stats = {};
+        if (getGpuProfilerStats(&app->gpuProfiler, i, &stats)) {
+            report.gpuPasses.push_back(stats);
+        }
+    }
+    VulkanMemoryHeapStats heaps[VK_MAX_MEMORY_HEAPS];
+    const uint32_t heapCount = getMemoryHeapStats(app->context, heaps, VK_MAX_MEMORY_HEAPS);
+    report.memoryHeaps.assign(heaps, heaps + heapCount);
+    report.peakResidentBytes = getPeakResidentMemory();
+    report.sceneBuildCounters = app->sceneBuildCounters;
+    report.renderFrameCounters = app->renderFrameCounters;
+    runSceneMathBenchmarks(app, &report.math);
+
+    if (!writeBenchmarkReport(app->benchmark.outputPath, report)) {
+        return false;
+    }
+    LOG_INFO("Benchmark: mean ", report.frameTimes.meanMs, " ms, p99 ", report.frameTimes.p99Ms, " ms. Results written to ", app->benchmark.outputPath);
+    const PerfCounterTotals& renderCounters = report.renderFrameCounters;
+    if (renderCounters.valid[PERF_COUNTER_CYCLES] && renderCounters.valid[PERF_COUNTER_INSTRUCTIONS] && renderCounters.values[PERF_COUNTER_CYCLES] > 0) {
+        LOG_INFO("Benchmark: render thread IPC ", static_cast<double>(renderCounters.values[PERF_COUNTER_INSTRUCTIONS]) / static_cast<double>(renderCounters.values[PERF_COUNTER_CYCLES]));
+    }
+    LOG_INFO("Benchmark: ", report.math.backend, " frustum culling ", report.math.cullNsPerBox, " ns per box, scalar ", report.math.cullScalarNsPerBox, " ns");
+    return true;
+}
+
+// Main thread: polls events and runs the simulation, then hands a frame packet to the render
+// thread. Simulating frame N+1 overlaps recording and submitting frame N, and a blocking fence
+// wait or present never stalls input. The main thread only starts a frame once the render thread
+// has taken the previous packet, and the frame pacer then delays input sampling until the critical
+// path (or the frame rate cap) allows the frame to be consumed right away.
+void renderApplication(ApplicationState* app) {
+    PROFILE_THREAD_NAME("Main");
+    app->renderThread = std::thread(renderThreadMain, app);
+
+    uint64_t allocationsBefore = getThreadAllocationCounters().allocations;
+    for (;;) {
+        {
+            PROFILE_SCOPE("Wait for render thread");
+            spscWaitEmpty(&app->framePackets);
+        }
+        const uint64_t allocations = getThreadAllocationCounters().allocations;
+        app->lastMainFrameHeapAllocations.store(allocations - allocationsBefore, std::memory_order_relaxed);
+        PROFILE_COUNTER("Heap allocations main thread", allocations - allocationsBefore);
+        allocationsBefore = allocations;
+        uint64_t inputTimeNs = 0;
+        {
+            PROFILE_SCOPE("Frame pacing");
+            inputTimeNs = framePacerBeginFrame(&app->framePacer);
+        }
+        hitchDetectorBeginFrame(&app->hitchDetector, profilerNow(), app->frameNumber > 0 ? app->frameNumber - 1 : 0);
+        PROFILE_SCOPE("Main frame");
+        if (!handleMessage(app) || app->renderThreadFailed.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (app->windowPixelWidth.load(std::memory_order_relaxed) == 0 || app->windowPixelHeight.load(std::memory_order_relaxed) == 0) {
+            hitchDetectorSkipFrame(&app->hitchDetector);
+            SDL_Delay(10);
+            continue;
+        }
+
+        if (app->benchmark.enabled && !advanceBenchmark(app, inputTimeNs)) {
+            break;
+        }
+        if (app->frameLimit != 0 && app->frameNumber >= app->frameLimit) {
             break;
         }
+        ZERO_ALLOC_SCOPE(app->frameNumber >= ZERO_ALLOC_WARMUP_FRAMES ? "Main frame" : nullptr);
+
+        app->greenChannel += 0.01f;
+        if (app->greenChannel > 1.0f) app->greenChannel = 0.0f;
+
+        FramePacket packet = {};
+        packet.frameNumber = app->frameNumber++;
+        packet.inputTimeNs = inputTimeNs;
+        packet.time = static_cast<float>(SDL_GetTicks()) / 1000.0f;
+        packet.greenChannel = app->greenChannel;
+        packet.cameraT = -1.0f;
+        packet.captureIndex = -1;
+        // Regression frames are compared against golden images, which have no HUD.
+        packet.hudVisible = app->hudVisible && !app->regression;
+        if (app->benchmark.enabled) {
+            // Driven by the frame number instead of time, so every run renders the same frames.
+            const uint32_t pathFrames = app->benchmark.warmupFrames + app->benchmark.frameCount;
+            packet.cameraT = static_cast<float>(packet.frameNumber % pathFrames) / static_cast<float>(pathFrames);
+        } else if (app->regression) {
+            // Nothing may depend on time, or the frames would not match the golden images.
+            const uint32_t regressionCase = static_cast<uint32_t>(packet.frameNumber / REGRESSION_FRAMES_PER_CASE);
+            packet.time = 0.0f;
+            packet.greenChannel = 0.5f;
+            packet.cameraT = static_cast<float>(regressionCase) / static_cast<float>(REGRESSION_CASE_COUNT);
+            if (packet.frameNumber % REGRESSION_FRAMES_PER_CASE == REGRESSION_FRAMES_PER_CASE - 1) {
+                packet.captureIndex = static_cast<int32_t>(regressionCase);
+            }
+        }
+        packet.resized = app->resizePending;
+        packet.quit = false;
+        app->resizePending = false;
+        spscPush(&app->framePackets, packet);
 
-        app->currentFrame = (app->currentFrame + 1) % app->framesInFlight;
+        framePacerEndFrame(&app->framePacer);
+        logFramePacerStats(app);
     }
+
+    FramePacket quitPacket = {};
+    quitPacket.quit = true;
+    spscPush(&app->framePackets, quitPacket);
+    app->renderThread.join();
 }
 
 void shutdownApplication(ApplicationState* app) {
+    // Before the profiler shuts down, since a pending capture still reads its buffers.
+    stopHitchDetector(&app->hitchDetector);
     if (app->context == nullptr) {
         if (app->window != nullptr) {
             SDL_DestroyWindow(app->window);
@@ -618,49 +1733,353 @@ void shutdownApplication(ApplicationState* app) {
         return;
     }
 
-    VKA(vkDeviceWaitIdle(app->context->device));
+    waitForDeviceIdle(app->context);
 
     destroyImageResources(app);
     destroyIndexResources(app);
     destroyVertexResources(app);
     destroySwapchainResources(app);
+    destroyHud(app->context, &app->hud);
+    destroyFrameRing(app->context, &app->frameRing);
 
     for (uint32_t i = 0; i < app->acquireSemaphores.size(); i++) {
         if (app->acquireSemaphores[i] != VK_NULL_HANDLE) {
-            VK(vkDestroySemaphore(app->context->device, app->acquireSemaphores[i], nullptr));
+            VK(vkDestroySemaphore(app->context->device, app->acquireSemaphores[i], app->context->allocator));
         }
     }
     app->acquireSemaphores.clear();
 
     for (uint32_t i = 0; i < app->inFlightFences.size(); i++) {
         if (app->inFlightFences[i] != VK_NULL_HANDLE) {
-            VK(vkDestroyFence(app->context->device, app->inFlightFences[i], nullptr));
+            VK(vkDestroyFence(app->context->device, app->inFlightFences[i], app->context->allocator));
         }
     }
     app->inFlightFences.clear();
 
     for (uint32_t i = 0; i < app->commandPools.size(); i++) {
         if (app->commandPools[i] != VK_NULL_HANDLE) {
-            VK(vkDestroyCommandPool(app->context->device, app->commandPools[i], nullptr));
+            VK(vkDestroyCommandPool(app->context->device, app->commandPools[i], app->context->allocator));
         }
     }
     app->commandPools.clear();
     app->commandBuffers.clear();
 
-   VK(vkDestroySurfaceKHR(app->context->instance, app->surface, nullptr));
+    destroyStaticCommands(app->context, &app->staticCommands);
+    destroyGpuProfiler(app->context, &app->gpuProfiler);
+
+    destroySurface(app);
+    const VulkanHostAllocationStats hostStats = getVulkanHostAllocationStats(&app->context->hostAllocator);
+    LOG_INFO("Vulkan host memory: peak ", static_cast<unsigned long long>(hostStats.peakBytes), " bytes, ",
+        static_cast<unsigned long long>(hostStats.totalAllocationCount), " allocations, ",
+        static_cast<unsigned long long>(hostStats.internalBytes), " bytes driver internal");
+    for (uint32_t i = 0; i < VULKAN_ALLOCATION_SCOPE_COUNT; i++) {
+        LOG_INFO("  ", getVulkanAllocationScopeName(static_cast<VkSystemAllocationScope>(i)), ": ",
+            static_cast<unsigned long long>(hostStats.allocationCount[i]), " allocations, ",
+            static_cast<unsigned long long>(hostStats.liveBytes[i]), " bytes live");
+    }
     exitVulkan(app->context);
+    // Everything has been destroyed, so whatever is still live leaked in the driver or in here.
+    const uint64_t leakedBytes = getVulkanHostAllocationStats(&app->context->hostAllocator).totalLiveBytes;
+    if (leakedBytes != 0) {
+        LOG_WARN("Vulkan host memory still allocated after shutdown: ", static_cast<unsigned long long>(leakedBytes), " bytes");
+    }
+    logSlabAllocatorStats();
 
-    SDL_DestroyWindow(app->window);
+    if (app->window != nullptr) {
+        SDL_DestroyWindow(app->window);
+    }
     SDL_Quit();
 }
 
-int main() {
+// Called after the render thread has been joined. Saves the last rendered offscreen image as PNG.
+bool writeReadbackImage(ApplicationState* app) {
+    if (!app->swapchain.offscreen) {
+        LOG_WARN("Image readback needs --headless, swapchain images cannot be copied out.");
+        return true;
+    }
+    if (app->lastPresentedImage == UINT32_MAX) {
+        LOG_ERROR("No frame was rendered, nothing to read back.");
+        return false;
+    }
+
+    waitForDeviceIdle(app->context);
+    // Offscreen images are always HEADLESS_FORMAT, which is BGRA.
+    ImageBGRA8 image = {app->swapchain.width, app->swapchain.height, {}};
+    if (!readbackImage(app->context, app->swapchain.images[app->lastPresentedImage], image.width, image.height, &image.pixels)) {
+        return false;
+    }
+    if (!saveImagePng(app->readbackPath, image)) {
+        return false;
+    }
+    LOG_INFO("Wrote frame ", static_cast<unsigned long long>(app->frameNumber), " to ", app->readbackPath);
+    return true;
+}
+
+// Called after the render thread has been joined. Compares the captured frames against the golden
+// images (or replaces them with --update-golden) and checks the CPU and memory budgets. Every check
+// runs and is logged, so one failure does not hide the others.
+bool runRegressionChecks(ApplicationState* app) {
+    const RegressionBudgets& budgets = REGRESSION_DEFAULT_BUDGETS;
+    bool passed = true;
+
+    for (uint32_t i = 0; i < REGRESSION_CASE_COUNT; i++) {
+        const ImageBGRA8& capture = app->regressionCaptures[i];
+        char goldenPath[512];
+        std::snprintf(goldenPath, sizeof(goldenPath), "%s/case_%u.png", app->goldenDir, i);
+        if (capture.pixels.empty()) {
+            LOG_ERROR("Regression case ", i, ": no frame captured.");
+            passed = false;
+            continue;
+        }
+        if (app->updateGolden) {
+            if (!saveImagePng(goldenPath, capture)) {
+                passed = false;
+                continue;
+            }
+            LOG_INFO("Regression case ", i, ": golden image updated at ", goldenPath);
+            continue;
+        }
+
+        ImageBGRA8 golden = {};
+        if (!loadImagePng(goldenPath, &golden)) {
+            LOG_ERROR("Regression case ", i, ": golden image missing. Run with --update-golden to create it.");
+            passed = false;
+            continue;
+        }
+        if (golden.width != capture.width || golden.height != capture.height) {
+            LOG_ERROR("Regression case ", i, ": size ", capture.width, "x", capture.height, " does not match golden ", golden.width, "x", golden.height);
+            passed = false;
+            continue;
+        }
+        const ImageDiff diff = compareImages(capture, golden, budgets.channelTolerance);
+        const double mismatchFraction = static_cast<double>(diff.mismatchedPixels) / (static_cast<double>(capture.width) * capture.height);
+        if (mismatchFraction > budgets.maxMismatchFraction) {
+            char failurePath[512];
+            std::snprintf(failurePath, sizeof(failurePath), "%s/case_%u_failed.png", app->goldenDir, i);
+            saveImagePng(failurePath, capture);
+            LOG_ERROR("Regression case ", i, ": FAIL, ", static_cast<unsigned long long>(diff.mismatchedPixels), " pixels differ (max delta ", diff.maxChannelDelta, "). Frame written to ", failurePath);
+            passed = false;
+        } else {
+            LOG_INFO("Regression case ", i, ": ok, ", static_cast<unsigned long long>(diff.mismatchedPixels), " pixels differ (max delta ", diff.maxChannelDelta, ")");
+        }
+    }
+
+    const FrameTimeStats recordTimes = computeFrameTimeStats(app->recordTimesMs);
+    if (recordTimes.frameCount == 0 || recordTimes.p95Ms > budgets.maxRecordP95Ms) {
+        LOG_ERROR("Regression budget: FAIL, record time p95 ", recordTimes.p95Ms, " ms exceeds ", budgets.maxRecordP95Ms, " ms");
+        passed = false;
+    } else {
+        LOG_INFO("Regression budget: ok, record time p95 ", recordTimes.p95Ms, " ms");
+    }
+
+    const uint64_t uploadedBytes = app->context->uploadedBytes;
+    if (uploadedBytes > budgets.maxUploadBytes) {
+        LOG_ERROR("Regression budget: FAIL, uploaded ", static_cast<unsigned long long>(uploadedBytes), " bytes, budget ", static_cast<unsigned long long>(budgets.maxUploadBytes));
+        passed = false;
+    } else {
+        LOG_INFO("Regression budget: ok, uploaded ", static_cast<unsigned long long>(uploadedBytes), " bytes");
+    }
+
+    const uint64_t frameAllocations = app->context->deviceAllocationCount - app->initDeviceAllocations - app->captureAllocations;
+    if (frameAllocations > budgets.maxFrameAllocations) {
+        LOG_ERROR("Regression budget: FAIL, ", static_cast<unsigned long long>(frameAllocations), " device allocations while rendering");
+        passed = false;
+    } else {
+        LOG_INFO("Regression budget: ok, ", static_cast<unsigned long long>(frameAllocations), " device allocations while rendering");
+    }
+
+#ifdef ALLOC_TRACKING
+    const uint64_t heapAllocations = getZeroAllocViolationCount();
+    if (heapAllocations > budgets.maxFrameHeapAllocations) {
+        LOG_ERROR("Regression budget: FAIL, ", static_cast<unsigned long long>(heapAllocations), " heap allocations in zero-alloc frames");
+        passed = false;
+    } else {
+        LOG_INFO("Regression budget: ok, ", static_cast<unsigned long long>(heapAllocations), " heap allocations in zero-alloc frames");
+    }
+#else
+    LOG_INFO("Regression budget: heap allocations are only tracked in debug builds.");
+#endif
+
+    // Scene generation is the only CPU geometry building in the tree. Rebuilding produces the
+    // same geometry again, so the uploaded buffers stay valid.
+    const uint64_t buildBeginNs = framePacerNow();
+    for (uint32_t i = 0; i < REGRESSION_SCENE_BUILD_ITERATIONS; i++) {
+        buildScene(app);
+    }
+    const double buildSeconds = static_cast<double>(framePacerNow() - buildBeginNs) / 1e9;
+    const double quadsPerSecond = buildSeconds > 0.0 ? static_cast<double>(app->sceneQuadCount) * REGRESSION_SCENE_BUILD_ITERATIONS / buildSeconds : 0.0;
+    if (quadsPerSecond < budgets.minSceneQuadsPerSecond) {
+        LOG_ERROR("Regression budget: FAIL, scene build ", quadsPerSecond, " quads/s, budget ", budgets.minSceneQuadsPerSecond);
+        passed = false;
+    } else {
+        LOG_INFO("Regression budget: ok, scene build ", quadsPerSecond, " quads/s");
+    }
+
+    LOG_INFO(passed ? "Regression suite passed." : "Regression suite FAILED.");
+    return passed;
+}
+
+void printUsage() {
+    LOG_INFO("Usage: HikariVox [--headless] [--readback FILE.png] [--benchmark] [--frames N] [--seed N] [--output PATH] [--regression] [--golden-dir DIR] [--update-golden] [--hud] [--hitch-threshold X] [--hitch-dir DIR] [--log-block] [--binary-log FILE] [--log-level [CATEGORY=]LEVEL] [--zero-alloc count|log|assert] [--jobs N] [--pin-jobs]");
+}
+
+bool parseUnsigned(const char* text, uint64_t* value) {
+    char* end = nullptr;
+    const unsigned long long parsed = std::strtoull(text, &end, 0);
+    if (end == text || *end != '\0') {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+bool parseDouble(const char* text, double* value) {
+    char* end = nullptr;
+    const double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0') {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+bool parseCommandLine(int argc, char** argv, CommandLineOptions* options) {
+    *options = {};
+    options->benchmark.frameCount = BENCHMARK_DEFAULT_FRAME_COUNT;
+    options->benchmark.warmupFrames = BENCHMARK_WARMUP_FRAMES;
+    options->benchmark.seed = BENCHMARK_DEFAULT_SEED;
+    options->benchmark.outputPath = BENCHMARK_DEFAULT_OUTPUT_PATH;
+    options->goldenDir = REGRESSION_DEFAULT_GOLDEN_DIR;
+    options->hitchThreshold = -1.0;
+    options->hitchDir = ".";
+    options->zeroAllocAction = ALLOC_VIOLATION_LOG;
+    options->jobWorkers = -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* argument = argv[i];
+        const bool hasValue = (i + 1 < argc);
+        uint64_t value = 0;
+        if (std::strcmp(argument, "--benchmark") == 0) {
+            options->benchmark.enabled = true;
+        } else if (std::strcmp(argument, "--headless") == 0) {
+            options->headless = true;
+        } else if (std::strcmp(argument, "--readback") == 0 && hasValue) {
+            options->readbackPath = argv[i + 1];
+            i++;
+        } else if (std::strcmp(argument, "--frames") == 0 && hasValue && parseUnsigned(argv[i + 1], &value) && value > 0 && value <= UINT32_MAX) {
+            options->benchmark.frameCount = static_cast<uint32_t>(value);
+            options->frameLimit = static_cast<uint32_t>(value);
+            i++;
+        } else if (std::strcmp(argument, "--seed") == 0 && hasValue && parseUnsigned(argv[i + 1], &value)) {
+            options->benchmark.seed = value;
+            i++;
+        } else if (std::strcmp(argument, "--output") == 0 && hasValue) {
+            options->benchmark.outputPath = argv[i + 1];
+            i++;
+        } else if (std::strcmp(argument, "--regression") == 0) {
+            options->regression = true;
+        } else if (std::strcmp(argument, "--golden-dir") == 0 && hasValue) {
+            options->goldenDir = argv[i + 1];
+            i++;
+        } else if (std::strcmp(argument, "--update-golden") == 0) {
+            options->updateGolden = true;
+        } else if (std::strcmp(argument, "--hud") == 0) {
+            options->hud = true;
+        } else if (std::strcmp(argument, "--hitch-threshold") == 0 && hasValue && parseDouble(argv[i + 1], &options->hitchThreshold) && options->hitchThreshold >= 0.0) {
+            i++;
+        } else if (std::strcmp(argument, "--hitch-dir") == 0 && hasValue) {
+            options->hitchDir = argv[i + 1];
+            i++;
+        } else if (std::strcmp(argument, "--log-block") == 0) {
+            options->logBlock = true;
+        } else if (std::strcmp(argument, "--log-level") == 0 && hasValue && applyLogSetting(argv[i + 1])) {
+            // Applied right away, so filtering already covers instance creation.
+            i++;
+        } else if (std::strcmp(argument, "--zero-alloc") == 0 && hasValue && parseAllocViolationAction(argv[i + 1], &options->zeroAllocAction)) {
+            i++;
+        } else if (std::strcmp(argument, "--jobs") == 0 && hasValue && parseUnsigned(argv[i + 1], &value) && value <= JOB_MAX_WORKERS) {
+            options->jobWorkers = static_cast<int32_t>(value);
+            i++;
+        } else if (std::strcmp(argument, "--pin-jobs") == 0) {
+            options->pinJobWorkers = true;
+        } else if (std::strcmp(argument, "--binary-log") == 0 && hasValue) {
+            options->binaryLogPath = argv[i + 1];
+            i++;
+        } else {
+            LOG_ERROR("Invalid argument: ", argument);
+            printUsage();
+            return false;
+        }
+    }
+
+    if (options->regression && options->benchmark.enabled) {
+        LOG_ERROR("--regression and --benchmark cannot be combined.");
+        return false;
+    }
+
+    // The benchmark ends on its own after warmup plus the measured frames. The regression suite
+    // always runs headless, so it behaves the same with and without a display.
+    if (options->regression) {
+        options->headless = true;
+        options->frameLimit = REGRESSION_CASE_COUNT * REGRESSION_FRAMES_PER_CASE;
+    } else if (options->benchmark.enabled) {
+        options->frameLimit = 0;
+    } else if (options->headless && options->frameLimit == 0) {
+        options->frameLimit = HEADLESS_DEFAULT_FRAME_COUNT;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    initLogger();
+    CommandLineOptions options = {};
+    if (!parseCommandLine(argc, argv, &options)) {
+        exitLogger();
+        return 2;
+    }
+    setLogOverflowPolicy(options.logBlock ? LOG_OVERFLOW_BLOCK : LOG_OVERFLOW_DROP);
+    setAllocViolationAction(options.zeroAllocAction);
+    if (options.binaryLogPath != nullptr && !setLogBinaryOutput(options.binaryLogPath)) {
+        LOG_ERROR("Failed to open binary log ", options.binaryLogPath);
+        exitLogger();
+        return 2;
+    }
+
+    initProfiler();
+    initSlabAllocator();
     ApplicationState app = {};
-    if (!initApplication(&app)) {
+    // Before the application, since building the scene already runs jobs.
+    startJobSystem(&app.jobs, options.jobWorkers >= 0 ? static_cast<uint32_t>(options.jobWorkers) : getDefaultJobWorkerCount(), options.pinJobWorkers);
+    startAsyncIo(&app.asyncIo, &app.jobs);
+    if (!initApplication(&app, options)) {
+        stopAsyncIo(&app.asyncIo);
+        stopJobSystem(&app.jobs);
+        shutdownProfiler();
+        exitLogger();
         return 1;
     }
 
     renderApplication(&app);
+    int exitCode = 0;
+    if (app.benchmark.enabled && !writeBenchmarkResults(&app)) {
+        exitCode = 1;
+    }
+    if (app.readbackPath != nullptr && !writeReadbackImage(&app)) {
+        exitCode = 1;
+    }
+    if (app.regression && !runRegressionChecks(&app)) {
+        exitCode = 1;
+    }
     shutdownApplication(&app);
-    return 0;
+    stopAsyncIo(&app.asyncIo);
+    stopJobSystem(&app.jobs);
+    shutdownProfiler();
+    if (getLogSuppressedCount() != 0) {
+        LOG_INFO("Logger: ", static_cast<unsigned long long>(getLogSuppressedCount()), " repeated messages suppressed.");
+    }
+    if (getZeroAllocViolationCount() != 0) {
+        LOG_WARN(static_cast<unsigned long long>(getZeroAllocViolationCount()), " heap allocations in zero-alloc regions.");
+    }
+    exitLogger();
+    return exitCode;
 }
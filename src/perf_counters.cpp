@@ -0,0 +1,171 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "perf_counters.h"
+#include "logger.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+const char* getPerfCounterName(PerfCounter counter) {
+    switch (counter) {
+        case PERF_COUNTER_CYCLES:
+            return "cycles";
+        case PERF_COUNTER_INSTRUCTIONS:
+            return "instructions";
+        case PERF_COUNTER_CACHE_MISSES:
+            return "cache_misses";
+        case PERF_COUNTER_BRANCH_MISSES:
+            return "branch_misses";
+        default:
+            return "unknown";
+    }
+}
+
+void accumulatePerfCounters(const PerfCounterValues& begin, const PerfCounterValues& end, PerfCounterTotals* totals) {
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (!begin.valid[i] || !end.valid[i]) {
+            continue;
+        }
+        totals->valid[i] = true;
+        totals->values[i] += end.values[i] > begin.values[i] ? end.values[i] - begin.values[i] : 0;
+    }
+    totals->scopeCount++;
+}
+
+#ifdef __linux__
+
+static int openPerfEvent(uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    // The group starts disabled and is enabled as a whole once every member is attached.
+    attr.disabled = (groupFd == -1) ? 1 : 0;
+    // Kernel and hypervisor counting needs more privileges than perf_event_paranoid = 2 grants.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+bool openPerfCounters(PerfCounters* counters) {
+    static constexpr uint64_t CONFIGS[PERF_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    *counters = {};
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        counters->fds[i] = -1;
+        counters->groupSlots[i] = -1;
+    }
+
+    const int leader = openPerfEvent(CONFIGS[PERF_COUNTER_CYCLES], -1);
+    if (leader < 0) {
+        const int error = errno;
+        if (error == EACCES || error == EPERM) {
+            LOG_WARN("Performance counters not permitted. Lower /proc/sys/kernel/perf_event_paranoid to enable them.");
+        } else {
+            LOG_WARN("Performance counters unavailable: ", std::strerror(error));
+        }
+        return false;
+    }
+    counters->fds[PERF_COUNTER_CYCLES] = leader;
+    counters->groupSlots[PERF_COUNTER_CYCLES] = 0;
+    counters->groupSize = 1;
+
+    // Missing members are fine, e.g. virtual PMUs often lack the cache events.
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (i == PERF_COUNTER_CYCLES) {
+            continue;
+        }
+        const int fd = openPerfEvent(CONFIGS[i], leader);
+        if (fd < 0) {
+            LOG_WARN("Performance counter ", getPerfCounterName(static_cast<PerfCounter>(i)), " unavailable.");
+            continue;
+        }
+        counters->fds[i] = fd;
+        counters->groupSlots[i] = static_cast<int>(counters->groupSize++);
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    if (ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+        LOG_WARN("Failed to enable performance counters.");
+        closePerfCounters(counters);
+        return false;
+    }
+    counters->available = true;
+    return true;
+}
+
+void closePerfCounters(PerfCounters* counters) {
+    // Members first, the group leader last.
+    for (int i = PERF_COUNTER_COUNT - 1; i >= 0; i--) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+    counters->available = false;
+}
+
+bool readPerfCounters(const PerfCounters* counters, PerfCounterValues* values) {
+    *values = {};
+    if (!counters->available) {
+        return false;
+    }
+
+    // Layout of a PERF_FORMAT_GROUP read: nr, time_enabled, time_running, value[nr].
+    uint64_t buffer[3 + PERF_COUNTER_COUNT] = {};
+    const ssize_t expected = static_cast<ssize_t>((3 + counters->groupSize) * sizeof(uint64_t));
+    if (read(counters->fds[PERF_COUNTER_CYCLES], buffer, sizeof(buffer)) < expected) {
+        return false;
+    }
+    const uint64_t timeEnabled = buffer[1];
+    const uint64_t timeRunning = buffer[2];
+    if (timeRunning == 0) {
+        return false;
+    }
+
+    const double scale = static_cast<double>(timeEnabled) / static_cast<double>(timeRunning);
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (counters->groupSlots[i] < 0) {
+            continue;
+        }
+        const uint64_t raw = buffer[3 + counters->groupSlots[i]];
+        values->values[i] = (timeEnabled == timeRunning) ? raw : static_cast<uint64_t>(static_cast<double>(raw) * scale);
+        values->valid[i] = true;
+    }
+    return true;
+}
+
+#else
+
+bool openPerfCounters(PerfCounters* counters) {
+    *counters = {};
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        counters->fds[i] = -1;
+        counters->groupSlots[i] = -1;
+    }
+    return false;
+}
+
+void closePerfCounters(PerfCounters* counters) {
+    counters->available = false;
+}
+
+bool readPerfCounters(const PerfCounters* counters, PerfCounterValues* values) {
+    (void)counters;
+    *values = {};
+    return false;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+// Hardware performance counters of the calling thread through perf_event_open. Linux only; elsewhere,
+// or when the kernel refuses access (perf_event_paranoid, containers, VMs without a PMU),
+// openPerfCounters() fails and everything else turns into a no-op.
+enum PerfCounter {
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_CACHE_MISSES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+struct PerfCounters {
+    bool available;
+    // Counters are opened as one group so they are scheduled together. -1 for counters the PMU lacks.
+    int fds[PERF_COUNTER_COUNT];
+    // Position of each counter in a group read.
+    int groupSlots[PERF_COUNTER_COUNT];
+    uint32_t groupSize;
+};
+
+struct PerfCounterValues {
+    bool valid[PERF_COUNTER_COUNT];
+    uint64_t values[PERF_COUNTER_COUNT];
+};
+
+// Sums of counter deltas over all measured scopes of one phase.
+struct PerfCounterTotals {
+    bool valid[PERF_COUNTER_COUNT];
+    uint64_t values[PERF_COUNTER_COUNT];
+    uint64_t scopeCount;
+};
+
+// Must be called on the thread to be measured; the counters only count that thread, in user space.
+bool openPerfCounters(PerfCounters* counters);
+void closePerfCounters(PerfCounters* counters);
+// Values are scaled up when the kernel had to multiplex the counters.
+bool readPerfCounters(const PerfCounters* counters, PerfCounterValues* values);
+void accumulatePerfCounters(const PerfCounterValues& begin, const PerfCounterValues& end, PerfCounterTotals* totals);
+const char* getPerfCounterName(PerfCounter counter);
+
+// Adds the counter deltas of a scope to totals. Does nothing when counters is null or unavailable.
+struct PerfCounterScope {
+    const PerfCounters* counters;
+    PerfCounterTotals* totals;
+    PerfCounterValues begin;
+
+    PerfCounterScope(const PerfCounters* counters, PerfCounterTotals* totals)
+        : counters(counters), totals(totals), begin() {
+        if (counters == nullptr || !counters->available || !readPerfCounters(counters, &begin)) {
+            this->counters = nullptr;
+        }
+    }
+
+    ~PerfCounterScope() {
+        PerfCounterValues end = {};
+        if (counters != nullptr && readPerfCounters(counters, &end)) {
+            accumulatePerfCounters(begin, end, totals);
+        }
+    }
+
+    PerfCounterScope(const PerfCounterScope&) = delete;
+    PerfCounterScope& operator=(const PerfCounterScope&) = delete;
+};
@@ -0,0 +1,170 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "profiler.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+thread_local ProfilerThreadBuffer* profilerThreadBuffer = nullptr;
+
+// Buffers outlive their threads so events of finished threads still make it into an export.
+static std::mutex profilerMutex;
+static std::vector<ProfilerThreadBuffer*> profilerBuffers;
+static uint64_t profilerEpochNs = 0;
+
+ProfilerThreadBuffer* profilerRegisterThread() {
+    ProfilerThreadBuffer* buffer = new ProfilerThreadBuffer();
+    buffer->reserved.store(0, std::memory_order_relaxed);
+    buffer->committed.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(profilerMutex);
+        buffer->threadId = static_cast<uint32_t>(profilerBuffers.size() + 1);
+        std::snprintf(buffer->name, sizeof(buffer->name), "Thread %u", buffer->threadId);
+        profilerBuffers.push_back(buffer);
+    }
+    profilerThreadBuffer = buffer;
+    return buffer;
+}
+
+void initProfiler() {
+    profilerEpochNs = profilerNow();
+}
+
+void shutdownProfiler() {
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    for (ProfilerThreadBuffer* buffer : profilerBuffers) {
+        delete buffer;
+    }
+    profilerBuffers.clear();
+    profilerThreadBuffer = nullptr;
+}
+
+void profilerSetThreadName(const char* name) {
+    ProfilerThreadBuffer* buffer = profilerThreadBuffer;
+    if (buffer == nullptr) {
+        buffer = profilerRegisterThread();
+    }
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    std::snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+void writeJsonString(FILE* file, const char* text) {
+    std::fputc('"', file);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+            std::fputc(*c, file);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            std::fprintf(file, "\\u%04x", static_cast<unsigned>(*c));
+        } else {
+            std::fputc(*c, file);
+        }
+    }
+    std::fputc('"', file);
+}
+
+bool exportChromeTrace(const char* path) {
+    return exportChromeTraceWindow(path, 0, UINT64_MAX, nullptr);
+}
+
+static uint64_t toTraceNs(uint64_t timestampNs) {
+    return timestampNs > profilerEpochNs ? timestampNs - profilerEpochNs : 0;
+}
+
+bool exportChromeTraceWindow(const char* path, uint64_t windowBeginNs, uint64_t windowEndNs, const ProfilerHighlight* highlight) {
+    FILE* file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open trace file ", path);
+        return false;
+    }
+
+    struct ExportEvent {
+        const char* name;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+    std::vector<ExportEvent> events;
+    events.reserve(PROFILER_EVENTS_PER_THREAD);
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+    bool first = true;
+    size_t eventCount = 0;
+
+    // Thread id 0 is free, threads are numbered from 1. The instant event draws a line across
+    // every track at the start of the highlighted range.
+    if (highlight != nullptr) {
+        const uint64_t beginNs = toTraceNs(highlight->beginNs);
+        const uint64_t durationNs = highlight->endNs > highlight->beginNs ? highlight->endNs - highlight->beginNs : 0;
+        std::fputs("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Highlight\"}},{\"name\":", file);
+        writeJsonString(file, highlight->name);
+        std::fprintf(file, ",\"ph\":\"X\",\"cname\":\"terrible\",\"pid\":1,\"tid\":0,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu},{\"name\":",
+            static_cast<unsigned long long>(beginNs / 1000), static_cast<unsigned long long>(beginNs % 1000),
+            static_cast<unsigned long long>(durationNs / 1000), static_cast<unsigned long long>(durationNs % 1000));
+        writeJsonString(file, highlight->name);
+        std::fprintf(file, ",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%llu.%03llu}",
+            static_cast<unsigned long long>(beginNs / 1000), static_cast<unsigned long long>(beginNs % 1000));
+        first = false;
+    }
+
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    for (ProfilerThreadBuffer* buffer : profilerBuffers) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",", buffer->threadId);
+        writeJsonString(file, buffer->name);
+        std::fputs("}}", file);
+        first = false;
+
+        // Copy the live window first, then drop every slot the owner may have started to
+        // overwrite in the meantime.
+        const uint64_t committed = buffer->committed.load(std::memory_order_acquire);
+        const uint64_t begin = committed > PROFILER_EVENTS_PER_THREAD ? committed - PROFILER_EVENTS_PER_THREAD : 0;
+        events.clear();
+        for (uint64_t i = begin; i < committed; i++) {
+            const ProfilerEvent& event = buffer->events[i & (PROFILER_EVENTS_PER_THREAD - 1)];
+            events.push_back({event.name.load(std::memory_order_relaxed), event.beginNs.load(std::memory_order_relaxed), event.endNs.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t reserved = buffer->reserved.load(std::memory_order_relaxed);
+        const uint64_t firstValid = reserved > PROFILER_EVENTS_PER_THREAD ? reserved - PROFILER_EVENTS_PER_THREAD : 0;
+
+        for (uint64_t i = begin; i < committed; i++) {
+            if (i < firstValid) {
+                continue;
+            }
+            const ExportEvent& event = events[i - begin];
+            const bool counter = (event.beginNs & PROFILER_COUNTER_FLAG) != 0;
+            const uint64_t timestampNs = event.beginNs & ~PROFILER_COUNTER_FLAG;
+            const uint64_t eventEndNs = counter ? timestampNs : event.endNs;
+            if (eventEndNs < windowBeginNs || timestampNs > windowEndNs) {
+                continue;
+            }
+            const uint64_t beginNs = toTraceNs(timestampNs);
+            std::fputs(",{\"name\":", file);
+            writeJsonString(file, event.name);
+            if (counter) {
+                std::fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu,\"args\":{\"value\":%llu}}",
+                    buffer->threadId,
+                    static_cast<unsigned long long>(beginNs / 1000), static_cast<unsigned long long>(beginNs % 1000),
+                    static_cast<unsigned long long>(event.endNs));
+                eventCount++;
+                continue;
+            }
+            // Chrome trace timestamps are microseconds; keep the nanoseconds as decimals.
+            std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu}",
+                buffer->threadId,
+                static_cast<unsigned long long>(beginNs / 1000), static_cast<unsigned long long>(beginNs % 1000),
+                static_cast<unsigned long long>((event.endNs - event.beginNs) / 1000), static_cast<unsigned long long>((event.endNs - event.beginNs) % 1000));
+            eventCount++;
+        }
+    }
+    std::fputs("]}\n", file);
+
+    const bool written = (std::ferror(file) == 0);
+    std::fclose(file);
+    if (!written) {
+        LOG_ERROR("Failed to write trace file ", path);
+        return false;
+    }
+    LOG_INFO("Wrote ", static_cast<unsigned long long>(eventCount), " profiler events to ", path);
+    return true;
+}
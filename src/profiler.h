@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+//#define PROFILING_DISABLE
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PROFILING_DISABLE
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_COUNTER(name, value)
+#else
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD_NAME(name) profilerSetThreadName(name)
+#define PROFILE_COUNTER(name, value) profilerRecordCounter(name, value)
+#endif
+
+// Events kept per thread. Older events are overwritten once a thread records more than this.
+static constexpr uint32_t PROFILER_EVENTS_PER_THREAD = 1 << 16;
+static constexpr uint32_t PROFILER_THREAD_NAME_SIZE = 32;
+// Set in beginNs of counter samples, whose endNs holds the value. Timestamps never get this large.
+static constexpr uint64_t PROFILER_COUNTER_FLAG = 1ull << 63;
+
+// Fields are relaxed atomics so the exporter may read a slot while its owner overwrites it.
+// The exporter detects and drops such slots through the reserved counter.
+struct ProfilerEvent {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> beginNs;
+    std::atomic<uint64_t> endNs;
+};
+
+// Event ring of one thread. Only the owning thread writes, so recording is lock-free and
+// the only shared state is the two counters: reserved is bumped before a slot is written,
+// committed after.
+struct ProfilerThreadBuffer {
+    uint32_t threadId;
+    char name[PROFILER_THREAD_NAME_SIZE];
+    alignas(64) std::atomic<uint64_t> reserved;
+    std::atomic<uint64_t> committed;
+    ProfilerEvent events[PROFILER_EVENTS_PER_THREAD];
+};
+
+extern thread_local ProfilerThreadBuffer* profilerThreadBuffer;
+
+ProfilerThreadBuffer* profilerRegisterThread();
+
+inline uint64_t profilerNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void profilerRecord(const char* name, uint64_t beginNs, uint64_t endNs) {
+    ProfilerThreadBuffer* buffer = profilerThreadBuffer;
+    if (buffer == nullptr) {
+        buffer = profilerRegisterThread();
+    }
+
+    const uint64_t index = buffer->committed.load(std::memory_order_relaxed);
+    buffer->reserved.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ProfilerEvent& event = buffer->events[index & (PROFILER_EVENTS_PER_THREAD - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.beginNs.store(beginNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    buffer->committed.store(index + 1, std::memory_order_release);
+}
+
+// Counter samples show up as graphs next to the zones in the trace viewer.
+inline void profilerRecordCounter(const char* name, uint64_t value) {
+    profilerRecord(name, profilerNow() | PROFILER_COUNTER_FLAG, value);
+}
+
+// Records one complete event when it goes out of scope. name must outlive the export,
+// string literals and __func__ do.
+struct ProfileZone {
+    const char* name;
+    uint64_t beginNs;
+
+    explicit ProfileZone(const char* name) : name(name), beginNs(profilerNow()) {}
+    ~ProfileZone() {
+        profilerRecord(name, beginNs, profilerNow());
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+// A time range drawn on its own track of an export, e.g. the frame that triggered a hitch capture.
+struct ProfilerHighlight {
+    const char* name;
+    uint64_t beginNs;
+    uint64_t endNs;
+};
+
+void initProfiler();
+void shutdownProfiler();
+void profilerSetThreadName(const char* name);
+// Writes every thread's recorded events as Chrome trace-event JSON (loadable in Perfetto).
+// Safe to call while other threads keep recording.
+bool exportChromeTrace(const char* path);
+// Same, limited to events that overlap [beginNs, endNs]. highlight may be null.
+bool exportChromeTraceWindow(const char* path, uint64_t beginNs, uint64_t endNs, const ProfilerHighlight* highlight);
+// Writes text as a quoted JSON string, escaping quotes, backslashes and control characters.
+// Shared by every JSON file the engine writes.
+void writeJsonString(FILE* file, const char* text);
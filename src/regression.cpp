@@ -0,0 +1,90 @@
+#include "regression.h"
+#include "logger.h"
+#include <SDL3/SDL.h>
+#include <cstring>
+
+bool saveImagePng(const char* path, const ImageBGRA8& image) {
+    SDL_Surface* surface = SDL_CreateSurfaceFrom(
+        static_cast<int>(image.width),
+        static_cast<int>(image.height),
+        SDL_PIXELFORMAT_BGRA32,
+        const_cast<uint8_t*>(image.pixels.data()),
+        static_cast<int>(image.width * 4));
+    if (surface == nullptr) {
+        LOG_ERROR("SDL_CreateSurfaceFrom failed: ", SDL_GetError());
+        return false;
+    }
+    const bool saved = SDL_SavePNG(surface, path);
+    SDL_DestroySurface(surface);
+    if (!saved) {
+        LOG_ERROR("SDL_SavePNG failed: ", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+bool loadImagePng(const char* path, ImageBGRA8* image) {
+    SDL_Surface* loaded = SDL_LoadPNG(path);
+    if (loaded == nullptr) {
+        LOG_ERROR("Failed to load ", path, ": ", SDL_GetError());
+        return false;
+    }
+    SDL_Surface* converted = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_BGRA32);
+    SDL_DestroySurface(loaded);
+    if (converted == nullptr) {
+        LOG_ERROR("SDL_ConvertSurface failed: ", SDL_GetError());
+        return false;
+    }
+
+    image->width = static_cast<uint32_t>(converted->w);
+    image->height = static_cast<uint32_t>(converted->h);
+    image->pixels.resize(static_cast<size_t>(image->width) * image->height * 4);
+    const size_t rowSize = static_cast<size_t>(image->width) * 4;
+    for (uint32_t y = 0; y < image->height; y++) {
+        std::memcpy(image->pixels.data() + y * rowSize, static_cast<const uint8_t*>(converted->pixels) + static_cast<size_t>(y) * converted->pitch, rowSize);
+    }
+    SDL_DestroySurface(converted);
+    return true;
+}
+
+static uint32_t maxChannelDelta(const uint8_t* a, const uint8_t* b) {
+    uint32_t maxDelta = 0;
+    for (uint32_t channel = 0; channel < 3; channel++) {
+        const int delta = static_cast<int>(a[channel]) - static_cast<int>(b[channel]);
+        const uint32_t absDelta = static_cast<uint32_t>(delta < 0 ? -delta : delta);
+        if (absDelta > maxDelta) {
+            maxDelta = absDelta;
+        }
+    }
+    return maxDelta;
+}
+
+ImageDiff compareImages(const ImageBGRA8& a, const ImageBGRA8& b, uint32_t channelTolerance) {
+    ImageDiff diff = {};
+    for (uint32_t y = 0; y < a.height; y++) {
+        for (uint32_t x = 0; x < a.width; x++) {
+            const uint8_t* pixel = &a.pixels[(static_cast<size_t>(y) * a.width + x) * 4];
+            const uint32_t delta = maxChannelDelta(pixel, &b.pixels[(static_cast<size_t>(y) * b.width + x) * 4]);
+            if (delta > diff.maxChannelDelta) {
+                diff.maxChannelDelta = delta;
+            }
+            if (delta <= channelTolerance) {
+                continue;
+            }
+
+            // An edge that moved by one pixel still finds its colour next door.
+            bool matchedNeighbour = false;
+            const uint32_t yEnd = y + 1 < b.height ? y + 1 : y;
+            const uint32_t xEnd = x + 1 < b.width ? x + 1 : x;
+            for (uint32_t ny = y > 0 ? y - 1 : 0; ny <= yEnd && !matchedNeighbour; ny++) {
+                for (uint32_t nx = x > 0 ? x - 1 : 0; nx <= xEnd && !matchedNeighbour; nx++) {
+                    matchedNeighbour = maxChannelDelta(pixel, &b.pixels[(static_cast<size_t>(ny) * b.width + nx) * 4]) <= channelTolerance;
+                }
+            }
+            if (!matchedNeighbour) {
+                diff.mismatchedPixels++;
+            }
+        }
+    }
+    return diff;
+}
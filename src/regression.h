@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Regression mode renders a few fixed camera positions of the benchmark scene headless, compares
+// the frames against golden images and checks CPU and memory budgets. It is meant to run on a
+// software driver such as lavapipe or SwiftShader, so the image tolerance absorbs rasterisation
+// differences. The golden images are PNGs written by --update-golden.
+static constexpr uint32_t REGRESSION_CASE_COUNT = 4;
+// Frames rendered per camera position; the last one is captured.
+static constexpr uint32_t REGRESSION_FRAMES_PER_CASE = 8;
+// Frames excluded from the record time budget while pipelines and static draws warm up.
+static constexpr uint32_t REGRESSION_WARMUP_FRAMES = 4;
+static constexpr const char* REGRESSION_DEFAULT_GOLDEN_DIR = "../regression";
+// Scene rebuilds timed for the scene build throughput budget.
+static constexpr uint32_t REGRESSION_SCENE_BUILD_ITERATIONS = 16;
+
+struct RegressionBudgets {
+    // Largest per-channel difference that still counts as matching.
+    uint32_t channelTolerance;
+    // Fraction of pixels allowed to exceed channelTolerance.
+    double maxMismatchFraction;
+    double maxRecordP95Ms;
+    uint64_t maxUploadBytes;
+    // Device memory allocations allowed while rendering, after initialisation.
+    uint64_t maxFrameAllocations;
+    // Heap allocations of the main and render thread's frames after ZERO_ALLOC_WARMUP_FRAMES.
+    // Counted in debug builds only.
+    uint64_t maxFrameHeapAllocations;
+    double minSceneQuadsPerSecond;
+};
+
+static constexpr RegressionBudgets REGRESSION_DEFAULT_BUDGETS = {
+    8,
+    0.002,
+    2.0,
+    16ull * 1024 * 1024,
+    0,
+    0,
+    1000000.0
+};
+
+// Tightly packed 8 bit BGRA, matching VK_FORMAT_B8G8R8A8_UNORM readbacks.
+struct ImageBGRA8 {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> pixels;
+};
+
+struct ImageDiff {
+    // Pixels that match neither the golden pixel nor any of its eight neighbours.
+    uint64_t mismatchedPixels;
+    uint32_t maxChannelDelta;
+};
+
+bool saveImagePng(const char* path, const ImageBGRA8& image);
+// Converts whatever the file holds to BGRA8.
+bool loadImagePng(const char* path, ImageBGRA8* image);
+// Images must have the same size. Alpha is ignored since it is not part of what ends up on screen.
+// Drivers snap vertices to between 4 and 8 subpixel bits, which moves edges by a pixel, so a pixel
+// that matches a neighbour in b does not count as mismatched.
+ImageDiff compareImages(const ImageBGRA8& a, const ImageBGRA8& b, uint32_t channelTolerance);
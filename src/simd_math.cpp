@@ -0,0 +1,368 @@
+#include "simd_math.h"
+#include <cstring>
+
+#if defined(SIMD_MATH_AVX2)
+#include <immintrin.h>
+#elif defined(SIMD_MATH_SSE)
+#include <emmintrin.h>
+#elif defined(SIMD_MATH_NEON)
+#include <arm_neon.h>
+#endif
+
+// Four floats in a register for Vec4 and Mat4 math, and the widest register for the batches.
+#if defined(SIMD_MATH_SSE)
+typedef __m128 Float4;
+
+static inline Float4 float4Load(const Vec4* v) { return _mm_load_ps(&v->x); }
+static inline void float4Store(Vec4* v, Float4 value) { _mm_store_ps(&v->x, value); }
+static inline Float4 float4Splat(float value) { return _mm_set1_ps(value); }
+static inline Float4 float4Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+static inline Float4 float4Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+#elif defined(SIMD_MATH_NEON)
+typedef float32x4_t Float4;
+
+static inline Float4 float4Load(const Vec4* v) { return vld1q_f32(&v->x); }
+static inline void float4Store(Vec4* v, Float4 value) { vst1q_f32(&v->x, value); }
+static inline Float4 float4Splat(float value) { return vdupq_n_f32(value); }
+static inline Float4 float4Mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+static inline Float4 float4Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+#endif
+
+#if defined(SIMD_MATH_AVX2)
+static constexpr uint32_t SIMD_WIDTH = 8;
+typedef __m256 SimdFloat;
+typedef __m256 SimdMask;
+
+static inline SimdFloat simdLoad(const float* values) { return _mm256_loadu_ps(values); }
+static inline void simdStore(float* values, SimdFloat value) { _mm256_storeu_ps(values, value); }
+static inline SimdFloat simdSplat(float value) { return _mm256_set1_ps(value); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a, b); }
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a, b); }
+static inline SimdMask simdMaskNone() { return _mm256_setzero_ps(); }
+static inline SimdMask simdLessThanZero(SimdFloat value) { return _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_LT_OQ); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return _mm256_or_ps(a, b); }
+static inline uint32_t simdMaskBits(SimdMask mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+#elif defined(SIMD_MATH_SSE)
+static constexpr uint32_t SIMD_WIDTH = 4;
+typedef __m128 SimdFloat;
+typedef __m128 SimdMask;
+
+static inline SimdFloat simdLoad(const float* values) { return _mm_loadu_ps(values); }
+static inline void simdStore(float* values, SimdFloat value) { _mm_storeu_ps(values, value); }
+static inline SimdFloat simdSplat(float value) { return _mm_set1_ps(value); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return _mm_mul_ps(a, b); }
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return _mm_add_ps(a, b); }
+static inline SimdMask simdMaskNone() { return _mm_setzero_ps(); }
+static inline SimdMask simdLessThanZero(SimdFloat value) { return _mm_cmplt_ps(value, _mm_setzero_ps()); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return _mm_or_ps(a, b); }
+static inline uint32_t simdMaskBits(SimdMask mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+#elif defined(SIMD_MATH_NEON)
+static constexpr uint32_t SIMD_WIDTH = 4;
+typedef float32x4_t SimdFloat;
+typedef uint32x4_t SimdMask;
+
+static inline SimdFloat simdLoad(const float* values) { return vld1q_f32(values); }
+static inline void simdStore(float* values, SimdFloat value) { vst1q_f32(values, value); }
+static inline SimdFloat simdSplat(float value) { return vdupq_n_f32(value); }
+static inline SimdFloat simdMul(SimdFloat a, SimdFloat b) { return vmulq_f32(a, b); }
+static inline SimdFloat simdAdd(SimdFloat a, SimdFloat b) { return vaddq_f32(a, b); }
+static inline SimdMask simdMaskNone() { return vdupq_n_u32(0); }
+static inline SimdMask simdLessThanZero(SimdFloat value) { return vcltq_f32(value, vdupq_n_f32(0.0f)); }
+static inline SimdMask simdMaskOr(SimdMask a, SimdMask b) { return vorrq_u32(a, b); }
+static inline uint32_t simdMaskBits(SimdMask mask) {
+    // NEON has no movemask; weigh each lane's bit and add them up.
+    static const uint32_t laneBits[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(mask, vld1q_u32(laneBits)));
+}
+#endif
+
+#if !defined(SIMD_MATH_SCALAR)
+static_assert(SIMD_BATCH_SIZE % SIMD_WIDTH == 0, "A batch has to fill whole registers");
+#endif
+
+void mat4Identity(Mat4* out) {
+    out->columns[0] = {1.0f, 0.0f, 0.0f, 0.0f};
+    out->columns[1] = {0.0f, 1.0f, 0.0f, 0.0f};
+    out->columns[2] = {0.0f, 0.0f, 1.0f, 0.0f};
+    out->columns[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+}
+
+Vec4 mat4MultiplyVec4(const Mat4* matrix, Vec4 v) {
+#if defined(SIMD_MATH_SCALAR)
+    const Vec4* c = matrix->columns;
+    return {
+        c[0].x * v.x + c[1].x * v.y + c[2].x * v.z + c[3].x * v.w,
+        c[0].y * v.x + c[1].y * v.y + c[2].y * v.z + c[3].y * v.w,
+        c[0].z * v.x + c[1].z * v.y + c[2].z * v.z + c[3].z * v.w,
+        c[0].w * v.x + c[1].w * v.y + c[2].w * v.z + c[3].w * v.w,
+    };
+#else
+    Float4 result = float4Mul(float4Load(&matrix->columns[0]), float4Splat(v.x));
+    result = float4Add(result, float4Mul(float4Load(&matrix->columns[1]), float4Splat(v.y)));
+    result = float4Add(result, float4Mul(float4Load(&matrix->columns[2]), float4Splat(v.z)));
+    result = float4Add(result, float4Mul(float4Load(&matrix->columns[3]), float4Splat(v.w)));
+    Vec4 out;
+    float4Store(&out, result);
+    return out;
+#endif
+}
+
+void mat4Multiply(const Mat4* a, const Mat4* b, Mat4* out) {
+    // Column j of a * b is a * (column j of b).
+    Mat4 result;
+    for (uint32_t column = 0; column < 4; column++) {
+        result.columns[column] = mat4MultiplyVec4(a, b->columns[column]);
+    }
+    *out = result;
+}
+
+void mat4Transpose(const Mat4* matrix, Mat4* out) {
+    float in[16];
+    float result[16];
+    std::memcpy(in, matrix, sizeof(in));
+    for (uint32_t column = 0; column < 4; column++) {
+        for (uint32_t row = 0; row < 4; row++) {
+            result[column * 4 + row] = in[row * 4 + column];
+        }
+    }
+    std::memcpy(out, result, sizeof(result));
+}
+
+void mat4LookAt(Vec3 eye, Vec3 target, Vec3 up, Mat4* out) {
+    const Vec3 forward = vec3Normalize(vec3Sub(target, eye));
+    const Vec3 right = vec3Normalize(vec3Cross(forward, up));
+    const Vec3 cameraUp = vec3Cross(right, forward);
+
+    out->columns[0] = {right.x, cameraUp.x, -forward.x, 0.0f};
+    out->columns[1] = {right.y, cameraUp.y, -forward.y, 0.0f};
+    out->columns[2] = {right.z, cameraUp.z, -forward.z, 0.0f};
+    out->columns[3] = {-vec3Dot(right, eye), -vec3Dot(cameraUp, eye), vec3Dot(forward, eye), 1.0f};
+}
+
+void mat4Perspective(float fovYRadians, float aspect, float nearPlane, float farPlane, Mat4* out) {
+    const float focalLength = 1.0f / std::tan(fovYRadians * 0.5f);
+    out->columns[0] = {focalLength / aspect, 0.0f, 0.0f, 0.0f};
+    // Vulkan clip space has y pointing down.
+    out->columns[1] = {0.0f, -focalLength, 0.0f, 0.0f};
+    out->columns[2] = {0.0f, 0.0f, farPlane / (nearPlane - farPlane), -1.0f};
+    out->columns[3] = {0.0f, 0.0f, (nearPlane * farPlane) / (nearPlane - farPlane), 0.0f};
+}
+
+void mat4FromQuat(Quat rotation, Mat4* out) {
+    const float x = rotation.x;
+    const float y = rotation.y;
+    const float z = rotation.z;
+    const float w = rotation.w;
+    out->columns[0] = {1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f};
+    out->columns[1] = {2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f};
+    out->columns[2] = {2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f};
+    out->columns[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+}
+
+void mat4FromTransform(Vec3 translation, Quat rotation, Vec3 scale, Mat4* out) {
+    mat4FromQuat(rotation, out);
+    const float scales[3] = {scale.x, scale.y, scale.z};
+    for (uint32_t column = 0; column < 3; column++) {
+        Vec4* c = &out->columns[column];
+        c->x *= scales[column];
+        c->y *= scales[column];
+        c->z *= scales[column];
+    }
+    out->columns[3] = {translation.x, translation.y, translation.z, 1.0f};
+}
+
+Quat quatIdentity() {
+    return {0.0f, 0.0f, 0.0f, 1.0f};
+}
+
+Quat quatFromAxisAngle(Vec3 axis, float radians) {
+    const float s = std::sin(radians * 0.5f);
+    return {axis.x * s, axis.y * s, axis.z * s, std::cos(radians * 0.5f)};
+}
+
+Quat quatMultiply(Quat a, Quat b) {
+    return {
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+    };
+}
+
+Quat quatNormalize(Quat q) {
+    const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    if (length <= 0.0f) {
+        return quatIdentity();
+    }
+    const float inverse = 1.0f / length;
+    return {q.x * inverse, q.y * inverse, q.z * inverse, q.w * inverse};
+}
+
+Vec3 quatRotate(Quat q, Vec3 v) {
+    // v + w * t + u x t with t = 2 * (u x v), which spares building the matrix.
+    const Vec3 u = {q.x, q.y, q.z};
+    const Vec3 t = vec3Scale(vec3Cross(u, v), 2.0f);
+    return vec3Add(vec3Add(v, vec3Scale(t, q.w)), vec3Cross(u, t));
+}
+
+static Vec4 combineRows(const float a[4], const float b[4], float sign) {
+    return {a[0] + sign * b[0], a[1] + sign * b[1], a[2] + sign * b[2], a[3] + sign * b[3]};
+}
+
+void frustumFromViewProjection(const Mat4* viewProjection, Frustum* frustum) {
+    // A clip space point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w. With row i of
+    // the matrix written r_i, each bound is a plane in world space, e.g. w + x >= 0 is r3 + r0.
+    float m[16];
+    std::memcpy(m, viewProjection, sizeof(m));
+    float rows[4][4];
+    for (uint32_t row = 0; row < 4; row++) {
+        for (uint32_t column = 0; column < 4; column++) {
+            rows[row][column] = m[column * 4 + row];
+        }
+    }
+    frustum->planes[0] = combineRows(rows[3], rows[0], 1.0f);
+    frustum->planes[1] = combineRows(rows[3], rows[0], -1.0f);
+    frustum->planes[2] = combineRows(rows[3], rows[1], 1.0f);
+    frustum->planes[3] = combineRows(rows[3], rows[1], -1.0f);
+    frustum->planes[4] = {rows[2][0], rows[2][1], rows[2][2], rows[2][3]};
+    frustum->planes[5] = combineRows(rows[3], rows[2], -1.0f);
+    // Normalized planes give distances in world units, which keeps the tests well conditioned.
+    for (Vec4& plane : frustum->planes) {
+        const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f) {
+            const float inverse = 1.0f / length;
+            plane = {plane.x * inverse, plane.y * inverse, plane.z * inverse, plane.w * inverse};
+        }
+    }
+}
+
+static uint32_t cullAabbRange(const Frustum* frustum, const AabbSoa* boxes, uint32_t begin, uint32_t end, uint8_t* visible) {
+    uint32_t visibleCount = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        bool outside = false;
+        for (const Vec4& plane : frustum->planes) {
+            // The corner furthest along the normal is the last one to leave the plane.
+            const float x = plane.x >= 0.0f ? boxes->maxX[i] : boxes->minX[i];
+            const float y = plane.y >= 0.0f ? boxes->maxY[i] : boxes->minY[i];
+            const float z = plane.z >= 0.0f ? boxes->maxZ[i] : boxes->minZ[i];
+            outside |= (plane.x * x + plane.y * y + plane.z * z + plane.w) < 0.0f;
+        }
+        visible[i] = outside ? 0 : 1;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+uint32_t cullAabbsScalar(const Frustum* frustum, const AabbSoa* boxes, uint8_t* visible) {
+    return cullAabbRange(frustum, boxes, 0, boxes->count, visible);
+}
+
+uint32_t cullAabbs(const Frustum* frustum, const AabbSoa* boxes, uint8_t* visible) {
+#if defined(SIMD_MATH_SCALAR)
+    return cullAabbsScalar(frustum, boxes, visible);
+#else
+    // Which array holds the furthest corner only depends on the signs of the plane's normal, so it
+    // is picked once per plane and the loop below is free of branches.
+    const float* cornerX[6];
+    const float* cornerY[6];
+    const float* cornerZ[6];
+    SimdFloat normalX[6];
+    SimdFloat normalY[6];
+    SimdFloat normalZ[6];
+    SimdFloat distance[6];
+    for (uint32_t p = 0; p < 6; p++) {
+        const Vec4& plane = frustum->planes[p];
+        cornerX[p] = plane.x >= 0.0f ? boxes->maxX : boxes->minX;
+        cornerY[p] = plane.y >= 0.0f ? boxes->maxY : boxes->minY;
+        cornerZ[p] = plane.z >= 0.0f ? boxes->maxZ : boxes->minZ;
+        normalX[p] = simdSplat(plane.x);
+        normalY[p] = simdSplat(plane.y);
+        normalZ[p] = simdSplat(plane.z);
+        distance[p] = simdSplat(plane.w);
+    }
+
+    const uint32_t batchEnd = boxes->count - boxes->count % SIMD_BATCH_SIZE;
+    uint32_t visibleCount = 0;
+    for (uint32_t batch = 0; batch < batchEnd; batch += SIMD_BATCH_SIZE) {
+        for (uint32_t i = batch; i < batch + SIMD_BATCH_SIZE; i += SIMD_WIDTH) {
+            SimdMask outside = simdMaskNone();
+            for (uint32_t p = 0; p < 6; p++) {
+                // Same order of operations as the scalar path, so both agree to the bit.
+                SimdFloat d = simdMul(normalX[p], simdLoad(cornerX[p] + i));
+                d = simdAdd(d, simdMul(normalY[p], simdLoad(cornerY[p] + i)));
+                d = simdAdd(d, simdMul(normalZ[p], simdLoad(cornerZ[p] + i)));
+                d = simdAdd(d, distance[p]);
+                outside = simdMaskOr(outside, simdLessThanZero(d));
+            }
+            const uint32_t outsideBits = simdMaskBits(outside);
+            for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++) {
+                const uint8_t boxVisible = static_cast<uint8_t>(((outsideBits >> lane) & 1) ^ 1);
+                visible[i + lane] = boxVisible;
+                visibleCount += boxVisible;
+            }
+        }
+    }
+    return visibleCount + cullAabbRange(frustum, boxes, batchEnd, boxes->count, visible);
+#endif
+}
+
+static void transformPointRange(const Mat4* matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, uint32_t begin, uint32_t end) {
+    const Vec4* c = matrix->columns;
+    for (uint32_t i = begin; i < end; i++) {
+        const float px = x[i];
+        const float py = y[i];
+        const float pz = z[i];
+        outX[i] = c[0].x * px + c[1].x * py + c[2].x * pz + c[3].x;
+        outY[i] = c[0].y * px + c[1].y * py + c[2].y * pz + c[3].y;
+        outZ[i] = c[0].z * px + c[1].z * py + c[2].z * pz + c[3].z;
+    }
+}
+
+void transformPointsScalar(const Mat4* matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, uint32_t count) {
+    transformPointRange(matrix, x, y, z, outX, outY, outZ, 0, count);
+}
+
+void transformPoints(const Mat4* matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, uint32_t count) {
+#if defined(SIMD_MATH_SCALAR)
+    transformPointsScalar(matrix, x, y, z, outX, outY, outZ, count);
+#else
+    SimdFloat m[4][3];
+    for (uint32_t column = 0; column < 4; column++) {
+        m[column][0] = simdSplat(matrix->columns[column].x);
+        m[column][1] = simdSplat(matrix->columns[column].y);
+        m[column][2] = simdSplat(matrix->columns[column].z);
+    }
+
+    const uint32_t batchEnd = count - count % SIMD_BATCH_SIZE;
+    for (uint32_t batch = 0; batch < batchEnd; batch += SIMD_BATCH_SIZE) {
+        for (uint32_t i = batch; i < batch + SIMD_BATCH_SIZE; i += SIMD_WIDTH) {
+            const SimdFloat px = simdLoad(x + i);
+            const SimdFloat py = simdLoad(y + i);
+            const SimdFloat pz = simdLoad(z + i);
+            SimdFloat result[3];
+            for (uint32_t row = 0; row < 3; row++) {
+                SimdFloat r = simdMul(m[0][row], px);
+                r = simdAdd(r, simdMul(m[1][row], py));
+                r = simdAdd(r, simdMul(m[2][row], pz));
+                result[row] = simdAdd(r, m[3][row]);
+            }
+            simdStore(outX + i, result[0]);
+            simdStore(outY + i, result[1]);
+            simdStore(outZ + i, result[2]);
+        }
+    }
+    transformPointRange(matrix, x, y, z, outX, outY, outZ, batchEnd, count);
+#endif
+}
+
+const char* getSimdMathBackendName() {
+#if defined(SIMD_MATH_AVX2)
+    return "AVX2";
+#elif defined(SIMD_MATH_SSE)
+    return "SSE2";
+#elif defined(SIMD_MATH_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// Forces the scalar fallback, e.g. to compare results against it.
+//#define SIMD_MATH_DISABLE
+
+// The widest instruction set the compiler was told it may use. AVX2 needs -mavx2 or /arch:AVX2
+// (HIKARIVOX_AVX2 in CMake); SSE2 is part of every x86-64 target and NEON of every arm64 one.
+// 32 bit ARM falls back to scalar.
+#if defined(SIMD_MATH_DISABLE)
+#define SIMD_MATH_SCALAR
+#elif defined(__AVX2__)
+#define SIMD_MATH_AVX2
+#define SIMD_MATH_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_MATH_SSE
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#define SIMD_MATH_NEON
+#else
+#define SIMD_MATH_SCALAR
+#endif
+
+// Boxes and points the batch routines handle per iteration. A multiple of every backend's width.
+static constexpr uint32_t SIMD_BATCH_SIZE = 8;
+
+// All matrices are column-major, matching GLSL mat4 in a std140 block, so a Mat4 can be copied
+// into a uniform buffer as it is. Projections target Vulkan clip space: y points down and depth
+// goes from 0 to 1. Vec4, Mat4 and Quat are 16 byte aligned so they load as one register.
+struct Vec3 {
+    float x, y, z;
+};
+
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+};
+
+struct alignas(16) Mat4 {
+    Vec4 columns[4];
+};
+
+// Unit quaternion for rotations, w is the real part.
+struct alignas(16) Quat {
+    float x, y, z, w;
+};
+
+inline Vec3 vec3(float x, float y, float z) {
+    return {x, y, z};
+}
+
+inline Vec3 vec3Add(Vec3 a, Vec3 b) {
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline Vec3 vec3Sub(Vec3 a, Vec3 b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline Vec3 vec3Scale(Vec3 v, float scale) {
+    return {v.x * scale, v.y * scale, v.z * scale};
+}
+
+inline float vec3Dot(Vec3 a, Vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 vec3Cross(Vec3 a, Vec3 b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline float vec3Length(Vec3 v) {
+    return std::sqrt(vec3Dot(v, v));
+}
+
+// Zero vectors stay zero.
+inline Vec3 vec3Normalize(Vec3 v) {
+    const float length = vec3Length(v);
+    return length > 0.0f ? vec3Scale(v, 1.0f / length) : v;
+}
+
+inline Vec4 vec4(float x, float y, float z, float w) {
+    return {x, y, z, w};
+}
+
+void mat4Identity(Mat4* out);
+// out = a * b. out may alias a or b.
+void mat4Multiply(const Mat4* a, const Mat4* b, Mat4* out);
+void mat4Transpose(const Mat4* matrix, Mat4* out);
+Vec4 mat4MultiplyVec4(const Mat4* matrix, Vec4 v);
+// Right-handed view space looking down -z.
+void mat4LookAt(Vec3 eye, Vec3 target, Vec3 up, Mat4* out);
+void mat4Perspective(float fovYRadians, float aspect, float nearPlane, float farPlane, Mat4* out);
+void mat4FromQuat(Quat rotation, Mat4* out);
+// Scale first, then rotation, then translation.
+void mat4FromTransform(Vec3 translation, Quat rotation, Vec3 scale, Mat4* out);
+
+Quat quatIdentity();
+// axis has to be normalized.
+Quat quatFromAxisAngle(Vec3 axis, float radians);
+// Rotates by b first, then by a.
+Quat quatMultiply(Quat a, Quat b);
+Quat quatNormalize(Quat q);
+Vec3 quatRotate(Quat q, Vec3 v);
+
+// Planes as (normal, distance) with normals pointing inwards, so a point p is inside a plane when
+// dot(normal, p) + distance >= 0. Order: left, right, bottom, top, near, far.
+struct Frustum {
+    Vec4 planes[6];
+};
+
+// Extracts the world space frustum from a view projection in Vulkan clip space.
+void frustumFromViewProjection(const Mat4* viewProjection, Frustum* frustum);
+
+// Axis aligned boxes in structure-of-arrays form, one array per coordinate, so the batch routines
+// load eight boxes' worth of one coordinate at once. The arrays belong to the caller.
+struct AabbSoa {
+    const float* minX;
+    const float* minY;
+    const float* minZ;
+    const float* maxX;
+    const float* maxY;
+    const float* maxZ;
+    uint32_t count;
+};
+
+// Writes 1 to visible[i] for boxes that intersect or lie inside the frustum and 0 for boxes fully
+// behind one of its planes, SIMD_BATCH_SIZE boxes at a time. Conservative like every plane test:
+// some boxes outside near the frustum's corners pass. Returns the number of visible boxes.
+uint32_t cullAabbs(const Frustum* frustum, const AabbSoa* boxes, uint8_t* visible);
+// Reference for cullAabbs(), one box at a time.
+uint32_t cullAabbsScalar(const Frustum* frustum, const AabbSoa* boxes, uint8_t* visible);
+
+// out = matrix * (x, y, z, 1) without the perspective divide, for model and view transforms.
+// Structure-of-arrays in and out; the outputs may alias the inputs.
+void transformPoints(const Mat4* matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, uint32_t count);
+// Reference for transformPoints(), one point at a time.
+void transformPointsScalar(const Mat4* matrix, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, uint32_t count);
+
+// "AVX2", "SSE2", "NEON" or "scalar".
+const char* getSimdMathBackendName();
@@ -1,3 +1,5 @@
+#include "binary_log.h"
+#include "logger.h"
 #include <iostream>
 
 void initLogger() {
@@ -9,14 +11,48 @@ void exitLogger() {
     std::cout << std::flush;
 }
 
+void flushLogger() {
+    std::cout << std::flush;
+}
+
+void setLogOverflowPolicy(LogOverflowPolicy policy) {
+    // Writes are synchronous, nothing can overflow.
+    (void)policy;
+}
+
 void logInfo(size_t lineNumber, const char* file, const char* message, size_t messageLength) {
-    std::cout << '[' << file << ':' << lineNumber << "]: " << message << std::endl;
+    std::cout << '[' << file << ':' << lineNumber << "]: ";
+    std::cout.write(message, messageLength) << std::endl;
 }
 
 void logWarn(size_t lineNumber, const char* file, const char* message, size_t messageLength) {
-    std::cout << "\033[33m[" << file << ':' << lineNumber << "]: " << message << "\033[0m" << std::endl;
+    std::cout << "\033[33m[" << file << ':' << lineNumber << "]: ";
+    std::cout.write(message, messageLength) << "\033[0m" << std::endl;
 }
 
 void logError(size_t lineNumber, const char* file, const char* message, size_t messageLength) {
-    std::cout << "\033[31m[" << file << ':' << lineNumber << "]: " << message << "\033[0m" << std::endl;
-}
\ No newline at end of file
+    std::cout << "\033[31m[" << file << ':' << lineNumber << "]: ";
+    std::cout.write(message, messageLength) << "\033[0m" << std::endl;
+}
+
+static void appendDecoded(const char* text, size_t length, void* userData) {
+    static_cast<std::string*>(userData)->append(text, length);
+}
+
+void logDeferred(const LogSite* site, const uint8_t* payload, size_t payloadSize) {
+    std::string buf;
+    decodeLogArgs(site->argTypes, site->argCount, payload, payloadSize, appendDecoded, &buf);
+    if (site->level == LOG_LEVEL_WARN) {
+        logWarn(site->lineNumber, site->file, buf.c_str(), buf.size());
+    } else if (site->level == LOG_LEVEL_ERROR) {
+        logError(site->lineNumber, site->file, buf.c_str(), buf.size());
+    } else {
+        logInfo(site->lineNumber, site->file, buf.c_str(), buf.size());
+    }
+}
+
+bool setLogBinaryOutput(const char* path) {
+    // Messages are formatted as soon as they arrive, there is nothing to defer to a file.
+    (void)path;
+    return false;
+}
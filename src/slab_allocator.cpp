@@ -0,0 +1,409 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "slab_allocator.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static constexpr uint32_t SLAB_COUNT = static_cast<uint32_t>(SLAB_REGION_SIZE / SLAB_SIZE);
+static constexpr uint32_t SLAB_NONE = UINT32_MAX;
+static constexpr uint32_t SLAB_THREAD_CACHE_BATCH = SLAB_THREAD_CACHE_SIZE / 2;
+static_assert(SLAB_SIZE_CLASSES[SLAB_SIZE_CLASS_COUNT - 1] == SLAB_MAX_OBJECT_SIZE, "The largest size class must be SLAB_MAX_OBJECT_SIZE");
+
+// Free objects link through their first bytes.
+struct SlabObject {
+    SlabObject* next;
+};
+
+struct SlabInfo {
+    SlabObject* freeList;
+    // Objects handed out by bumping, so a new slab's pages are only touched as it fills up.
+    uint32_t carved;
+    uint32_t used;
+    // Links in the pool's partial list, or in the pool's or one of the region's lists while empty.
+    uint32_t prev;
+    uint32_t next;
+    uint32_t sizeClass;
+};
+
+struct SlabPool {
+    std::mutex mutex;
+    uint32_t objectsPerSlab;
+    // Slabs with free objects. Full slabs are in no list and join again with their first free.
+    uint32_t partialHead;
+    // Empty slabs kept for this class, singly linked. Only used once no slab is partial.
+    uint32_t retainedHead;
+    SlabPoolStats stats;
+};
+
+struct SlabRegion {
+    uint8_t* base;
+    std::mutex mutex;
+    // Slabs from here on were never used.
+    uint32_t carvedSlabs;
+    // Empty slabs that still have their pages, and empty slabs whose pages went back to the OS.
+    uint32_t emptyHead;
+    uint32_t emptyCount;
+    uint32_t purgedHead;
+    uint32_t committedSlabs;
+    uint64_t purgedSlabCount;
+    bool hugePages;
+};
+
+// Plain data only, so the thread_local is constant initialised and needs no guard.
+struct SlabThreadCache {
+    void* objects[SLAB_SIZE_CLASS_COUNT][SLAB_THREAD_CACHE_SIZE];
+    uint32_t counts[SLAB_SIZE_CLASS_COUNT];
+    bool registered;
+    // Set once the thread's flusher ran; later calls on the exiting thread bypass the cache.
+    bool retired;
+};
+
+// Gives the cached objects back when the thread exits.
+struct SlabThreadCacheFlusher {
+    ~SlabThreadCacheFlusher();
+};
+
+static SlabRegion slabRegion;
+static SlabPool slabPools[SLAB_SIZE_CLASS_COUNT];
+static SlabInfo slabInfos[SLAB_COUNT];
+static uint8_t slabSizeClassLookup[SLAB_MAX_OBJECT_SIZE / 16 + 1];
+static std::atomic<uint64_t> slabLargeAllocations{0};
+static thread_local SlabThreadCache slabThreadCache = {};
+static thread_local SlabThreadCacheFlusher slabThreadCacheFlusher;
+
+static uint8_t* reserveRegion(size_t size) {
+#if defined(_WIN32)
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+#else
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<uint8_t*>(memory);
+#endif
+}
+
+static bool adviseHugePages(uint8_t* memory, size_t size) {
+#if defined(MADV_HUGEPAGE)
+    return madvise(memory, size, MADV_HUGEPAGE) == 0;
+#else
+    (void)memory;
+    (void)size;
+    return false;
+#endif
+}
+
+static bool commitSlab(uint32_t slab) {
+#if defined(_WIN32)
+    return VirtualAlloc(slabRegion.base + static_cast<size_t>(slab) * SLAB_SIZE, SLAB_SIZE, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    // Anonymous pages are committed on first touch.
+    (void)slab;
+    return true;
+#endif
+}
+
+// Splits the huge page around the slab. Only empty slabs beyond the retained ones get here, so
+// that happens when the live set shrinks, not during steady churn.
+static void purgeSlab(uint32_t slab) {
+    uint8_t* memory = slabRegion.base + static_cast<size_t>(slab) * SLAB_SIZE;
+#if defined(_WIN32)
+    VirtualFree(memory, SLAB_SIZE, MEM_DECOMMIT);
+#else
+    madvise(memory, SLAB_SIZE, MADV_DONTNEED);
+#endif
+}
+
+void initSlabAllocator() {
+    if (slabRegion.base != nullptr) {
+        return;
+    }
+    uint32_t sizeClass = 0;
+    for (uint32_t i = 0; i < sizeof(slabSizeClassLookup); i++) {
+        while (SLAB_SIZE_CLASSES[sizeClass] < i * 16) {
+            sizeClass++;
+        }
+        slabSizeClassLookup[i] = static_cast<uint8_t>(sizeClass);
+    }
+    for (uint32_t i = 0; i < SLAB_SIZE_CLASS_COUNT; i++) {
+        SlabPool* pool = &slabPools[i];
+        pool->objectsPerSlab = static_cast<uint32_t>(SLAB_SIZE / SLAB_SIZE_CLASSES[i]);
+        pool->partialHead = SLAB_NONE;
+        pool->retainedHead = SLAB_NONE;
+        pool->stats = {};
+        pool->stats.objectSize = SLAB_SIZE_CLASSES[i];
+    }
+
+    // Over-reserved by a huge page so the slabs can start on a huge page boundary.
+    uint8_t* reserved = reserveRegion(SLAB_REGION_SIZE + SLAB_HUGE_PAGE_SIZE);
+    if (reserved == nullptr) {
+        LOG_WARN("Failed to reserve ", static_cast<unsigned long long>(SLAB_REGION_SIZE >> 20), " MiB for slabs, small allocations use malloc.");
+        return;
+    }
+    const uintptr_t aligned = (reinterpret_cast<uintptr_t>(reserved) + SLAB_HUGE_PAGE_SIZE - 1) & ~static_cast<uintptr_t>(SLAB_HUGE_PAGE_SIZE - 1);
+    slabRegion.emptyHead = SLAB_NONE;
+    slabRegion.purgedHead = SLAB_NONE;
+    slabRegion.hugePages = adviseHugePages(reinterpret_cast<uint8_t*>(aligned), SLAB_REGION_SIZE);
+    slabRegion.base = reinterpret_cast<uint8_t*>(aligned);
+    LOG_INFO("Slab allocator: ", static_cast<unsigned long long>(SLAB_REGION_SIZE >> 20), " MiB reserved, huge pages ", slabRegion.hugePages ? "advised" : "unavailable");
+}
+
+// Takes the region lock; called with the pool's lock held.
+static uint32_t acquireSlab(uint32_t sizeClass) {
+    uint32_t slab = SLAB_NONE;
+    {
+        std::lock_guard<std::mutex> lock(slabRegion.mutex);
+        if (slabRegion.emptyHead != SLAB_NONE) {
+            slab = slabRegion.emptyHead;
+            slabRegion.emptyHead = slabInfos[slab].next;
+            slabRegion.emptyCount--;
+        } else {
+            if (slabRegion.purgedHead != SLAB_NONE) {
+                slab = slabRegion.purgedHead;
+                slabRegion.purgedHead = slabInfos[slab].next;
+            } else if (slabRegion.carvedSlabs < SLAB_COUNT) {
+                slab = slabRegion.carvedSlabs++;
+            } else {
+                return SLAB_NONE;
+            }
+            if (!commitSlab(slab)) {
+                slabInfos[slab].next = slabRegion.purgedHead;
+                slabRegion.purgedHead = slab;
+                return SLAB_NONE;
+            }
+            slabRegion.committedSlabs++;
+        }
+    }
+    SlabInfo* info = &slabInfos[slab];
+    info->freeList = nullptr;
+    info->carved = 0;
+    info->used = 0;
+    info->prev = SLAB_NONE;
+    info->next = SLAB_NONE;
+    info->sizeClass = sizeClass;
+    return slab;
+}
+
+static void releaseSlab(uint32_t slab) {
+    std::lock_guard<std::mutex> lock(slabRegion.mutex);
+    if (slabRegion.emptyCount < SLAB_RETAINED_EMPTY_SLABS) {
+        slabInfos[slab].next = slabRegion.emptyHead;
+        slabRegion.emptyHead = slab;
+        slabRegion.emptyCount++;
+        return;
+    }
+    purgeSlab(slab);
+    slabInfos[slab].next = slabRegion.purgedHead;
+    slabRegion.purgedHead = slab;
+    slabRegion.committedSlabs--;
+    slabRegion.purgedSlabCount++;
+}
+
+static void linkPartial(SlabPool* pool, uint32_t slab) {
+    SlabInfo* info = &slabInfos[slab];
+    info->prev = SLAB_NONE;
+    info->next = pool->partialHead;
+    if (pool->partialHead != SLAB_NONE) {
+        slabInfos[pool->partialHead].prev = slab;
+    }
+    pool->partialHead = slab;
+}
+
+static void unlinkPartial(SlabPool* pool, uint32_t slab) {
+    SlabInfo* info = &slabInfos[slab];
+    if (info->prev != SLAB_NONE) {
+        slabInfos[info->prev].next = info->next;
+    } else {
+        pool->partialHead = info->next;
+    }
+    if (info->next != SLAB_NONE) {
+        slabInfos[info->next].prev = info->prev;
+    }
+}
+
+// Returns how many of count objects the pool could hand out; fewer only when the region is full.
+static uint32_t takeFromPool(uint32_t sizeClass, void** objects, uint32_t count) {
+    SlabPool* pool = &slabPools[sizeClass];
+    const uint32_t objectSize = SLAB_SIZE_CLASSES[sizeClass];
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    uint32_t taken = 0;
+    while (taken < count) {
+        uint32_t slab = pool->partialHead;
+        if (slab == SLAB_NONE) {
+            // A retained slab keeps its free list, so it is taken back as it is.
+            slab = pool->retainedHead;
+            if (slab != SLAB_NONE) {
+                pool->retainedHead = slabInfos[slab].next;
+                pool->stats.retainedSlabCount--;
+            } else {
+                slab = acquireSlab(sizeClass);
+                if (slab == SLAB_NONE) {
+                    break;
+                }
+            }
+            linkPartial(pool, slab);
+            pool->stats.slabCount++;
+            pool->stats.peakSlabCount = std::max(pool->stats.peakSlabCount, pool->stats.slabCount);
+        }
+        SlabInfo* info = &slabInfos[slab];
+        while (taken < count && info->used < pool->objectsPerSlab) {
+            if (info->freeList != nullptr) {
+                objects[taken++] = info->freeList;
+                info->freeList = info->freeList->next;
+            } else {
+                objects[taken++] = slabRegion.base + static_cast<size_t>(slab) * SLAB_SIZE + static_cast<size_t>(info->carved) * objectSize;
+                info->carved++;
+            }
+            info->used++;
+        }
+        if (info->used == pool->objectsPerSlab) {
+            unlinkPartial(pool, slab);
+        }
+    }
+    pool->stats.outstandingObjects += taken;
+    pool->stats.refillCount++;
+    return taken;
+}
+
+static void returnToPool(uint32_t sizeClass, void* const* objects, uint32_t count) {
+    SlabPool* pool = &slabPools[sizeClass];
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t slab = static_cast<uint32_t>((static_cast<uint8_t*>(objects[i]) - slabRegion.base) / SLAB_SIZE);
+        SlabInfo* info = &slabInfos[slab];
+        if (info->used == pool->objectsPerSlab) {
+            linkPartial(pool, slab);
+        }
+        SlabObject* object = static_cast<SlabObject*>(objects[i]);
+        object->next = info->freeList;
+        info->freeList = object;
+        info->used--;
+        if (info->used == 0) {
+            unlinkPartial(pool, slab);
+            pool->stats.slabCount--;
+            if (pool->stats.retainedSlabCount < SLAB_RETAINED_SLABS_PER_CLASS) {
+                info->next = pool->retainedHead;
+                pool->retainedHead = slab;
+                pool->stats.retainedSlabCount++;
+            } else {
+                releaseSlab(slab);
+            }
+        }
+    }
+    pool->stats.outstandingObjects -= count;
+    pool->stats.flushCount++;
+}
+
+SlabThreadCacheFlusher::~SlabThreadCacheFlusher() {
+    SlabThreadCache* cache = &slabThreadCache;
+    for (uint32_t i = 0; i < SLAB_SIZE_CLASS_COUNT; i++) {
+        if (cache->counts[i] != 0) {
+            returnToPool(i, cache->objects[i], cache->counts[i]);
+            cache->counts[i] = 0;
+        }
+    }
+    cache->retired = true;
+}
+
+static void registerThreadCache(SlabThreadCache* cache) {
+    if (!cache->registered) {
+        // Constructs the flusher, which registers its destructor. Threads that only free objects
+        // fill their cache too, so both paths come through here.
+        (void)&slabThreadCacheFlusher;
+        cache->registered = true;
+    }
+}
+
+static bool isSlabMemory(const void* memory) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(memory);
+    return slabRegion.base != nullptr && bytes >= slabRegion.base && bytes < slabRegion.base + SLAB_REGION_SIZE;
+}
+
+static void* allocateLarge(size_t size) {
+    slabLargeAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+
+void* slabAllocate(size_t size) {
+    if (size > SLAB_MAX_OBJECT_SIZE || slabRegion.base == nullptr) {
+        return allocateLarge(size);
+    }
+    const uint32_t sizeClass = slabSizeClassLookup[(size + 15) / 16];
+    SlabThreadCache* cache = &slabThreadCache;
+    if (cache->retired) {
+        void* object = nullptr;
+        return takeFromPool(sizeClass, &object, 1) == 1 ? object : allocateLarge(size);
+    }
+    if (cache->counts[sizeClass] == 0) {
+        registerThreadCache(cache);
+        cache->counts[sizeClass] = takeFromPool(sizeClass, cache->objects[sizeClass], SLAB_THREAD_CACHE_BATCH);
+        if (cache->counts[sizeClass] == 0) {
+            return allocateLarge(size);
+        }
+    }
+    return cache->objects[sizeClass][--cache->counts[sizeClass]];
+}
+
+void slabFree(void* memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    if (!isSlabMemory(memory)) {
+        std::free(memory);
+        return;
+    }
+    const uint32_t slab = static_cast<uint32_t>((static_cast<uint8_t*>(memory) - slabRegion.base) / SLAB_SIZE);
+    const uint32_t sizeClass = slabInfos[slab].sizeClass;
+    SlabThreadCache* cache = &slabThreadCache;
+    if (cache->retired) {
+        returnToPool(sizeClass, &memory, 1);
+        return;
+    }
+    registerThreadCache(cache);
+    if (cache->counts[sizeClass] == SLAB_THREAD_CACHE_SIZE) {
+        // The older half goes back; the recently freed objects are the ones still in cache.
+        returnToPool(sizeClass, cache->objects[sizeClass], SLAB_THREAD_CACHE_BATCH);
+        std::memmove(cache->objects[sizeClass], cache->objects[sizeClass] + SLAB_THREAD_CACHE_BATCH, sizeof(void*) * (SLAB_THREAD_CACHE_SIZE - SLAB_THREAD_CACHE_BATCH));
+        cache->counts[sizeClass] -= SLAB_THREAD_CACHE_BATCH;
+    }
+    cache->objects[sizeClass][cache->counts[sizeClass]++] = memory;
+}
+
+void getSlabAllocatorStats(SlabAllocatorStats* stats) {
+    *stats = {};
+    for (uint32_t i = 0; i < SLAB_SIZE_CLASS_COUNT; i++) {
+        std::lock_guard<std::mutex> lock(slabPools[i].mutex);
+        stats->pools[i] = slabPools[i].stats;
+    }
+    std::lock_guard<std::mutex> lock(slabRegion.mutex);
+    stats->emptySlabCount = slabRegion.emptyCount;
+    stats->purgedSlabCount = slabRegion.purgedSlabCount;
+    stats->committedBytes = static_cast<uint64_t>(slabRegion.committedSlabs) * SLAB_SIZE;
+    stats->largeAllocationCount = slabLargeAllocations.load(std::memory_order_relaxed);
+    stats->hugePages = slabRegion.hugePages;
+}
+
+void logSlabAllocatorStats() {
+    SlabAllocatorStats stats = {};
+    getSlabAllocatorStats(&stats);
+    LOG_INFO("Slab allocator: ", static_cast<unsigned long long>(stats.committedBytes / 1024), " KiB committed, ",
+        stats.emptySlabCount, " empty slabs retained, ", static_cast<unsigned long long>(stats.purgedSlabCount), " purged, ",
+        static_cast<unsigned long long>(stats.largeAllocationCount), " large allocations");
+    for (uint32_t i = 0; i < SLAB_SIZE_CLASS_COUNT; i++) {
+        const SlabPoolStats& pool = stats.pools[i];
+        if (pool.peakSlabCount == 0) {
+            continue;
+        }
+        LOG_INFO("  ", pool.objectSize, " bytes: ", static_cast<unsigned long long>(pool.outstandingObjects), " objects out, ",
+            pool.slabCount, " slabs, peak ", pool.peakSlabCount, ", ", pool.retainedSlabCount, " retained, ", static_cast<unsigned long long>(pool.refillCount), " refills, ",
+            static_cast<unsigned long long>(pool.flushCount), " flushes");
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Objects of one size class are carved out of slabs of this size. Slabs are aligned to it.
+static constexpr size_t SLAB_SIZE = 64 * 1024;
+// Address space reserved up front for all slabs. Only touched pages take memory.
+static constexpr size_t SLAB_REGION_SIZE = 1024ull * 1024 * 1024;
+// The region is aligned to this, so the kernel can back it with transparent huge pages.
+static constexpr size_t SLAB_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static constexpr uint32_t SLAB_SIZE_CLASS_COUNT = 18;
+static constexpr uint32_t SLAB_SIZE_CLASSES[SLAB_SIZE_CLASS_COUNT] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192
+};
+// Larger requests go to malloc.
+static constexpr size_t SLAB_MAX_OBJECT_SIZE = 8192;
+// Objects per size class a thread keeps for itself. Refills and flushes move half of that.
+static constexpr uint32_t SLAB_THREAD_CACHE_SIZE = 32;
+// Empty slabs each size class keeps for itself, so a class whose live set rises and falls every
+// frame reuses its own slabs without touching the region. A class never keeps more than it had
+// live at its peak, so this only caps what a one-off spike leaves resident.
+static constexpr uint32_t SLAB_RETAINED_SLABS_PER_CLASS = 64;
+// Empty slabs the region keeps committed for any class on top of that. Beyond that their pages
+// go back to the OS, so churn cannot grow the resident set past the peak that is actually live.
+static constexpr uint32_t SLAB_RETAINED_EMPTY_SLABS = 32;
+
+// Size-class slab allocator for small objects that are allocated and freed all the time, such
+// as the driver's host allocations or chunk data. Every thread caches a few objects per class,
+// so most calls touch no lock. Slabs come from one address range reserved with mmap and marked
+// for huge pages, which keeps TLB misses down and makes ownership a range check.
+void initSlabAllocator();
+// 16 byte aligned. Never fails for sizes up to SLAB_MAX_OBJECT_SIZE unless the region is full,
+// in which case it falls back to malloc like larger sizes do.
+void* slabAllocate(size_t size);
+// Takes anything slabAllocate() returned, from any thread.
+void slabFree(void* memory);
+
+struct SlabPoolStats {
+    uint32_t objectSize;
+    // Slabs holding at least one object of this class.
+    uint32_t slabCount;
+    uint32_t peakSlabCount;
+    // Empty slabs the class keeps for itself.
+    uint32_t retainedSlabCount;
+    // Objects handed out of the pool, including those in thread caches.
+    uint64_t outstandingObjects;
+    // Trips to the pool from thread caches.
+    uint64_t refillCount;
+    uint64_t flushCount;
+};
+
+struct SlabAllocatorStats {
+    SlabPoolStats pools[SLAB_SIZE_CLASS_COUNT];
+    // Empty slabs the region keeps for any class.
+    uint32_t emptySlabCount;
+    // Empty slabs whose pages were returned to the OS.
+    uint64_t purgedSlabCount;
+    // Bytes of slabs that hold objects, i.e. the slab allocator's share of the resident set.
+    uint64_t committedBytes;
+    uint64_t largeAllocationCount;
+    bool hugePages;
+};
+
+void getSlabAllocatorStats(SlabAllocatorStats* stats);
+void logSlabAllocatorStats();
+
+template <typename T, typename... Args>
+T* slabNew(Args&&... args) {
+    static_assert(alignof(T) <= 16, "Slab objects are 16 byte aligned");
+    return new (slabAllocate(sizeof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void slabDelete(T* object) {
+    if (object != nullptr) {
+        object->~T();
+        slabFree(object);
+    }
+}
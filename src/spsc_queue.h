@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Fixed-size single-producer/single-consumer ring.
+// The try variants never block or take a lock. The blocking variants park on the index
+// atomics (C++20 wait/notify) only while the ring is full or empty.
+template<typename T, uint32_t Capacity>
+struct SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    // Next slot to read. Only written by the consumer.
+    alignas(64) std::atomic<uint32_t> head{0};
+    // Next slot to write. Only written by the producer.
+    alignas(64) std::atomic<uint32_t> tail{0};
+    alignas(64) T items[Capacity];
+};
+
+template<typename T, uint32_t Capacity>
+inline bool spscTryPush(SpscQueue<T, Capacity>* queue, const T& item) {
+    const uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    const uint32_t head = queue->head.load(std::memory_order_acquire);
+    if (tail - head == Capacity) {
+        return false;
+    }
+
+    queue->items[tail & (Capacity - 1)] = item;
+    queue->tail.store(tail + 1, std::memory_order_release);
+    queue->tail.notify_one();
+    return true;
+}
+
+template<typename T, uint32_t Capacity>
+inline void spscPush(SpscQueue<T, Capacity>* queue, const T& item) {
+    while (!spscTryPush(queue, item)) {
+        const uint32_t head = queue->head.load(std::memory_order_acquire);
+        if (queue->tail.load(std::memory_order_relaxed) - head == Capacity) {
+            queue->head.wait(head, std::memory_order_acquire);
+        }
+    }
+}
+
+template<typename T, uint32_t Capacity>
+inline bool spscTryPop(SpscQueue<T, Capacity>* queue, T* item) {
+    const uint32_t head = queue->head.load(std::memory_order_relaxed);
+    const uint32_t tail = queue->tail.load(std::memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *item = queue->items[head & (Capacity - 1)];
+    queue->head.store(head + 1, std::memory_order_release);
+    queue->head.notify_one();
+    return true;
+}
+
+template<typename T, uint32_t Capacity>
+inline void spscPop(SpscQueue<T, Capacity>* queue, T* item) {
+    while (!spscTryPop(queue, item)) {
+        const uint32_t tail = queue->tail.load(std::memory_order_acquire);
+        if (queue->head.load(std::memory_order_relaxed) == tail) {
+            queue->tail.wait(tail, std::memory_order_acquire);
+        }
+    }
+}
+
+// Items queued right now. Exact from either end's own thread, a snapshot from anywhere else.
+template<typename T, uint32_t Capacity>
+inline uint32_t spscSize(const SpscQueue<T, Capacity>* queue) {
+    return queue->tail.load(std::memory_order_acquire) - queue->head.load(std::memory_order_acquire);
+}
+
+// Blocks the producer until the consumer has taken every queued item.
+template<typename T, uint32_t Capacity>
+inline void spscWaitEmpty(SpscQueue<T, Capacity>* queue) {
+    uint32_t head = queue->head.load(std::memory_order_acquire);
+    while (head != queue->tail.load(std::memory_order_relaxed)) {
+        queue->head.wait(head, std::memory_order_acquire);
+        head = queue->head.load(std::memory_order_acquire);
+    }
+}
@@ -0,0 +1,233 @@
+#pragma once
+#include "async_io.h"
+#include "job_system.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+// Coroutines on top of the job system. A Task is lazy: it runs once awaited or started with
+// startTask(), on the thread that does so, and after each co_await on whichever thread completed
+// the awaited operation, usually a job worker. Waiting never blocks a thread; the awaiting
+// coroutine is resumed by a job submitted on completion. Coroutine frames live on the heap, so
+// tasks are for loading and streaming, not for the frame loop.
+// A task that finishes without suspending hands back to its awaiter by returning, not by resuming
+// it, so a loop over such tasks runs in constant stack. Symmetric transfer would leave that to the
+// compiler turning the resume into a tail call, which GCC and MSVC skip in debug builds.
+
+template <typename T>
+struct Task;
+
+inline void resumeCoroutineJob(void* data) {
+    std::coroutine_handle<>::from_address(data).resume();
+}
+
+inline Job makeResumeJob(std::coroutine_handle<> handle) {
+    return {resumeCoroutineJob, handle.address(), "Resume task", nullptr};
+}
+
+struct TaskPromiseBase {
+    // The awaiting coroutine.
+    std::coroutine_handle<> continuation;
+    // Set by whichever comes first of the task finishing and its awaiter being done starting it.
+    // The second one continues the awaiting coroutine.
+    std::atomic<bool> handedOver{false};
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            // Read first: once resumed, the awaiting coroutine may destroy this frame.
+            const std::coroutine_handle<> continuation = handle.promise().continuation;
+            if (handle.promise().handedOver.exchange(true, std::memory_order_acq_rel)) {
+                continuation.resume();
+            }
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    // Exceptions are off the table like everywhere else in the engine.
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    T value;
+    Task<T> get_return_object() noexcept;
+    void return_value(T result) { value = std::move(result); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+};
+
+template <typename T = void>
+struct Task {
+    using promise_type = TaskPromise<T>;
+    std::coroutine_handle<promise_type> handle;
+
+    Task() : handle(nullptr) {}
+    explicit Task(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // Valid once the task has finished.
+    T result() {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(handle.promise().value);
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    T await_resume() { return result(); }
+};
+
+// Runs task on the calling thread up to its first suspension. False if it already finished, in
+// which case the awaiting coroutine does not suspend.
+template <typename T>
+bool startAwaitedTask(std::coroutine_handle<TaskPromise<T>> task, std::coroutine_handle<> awaiting) noexcept {
+    task.promise().continuation = awaiting;
+    task.resume();
+    return !task.promise().handedOver.exchange(true, std::memory_order_acq_rel);
+}
+
+template <typename T>
+bool Task<T>::await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    return startAwaitedTask(handle, awaiting);
+}
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Fire and forget; the frame frees itself when the coroutine returns.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+template <typename T>
+struct TaskRunAwaiter {
+    std::coroutine_handle<TaskPromise<T>> handle;
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept { return startAwaitedTask(handle, awaiting); }
+    void await_resume() noexcept {}
+};
+
+template <typename T>
+DetachedTask runTaskDetached(JobSystem* system, Task<T>* task, JobCounter* counter) {
+    co_await TaskRunAwaiter<T>{task->handle};
+    finishJobCounter(system, counter);
+}
+
+// Runs task on the calling thread up to its first suspension and counts it in counter until it
+// has finished, so a thread outside of any coroutine can join it with waitForCounter(). The task
+// object has to stay alive until then; its value is read with result() afterwards.
+template <typename T>
+void startTask(JobSystem* system, Task<T>* task, JobCounter* counter) {
+    counter->pending.fetch_add(1, std::memory_order_relaxed);
+    runTaskDetached(system, task, counter);
+}
+
+// Continues the coroutine on a job worker, e.g. to move decoding off the I/O thread.
+struct ScheduleOnJobsAwaiter {
+    JobSystem* system;
+    JobPriority priority;
+    Job job;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        job = makeResumeJob(awaiting);
+        submitJobs(system, &job, 1, priority, nullptr);
+    }
+    void await_resume() noexcept {}
+};
+
+inline ScheduleOnJobsAwaiter scheduleOnJobs(JobSystem* system, JobPriority priority = JOB_PRIORITY_NORMAL) {
+    return {system, priority, {}};
+}
+
+// Submits jobs and continues once all of them are done. The counter holds one extra count for the
+// suspension itself, so the jobs cannot resume the coroutine before await_suspend is done with it;
+// if they all finished by then, the coroutine simply does not suspend.
+struct JobsAwaiter {
+    JobSystem* system;
+    Job* jobs;
+    uint32_t count;
+    JobPriority priority;
+    JobCounter counter;
+    Job resumeJob;
+    bool await_ready() const noexcept { return count == 0; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        resumeJob = makeResumeJob(awaiting);
+        counter.pending.store(1, std::memory_order_relaxed);
+        counter.continuation = &resumeJob;
+        submitJobs(system, jobs, count, priority, &counter);
+        return counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+    void await_resume() noexcept {}
+};
+
+// The jobs have to stay alive until the co_await returns.
+inline JobsAwaiter runJobsAsync(JobSystem* system, Job* jobs, uint32_t count, JobPriority priority = JOB_PRIORITY_NORMAL) {
+    return {system, jobs, count, priority, {}, {}};
+}
+
+struct AsyncIoAwaiter {
+    AsyncIo* io;
+    AsyncIoRequest request;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        request.completion = makeResumeJob(awaiting);
+        submitAsyncIo(io, &request);
+    }
+    bool await_resume() noexcept { return request.result; }
+};
+
+// Reads the whole file into bytes on the I/O thread. Yields false if it cannot be read.
+inline AsyncIoAwaiter readFileAsync(AsyncIo* io, const char* path, std::vector<uint8_t>* bytes) {
+    AsyncIoAwaiter awaiter = {io, {}};
+    awaiter.request.kind = ASYNC_IO_FILE_READ;
+    awaiter.request.path = path;
+    awaiter.request.bytes = bytes;
+    return awaiter;
+}
+
+// Continues once the GPU has signalled fence. Yields false if the device was lost.
+inline AsyncIoAwaiter waitForFenceAsync(AsyncIo* io, VkDevice device, VkFence fence) {
+    AsyncIoAwaiter awaiter = {io, {}};
+    awaiter.request.kind = ASYNC_IO_FENCE_WAIT;
+    awaiter.request.device = device;
+    awaiter.request.fence = fence;
+    return awaiter;
+}
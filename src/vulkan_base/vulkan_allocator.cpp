@@ -0,0 +1,142 @@
+#include "vulkan_base.h"
+#include <cstdlib>
+#include <cstring>
+
+// Stored in front of every allocation so free and realloc know the size and scope,
+// and where the backend allocation actually starts.
+struct alignas(16) HostAllocationHeader {
+    void* base;
+    uint64_t size;
+    uint32_t scope;
+};
+
+static void* mallocBackend(size_t size) {
+    return std::malloc(size);
+}
+
+static void freeBackend(void* memory) {
+    std::free(memory);
+}
+
+static HostAllocationHeader* getHeader(void* memory) {
+    return reinterpret_cast<HostAllocationHeader*>(static_cast<uint8_t*>(memory) - sizeof(HostAllocationHeader));
+}
+
+static VKAPI_ATTR void* VKAPI_CALL hostAllocate(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    VulkanHostAllocator* allocator = static_cast<VulkanHostAllocator*>(userData);
+    if (alignment < alignof(HostAllocationHeader)) {
+        alignment = alignof(HostAllocationHeader);
+    }
+
+    uint8_t* base = static_cast<uint8_t*>(allocator->backend.allocate(size + sizeof(HostAllocationHeader) + alignment));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    const uintptr_t firstUsable = reinterpret_cast<uintptr_t>(base) + sizeof(HostAllocationHeader);
+    void* memory = reinterpret_cast<void*>((firstUsable + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+
+    HostAllocationHeader* header = getHeader(memory);
+    header->base = base;
+    header->size = size;
+    header->scope = static_cast<uint32_t>(scope);
+
+    allocator->liveBytes[scope].fetch_add(size, std::memory_order_relaxed);
+    allocator->allocationCount[scope].fetch_add(1, std::memory_order_relaxed);
+    const uint64_t totalBytes = allocator->totalBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = allocator->peakBytes.load(std::memory_order_relaxed);
+    while (totalBytes > peak && !allocator->peakBytes.compare_exchange_weak(peak, totalBytes, std::memory_order_relaxed)) {
+    }
+    return memory;
+}
+
+static VKAPI_ATTR void VKAPI_CALL hostFree(void* userData, void* memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    VulkanHostAllocator* allocator = static_cast<VulkanHostAllocator*>(userData);
+    HostAllocationHeader* header = getHeader(memory);
+    allocator->liveBytes[header->scope].fetch_sub(header->size, std::memory_order_relaxed);
+    allocator->totalBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    allocator->backend.free(header->base);
+}
+
+static VKAPI_ATTR void* VKAPI_CALL hostReallocate(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (original == nullptr) {
+        return hostAllocate(userData, size, alignment, scope);
+    }
+    if (size == 0) {
+        hostFree(userData, original);
+        return nullptr;
+    }
+
+    void* memory = hostAllocate(userData, size, alignment, scope);
+    if (memory == nullptr) {
+        // The original allocation must stay valid on failure.
+        return nullptr;
+    }
+    const uint64_t originalSize = getHeader(original)->size;
+    std::memcpy(memory, original, static_cast<size_t>(originalSize < size ? originalSize : size));
+    hostFree(userData, original);
+    return memory;
+}
+
+static VKAPI_ATTR void VKAPI_CALL hostInternalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+    (void)type;
+    (void)scope;
+    static_cast<VulkanHostAllocator*>(userData)->internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static VKAPI_ATTR void VKAPI_CALL hostInternalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+    (void)type;
+    (void)scope;
+    static_cast<VulkanHostAllocator*>(userData)->internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void initVulkanHostAllocator(VulkanHostAllocator* allocator, const VulkanHostAllocatorBackend* backend) {
+    allocator->backend = (backend != nullptr) ? *backend : VulkanHostAllocatorBackend{mallocBackend, freeBackend};
+    for (uint32_t i = 0; i < VULKAN_ALLOCATION_SCOPE_COUNT; i++) {
+        allocator->liveBytes[i].store(0, std::memory_order_relaxed);
+        allocator->allocationCount[i].store(0, std::memory_order_relaxed);
+    }
+    allocator->totalBytes.store(0, std::memory_order_relaxed);
+    allocator->peakBytes.store(0, std::memory_order_relaxed);
+    allocator->internalBytes.store(0, std::memory_order_relaxed);
+
+    allocator->callbacks = {};
+    allocator->callbacks.pUserData = allocator;
+    allocator->callbacks.pfnAllocation = hostAllocate;
+    allocator->callbacks.pfnReallocation = hostReallocate;
+    allocator->callbacks.pfnFree = hostFree;
+    allocator->callbacks.pfnInternalAllocation = hostInternalAllocation;
+    allocator->callbacks.pfnInternalFree = hostInternalFree;
+}
+
+VulkanHostAllocationStats getVulkanHostAllocationStats(const VulkanHostAllocator* allocator) {
+    VulkanHostAllocationStats stats = {};
+    for (uint32_t i = 0; i < VULKAN_ALLOCATION_SCOPE_COUNT; i++) {
+        stats.liveBytes[i] = allocator->liveBytes[i].load(std::memory_order_relaxed);
+        stats.allocationCount[i] = allocator->allocationCount[i].load(std::memory_order_relaxed);
+        stats.totalAllocationCount += stats.allocationCount[i];
+    }
+    stats.totalLiveBytes = allocator->totalBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = allocator->peakBytes.load(std::memory_order_relaxed);
+    stats.internalBytes = allocator->internalBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+const char* getVulkanAllocationScopeName(VkSystemAllocationScope scope) {
+    switch (scope) {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+            return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+            return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+            return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+            return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+            return "instance";
+        default:
+            return "unknown";
+    }
+}
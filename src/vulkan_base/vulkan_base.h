@@ -1,10 +1,14 @@
 //
 // Created by liqui on 26.02.2026.
 //
+#pragma once
 #include "../logger.h"
+#include "../profiler.h"
 
 #include <vulkan/vulkan.h>
+#include <atomic>
 #include <cassert>
+#include <mutex>
 #include <vector>
 
 #define ASSERT_VULKAN(val) if (val != VK_SUCCESS) {assert(false);}
@@ -17,6 +21,19 @@
 
 #define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
 
+// Debug-utils object names and command labels for RenderDoc and validation output.
+// Release builds (NDEBUG) compile them out.
+#ifndef NDEBUG
+#define VULKAN_DEBUG_MARKERS
+#endif
+
+#ifdef VULKAN_DEBUG_MARKERS
+#define VK_NAME(context, objectType, handle, name) setVulkanObjectName(context, objectType, (uint64_t)(handle), name)
+#else
+// Still evaluates the context and handle, so variables that only exist to be named stay used.
+#define VK_NAME(context, objectType, handle, name) ((void)(context), (void)(handle))
+#endif
+
 struct VulkanQueue {
     VkQueue queue;
     uint32_t familyIndex;
@@ -27,8 +44,12 @@ struct VulkanSwapChain {
     uint32_t width;
     uint32_t height;
     VkFormat format;
+    VkPresentModeKHR presentMode;
     std::vector<VkImage> images;
     std::vector<VkImageView> imageViews;
+    // Offscreen only: swapChain stays VK_NULL_HANDLE and the images own their memory.
+    bool offscreen;
+    std::vector<VkDeviceMemory> imageMemory;
 };
 
 struct VulkanPipeline {
@@ -36,27 +57,387 @@ struct VulkanPipeline {
     VkPipelineLayout pipelineLayout;
 };
 
+// One screen-space quad of an overlay, drawn as an instance. Mirrors the inputs of hud_vert.glsl.
+struct VulkanOverlayQuad {
+    // x0, y0, x1, y1 in normalized device coordinates.
+    float rect[4];
+    // u0, v0, u1, v1.
+    float uvRect[4];
+    // RGBA8, multiplied with the sampled texel.
+    uint32_t color;
+};
+
+// budget and usage are only known with VK_EXT_memory_budget, otherwise they are 0.
+struct VulkanMemoryHeapStats {
+    VkDeviceSize size;
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    bool deviceLocal;
+};
+
+// Secondary command buffers that are recorded once and replayed every frame.
+// Each frame-in-flight slot owns one buffer; bumping the version marks all slots stale.
+struct VulkanStaticCommands {
+    VkCommandPool commandPool;
+    std::vector<VkCommandBuffer> commandBuffers;
+    std::vector<uint64_t> recordedVersions;
+    uint64_t version;
+};
+
+struct VulkanFrameRingAllocation {
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void* data;
+};
+
+// Persistently mapped buffer split into one linear segment per frame in flight.
+// Allocations are a bump of head; a segment is recycled once its frame fence has been waited on.
+// uniformSet exposes the whole ring as a dynamic uniform buffer, so binding is just a dynamic offset.
+struct VulkanFrameRing {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint8_t* mapped;
+    VkDeviceSize frameSize;
+    uint32_t frameCount;
+    VkDeviceSize minAlignment;
+    VkDeviceSize frameBegin;
+    VkDeviceSize head;
+    VkDeviceSize frameEnd;
+    VkDescriptorSetLayout uniformSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet uniformSet;
+};
+
+static constexpr uint32_t VULKAN_ALLOCATION_SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+// Where the tracking allocator gets its memory from. Must return memory aligned for any scalar type.
+struct VulkanHostAllocatorBackend {
+    void* (*allocate)(size_t size);
+    void (*free)(void* memory);
+};
+
+// Host memory the driver allocates through the context's VkAllocationCallbacks, per
+// VkSystemAllocationScope. The driver may call the callbacks from any thread, hence the atomics.
+struct VulkanHostAllocator {
+    VkAllocationCallbacks callbacks;
+    VulkanHostAllocatorBackend backend;
+    std::atomic<uint64_t> liveBytes[VULKAN_ALLOCATION_SCOPE_COUNT];
+    std::atomic<uint64_t> allocationCount[VULKAN_ALLOCATION_SCOPE_COUNT];
+    std::atomic<uint64_t> totalBytes;
+    std::atomic<uint64_t> peakBytes;
+    // Memory the driver allocated itself and only reported, e.g. executable code.
+    std::atomic<uint64_t> internalBytes;
+};
+
+struct VulkanHostAllocationStats {
+    uint64_t liveBytes[VULKAN_ALLOCATION_SCOPE_COUNT];
+    uint64_t allocationCount[VULKAN_ALLOCATION_SCOPE_COUNT];
+    uint64_t totalLiveBytes;
+    uint64_t totalAllocationCount;
+    uint64_t peakBytes;
+    uint64_t internalBytes;
+};
+
 struct VulkanContext {
+    // Passed to every create and destroy call. Points at hostAllocator.callbacks.
+    const VkAllocationCallbacks* allocator;
+    VulkanHostAllocator hostAllocator;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice;
     VkPhysicalDeviceProperties physicalDeviceProperties;
     VkDevice device;
     VulkanQueue graphicsQueue;
+    // Held around vkQueueSubmit, vkQueuePresentKHR and vkDeviceWaitIdle, which need external
+    // synchronisation of graphicsQueue now that uploads may be submitted from job threads.
+    std::mutex graphicsQueueMutex;
+    bool synchronization2Enabled;
+    bool presentWaitEnabled;
+    bool memoryBudgetEnabled;
+    PFN_vkWaitForPresentKHR vkWaitForPresentKHR;
+    // Null without VK_EXT_debug_utils; the debug marker functions then do nothing.
+    PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameEXT;
+    PFN_vkCmdBeginDebugUtilsLabelEXT vkCmdBeginDebugUtilsLabelEXT;
+    PFN_vkCmdEndDebugUtilsLabelEXT vkCmdEndDebugUtilsLabelEXT;
+    // Valid bits of graphics queue timestamps. 0 means the queue does not support timestamps.
+    uint32_t timestampValidBits;
+    // Running totals for statistics and budgets. Uploads may run on job threads, hence the atomics.
+    std::atomic<uint64_t> deviceAllocationCount;
+    std::atomic<uint64_t> uploadedBytes;
+};
+
+static constexpr uint32_t GPU_PROFILER_INVALID_SCOPE = UINT32_MAX;
+// Samples per scope used for the rolling average and the percentiles.
+static constexpr uint32_t GPU_PROFILER_HISTORY_SIZE = 128;
+
+struct VulkanGpuProfilerStats {
+    const char* name;
+    uint32_t sampleCount;
+    double lastMs;
+    double averageMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+};
+
+// Rolling timing history of one named scope. Scopes with the same name share one history.
+struct VulkanGpuProfilerScope {
+    const char* name;
+    float historyMs[GPU_PROFILER_HISTORY_SIZE];
+    uint32_t historyCount;
+    uint32_t historyHead;
+    double lastMs;
+};
+
+// Timestamp queries written into one frame-in-flight slot, read back the next time the slot is begun.
+struct VulkanGpuProfilerFrame {
+    uint32_t queryCount;
+    std::vector<uint32_t> scopeIds;
+    bool pending;
+};
+
+// Timestamp query based GPU profiler. Every frame slot owns a range of a single query pool.
+// beginGpuProfilerFrame() must be called at the start of a slot's command buffer after its fence
+// has been waited on; it collects the results written frameCount frames ago without stalling and
+// resets the range. Each scope writes a begin and an end timestamp, so scopes may nest.
+struct VulkanGpuProfiler {
+    VkQueryPool queryPool;
+    uint32_t frameCount;
+    uint32_t maxScopesPerFrame;
+    double nsPerTick;
+    uint64_t timestampMask;
+    std::vector<VulkanGpuProfilerFrame> frames;
+    std::vector<VulkanGpuProfilerScope> scopes;
+    std::vector<uint64_t> readback;
+    uint32_t currentFrame;
+    // GPU time from the first to the last timestamp of the most recently resolved frame.
+    double lastFrameMs;
+    bool lastFrameValid;
+    bool enabled;
+};
+
+// How a render graph pass (or the outside world) touches an image.
+// Each access maps to a pipeline stage, access mask and image layout, see getAccessState().
+enum VulkanResourceAccess {
+    VULKAN_ACCESS_NONE,
+    // Swapchain image right after acquire: contents undefined, must wait for the acquire semaphore stage.
+    VULKAN_ACCESS_ACQUIRE,
+    VULKAN_ACCESS_TRANSFER_READ,
+    VULKAN_ACCESS_TRANSFER_WRITE,
+    VULKAN_ACCESS_COLOR_ATTACHMENT_WRITE,
+    VULKAN_ACCESS_DEPTH_ATTACHMENT_WRITE,
+    VULKAN_ACCESS_DEPTH_ATTACHMENT_READ,
+    VULKAN_ACCESS_FRAGMENT_SHADER_READ,
+    VULKAN_ACCESS_COMPUTE_SHADER_READ,
+    VULKAN_ACCESS_COMPUTE_SHADER_WRITE,
+    VULKAN_ACCESS_PRESENT,
+};
+
+struct VulkanAccessState {
+    VkPipelineStageFlags2 stageMask;
+    VkAccessFlags2 accessMask;
+    VkImageLayout layout;
+    bool write;
+};
+
+typedef uint32_t RenderGraphResource;
+static constexpr RenderGraphResource RENDER_GRAPH_INVALID_RESOURCE = UINT32_MAX;
+
+typedef void (*RenderGraphPassCallback)(VkCommandBuffer commandBuffer, void* userData);
+
+struct RenderGraphImageDesc {
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspectMask;
+    uint32_t mipLevels;
+    uint32_t arrayLayers;
+};
+
+struct RenderGraphResourceUse {
+    RenderGraphResource resource;
+    VulkanResourceAccess access;
+    uint32_t baseMipLevel;
+    uint32_t levelCount;
+    uint32_t baseArrayLayer;
+    uint32_t layerCount;
 };
 
-VulkanContext* initVulkan(uint32_t instanceExtensionCount, const char* const* instanceExtensions, uint32_t deviceExtensionCount, const char** deviceExtensions);
+struct RenderGraphPass {
+    const char* name;
+    RenderGraphPassCallback callback;
+    void* userData;
+    std::vector<RenderGraphResourceUse> uses;
+    bool sideEffects;
+    bool culled;
+};
+
+struct RenderGraphImage {
+    const char* name;
+    RenderGraphImageDesc desc;
+    bool imported;
+    VulkanResourceAccess initialAccess;
+    VulkanResourceAccess finalAccess;
+    VkImage image;
+    VkImageView imageView;
+    uint32_t memoryBlock;
+    uint32_t firstPass;
+    uint32_t lastPass;
+};
+
+// Barriers that have to run before an executed pass, already merged into one batch.
+// barrierResources parallels barriers so imported image handles can be patched in each frame.
+struct RenderGraphBarrierBatch {
+    std::vector<VkImageMemoryBarrier2> barriers;
+    std::vector<RenderGraphResource> barrierResources;
+};
+
+// Frame graph: passes declare their image uses, compileRenderGraph() culls unused passes,
+// aliases transient image memory and precomputes the barrier batches, and executeRenderGraph()
+// only patches imported image handles and replays them.
+struct RenderGraph {
+    std::vector<RenderGraphImage> images;
+    std::vector<RenderGraphPass> passes;
+    std::vector<uint32_t> executionOrder;
+    std::vector<RenderGraphBarrierBatch> passBarriers;
+    RenderGraphBarrierBatch finalBarriers;
+    std::vector<VkDeviceMemory> memoryBlocks;
+    bool compiled;
+};
+
+// A null hostAllocatorBackend uses malloc and free.
+VulkanContext* initVulkan(uint32_t instanceExtensionCount, const char* const* instanceExtensions, uint32_t deviceExtensionCount, const char** deviceExtensions, const VulkanHostAllocatorBackend* hostAllocatorBackend);
 void exitVulkan(VulkanContext* context);
+// vkDeviceWaitIdle under graphicsQueueMutex. Use it instead of calling vkDeviceWaitIdle directly.
+void waitForDeviceIdle(VulkanContext* context);
 
-VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage);
+VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage, VkPresentModeKHR preferredPresentMode);
+VulkanSwapChain createOffscreenSwapChain(VulkanContext* context, uint32_t width, uint32_t height, VkFormat format, uint32_t imageCount, VkImageUsageFlags usage);
 void destroySwapChain(VulkanContext* context, VulkanSwapChain* swapChain);
 
-VkRenderPass createRenderPass(VulkanContext* context, VkFormat format);
+// LOAD keeps what earlier passes drew, e.g. for overlays. Passes that only differ in loadOp are
+// compatible, so they can share framebuffers.
+VkRenderPass createRenderPass(VulkanContext* context, VkFormat format, VkAttachmentLoadOp loadOp);
 void destroyRenderPass(VulkanContext* context, VkRenderPass renderPass);
 
-VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height);
+VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VkDescriptorSetLayout descriptorSetLayout);
+// Instanced VulkanOverlayQuads with alpha blending, for screen-space overlays.
+VulkanPipeline createOverlayPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VkDescriptorSetLayout descriptorSetLayout);
 void destroyPipeline(VulkanContext* context, VulkanPipeline* pipeline);
 
+bool createStaticCommands(VulkanContext* context, uint32_t slotCount, VulkanStaticCommands* staticCommands);
+void destroyStaticCommands(VulkanContext* context, VulkanStaticCommands* staticCommands);
+void invalidateStaticCommands(VulkanStaticCommands* staticCommands);
+bool staticCommandsUpToDate(const VulkanStaticCommands* staticCommands, uint32_t slot);
+VkCommandBuffer beginStaticCommands(VulkanContext* context, VulkanStaticCommands* staticCommands, uint32_t slot, VkRenderPass renderPass, uint32_t subpass);
+void endStaticCommands(VulkanContext* context, VulkanStaticCommands* staticCommands, uint32_t slot);
+
+bool createFrameRing(VulkanContext* context, VkDeviceSize frameSize, uint32_t frameCount, VkDeviceSize uniformRange, VulkanFrameRing* ring);
+void destroyFrameRing(VulkanContext* context, VulkanFrameRing* ring);
+void beginFrameRing(VulkanFrameRing* ring, uint32_t frame);
+bool allocateFrameRing(VulkanFrameRing* ring, VkDeviceSize size, VkDeviceSize alignment, VulkanFrameRingAllocation* allocation);
+
+VulkanAccessState getAccessState(VulkanResourceAccess access);
+bool getLayoutAccess(VkImageLayout layout, VulkanResourceAccess* access);
+void cmdImageBarriers(VulkanContext* context, VkCommandBuffer commandBuffer, uint32_t barrierCount, const VkImageMemoryBarrier2* barriers);
+
+RenderGraphResource renderGraphImportImage(RenderGraph* graph, const char* name, const RenderGraphImageDesc& desc, VulkanResourceAccess initialAccess, VulkanResourceAccess finalAccess);
+RenderGraphResource renderGraphCreateImage(RenderGraph* graph, const char* name, const RenderGraphImageDesc& desc);
+uint32_t renderGraphAddPass(RenderGraph* graph, const char* name, RenderGraphPassCallback callback, void* userData);
+void renderGraphUse(RenderGraph* graph, uint32_t pass, RenderGraphResource resource, VulkanResourceAccess access);
+void renderGraphUseSubresource(RenderGraph* graph, uint32_t pass, RenderGraphResource resource, VulkanResourceAccess access, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount);
+void renderGraphSetSideEffects(RenderGraph* graph, uint32_t pass);
+bool compileRenderGraph(VulkanContext* context, RenderGraph* graph);
+void setRenderGraphImportedImage(RenderGraph* graph, RenderGraphResource resource, VkImage image, VkImageView imageView);
+VkImageView getRenderGraphImageView(const RenderGraph* graph, RenderGraphResource resource);
+void executeRenderGraph(VulkanContext* context, RenderGraph* graph, VkCommandBuffer commandBuffer, VulkanGpuProfiler* profiler);
+void destroyRenderGraph(VulkanContext* context, RenderGraph* graph);
+
+bool createGpuProfiler(VulkanContext* context, uint32_t frameCount, uint32_t maxScopesPerFrame, VulkanGpuProfiler* profiler);
+void destroyGpuProfiler(VulkanContext* context, VulkanGpuProfiler* profiler);
+void beginGpuProfilerFrame(VulkanContext* context, VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, uint32_t frame);
+uint32_t beginGpuScope(VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name);
+void endGpuScope(VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, uint32_t scope);
+uint32_t getGpuProfilerScopeCount(const VulkanGpuProfiler* profiler);
+bool getGpuProfilerStats(const VulkanGpuProfiler* profiler, uint32_t scopeIndex, VulkanGpuProfilerStats* stats);
+
+// Ends the scope when it leaves C++ scope. A null profiler records nothing.
+struct GpuProfileScope {
+    VulkanGpuProfiler* profiler;
+    VkCommandBuffer commandBuffer;
+    uint32_t scope;
+
+    GpuProfileScope(VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name)
+        : profiler(profiler), commandBuffer(commandBuffer),
+          scope(profiler != nullptr ? beginGpuScope(profiler, commandBuffer, name) : GPU_PROFILER_INVALID_SCOPE) {}
+    ~GpuProfileScope() {
+        if (profiler != nullptr) {
+            endGpuScope(profiler, commandBuffer, scope);
+        }
+    }
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+#define GPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define GPU_PROFILE_CONCAT(a, b) GPU_PROFILE_CONCAT_INNER(a, b)
+#define GPU_PROFILE_SCOPE(profiler, commandBuffer, name) GpuProfileScope GPU_PROFILE_CONCAT(gpuProfileScope, __LINE__)(profiler, commandBuffer, name)
+
+void setVulkanObjectName(VulkanContext* context, VkObjectType objectType, uint64_t handle, const char* name);
+// The label color is derived from the name, so a pass keeps its color across captures.
+void cmdBeginDebugLabel(VulkanContext* context, VkCommandBuffer commandBuffer, const char* name);
+void cmdEndDebugLabel(VulkanContext* context, VkCommandBuffer commandBuffer);
+
+struct DebugLabelScope {
+    VulkanContext* context;
+    VkCommandBuffer commandBuffer;
+
+    DebugLabelScope(VulkanContext* context, VkCommandBuffer commandBuffer, const char* name)
+        : context(context), commandBuffer(commandBuffer) {
+        cmdBeginDebugLabel(context, commandBuffer, name);
+    }
+    ~DebugLabelScope() {
+        cmdEndDebugLabel(context, commandBuffer);
+    }
+    DebugLabelScope(const DebugLabelScope&) = delete;
+    DebugLabelScope& operator=(const DebugLabelScope&) = delete;
+};
+
+// One marker for a block of recorded GPU work: a CPU profiler zone around the recording, a
+// debug-utils label around the commands and a GPU timestamp scope inside the label. The zone
+// follows PROFILING_DISABLE and the label VULKAN_DEBUG_MARKERS; with both off and a null
+// profiler nothing is left.
+struct RenderScope {
+#ifndef PROFILING_DISABLE
+    ProfileZone cpuZone;
+#endif
+#ifdef VULKAN_DEBUG_MARKERS
+    DebugLabelScope label;
+#endif
+    GpuProfileScope gpuScope;
+
+    RenderScope(VulkanContext* context, VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name)
+        :
+#ifndef PROFILING_DISABLE
+          cpuZone(name),
+#endif
+#ifdef VULKAN_DEBUG_MARKERS
+          label(context, commandBuffer, name),
+#endif
+          gpuScope(profiler, commandBuffer, name) {
+        (void)context;
+    }
+    RenderScope(const RenderScope&) = delete;
+    RenderScope& operator=(const RenderScope&) = delete;
+};
+
+#define RENDER_SCOPE(context, profiler, commandBuffer, name) RenderScope GPU_PROFILE_CONCAT(renderScope, __LINE__)(context, profiler, commandBuffer, name)
+
+void initVulkanHostAllocator(VulkanHostAllocator* allocator, const VulkanHostAllocatorBackend* backend);
+VulkanHostAllocationStats getVulkanHostAllocationStats(const VulkanHostAllocator* allocator);
+const char* getVulkanAllocationScopeName(VkSystemAllocationScope scope);
+
 uint32_t findMemoryType(VulkanContext* context, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 bool createBuffer(VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
 void destroyBuffer(VulkanContext* context, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
@@ -68,5 +449,22 @@ bool createImageView(VulkanContext* context, VkImage image, VkFormat format, VkI
 void destroyImageView(VulkanContext* context, VkImageView* imageView);
 bool transitionImageLayout(VulkanContext* context, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageAspectFlags aspectFlags);
 bool copyBufferToImage(VulkanContext* context, VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height);
+bool readbackImage(VulkanContext* context, VkImage image, uint32_t width, uint32_t height, std::vector<uint8_t>* pixels);
+uint32_t getMemoryHeapStats(VulkanContext* context, VulkanMemoryHeapStats* stats, uint32_t maxHeapCount);
 bool uploadToDeviceLocalImageRGBA8(VulkanContext* context, const void* pixelData, uint32_t width, uint32_t height, VkImage* image, VkDeviceMemory* imageMemory, VkImageView* imageView);
 
+// An upload whose commands were submitted but may still be running. The staging buffer and the
+// command pool stay alive until finishUpload().
+struct VulkanPendingUpload {
+    VkFence fence;
+    VkCommandPool commandPool;
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+};
+
+// Records the whole upload into one command buffer and submits it without waiting. The image and
+// its view may be used once upload->fence has signalled; pixelData may be freed right away.
+bool beginUploadToDeviceLocalImageRGBA8(VulkanContext* context, const void* pixelData, uint32_t width, uint32_t height, VkImage* image, VkDeviceMemory* imageMemory, VkImageView* imageView, VulkanPendingUpload* upload);
+// Waits for the fence if it has not signalled yet, then frees the upload's resources.
+void finishUpload(VulkanContext* context, VulkanPendingUpload* upload);
+
@@ -0,0 +1,72 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
+#include "vulkan_base.h"
+
+bool createStaticCommands(VulkanContext* context, uint32_t slotCount, VulkanStaticCommands* staticCommands) {
+    *staticCommands = {};
+
+    // Buffers are re-recorded individually when their slot goes stale, so the pool must allow per-buffer resets.
+    VkCommandPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolCreateInfo.queueFamilyIndex = context->graphicsQueue.familyIndex;
+    if (VK(vkCreateCommandPool(context->device, &poolCreateInfo, context->allocator, &staticCommands->commandPool)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create static command pool.");
+        return false;
+    }
+
+    staticCommands->commandBuffers.resize(slotCount, VK_NULL_HANDLE);
+    VkCommandBufferAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocateInfo.commandPool = staticCommands->commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocateInfo.commandBufferCount = slotCount;
+    if (VK(vkAllocateCommandBuffers(context->device, &allocateInfo, staticCommands->commandBuffers.data())) != VK_SUCCESS) {
+        LOG_ERROR("Failed to allocate static command buffers.");
+        destroyStaticCommands(context, staticCommands);
+        return false;
+    }
+    for (VkCommandBuffer commandBuffer : staticCommands->commandBuffers) {
+        VK_NAME(context, VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer, "Static draws");
+    }
+
+    // Version 0 is never current, so every slot is recorded on first use.
+    staticCommands->recordedVersions.assign(slotCount, 0);
+    staticCommands->version = 1;
+    return true;
+}
+
+void destroyStaticCommands(VulkanContext* context, VulkanStaticCommands* staticCommands) {
+    if (staticCommands->commandPool != VK_NULL_HANDLE) {
+        VK(vkDestroyCommandPool(context->device, staticCommands->commandPool, context->allocator));
+    }
+    *staticCommands = {};
+}
+
+void invalidateStaticCommands(VulkanStaticCommands* staticCommands) {
+    staticCommands->version++;
+}
+
+bool staticCommandsUpToDate(const VulkanStaticCommands* staticCommands, uint32_t slot) {
+    return staticCommands->recordedVersions[slot] == staticCommands->version;
+}
+
+VkCommandBuffer beginStaticCommands(VulkanContext* context, VulkanStaticCommands* staticCommands, uint32_t slot, VkRenderPass renderPass, uint32_t subpass) {
+    (void)context;
+    VkCommandBuffer commandBuffer = staticCommands->commandBuffers[slot];
+
+    // Leave the framebuffer unspecified so one recording stays valid for every swapchain image.
+    VkCommandBufferInheritanceInfo inheritanceInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = subpass;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    VKA(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    return commandBuffer;
+}
+
+void endStaticCommands(VulkanContext* context, VulkanStaticCommands* staticCommands, uint32_t slot) {
+    (void)context;
+    VKA(vkEndCommandBuffer(staticCommands->commandBuffers[slot]));
+    staticCommands->recordedVersions[slot] = staticCommands->version;
+}
@@ -0,0 +1,37 @@
+#include "vulkan_base.h"
+
+void setVulkanObjectName(VulkanContext* context, VkObjectType objectType, uint64_t handle, const char* name) {
+    if (context->vkSetDebugUtilsObjectNameEXT == nullptr || handle == 0) {
+        return;
+    }
+    VkDebugUtilsObjectNameInfoEXT nameInfo = {VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+    nameInfo.objectType = objectType;
+    nameInfo.objectHandle = handle;
+    nameInfo.pObjectName = name;
+    VK(context->vkSetDebugUtilsObjectNameEXT(context->device, &nameInfo));
+}
+
+void cmdBeginDebugLabel(VulkanContext* context, VkCommandBuffer commandBuffer, const char* name) {
+    if (context->vkCmdBeginDebugUtilsLabelEXT == nullptr) {
+        return;
+    }
+    // FNV-1a of the name, one byte per color channel, kept away from black.
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    VkDebugUtilsLabelEXT label = {VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+    label.pLabelName = name;
+    label.color[0] = 0.3f + 0.7f * static_cast<float>(hash & 0xFF) / 255.0f;
+    label.color[1] = 0.3f + 0.7f * static_cast<float>((hash >> 8) & 0xFF) / 255.0f;
+    label.color[2] = 0.3f + 0.7f * static_cast<float>((hash >> 16) & 0xFF) / 255.0f;
+    label.color[3] = 1.0f;
+    context->vkCmdBeginDebugUtilsLabelEXT(commandBuffer, &label);
+}
+
+void cmdEndDebugLabel(VulkanContext* context, VkCommandBuffer commandBuffer) {
+    if (context->vkCmdEndDebugUtilsLabelEXT == nullptr) {
+        return;
+    }
+    context->vkCmdEndDebugUtilsLabelEXT(commandBuffer);
+}
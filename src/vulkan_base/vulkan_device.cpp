@@ -1,3 +1,4 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
 #include "vulkan_base.h"
 #include <vector>
 #include <cstring>
@@ -30,11 +31,11 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 
     const char* message = (callbackData != nullptr && callbackData->pMessage != nullptr) ? callbackData->pMessage : "No validation message text.";
     if ((messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) != 0) {
-        LOG_ERROR("[Validation] ", message);
+        LOG_CAT_ERROR(LOG_CATEGORY_VALIDATION, "[Validation] ", message);
     } else if ((messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) != 0) {
-        LOG_WARN("[Validation] ", message);
+        LOG_CAT_WARN(LOG_CATEGORY_VALIDATION, "[Validation] ", message);
     } else {
-        LOG_INFO("[Validation] ", message);
+        LOG_CAT_INFO(LOG_CATEGORY_VALIDATION, "[Validation] ", message);
     }
 
     return VK_FALSE;
@@ -43,10 +44,12 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 static void fillDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT* createInfo) {
     *createInfo = {VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT};
     createInfo->messageSeverity =
-        VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-        VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
         VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
         VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    // The layers only produce the chatty severities when someone is going to read them.
+    if (getLogLevel(LOG_CATEGORY_VALIDATION) <= LOG_LEVEL_INFO) {
+        createInfo->messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+    }
     createInfo->messageType =
         VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
         VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
@@ -161,7 +164,7 @@ bool initVulkanInstance(VulkanContext* context, uint32_t instanceExtensionCount,
     }
     createInfo.pNext = instanceCreatePNext;
 
-   if (VK(vkCreateInstance(&createInfo, 0, &context->instance)) != VK_SUCCESS) {
+   if (VK(vkCreateInstance(&createInfo, context->allocator, &context->instance)) != VK_SUCCESS) {
         LOG_ERROR("Error creating Vulkan instance");
        return false;
     }
@@ -172,7 +175,7 @@ bool initVulkanInstance(VulkanContext* context, uint32_t instanceExtensionCount,
             reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(
                 vkGetInstanceProcAddr(context->instance, "vkCreateDebugUtilsMessengerEXT"));
         if (createDebugUtilsMessenger != nullptr) {
-            VkResult debugResult = VK(createDebugUtilsMessenger(context->instance, &debugCreateInfo, nullptr, &context->debugMessenger));
+            VkResult debugResult = VK(createDebugUtilsMessenger(context->instance, &debugCreateInfo, context->allocator, &context->debugMessenger));
             if (debugResult == VK_SUCCESS) {
                 LOG_INFO("Debug utils messenger created.");
             } else {
@@ -181,6 +184,13 @@ bool initVulkanInstance(VulkanContext* context, uint32_t instanceExtensionCount,
         } else {
             LOG_WARN("vkCreateDebugUtilsMessengerEXT is not available from instance proc addr.");
         }
+
+        context->vkSetDebugUtilsObjectNameEXT = reinterpret_cast<PFN_vkSetDebugUtilsObjectNameEXT>(
+            vkGetInstanceProcAddr(context->instance, "vkSetDebugUtilsObjectNameEXT"));
+        context->vkCmdBeginDebugUtilsLabelEXT = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(
+            vkGetInstanceProcAddr(context->instance, "vkCmdBeginDebugUtilsLabelEXT"));
+        context->vkCmdEndDebugUtilsLabelEXT = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(
+            vkGetInstanceProcAddr(context->instance, "vkCmdEndDebugUtilsLabelEXT"));
     }
 
     return true;
@@ -232,6 +242,7 @@ bool createLogicalDevice(VulkanContext* context, uint32_t deviceExtensionCount,
             }
         }
     }
+    const uint32_t timestampValidBits = queueFamilies[graphicsQueueIndex].timestampValidBits;
 
 
     float priorities = { 1.0f };
@@ -242,20 +253,110 @@ bool createLogicalDevice(VulkanContext* context, uint32_t deviceExtensionCount,
 
     VkPhysicalDeviceFeatures enabledFeatures = {};
 
+    uint32_t availableDeviceExtensionCount = 0;
+    VKA(vkEnumerateDeviceExtensionProperties(context->physicalDevice, nullptr, &availableDeviceExtensionCount, nullptr));
+    std::vector<VkExtensionProperties> availableDeviceExtensions(availableDeviceExtensionCount);
+    if (availableDeviceExtensionCount > 0) {
+        VKA(vkEnumerateDeviceExtensionProperties(context->physicalDevice, nullptr, &availableDeviceExtensionCount, availableDeviceExtensions.data()));
+    }
+
+    std::vector<const char*> enabledDeviceExtensions(deviceExtensions, deviceExtensions + deviceExtensionCount);
+    bool requestsSwapchain = false;
+    for (const char* extensionName : enabledDeviceExtensions) {
+        if (std::strcmp(extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0) {
+            requestsSwapchain = true;
+        }
+    }
+
+    // Optional features. synchronization2 backs the render graph barriers; without it they are
+    // translated to legacy vkCmdPipelineBarrier calls. present_id/present_wait let the frame pacer
+    // measure real input-to-present latency; without them it estimates from fence timing.
+    const bool deviceSupports13 = context->physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_3;
+    const bool hasPresentWaitExtensions = requestsSwapchain &&
+        hasExtension(availableDeviceExtensions, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasExtension(availableDeviceExtensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+    VkPhysicalDeviceVulkan13Features supportedFeatures13 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+    {
+        VkPhysicalDeviceFeatures2 supportedFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        void* queryPNext = nullptr;
+        if (hasPresentWaitExtensions) {
+            supportedPresentWait.pNext = queryPNext;
+            supportedPresentId.pNext = &supportedPresentWait;
+            queryPNext = &supportedPresentId;
+        }
+        if (deviceSupports13) {
+            supportedFeatures13.pNext = queryPNext;
+            queryPNext = &supportedFeatures13;
+        }
+        if (queryPNext != nullptr) {
+            supportedFeatures.pNext = queryPNext;
+            vkGetPhysicalDeviceFeatures2(context->physicalDevice, &supportedFeatures);
+        }
+    }
+
+    void* devicePNext = nullptr;
+    VkPhysicalDeviceVulkan13Features enabledFeatures13 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    enabledFeatures13.synchronization2 = supportedFeatures13.synchronization2;
+    if (deviceSupports13) {
+        enabledFeatures13.pNext = devicePNext;
+        devicePNext = &enabledFeatures13;
+    }
+
+    VkPhysicalDevicePresentIdFeaturesKHR enabledPresentId = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    VkPhysicalDevicePresentWaitFeaturesKHR enabledPresentWait = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+    const bool presentWaitSupported = hasPresentWaitExtensions && supportedPresentId.presentId && supportedPresentWait.presentWait;
+    if (presentWaitSupported) {
+        enabledDeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        enabledDeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        enabledPresentId.presentId = VK_TRUE;
+        enabledPresentWait.presentWait = VK_TRUE;
+        enabledPresentWait.pNext = devicePNext;
+        enabledPresentId.pNext = &enabledPresentWait;
+        devicePNext = &enabledPresentId;
+    }
+
+    // Only adds heap budget/usage queries, used for memory statistics.
+    const bool memoryBudgetSupported = hasExtension(availableDeviceExtensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudgetSupported) {
+        enabledDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     VkDeviceCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+    createInfo.pNext = devicePNext;
     createInfo.queueCreateInfoCount = 1;
     createInfo.pQueueCreateInfos = &queueCreateInfo;
-    createInfo.enabledExtensionCount = deviceExtensionCount;
-    createInfo.ppEnabledExtensionNames = deviceExtensions;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
     createInfo.pEnabledFeatures = &enabledFeatures;
 
-    if (vkCreateDevice(context->physicalDevice, &createInfo, 0, &context->device)) {
+    if (vkCreateDevice(context->physicalDevice, &createInfo, context->allocator, &context->device)) {
         LOG_ERROR("Failed to create/find vulkan logical device");
         return false;
     }
 
+    context->synchronization2Enabled = (enabledFeatures13.synchronization2 == VK_TRUE);
+    if (!context->synchronization2Enabled) {
+        LOG_WARN("synchronization2 is not supported. Falling back to legacy pipeline barriers.");
+    }
+
+    context->memoryBudgetEnabled = memoryBudgetSupported;
+
+    context->presentWaitEnabled = false;
+    context->vkWaitForPresentKHR = nullptr;
+    if (presentWaitSupported) {
+        context->vkWaitForPresentKHR = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(context->device, "vkWaitForPresentKHR"));
+        context->presentWaitEnabled = (context->vkWaitForPresentKHR != nullptr);
+    }
+    if (context->presentWaitEnabled) {
+        LOG_INFO("Enabled ", VK_KHR_PRESENT_WAIT_EXTENSION_NAME, ". Frame latency is measured at present.");
+    }
+
     // Aquire queues
     context->graphicsQueue.familyIndex = graphicsQueueIndex;
+    context->timestampValidBits = timestampValidBits;
     VK(vkGetDeviceQueue(context->device, graphicsQueueIndex, 0, &context->graphicsQueue.queue));
 
 
@@ -263,8 +364,11 @@ bool createLogicalDevice(VulkanContext* context, uint32_t deviceExtensionCount,
 }
 
 
-VulkanContext* initVulkan(uint32_t instanceExtensionCount, const char* const* instanceExtensions, uint32_t deviceExtensionCount, const char** deviceExtensions) {
+VulkanContext* initVulkan(uint32_t instanceExtensionCount, const char* const* instanceExtensions, uint32_t deviceExtensionCount, const char** deviceExtensions, const VulkanHostAllocatorBackend* hostAllocatorBackend) {
     VulkanContext* context = new VulkanContext{};
+    // The context lives on the heap, so the callbacks' user data stays valid until the instance is gone.
+    initVulkanHostAllocator(&context->hostAllocator, hostAllocatorBackend);
+    context->allocator = &context->hostAllocator.callbacks;
 
 
     if (!initVulkanInstance(context, instanceExtensionCount, instanceExtensions)) {
@@ -284,19 +388,24 @@ VulkanContext* initVulkan(uint32_t instanceExtensionCount, const char* const* in
     return context;
 }
 
-void exitVulkan(VulkanContext* context) {
+void waitForDeviceIdle(VulkanContext* context) {
+    std::lock_guard<std::mutex> lock(context->graphicsQueueMutex);
     VKA(vkDeviceWaitIdle(context->device));
-    VK(vkDestroyDevice(context->device, 0));
+}
+
+void exitVulkan(VulkanContext* context) {
+    waitForDeviceIdle(context);
+    VK(vkDestroyDevice(context->device, context->allocator));
 
     if (context->debugMessenger != VK_NULL_HANDLE) {
         PFN_vkDestroyDebugUtilsMessengerEXT destroyDebugUtilsMessenger =
             reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
                 vkGetInstanceProcAddr(context->instance, "vkDestroyDebugUtilsMessengerEXT"));
         if (destroyDebugUtilsMessenger != nullptr) {
-            destroyDebugUtilsMessenger(context->instance, context->debugMessenger, nullptr);
+            destroyDebugUtilsMessenger(context->instance, context->debugMessenger, context->allocator);
         }
         context->debugMessenger = VK_NULL_HANDLE;
     }
 
-    vkDestroyInstance(context->instance, 0);
+    vkDestroyInstance(context->instance, context->allocator);
 }
@@ -0,0 +1,139 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
+#include "vulkan_base.h"
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool createFrameRing(VulkanContext* context, VkDeviceSize frameSize, uint32_t frameCount, VkDeviceSize uniformRange, VulkanFrameRing* ring) {
+    *ring = {};
+
+    const VkPhysicalDeviceLimits& limits = context->physicalDeviceProperties.limits;
+    ring->minAlignment = limits.minUniformBufferOffsetAlignment;
+    if (limits.minStorageBufferOffsetAlignment > ring->minAlignment) {
+        ring->minAlignment = limits.minStorageBufferOffsetAlignment;
+    }
+    if (ring->minAlignment < 16) {
+        ring->minAlignment = 16;
+    }
+
+    ring->frameSize = alignUp(frameSize, ring->minAlignment);
+    ring->frameCount = frameCount;
+
+    if (!createBuffer(
+            context,
+            ring->frameSize * frameCount,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &ring->buffer,
+            &ring->memory)) {
+        LOG_ERROR("Failed to create frame ring buffer.");
+        return false;
+    }
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, ring->buffer, "Frame ring");
+
+    // Mapped once for the lifetime of the ring. Coherent memory means no flushes are needed.
+    void* mapped = nullptr;
+    if (VK(vkMapMemory(context->device, ring->memory, 0, VK_WHOLE_SIZE, 0, &mapped)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to map frame ring buffer.");
+        destroyFrameRing(context, ring);
+        return false;
+    }
+    ring->mapped = static_cast<uint8_t*>(mapped);
+
+    // One dynamic uniform descriptor covers the whole ring; the dynamic offset picks the allocation.
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutCreateInfo.bindingCount = 1;
+    layoutCreateInfo.pBindings = &binding;
+    if (VK(vkCreateDescriptorSetLayout(context->device, &layoutCreateInfo, context->allocator, &ring->uniformSetLayout)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create frame ring descriptor set layout.");
+        destroyFrameRing(context, ring);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1};
+    VkDescriptorPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolCreateInfo.maxSets = 1;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &poolSize;
+    if (VK(vkCreateDescriptorPool(context->device, &poolCreateInfo, context->allocator, &ring->descriptorPool)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create frame ring descriptor pool.");
+        destroyFrameRing(context, ring);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo setAllocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    setAllocateInfo.descriptorPool = ring->descriptorPool;
+    setAllocateInfo.descriptorSetCount = 1;
+    setAllocateInfo.pSetLayouts = &ring->uniformSetLayout;
+    if (VK(vkAllocateDescriptorSets(context->device, &setAllocateInfo, &ring->uniformSet)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to allocate frame ring descriptor set.");
+        destroyFrameRing(context, ring);
+        return false;
+    }
+    VK_NAME(context, VK_OBJECT_TYPE_DESCRIPTOR_SET, ring->uniformSet, "Frame ring uniforms");
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = ring->buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = uniformRange;
+
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = ring->uniformSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context->device, 1, &write, 0, nullptr);
+
+    ring->frameBegin = 0;
+    ring->head = 0;
+    ring->frameEnd = 0;
+    return true;
+}
+
+void destroyFrameRing(VulkanContext* context, VulkanFrameRing* ring) {
+    if (ring->descriptorPool != VK_NULL_HANDLE) {
+        VK(vkDestroyDescriptorPool(context->device, ring->descriptorPool, context->allocator));
+    }
+    if (ring->uniformSetLayout != VK_NULL_HANDLE) {
+        VK(vkDestroyDescriptorSetLayout(context->device, ring->uniformSetLayout, context->allocator));
+    }
+    if (ring->mapped != nullptr) {
+        vkUnmapMemory(context->device, ring->memory);
+    }
+    destroyBuffer(context, &ring->buffer, &ring->memory);
+    *ring = {};
+}
+
+void beginFrameRing(VulkanFrameRing* ring, uint32_t frame) {
+    ring->frameBegin = ring->frameSize * frame;
+    ring->head = ring->frameBegin;
+    ring->frameEnd = ring->frameBegin + ring->frameSize;
+}
+
+bool allocateFrameRing(VulkanFrameRing* ring, VkDeviceSize size, VkDeviceSize alignment, VulkanFrameRingAllocation* allocation) {
+    if (alignment < ring->minAlignment) {
+        alignment = ring->minAlignment;
+    }
+
+    const VkDeviceSize offset = alignUp(ring->head, alignment);
+    if (offset + size > ring->frameEnd) {
+        *allocation = {};
+        return false;
+    }
+
+    ring->head = offset + size;
+    allocation->buffer = ring->buffer;
+    allocation->offset = offset;
+    allocation->data = ring->mapped + offset;
+    return true;
+}
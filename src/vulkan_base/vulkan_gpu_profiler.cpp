@@ -0,0 +1,206 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_PERF
+#include "vulkan_base.h"
+#include <algorithm>
+#include <cstring>
+
+static uint32_t findOrAddScope(VulkanGpuProfiler* profiler, const char* name) {
+    // Pass names are string literals, so the pointer compare almost always hits first.
+    for (uint32_t i = 0; i < profiler->scopes.size(); i++) {
+        if (profiler->scopes[i].name == name) {
+            return i;
+        }
+    }
+    for (uint32_t i = 0; i < profiler->scopes.size(); i++) {
+        if (std::strcmp(profiler->scopes[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    VulkanGpuProfilerScope scope = {};
+    scope.name = name;
+    profiler->scopes.push_back(scope);
+    return static_cast<uint32_t>(profiler->scopes.size() - 1);
+}
+
+static void addScopeSample(VulkanGpuProfilerScope* scope, double ms) {
+    scope->historyMs[scope->historyHead] = static_cast<float>(ms);
+    scope->historyHead = (scope->historyHead + 1) % GPU_PROFILER_HISTORY_SIZE;
+    if (scope->historyCount < GPU_PROFILER_HISTORY_SIZE) {
+        scope->historyCount++;
+    }
+    scope->lastMs = ms;
+}
+
+static void resolveFrame(VulkanContext* context, VulkanGpuProfiler* profiler, uint32_t frame) {
+    VulkanGpuProfilerFrame& profilerFrame = profiler->frames[frame];
+    profiler->lastFrameValid = false;
+    if (!profilerFrame.pending || profilerFrame.queryCount == 0) {
+        return;
+    }
+
+    // Each query yields its value followed by an availability word. Without the WAIT flag this
+    // never blocks; scopes whose queries are not available yet are dropped instead.
+    const uint32_t firstQuery = frame * profiler->maxScopesPerFrame * 2;
+    const VkResult result = VK(vkGetQueryPoolResults(
+        context->device,
+        profiler->queryPool,
+        firstQuery,
+        profilerFrame.queryCount,
+        profilerFrame.queryCount * 2 * sizeof(uint64_t),
+        profiler->readback.data(),
+        2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT));
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        LOG_WARN("vkGetQueryPoolResults failed: ", static_cast<int>(result));
+        return;
+    }
+
+    uint64_t frameBegin = UINT64_MAX;
+    uint64_t frameEnd = 0;
+    for (uint32_t i = 0; i < profilerFrame.scopeIds.size(); i++) {
+        const uint64_t* begin = &profiler->readback[(i * 2) * 2];
+        const uint64_t* end = &profiler->readback[(i * 2 + 1) * 2];
+        if (begin[1] == 0 || end[1] == 0) {
+            continue;
+        }
+        const uint64_t beginTicks = begin[0] & profiler->timestampMask;
+        const uint64_t endTicks = end[0] & profiler->timestampMask;
+        // The mask also makes a counter wrap between the two timestamps come out right.
+        const uint64_t ticks = (endTicks - beginTicks) & profiler->timestampMask;
+        addScopeSample(&profiler->scopes[profilerFrame.scopeIds[i]], static_cast<double>(ticks) * profiler->nsPerTick / 1e6);
+
+        if (beginTicks < frameBegin) {
+            frameBegin = beginTicks;
+        }
+        if (beginTicks + ticks > frameEnd) {
+            frameEnd = beginTicks + ticks;
+        }
+    }
+
+    if (frameEnd > frameBegin) {
+        profiler->lastFrameMs = static_cast<double>(frameEnd - frameBegin) * profiler->nsPerTick / 1e6;
+        profiler->lastFrameValid = true;
+    }
+}
+
+bool createGpuProfiler(VulkanContext* context, uint32_t frameCount, uint32_t maxScopesPerFrame, VulkanGpuProfiler* profiler) {
+    *profiler = {};
+    profiler->frameCount = frameCount;
+    profiler->maxScopesPerFrame = maxScopesPerFrame;
+
+    const float timestampPeriod = context->physicalDeviceProperties.limits.timestampPeriod;
+    if (context->timestampValidBits == 0 || timestampPeriod <= 0.0f) {
+        // Not an error: every profiler call turns into a no-op.
+        LOG_WARN("The graphics queue does not support timestamps. GPU profiling is disabled.");
+        return true;
+    }
+
+    profiler->nsPerTick = static_cast<double>(timestampPeriod);
+    profiler->timestampMask = context->timestampValidBits >= 64 ? UINT64_MAX : ((1ull << context->timestampValidBits) - 1);
+
+    VkQueryPoolCreateInfo createInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = frameCount * maxScopesPerFrame * 2;
+    if (VK(vkCreateQueryPool(context->device, &createInfo, context->allocator, &profiler->queryPool)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create timestamp query pool.");
+        return false;
+    }
+    VK_NAME(context, VK_OBJECT_TYPE_QUERY_POOL, profiler->queryPool, "GPU profiler timestamps");
+
+    profiler->frames.resize(frameCount);
+    for (VulkanGpuProfilerFrame& frame : profiler->frames) {
+        frame.queryCount = 0;
+        frame.scopeIds.reserve(maxScopesPerFrame);
+        frame.pending = false;
+    }
+    profiler->readback.resize(maxScopesPerFrame * 2 * 2);
+    profiler->currentFrame = 0;
+    profiler->enabled = true;
+    return true;
+}
+
+void destroyGpuProfiler(VulkanContext* context, VulkanGpuProfiler* profiler) {
+    if (profiler->queryPool != VK_NULL_HANDLE) {
+        VK(vkDestroyQueryPool(context->device, profiler->queryPool, context->allocator));
+    }
+    *profiler = {};
+}
+
+void beginGpuProfilerFrame(VulkanContext* context, VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, uint32_t frame) {
+    if (!profiler->enabled) {
+        return;
+    }
+
+    resolveFrame(context, profiler, frame);
+
+    VulkanGpuProfilerFrame& profilerFrame = profiler->frames[frame];
+    profilerFrame.queryCount = 0;
+    profilerFrame.scopeIds.clear();
+    profilerFrame.pending = true;
+    profiler->currentFrame = frame;
+
+    const uint32_t firstQuery = frame * profiler->maxScopesPerFrame * 2;
+    VK(vkCmdResetQueryPool(commandBuffer, profiler->queryPool, firstQuery, profiler->maxScopesPerFrame * 2));
+}
+
+uint32_t beginGpuScope(VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name) {
+    if (!profiler->enabled) {
+        return GPU_PROFILER_INVALID_SCOPE;
+    }
+
+    VulkanGpuProfilerFrame& profilerFrame = profiler->frames[profiler->currentFrame];
+    if (profilerFrame.scopeIds.size() >= profiler->maxScopesPerFrame) {
+        return GPU_PROFILER_INVALID_SCOPE;
+    }
+
+    const uint32_t scope = static_cast<uint32_t>(profilerFrame.scopeIds.size());
+    profilerFrame.scopeIds.push_back(findOrAddScope(profiler, name));
+    profilerFrame.queryCount = (scope + 1) * 2;
+
+    const uint32_t query = profiler->currentFrame * profiler->maxScopesPerFrame * 2 + scope * 2;
+    VK(vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, profiler->queryPool, query));
+    return scope;
+}
+
+void endGpuScope(VulkanGpuProfiler* profiler, VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (!profiler->enabled || scope == GPU_PROFILER_INVALID_SCOPE) {
+        return;
+    }
+
+    const uint32_t query = profiler->currentFrame * profiler->maxScopesPerFrame * 2 + scope * 2 + 1;
+    VK(vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, profiler->queryPool, query));
+}
+
+uint32_t getGpuProfilerScopeCount(const VulkanGpuProfiler* profiler) {
+    return static_cast<uint32_t>(profiler->scopes.size());
+}
+
+bool getGpuProfilerStats(const VulkanGpuProfiler* profiler, uint32_t scopeIndex, VulkanGpuProfilerStats* stats) {
+    *stats = {};
+    if (scopeIndex >= profiler->scopes.size()) {
+        return false;
+    }
+
+    const VulkanGpuProfilerScope& scope = profiler->scopes[scopeIndex];
+    stats->name = scope.name;
+    stats->sampleCount = scope.historyCount;
+    stats->lastMs = scope.lastMs;
+    if (scope.historyCount == 0) {
+        return true;
+    }
+
+    float sorted[GPU_PROFILER_HISTORY_SIZE];
+    double sum = 0.0;
+    for (uint32_t i = 0; i < scope.historyCount; i++) {
+        sorted[i] = scope.historyMs[i];
+        sum += scope.historyMs[i];
+    }
+    std::sort(sorted, sorted + scope.historyCount);
+
+    const uint32_t last = scope.historyCount - 1;
+    stats->averageMs = sum / scope.historyCount;
+    stats->p50Ms = sorted[last * 50 / 100];
+    stats->p95Ms = sorted[last * 95 / 100];
+    stats->p99Ms = sorted[last * 99 / 100];
+    return true;
+}
@@ -1,7 +1,9 @@
 //
 // Created by liqui on 26.02.2026.
 //
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
 #include "vulkan_base.h"
+#include <cstddef>
 
 VkShaderModule createShaderModule(VulkanContext* context, const char* shaderFilename) {
     VkShaderModule result = {};
@@ -22,7 +24,7 @@ VkShaderModule createShaderModule(VulkanContext* context, const char* shaderFile
     VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
     createInfo.codeSize = fileSize;
     createInfo.pCode = (uint32_t*)buffer;
-    VKA(vkCreateShaderModule(context->device, &createInfo, nullptr, &result));
+    VKA(vkCreateShaderModule(context->device, &createInfo, context->allocator, &result));
 
     delete[] buffer;
     fclose(file);
@@ -32,7 +34,8 @@ VkShaderModule createShaderModule(VulkanContext* context, const char* shaderFile
 }
 
 
-VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height) {
+// Shared by the scene and overlay pipelines, which only differ in vertex input and blending.
+static VulkanPipeline createGraphicsPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VkDescriptorSetLayout descriptorSetLayout, const VkPipelineVertexInputStateCreateInfo& vertexInputState, bool alphaBlend) {
     VkShaderModule vertexShaderModule = createShaderModule(context, vertexShaderFilename);
     VkShaderModule fragmentShaderModule = createShaderModule(context, fragmentShaderFilename);
 
@@ -46,28 +49,6 @@ VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFi
     shaderStages[1].module = fragmentShaderModule;
     shaderStages[1].pName = "main";
 
-    VkVertexInputBindingDescription vertexBindingDescription = {};
-    vertexBindingDescription.binding = 0;
-    vertexBindingDescription.stride = sizeof(float) * 5;
-    vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription vertexAttributeDescriptions[2] = {};
-    vertexAttributeDescriptions[0].location = 0;
-    vertexAttributeDescriptions[0].binding = 0;
-    vertexAttributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexAttributeDescriptions[0].offset = 0;
-
-    vertexAttributeDescriptions[1].location = 1;
-    vertexAttributeDescriptions[1].binding = 0;
-    vertexAttributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttributeDescriptions[1].offset = sizeof(float) * 2;
-
-    VkPipelineVertexInputStateCreateInfo vertexInputState = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-    vertexInputState.vertexBindingDescriptionCount = 1;
-    vertexInputState.pVertexBindingDescriptions = &vertexBindingDescription;
-    vertexInputState.vertexAttributeDescriptionCount = ARRAY_COUNT(vertexAttributeDescriptions);
-    vertexInputState.pVertexAttributeDescriptions = vertexAttributeDescriptions;
-
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
     inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
@@ -95,7 +76,13 @@ VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFi
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT ;
-    colorBlendAttachment.blendEnable = VK_FALSE;
+    colorBlendAttachment.blendEnable = alphaBlend ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
     VkPipelineColorBlendStateCreateInfo colorBlendState = {VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
     colorBlendState.attachmentCount = 1;
     colorBlendState.pAttachments = &colorBlendAttachment;
@@ -104,7 +91,11 @@ VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFi
     VkPipelineLayout pipelineLayout;
     {
         VkPipelineLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-        VKA(vkCreatePipelineLayout(context->device, &createInfo, nullptr, &pipelineLayout));
+        if (descriptorSetLayout != VK_NULL_HANDLE) {
+            createInfo.setLayoutCount = 1;
+            createInfo.pSetLayouts = &descriptorSetLayout;
+        }
+        VKA(vkCreatePipelineLayout(context->device, &createInfo, context->allocator, &pipelineLayout));
     }
 
     VkPipeline pipeline;
@@ -122,12 +113,16 @@ VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFi
         createInfo.layout = pipelineLayout;
         createInfo.renderPass = renderPass;
         createInfo.subpass = 0;
-        VKA(vkCreateGraphicsPipelines(context->device, nullptr, 1, &createInfo, nullptr, &pipeline));
+        VKA(vkCreateGraphicsPipelines(context->device, nullptr, 1, &createInfo, context->allocator, &pipeline));
     }
 
     // Module can be destroyed after pipeline creation
-    VK(vkDestroyShaderModule(context->device, vertexShaderModule, nullptr));
-    VK(vkDestroyShaderModule(context->device, fragmentShaderModule, nullptr));
+    VK(vkDestroyShaderModule(context->device, vertexShaderModule, context->allocator));
+    VK(vkDestroyShaderModule(context->device, fragmentShaderModule, context->allocator));
+
+    // Named after the vertex shader, which is what tells pipelines apart in a capture.
+    VK_NAME(context, VK_OBJECT_TYPE_PIPELINE, pipeline, vertexShaderFilename);
+    VK_NAME(context, VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, vertexShaderFilename);
 
     VulkanPipeline result = {};
     result.pipeline = pipeline;
@@ -135,7 +130,65 @@ VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFi
     return result;
 }
 
+VulkanPipeline createPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VkDescriptorSetLayout descriptorSetLayout) {
+    VkVertexInputBindingDescription vertexBindingDescription = {};
+    vertexBindingDescription.binding = 0;
+    vertexBindingDescription.stride = sizeof(float) * 5;
+    vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription vertexAttributeDescriptions[2] = {};
+    vertexAttributeDescriptions[0].location = 0;
+    vertexAttributeDescriptions[0].binding = 0;
+    vertexAttributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    vertexAttributeDescriptions[0].offset = 0;
+
+    vertexAttributeDescriptions[1].location = 1;
+    vertexAttributeDescriptions[1].binding = 0;
+    vertexAttributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    vertexAttributeDescriptions[1].offset = sizeof(float) * 2;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputState = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertexInputState.vertexBindingDescriptionCount = 1;
+    vertexInputState.pVertexBindingDescriptions = &vertexBindingDescription;
+    vertexInputState.vertexAttributeDescriptionCount = ARRAY_COUNT(vertexAttributeDescriptions);
+    vertexInputState.pVertexAttributeDescriptions = vertexAttributeDescriptions;
+
+    return createGraphicsPipeline(context, vertexShaderFilename, fragmentShaderFilename, renderPass, width, height, descriptorSetLayout, vertexInputState, false);
+}
+
+VulkanPipeline createOverlayPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VkDescriptorSetLayout descriptorSetLayout) {
+    // One VulkanOverlayQuad per instance; the vertex shader expands it to six vertices.
+    VkVertexInputBindingDescription vertexBindingDescription = {};
+    vertexBindingDescription.binding = 0;
+    vertexBindingDescription.stride = sizeof(VulkanOverlayQuad);
+    vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputAttributeDescription vertexAttributeDescriptions[3] = {};
+    vertexAttributeDescriptions[0].location = 0;
+    vertexAttributeDescriptions[0].binding = 0;
+    vertexAttributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    vertexAttributeDescriptions[0].offset = offsetof(VulkanOverlayQuad, rect);
+
+    vertexAttributeDescriptions[1].location = 1;
+    vertexAttributeDescriptions[1].binding = 0;
+    vertexAttributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    vertexAttributeDescriptions[1].offset = offsetof(VulkanOverlayQuad, uvRect);
+
+    vertexAttributeDescriptions[2].location = 2;
+    vertexAttributeDescriptions[2].binding = 0;
+    vertexAttributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    vertexAttributeDescriptions[2].offset = offsetof(VulkanOverlayQuad, color);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputState = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertexInputState.vertexBindingDescriptionCount = 1;
+    vertexInputState.pVertexBindingDescriptions = &vertexBindingDescription;
+    vertexInputState.vertexAttributeDescriptionCount = ARRAY_COUNT(vertexAttributeDescriptions);
+    vertexInputState.pVertexAttributeDescriptions = vertexAttributeDescriptions;
+
+    return createGraphicsPipeline(context, vertexShaderFilename, fragmentShaderFilename, renderPass, width, height, descriptorSetLayout, vertexInputState, true);
+}
+
 void destroyPipeline(VulkanContext* context, VulkanPipeline* pipeline) {
-    VK(vkDestroyPipeline(context->device, pipeline->pipeline, nullptr));
-    VK(vkDestroyPipelineLayout(context->device, pipeline->pipelineLayout, nullptr));
+    VK(vkDestroyPipeline(context->device, pipeline->pipeline, context->allocator));
+    VK(vkDestroyPipelineLayout(context->device, pipeline->pipelineLayout, context->allocator));
 }
@@ -0,0 +1,511 @@
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
+#include "vulkan_base.h"
+#include <algorithm>
+
+// Only legacy-compatible stage and access bits are used here, so the same masks can be
+// handed to vkCmdPipelineBarrier when synchronization2 is not available.
+VulkanAccessState getAccessState(VulkanResourceAccess access) {
+    switch (access) {
+        case VULKAN_ACCESS_NONE:
+            return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case VULKAN_ACCESS_ACQUIRE:
+            return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case VULKAN_ACCESS_TRANSFER_READ:
+            return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+        case VULKAN_ACCESS_TRANSFER_WRITE:
+            return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+        case VULKAN_ACCESS_COLOR_ATTACHMENT_WRITE:
+            return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+        case VULKAN_ACCESS_DEPTH_ATTACHMENT_WRITE:
+            return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true};
+        case VULKAN_ACCESS_DEPTH_ATTACHMENT_READ:
+            return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false};
+        case VULKAN_ACCESS_FRAGMENT_SHADER_READ:
+            return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+        case VULKAN_ACCESS_COMPUTE_SHADER_READ:
+            return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+        case VULKAN_ACCESS_COMPUTE_SHADER_WRITE:
+            return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL, true};
+        case VULKAN_ACCESS_PRESENT:
+            // Presentation is ordered by the release semaphore, so no destination stage is needed.
+            return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false};
+    }
+    return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false};
+}
+
+bool getLayoutAccess(VkImageLayout layout, VulkanResourceAccess* access) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED: *access = VULKAN_ACCESS_NONE; return true;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: *access = VULKAN_ACCESS_TRANSFER_READ; return true;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: *access = VULKAN_ACCESS_TRANSFER_WRITE; return true;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: *access = VULKAN_ACCESS_COLOR_ATTACHMENT_WRITE; return true;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: *access = VULKAN_ACCESS_DEPTH_ATTACHMENT_WRITE; return true;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: *access = VULKAN_ACCESS_DEPTH_ATTACHMENT_READ; return true;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: *access = VULKAN_ACCESS_FRAGMENT_SHADER_READ; return true;
+        case VK_IMAGE_LAYOUT_GENERAL: *access = VULKAN_ACCESS_COMPUTE_SHADER_WRITE; return true;
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: *access = VULKAN_ACCESS_PRESENT; return true;
+        default: return false;
+    }
+}
+
+void cmdImageBarriers(VulkanContext* context, VkCommandBuffer commandBuffer, uint32_t barrierCount, const VkImageMemoryBarrier2* barriers) {
+    if (barrierCount == 0) {
+        return;
+    }
+
+    if (context->synchronization2Enabled) {
+        VkDependencyInfo dependencyInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependencyInfo.imageMemoryBarrierCount = barrierCount;
+        dependencyInfo.pImageMemoryBarriers = barriers;
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        return;
+    }
+
+    // Legacy path: one call per chunk with the union of all stage masks.
+    static constexpr uint32_t CHUNK_SIZE = 16;
+    for (uint32_t first = 0; first < barrierCount; first += CHUNK_SIZE) {
+        const uint32_t count = std::min(CHUNK_SIZE, barrierCount - first);
+        VkImageMemoryBarrier legacyBarriers[CHUNK_SIZE];
+        VkPipelineStageFlags sourceStage = 0;
+        VkPipelineStageFlags destinationStage = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const VkImageMemoryBarrier2& barrier = barriers[first + i];
+            legacyBarriers[i] = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            legacyBarriers[i].srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+            legacyBarriers[i].dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+            legacyBarriers[i].oldLayout = barrier.oldLayout;
+            legacyBarriers[i].newLayout = barrier.newLayout;
+            legacyBarriers[i].srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+            legacyBarriers[i].dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+            legacyBarriers[i].image = barrier.image;
+            legacyBarriers[i].subresourceRange = barrier.subresourceRange;
+            sourceStage |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+            destinationStage |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+        }
+        if (sourceStage == 0) {
+            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        if (destinationStage == 0) {
+            destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, count, legacyBarriers);
+    }
+}
+
+static bool sameAccessState(const VulkanAccessState& a, const VulkanAccessState& b) {
+    return a.stageMask == b.stageMask && a.accessMask == b.accessMask && a.layout == b.layout && a.write == b.write;
+}
+
+static bool needsBarrier(const VulkanAccessState& before, const VulkanAccessState& after) {
+    // Read after read in the same layout is the only combination without a hazard.
+    return before.layout != after.layout || before.write || after.write;
+}
+
+static VkImageMemoryBarrier2 makeBarrier(const VulkanAccessState& before, const VulkanAccessState& after, VkImageAspectFlags aspectMask, uint32_t mipLevel, uint32_t baseArrayLayer, uint32_t layerCount) {
+    VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask = before.stageMask;
+    // Only writes have to be made available; a read before a write just needs the execution dependency.
+    barrier.srcAccessMask = before.write ? before.accessMask : VK_ACCESS_2_NONE;
+    barrier.dstStageMask = after.stageMask;
+    barrier.dstAccessMask = after.accessMask;
+    barrier.oldLayout = before.layout;
+    barrier.newLayout = after.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange = {aspectMask, mipLevel, 1, baseArrayLayer, layerCount};
+    return barrier;
+}
+
+// Transitions every subresource in the range to `after`, appending merged barriers to the batch.
+static void transitionSubresources(RenderGraph* graph, RenderGraphResource resource, std::vector<VulkanAccessState>& states, const VulkanAccessState& after, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount, RenderGraphBarrierBatch* batch) {
+    const RenderGraphImage& image = graph->images[resource];
+    const uint32_t arrayLayers = image.desc.arrayLayers;
+
+    for (uint32_t mip = baseMipLevel; mip < baseMipLevel + levelCount; mip++) {
+        uint32_t runStart = baseArrayLayer;
+        while (runStart < baseArrayLayer + layerCount) {
+            const VulkanAccessState before = states[mip * arrayLayers + runStart];
+            uint32_t runEnd = runStart + 1;
+            while (runEnd < baseArrayLayer + layerCount && sameAccessState(states[mip * arrayLayers + runEnd], before)) {
+                runEnd++;
+            }
+
+            if (needsBarrier(before, after)) {
+                VkImageMemoryBarrier2 barrier = makeBarrier(before, after, image.desc.aspectMask, mip, runStart, runEnd - runStart);
+
+                // Fold into the previous barrier when it covers the same layers of the preceding mip.
+                bool merged = false;
+                if (!batch->barriers.empty() && batch->barrierResources.back() == resource) {
+                    VkImageMemoryBarrier2& previous = batch->barriers.back();
+                    if (previous.srcStageMask == barrier.srcStageMask && previous.srcAccessMask == barrier.srcAccessMask &&
+                        previous.dstStageMask == barrier.dstStageMask && previous.dstAccessMask == barrier.dstAccessMask &&
+                        previous.oldLayout == barrier.oldLayout && previous.newLayout == barrier.newLayout &&
+                        previous.subresourceRange.baseArrayLayer == barrier.subresourceRange.baseArrayLayer &&
+                        previous.subresourceRange.layerCount == barrier.subresourceRange.layerCount &&
+                        previous.subresourceRange.baseMipLevel + previous.subresourceRange.levelCount == mip) {
+                        previous.subresourceRange.levelCount++;
+                        merged = true;
+                    }
+                }
+                if (!merged) {
+                    batch->barriers.push_back(barrier);
+                    batch->barrierResources.push_back(resource);
+                }
+            }
+
+            for (uint32_t layer = runStart; layer < runEnd; layer++) {
+                states[mip * arrayLayers + layer] = after;
+            }
+            runStart = runEnd;
+        }
+    }
+}
+
+static RenderGraphResource addImage(RenderGraph* graph, const char* name, const RenderGraphImageDesc& desc, bool imported, VulkanResourceAccess initialAccess, VulkanResourceAccess finalAccess) {
+    RenderGraphImage image = {};
+    image.name = name;
+    image.desc = desc;
+    if (image.desc.mipLevels == 0) {
+        image.desc.mipLevels = 1;
+    }
+    if (image.desc.arrayLayers == 0) {
+        image.desc.arrayLayers = 1;
+    }
+    image.imported = imported;
+    image.initialAccess = initialAccess;
+    image.finalAccess = finalAccess;
+    image.image = VK_NULL_HANDLE;
+    image.imageView = VK_NULL_HANDLE;
+    image.memoryBlock = UINT32_MAX;
+    image.firstPass = UINT32_MAX;
+    image.lastPass = 0;
+    graph->images.push_back(image);
+    graph->compiled = false;
+    return static_cast<RenderGraphResource>(graph->images.size() - 1);
+}
+
+RenderGraphResource renderGraphImportImage(RenderGraph* graph, const char* name, const RenderGraphImageDesc& desc, VulkanResourceAccess initialAccess, VulkanResourceAccess finalAccess) {
+    return addImage(graph, name, desc, true, initialAccess, finalAccess);
+}
+
+RenderGraphResource renderGraphCreateImage(RenderGraph* graph, const char* name, const RenderGraphImageDesc& desc) {
+    return addImage(graph, name, desc, false, VULKAN_ACCESS_NONE, VULKAN_ACCESS_NONE);
+}
+
+uint32_t renderGraphAddPass(RenderGraph* graph, const char* name, RenderGraphPassCallback callback, void* userData) {
+    RenderGraphPass pass = {};
+    pass.name = name;
+    pass.callback = callback;
+    pass.userData = userData;
+    pass.sideEffects = false;
+    pass.culled = false;
+    graph->passes.push_back(pass);
+    graph->compiled = false;
+    return static_cast<uint32_t>(graph->passes.size() - 1);
+}
+
+void renderGraphUse(RenderGraph* graph, uint32_t pass, RenderGraphResource resource, VulkanResourceAccess access) {
+    const RenderGraphImage& image = graph->images[resource];
+    renderGraphUseSubresource(graph, pass, resource, access, 0, image.desc.mipLevels, 0, image.desc.arrayLayers);
+}
+
+void renderGraphUseSubresource(RenderGraph* graph, uint32_t pass, RenderGraphResource resource, VulkanResourceAccess access, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount) {
+    RenderGraphResourceUse use = {};
+    use.resource = resource;
+    use.access = access;
+    use.baseMipLevel = baseMipLevel;
+    use.levelCount = levelCount;
+    use.baseArrayLayer = baseArrayLayer;
+    use.layerCount = layerCount;
+    graph->passes[pass].uses.push_back(use);
+    graph->compiled = false;
+}
+
+void renderGraphSetSideEffects(RenderGraph* graph, uint32_t pass) {
+    graph->passes[pass].sideEffects = true;
+    graph->compiled = false;
+}
+
+static void destroyTransientImages(VulkanContext* context, RenderGraph* graph) {
+    for (RenderGraphImage& image : graph->images) {
+        if (image.imported) {
+            continue;
+        }
+        if (image.imageView != VK_NULL_HANDLE) {
+            VK(vkDestroyImageView(context->device, image.imageView, context->allocator));
+            image.imageView = VK_NULL_HANDLE;
+        }
+        if (image.image != VK_NULL_HANDLE) {
+            VK(vkDestroyImage(context->device, image.image, context->allocator));
+            image.image = VK_NULL_HANDLE;
+        }
+        image.memoryBlock = UINT32_MAX;
+    }
+    for (VkDeviceMemory memory : graph->memoryBlocks) {
+        VK(vkFreeMemory(context->device, memory, context->allocator));
+    }
+    graph->memoryBlocks.clear();
+}
+
+static void cullPasses(RenderGraph* graph) {
+    // Walk backwards from the outputs: a pass survives if it has side effects or writes
+    // something that a surviving pass (or the outside world, for imported images) consumes.
+    std::vector<bool> resourceNeeded(graph->images.size(), false);
+    for (uint32_t i = 0; i < graph->images.size(); i++) {
+        resourceNeeded[i] = graph->images[i].imported;
+    }
+
+    for (uint32_t passIndex = static_cast<uint32_t>(graph->passes.size()); passIndex-- > 0;) {
+        RenderGraphPass& pass = graph->passes[passIndex];
+        bool needed = pass.sideEffects;
+        for (const RenderGraphResourceUse& use : pass.uses) {
+            if (getAccessState(use.access).write && resourceNeeded[use.resource]) {
+                needed = true;
+            }
+        }
+
+        pass.culled = !needed;
+        if (!needed) {
+            continue;
+        }
+        for (const RenderGraphResourceUse& use : pass.uses) {
+            resourceNeeded[use.resource] = true;
+        }
+    }
+}
+
+static bool allocateTransientImages(VulkanContext* context, RenderGraph* graph) {
+    struct MemoryBlock {
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+        std::vector<uint32_t> members;
+    };
+
+    std::vector<uint32_t> transients;
+    std::vector<VkMemoryRequirements> requirements(graph->images.size());
+    for (uint32_t i = 0; i < graph->images.size(); i++) {
+        RenderGraphImage& image = graph->images[i];
+        if (image.imported || image.firstPass == UINT32_MAX) {
+            continue;
+        }
+
+        VkImageCreateInfo createInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        createInfo.imageType = VK_IMAGE_TYPE_2D;
+        createInfo.extent = {image.desc.width, image.desc.height, 1};
+        createInfo.mipLevels = image.desc.mipLevels;
+        createInfo.arrayLayers = image.desc.arrayLayers;
+        createInfo.format = image.desc.format;
+        createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        createInfo.usage = image.desc.usage;
+        createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (VK(vkCreateImage(context->device, &createInfo, context->allocator, &image.image)) != VK_SUCCESS) {
+            LOG_ERROR("Failed to create render graph image ", image.name);
+            return false;
+        }
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE, image.image, image.name);
+        vkGetImageMemoryRequirements(context->device, image.image, &requirements[i]);
+        transients.push_back(i);
+    }
+
+    // Largest first, then greedily share a block with images whose lifetimes do not overlap.
+    std::sort(transients.begin(), transients.end(), [&requirements](uint32_t a, uint32_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    std::vector<MemoryBlock> blocks;
+    for (uint32_t imageIndex : transients) {
+        RenderGraphImage& image = graph->images[imageIndex];
+        const VkMemoryRequirements& imageRequirements = requirements[imageIndex];
+
+        uint32_t selectedBlock = UINT32_MAX;
+        for (uint32_t blockIndex = 0; blockIndex < blocks.size() && selectedBlock == UINT32_MAX; blockIndex++) {
+            MemoryBlock& block = blocks[blockIndex];
+            if ((block.memoryTypeBits & imageRequirements.memoryTypeBits) == 0) {
+                continue;
+            }
+            bool overlaps = false;
+            for (uint32_t member : block.members) {
+                const RenderGraphImage& other = graph->images[member];
+                if (image.firstPass <= other.lastPass && other.firstPass <= image.lastPass) {
+                    overlaps = true;
+                    break;
+                }
+            }
+            if (!overlaps) {
+                selectedBlock = blockIndex;
+            }
+        }
+
+        if (selectedBlock == UINT32_MAX) {
+            blocks.push_back({0, imageRequirements.memoryTypeBits, {}});
+            selectedBlock = static_cast<uint32_t>(blocks.size() - 1);
+        }
+
+        MemoryBlock& block = blocks[selectedBlock];
+        block.size = std::max(block.size, imageRequirements.size);
+        block.memoryTypeBits &= imageRequirements.memoryTypeBits;
+        block.members.push_back(imageIndex);
+        image.memoryBlock = selectedBlock;
+    }
+
+    for (const MemoryBlock& block : blocks) {
+        VkMemoryAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        allocateInfo.allocationSize = block.size;
+        allocateInfo.memoryTypeIndex = findMemoryType(context, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        if (VK(vkAllocateMemory(context->device, &allocateInfo, context->allocator, &memory)) != VK_SUCCESS) {
+            LOG_ERROR("Failed to allocate render graph transient memory.");
+            return false;
+        }
+        context->deviceAllocationCount++;
+        VK_NAME(context, VK_OBJECT_TYPE_DEVICE_MEMORY, memory, "Render graph transient memory");
+        graph->memoryBlocks.push_back(memory);
+
+        for (uint32_t member : block.members) {
+            RenderGraphImage& image = graph->images[member];
+            VKA(vkBindImageMemory(context->device, image.image, memory, 0));
+
+            VkImageViewCreateInfo viewCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            viewCreateInfo.image = image.image;
+            viewCreateInfo.viewType = image.desc.arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+            viewCreateInfo.format = image.desc.format;
+            viewCreateInfo.subresourceRange = {image.desc.aspectMask, 0, image.desc.mipLevels, 0, image.desc.arrayLayers};
+            if (VK(vkCreateImageView(context->device, &viewCreateInfo, context->allocator, &image.imageView)) != VK_SUCCESS) {
+                LOG_ERROR("Failed to create render graph image view ", image.name);
+                return false;
+            }
+            VK_NAME(context, VK_OBJECT_TYPE_IMAGE_VIEW, image.imageView, image.name);
+        }
+    }
+
+    if (!blocks.empty()) {
+        LOG_INFO("Render graph: ", static_cast<uint32_t>(transients.size()), " transient image(s) in ", static_cast<uint32_t>(blocks.size()), " memory block(s).");
+    }
+    return true;
+}
+
+bool compileRenderGraph(VulkanContext* context, RenderGraph* graph) {
+    PROFILE_FUNCTION();
+    destroyTransientImages(context, graph);
+    graph->executionOrder.clear();
+    graph->passBarriers.clear();
+    graph->finalBarriers = {};
+    graph->compiled = false;
+
+    cullPasses(graph);
+
+    for (RenderGraphImage& image : graph->images) {
+        image.firstPass = UINT32_MAX;
+        image.lastPass = 0;
+    }
+    for (uint32_t passIndex = 0; passIndex < graph->passes.size(); passIndex++) {
+        if (graph->passes[passIndex].culled) {
+            continue;
+        }
+        const uint32_t order = static_cast<uint32_t>(graph->executionOrder.size());
+        graph->executionOrder.push_back(passIndex);
+        for (const RenderGraphResourceUse& use : graph->passes[passIndex].uses) {
+            RenderGraphImage& image = graph->images[use.resource];
+            image.firstPass = std::min(image.firstPass, order);
+            image.lastPass = std::max(image.lastPass, order);
+        }
+    }
+
+    if (!allocateTransientImages(context, graph)) {
+        destroyTransientImages(context, graph);
+        return false;
+    }
+
+    // Transient images start undefined, but their first barrier still has to wait for everything
+    // that touched the same memory before: aliased images and the previous frame's use of it.
+    std::vector<VulkanAccessState> blockStates(graph->memoryBlocks.size(), {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, true});
+    for (uint32_t passIndex : graph->executionOrder) {
+        for (const RenderGraphResourceUse& use : graph->passes[passIndex].uses) {
+            const RenderGraphImage& image = graph->images[use.resource];
+            if (image.imported) {
+                continue;
+            }
+            const VulkanAccessState state = getAccessState(use.access);
+            blockStates[image.memoryBlock].stageMask |= state.stageMask;
+            blockStates[image.memoryBlock].accessMask |= state.accessMask;
+        }
+    }
+
+    std::vector<std::vector<VulkanAccessState>> subresourceStates(graph->images.size());
+    for (uint32_t i = 0; i < graph->images.size(); i++) {
+        const RenderGraphImage& image = graph->images[i];
+        VulkanAccessState initialState = getAccessState(image.initialAccess);
+        if (!image.imported && image.memoryBlock != UINT32_MAX) {
+            initialState = blockStates[image.memoryBlock];
+        }
+        subresourceStates[i].assign(image.desc.mipLevels * image.desc.arrayLayers, initialState);
+    }
+
+    graph->passBarriers.resize(graph->executionOrder.size());
+    for (uint32_t order = 0; order < graph->executionOrder.size(); order++) {
+        const RenderGraphPass& pass = graph->passes[graph->executionOrder[order]];
+        for (const RenderGraphResourceUse& use : pass.uses) {
+            transitionSubresources(graph, use.resource, subresourceStates[use.resource], getAccessState(use.access),
+                                   use.baseMipLevel, use.levelCount, use.baseArrayLayer, use.layerCount,
+                                   &graph->passBarriers[order]);
+        }
+    }
+
+    for (uint32_t i = 0; i < graph->images.size(); i++) {
+        const RenderGraphImage& image = graph->images[i];
+        if (!image.imported || image.finalAccess == VULKAN_ACCESS_NONE) {
+            continue;
+        }
+        transitionSubresources(graph, i, subresourceStates[i], getAccessState(image.finalAccess),
+                               0, image.desc.mipLevels, 0, image.desc.arrayLayers, &graph->finalBarriers);
+    }
+
+    graph->compiled = true;
+    return true;
+}
+
+void setRenderGraphImportedImage(RenderGraph* graph, RenderGraphResource resource, VkImage image, VkImageView imageView) {
+    graph->images[resource].image = image;
+    graph->images[resource].imageView = imageView;
+}
+
+VkImageView getRenderGraphImageView(const RenderGraph* graph, RenderGraphResource resource) {
+    return graph->images[resource].imageView;
+}
+
+static void submitBarrierBatch(VulkanContext* context, RenderGraph* graph, RenderGraphBarrierBatch* batch, VkCommandBuffer commandBuffer) {
+    if (batch->barriers.empty()) {
+        return;
+    }
+    for (uint32_t i = 0; i < batch->barriers.size(); i++) {
+        batch->barriers[i].image = graph->images[batch->barrierResources[i]].image;
+    }
+    cmdImageBarriers(context, commandBuffer, static_cast<uint32_t>(batch->barriers.size()), batch->barriers.data());
+}
+
+// Every pass, including its barriers, is wrapped in a RENDER_SCOPE named after the pass. profiler may be null.
+void executeRenderGraph(VulkanContext* context, RenderGraph* graph, VkCommandBuffer commandBuffer, VulkanGpuProfiler* profiler) {
+    assert(graph->compiled);
+    for (uint32_t order = 0; order < graph->executionOrder.size(); order++) {
+        const RenderGraphPass& pass = graph->passes[graph->executionOrder[order]];
+        RENDER_SCOPE(context, profiler, commandBuffer, pass.name);
+        submitBarrierBatch(context, graph, &graph->passBarriers[order], commandBuffer);
+        pass.callback(commandBuffer, pass.userData);
+    }
+    submitBarrierBatch(context, graph, &graph->finalBarriers, commandBuffer);
+}
+
+void destroyRenderGraph(VulkanContext* context, RenderGraph* graph) {
+    destroyTransientImages(context, graph);
+    *graph = {};
+}
@@ -3,16 +3,17 @@
 //
 #include "vulkan_base.h"
 
-VkRenderPass createRenderPass(VulkanContext* context, VkFormat format) {
+VkRenderPass createRenderPass(VulkanContext* context, VkFormat format, VkAttachmentLoadOp loadOp) {
     VkRenderPass renderPass;
 
     VkAttachmentDescription attachmentDescription = {};
     attachmentDescription.format = format;
     attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachmentDescription.loadOp = loadOp;
     attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Layout transitions around the pass are issued by the render graph, so the pass itself keeps the attachment layout.
+    attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     VkAttachmentReference attachmentReference = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
 
 
@@ -26,11 +27,11 @@ VkRenderPass createRenderPass(VulkanContext* context, VkFormat format) {
     createInfo.pAttachments = &attachmentDescription;
     createInfo.subpassCount = 1;
     createInfo.pSubpasses =  &subpass;
-    VKA(vkCreateRenderPass(context->device, &createInfo, 0, &renderPass));
+    VKA(vkCreateRenderPass(context->device, &createInfo, context->allocator, &renderPass));
 
     return renderPass;
 }
 
 void destroyRenderPass(VulkanContext* context, VkRenderPass renderPass) {
-    VK(vkDestroyRenderPass(context->device, renderPass, nullptr));
+    VK(vkDestroyRenderPass(context->device, renderPass, context->allocator));
 }
\ No newline at end of file
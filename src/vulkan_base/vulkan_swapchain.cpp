@@ -1,9 +1,12 @@
 //
 // Created by liqui on 26.02.2026.
 //
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
 #include "vulkan_base.h"
 
-VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage) {
+// preferredPresentMode is used when the surface supports it. Otherwise FIFO, which every surface supports.
+VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage, VkPresentModeKHR preferredPresentMode) {
+    PROFILE_FUNCTION();
     VulkanSwapChain result = {};
     VkBool32 supportsPresent = VK_FALSE;
     VKA(vkGetPhysicalDeviceSurfaceSupportKHR(context->physicalDevice, context->graphicsQueue.familyIndex, surface, &supportsPresent));
@@ -39,6 +42,24 @@ VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, Vk
         surfaceCapabilities.currentExtent.height = surfaceCapabilities.minImageExtent.height;
     }
 
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    if (preferredPresentMode != VK_PRESENT_MODE_FIFO_KHR) {
+        uint32_t numPresentModes = 0;
+        VKA(vkGetPhysicalDeviceSurfacePresentModesKHR(context->physicalDevice, surface, &numPresentModes, nullptr));
+        std::vector<VkPresentModeKHR> presentModes(numPresentModes);
+        if (numPresentModes > 0) {
+            VKA(vkGetPhysicalDeviceSurfacePresentModesKHR(context->physicalDevice, surface, &numPresentModes, presentModes.data()));
+        }
+        for (VkPresentModeKHR availablePresentMode : presentModes) {
+            if (availablePresentMode == preferredPresentMode) {
+                presentMode = preferredPresentMode;
+            }
+        }
+        if (presentMode != preferredPresentMode) {
+            LOG_WARN("Requested present mode ", static_cast<int>(preferredPresentMode), " is not supported. Using FIFO.");
+        }
+    }
+
     VkSwapchainCreateInfoKHR createInfo = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
     createInfo.surface = surface;
     uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
@@ -54,8 +75,8 @@ VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, Vk
     createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     createInfo.preTransform = surfaceCapabilities.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
-    if (VK(vkCreateSwapchainKHR(context->device, &createInfo, nullptr, &result.swapChain)) != VK_SUCCESS) {
+    createInfo.presentMode = presentMode;
+    if (VK(vkCreateSwapchainKHR(context->device, &createInfo, context->allocator, &result.swapChain)) != VK_SUCCESS) {
         LOG_ERROR("Failed to create swapchain");
         delete[] availableFormats;
         return result;
@@ -63,6 +84,7 @@ VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, Vk
 
 
     result.format = format;
+    result.presentMode = presentMode;
     result.width = surfaceCapabilities.currentExtent.width;
     result.height = surfaceCapabilities.currentExtent.height;
 
@@ -70,7 +92,7 @@ VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, Vk
     VKA(vkGetSwapchainImagesKHR(context->device, result.swapChain, &numImages, nullptr));
     if (numImages == 0) {
         LOG_ERROR("Swapchain has no images");
-        VK(vkDestroySwapchainKHR(context->device, result.swapChain, nullptr));
+        VK(vkDestroySwapchainKHR(context->device, result.swapChain, context->allocator));
         result.swapChain = VK_NULL_HANDLE;
         delete[] availableFormats;
         return result;
@@ -91,24 +113,68 @@ VulkanSwapChain createSwapChain(VulkanContext* context, VkSurfaceKHR surface, Vk
         createInfo.format = format;
         createInfo.components = {};
         createInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
-        VKA(vkCreateImageView(context->device, &createInfo, 0, &result.imageViews[i]));
+        VKA(vkCreateImageView(context->device, &createInfo, context->allocator, &result.imageViews[i]));
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE, result.images[i], "Swapchain image");
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE_VIEW, result.imageViews[i], "Swapchain image view");
     }
 
     delete[] availableFormats;
     return result;
 }
 
+// Stand-in for a swapchain when there is no surface. The images are owned by the application, so
+// there is nothing to acquire or present; the frame loop cycles through them instead.
+VulkanSwapChain createOffscreenSwapChain(VulkanContext* context, uint32_t width, uint32_t height, VkFormat format, uint32_t imageCount, VkImageUsageFlags usage) {
+    PROFILE_FUNCTION();
+    VulkanSwapChain result = {};
+    result.offscreen = true;
+    result.format = format;
+    result.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    result.width = width;
+    result.height = height;
+    result.images.resize(imageCount, VK_NULL_HANDLE);
+    result.imageMemory.resize(imageCount, VK_NULL_HANDLE);
+    result.imageViews.resize(imageCount, VK_NULL_HANDLE);
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+        if (!createImage(context, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &result.images[i], &result.imageMemory[i]) ||
+            !createImageView(context, result.images[i], format, VK_IMAGE_ASPECT_COLOR_BIT, &result.imageViews[i])) {
+            LOG_ERROR("Failed to create offscreen image ", i);
+            destroySwapChain(context, &result);
+            return result;
+        }
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE, result.images[i], "Offscreen image");
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE_VIEW, result.imageViews[i], "Offscreen image view");
+    }
+    return result;
+}
+
 void destroySwapChain(VulkanContext* context, VulkanSwapChain* swapChain) {
 
-    if (swapChain == nullptr || swapChain->swapChain == VK_NULL_HANDLE) {
+    if (swapChain == nullptr) {
+        return;
+    }
+
+    if (swapChain->offscreen) {
+        for (uint32_t i = 0; i < swapChain->images.size(); i++) {
+            destroyImageView(context, &swapChain->imageViews[i]);
+            destroyImage(context, &swapChain->images[i], &swapChain->imageMemory[i]);
+        }
+        swapChain->images.clear();
+        swapChain->imageMemory.clear();
+        swapChain->imageViews.clear();
+        return;
+    }
+
+    if (swapChain->swapChain == VK_NULL_HANDLE) {
         return;
     }
 
     for (uint32_t i = 0; i < swapChain->imageViews.size(); i++) {
-        VK(vkDestroyImageView(context->device, swapChain->imageViews[i], nullptr));
+        VK(vkDestroyImageView(context->device, swapChain->imageViews[i], context->allocator));
     }
 
-    VK(vkDestroySwapchainKHR(context->device, swapChain->swapChain, nullptr));
+    VK(vkDestroySwapchainKHR(context->device, swapChain->swapChain, context->allocator));
     swapChain->swapChain = VK_NULL_HANDLE;
     swapChain->images.clear();
     swapChain->imageViews.clear();
@@ -1,6 +1,7 @@
 //
 // Created by liqui on 27.02.2026.
 //
+#define LOG_DEFAULT_CATEGORY LOG_CATEGORY_VULKAN
 #include "vulkan_base.h"
 #include <cstring>
 
@@ -11,7 +12,7 @@ static bool beginSingleUseCommands(VulkanContext* context, VkCommandPool* comman
     VkCommandPoolCreateInfo poolCreateInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
     poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     poolCreateInfo.queueFamilyIndex = context->graphicsQueue.familyIndex;
-    if (VK(vkCreateCommandPool(context->device, &poolCreateInfo, nullptr, commandPool)) != VK_SUCCESS) {
+    if (VK(vkCreateCommandPool(context->device, &poolCreateInfo, context->allocator, commandPool)) != VK_SUCCESS) {
         LOG_ERROR("Failed to create temporary command pool.");
         return false;
     }
@@ -22,7 +23,7 @@ static bool beginSingleUseCommands(VulkanContext* context, VkCommandPool* comman
     allocateInfo.commandBufferCount = 1;
     if (VK(vkAllocateCommandBuffers(context->device, &allocateInfo, commandBuffer)) != VK_SUCCESS) {
         LOG_ERROR("Failed to allocate temporary command buffer.");
-        VK(vkDestroyCommandPool(context->device, *commandPool, nullptr));
+        VK(vkDestroyCommandPool(context->device, *commandPool, context->allocator));
         *commandPool = VK_NULL_HANDLE;
         return false;
     }
@@ -33,19 +34,40 @@ static bool beginSingleUseCommands(VulkanContext* context, VkCommandPool* comman
     return true;
 }
 
-static bool endSingleUseCommands(VulkanContext* context, VkCommandPool commandPool, VkCommandBuffer commandBuffer) {
+// Ends the commands and submits them with a new fence, without waiting.
+static bool submitSingleUseCommands(VulkanContext* context, VkCommandBuffer commandBuffer, VkFence* fence) {
     VKA(vkEndCommandBuffer(commandBuffer));
 
+    VkFenceCreateInfo fenceCreateInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    if (VK(vkCreateFence(context->device, &fenceCreateInfo, context->allocator, fence)) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create fence for temporary commands.");
+        *fence = VK_NULL_HANDLE;
+        return false;
+    }
+
     VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
-    VKA(vkQueueSubmit(context->graphicsQueue.queue, 1, &submitInfo, VK_NULL_HANDLE));
-    VKA(vkQueueWaitIdle(context->graphicsQueue.queue));
-
-    VK(vkDestroyCommandPool(context->device, commandPool, nullptr));
+    std::lock_guard<std::mutex> lock(context->graphicsQueueMutex);
+    VKA(vkQueueSubmit(context->graphicsQueue.queue, 1, &submitInfo, *fence));
     return true;
 }
 
+// Waits on the submission's own fence rather than vkQueueWaitIdle, which would also wait for
+// other threads' work and need the queue lock while waiting.
+static bool endSingleUseCommands(VulkanContext* context, VkCommandPool commandPool, VkCommandBuffer commandBuffer) {
+    VkFence fence = VK_NULL_HANDLE;
+    const bool submitted = submitSingleUseCommands(context, commandBuffer, &fence);
+    if (submitted) {
+        VKA(vkWaitForFences(context->device, 1, &fence, VK_TRUE, UINT64_MAX));
+    }
+    if (fence != VK_NULL_HANDLE) {
+        VK(vkDestroyFence(context->device, fence, context->allocator));
+    }
+    VK(vkDestroyCommandPool(context->device, commandPool, context->allocator));
+    return submitted;
+}
+
 uint32_t findMemoryType(VulkanContext* context, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
     VkPhysicalDeviceMemoryProperties memoryProperties = {};
     vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &memoryProperties);
@@ -71,7 +93,7 @@ bool createBuffer(VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags
     bufferCreateInfo.size = size;
     bufferCreateInfo.usage = usage;
     bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    if (VK(vkCreateBuffer(context->device, &bufferCreateInfo, nullptr, buffer)) != VK_SUCCESS) {
+    if (VK(vkCreateBuffer(context->device, &bufferCreateInfo, context->allocator, buffer)) != VK_SUCCESS) {
         LOG_ERROR("Failed to create buffer.");
         return false;
     }
@@ -82,12 +104,13 @@ bool createBuffer(VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags
     VkMemoryAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
     allocateInfo.allocationSize = memoryRequirements.size;
     allocateInfo.memoryTypeIndex = findMemoryType(context, memoryRequirements.memoryTypeBits, properties);
-    if (VK(vkAllocateMemory(context->device, &allocateInfo, nullptr, bufferMemory)) != VK_SUCCESS) {
+    if (VK(vkAllocateMemory(context->device, &allocateInfo, context->allocator, bufferMemory)) != VK_SUCCESS) {
         LOG_ERROR("Failed to allocate buffer memory.");
-        VK(vkDestroyBuffer(context->device, *buffer, nullptr));
+        VK(vkDestroyBuffer(context->device, *buffer, context->allocator));
         *buffer = VK_NULL_HANDLE;
         return false;
     }
+    context->deviceAllocationCount++;
 
     VKA(vkBindBufferMemory(context->device, *buffer, *bufferMemory, 0));
     return true;
@@ -95,16 +118,17 @@ bool createBuffer(VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags
 
 void destroyBuffer(VulkanContext* context, VkBuffer* buffer, VkDeviceMemory* bufferMemory) {
     if (buffer != nullptr && *buffer != VK_NULL_HANDLE) {
-        VK(vkDestroyBuffer(context->device, *buffer, nullptr));
+        VK(vkDestroyBuffer(context->device, *buffer, context->allocator));
         *buffer = VK_NULL_HANDLE;
     }
     if (bufferMemory != nullptr && *bufferMemory != VK_NULL_HANDLE) {
-        VK(vkFreeMemory(context->device, *bufferMemory, nullptr));
+        VK(vkFreeMemory(context->device, *bufferMemory, context->allocator));
         *bufferMemory = VK_NULL_HANDLE;
     }
 }
 
 bool copyBuffer(VulkanContext* context, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    PROFILE_FUNCTION();
     VkCommandPool commandPool = VK_NULL_HANDLE;
     VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
     if (!beginSingleUseCommands(context, &commandPool, &commandBuffer)) {
@@ -141,7 +165,7 @@ bool createImage(VulkanContext* context, uint32_t width, uint32_t height, VkForm
     createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (VK(vkCreateImage(context->device, &createInfo, nullptr, image)) != VK_SUCCESS) {
+    if (VK(vkCreateImage(context->device, &createInfo, context->allocator, image)) != VK_SUCCESS) {
         LOG_ERROR("Failed to create image.");
         return false;
     }
@@ -152,12 +176,13 @@ bool createImage(VulkanContext* context, uint32_t width, uint32_t height, VkForm
     VkMemoryAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
     allocInfo.allocationSize = memoryRequirements.size;
     allocInfo.memoryTypeIndex = findMemoryType(context, memoryRequirements.memoryTypeBits, properties);
-    if (VK(vkAllocateMemory(context->device, &allocInfo, nullptr, imageMemory)) != VK_SUCCESS) {
+    if (VK(vkAllocateMemory(context->device, &allocInfo, context->allocator, imageMemory)) != VK_SUCCESS) {
         LOG_ERROR("Failed to allocate image memory.");
-        VK(vkDestroyImage(context->device, *image, nullptr));
+        VK(vkDestroyImage(context->device, *image, context->allocator));
         *image = VK_NULL_HANDLE;
         return false;
     }
+    context->deviceAllocationCount++;
 
     VKA(vkBindImageMemory(context->device, *image, *imageMemory, 0));
     return true;
@@ -165,11 +190,11 @@ bool createImage(VulkanContext* context, uint32_t width, uint32_t height, VkForm
 
 void destroyImage(VulkanContext* context, VkImage* image, VkDeviceMemory* imageMemory) {
     if (image != nullptr && *image != VK_NULL_HANDLE) {
-        VK(vkDestroyImage(context->device, *image, nullptr));
+        VK(vkDestroyImage(context->device, *image, context->allocator));
         *image = VK_NULL_HANDLE;
     }
     if (imageMemory != nullptr && *imageMemory != VK_NULL_HANDLE) {
-        VK(vkFreeMemory(context->device, *imageMemory, nullptr));
+        VK(vkFreeMemory(context->device, *imageMemory, context->allocator));
         *imageMemory = VK_NULL_HANDLE;
     }
 }
@@ -187,7 +212,7 @@ bool createImageView(VulkanContext* context, VkImage image, VkFormat format, VkI
     createInfo.subresourceRange.baseArrayLayer = 0;
     createInfo.subresourceRange.layerCount = 1;
 
-    if (VK(vkCreateImageView(context->device, &createInfo, nullptr, imageView)) != VK_SUCCESS) {
+    if (VK(vkCreateImageView(context->device, &createInfo, context->allocator, imageView)) != VK_SUCCESS) {
         LOG_ERROR("Failed to create image view.");
         return false;
     }
@@ -196,20 +221,26 @@ bool createImageView(VulkanContext* context, VkImage image, VkFormat format, VkI
 
 void destroyImageView(VulkanContext* context, VkImageView* imageView) {
     if (imageView != nullptr && *imageView != VK_NULL_HANDLE) {
-        VK(vkDestroyImageView(context->device, *imageView, nullptr));
+        VK(vkDestroyImageView(context->device, *imageView, context->allocator));
         *imageView = VK_NULL_HANDLE;
     }
 }
 
-bool transitionImageLayout(VulkanContext* context, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageAspectFlags aspectFlags) {
-    VkCommandPool commandPool = VK_NULL_HANDLE;
-    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
-    if (!beginSingleUseCommands(context, &commandPool, &commandBuffer)) {
-        LOG_ERROR("Failed to begin temporary commands for image layout transition.");
+static bool cmdTransitionImageLayout(VulkanContext* context, VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageAspectFlags aspectFlags) {
+    VulkanResourceAccess oldAccess = VULKAN_ACCESS_NONE;
+    VulkanResourceAccess newAccess = VULKAN_ACCESS_NONE;
+    if (!getLayoutAccess(oldLayout, &oldAccess) || !getLayoutAccess(newLayout, &newAccess) || newLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+        LOG_ERROR("Unsupported image layout transition: oldLayout=", static_cast<int>(oldLayout), ", newLayout=", static_cast<int>(newLayout));
         return false;
     }
+    const VulkanAccessState before = getAccessState(oldAccess);
+    const VulkanAccessState after = getAccessState(newAccess);
 
-    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask = before.stageMask;
+    barrier.srcAccessMask = before.write ? before.accessMask : VK_ACCESS_2_NONE;
+    barrier.dstStageMask = after.stageMask;
+    barrier.dstAccessMask = after.accessMask;
     barrier.oldLayout = oldLayout;
     barrier.newLayout = newLayout;
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -220,35 +251,22 @@ bool transitionImageLayout(VulkanContext* context, VkImage image, VkImageLayout
     barrier.subresourceRange.levelCount = 1;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
+    cmdImageBarriers(context, commandBuffer, 1, &barrier);
+    return true;
+}
 
-    VkPipelineStageFlags sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    VkPipelineStageFlags destinationStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        LOG_ERROR("Unsupported image layout transition: oldLayout=", static_cast<int>(oldLayout), ", newLayout=", static_cast<int>(newLayout));
-        VK(vkDestroyCommandPool(context->device, commandPool, nullptr));
+bool transitionImageLayout(VulkanContext* context, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageAspectFlags aspectFlags) {
+    PROFILE_FUNCTION();
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!beginSingleUseCommands(context, &commandPool, &commandBuffer)) {
+        LOG_ERROR("Failed to begin temporary commands for image layout transition.");
+        return false;
+    }
+    if (!cmdTransitionImageLayout(context, commandBuffer, image, oldLayout, newLayout, aspectFlags)) {
+        VK(vkDestroyCommandPool(context->device, commandPool, context->allocator));
         return false;
     }
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        sourceStage,
-        destinationStage,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
-
     if (!endSingleUseCommands(context, commandPool, commandBuffer)) {
         LOG_ERROR("Failed to submit temporary commands for image layout transition.");
         return false;
@@ -256,14 +274,7 @@ bool transitionImageLayout(VulkanContext* context, VkImage image, VkImageLayout
     return true;
 }
 
-bool copyBufferToImage(VulkanContext* context, VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height) {
-    VkCommandPool commandPool = VK_NULL_HANDLE;
-    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
-    if (!beginSingleUseCommands(context, &commandPool, &commandBuffer)) {
-        LOG_ERROR("Failed to begin temporary commands for buffer-to-image copy.");
-        return false;
-    }
-
+static void cmdCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height) {
     VkBufferImageCopy region = {};
     region.bufferOffset = 0;
     region.bufferRowLength = 0;
@@ -282,7 +293,17 @@ bool copyBufferToImage(VulkanContext* context, VkBuffer srcBuffer, VkImage dstIm
         1,
         &region
     );
+}
 
+bool copyBufferToImage(VulkanContext* context, VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height) {
+    PROFILE_FUNCTION();
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!beginSingleUseCommands(context, &commandPool, &commandBuffer)) {
+        LOG_ERROR("Failed to begin temporary commands for buffer-to-image copy.");
+        return false;
+    }
+    cmdCopyBufferToImage(commandBuffer, srcBuffer, dstImage, width, height);
     if (!endSingleUseCommands(context, commandPool, commandBuffer)) {
         LOG_ERROR("Failed to submit temporary commands for buffer-to-image copy.");
         return false;
@@ -290,31 +311,32 @@ bool copyBufferToImage(VulkanContext* context, VkBuffer srcBuffer, VkImage dstIm
     return true;
 }
 
-bool uploadToDeviceLocalImageRGBA8(VulkanContext* context, const void* pixelData, uint32_t width, uint32_t height, VkImage* image, VkDeviceMemory* imageMemory, VkImageView* imageView) {
+bool beginUploadToDeviceLocalImageRGBA8(VulkanContext* context, const void* pixelData, uint32_t width, uint32_t height, VkImage* image, VkDeviceMemory* imageMemory, VkImageView* imageView, VulkanPendingUpload* upload) {
+    PROFILE_FUNCTION();
+    *upload = {};
     if (pixelData == nullptr || width == 0 || height == 0) {
         LOG_ERROR("Invalid image upload data or dimensions.");
         return false;
     }
 
     const VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * static_cast<VkDeviceSize>(height) * 4;
-    VkBuffer stagingBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
     if (!createBuffer(
             context,
             imageSize,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &stagingBuffer,
-            &stagingBufferMemory)) {
+            &upload->stagingBuffer,
+            &upload->stagingBufferMemory)) {
         LOG_ERROR("Failed to create staging buffer for image upload.");
         return false;
     }
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, upload->stagingBuffer, "Image upload staging buffer");
 
     {
         void* mappedMemory = nullptr;
-        VKA(vkMapMemory(context->device, stagingBufferMemory, 0, imageSize, 0, &mappedMemory));
+        VKA(vkMapMemory(context->device, upload->stagingBufferMemory, 0, imageSize, 0, &mappedMemory));
         std::memcpy(mappedMemory, pixelData, static_cast<size_t>(imageSize));
-        vkUnmapMemory(context->device, stagingBufferMemory);
+        vkUnmapMemory(context->device, upload->stagingBufferMemory);
     }
 
     if (!createImage(
@@ -328,43 +350,66 @@ bool uploadToDeviceLocalImageRGBA8(VulkanContext* context, const void* pixelData
             image,
             imageMemory)) {
         LOG_ERROR("Failed to create device-local image.");
-        destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
+        finishUpload(context, upload);
         return false;
     }
 
-    if (!transitionImageLayout(context, *image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT)) {
-        LOG_ERROR("Failed image layout transition to TRANSFER_DST_OPTIMAL.");
+    if (!createImageView(context, *image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, imageView)) {
+        LOG_ERROR("Failed to create image view for uploaded image.");
         destroyImage(context, image, imageMemory);
-        destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
+        finishUpload(context, upload);
         return false;
     }
 
-    if (!copyBufferToImage(context, stagingBuffer, *image, width, height)) {
-        LOG_ERROR("Failed to copy staging buffer to image.");
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!beginSingleUseCommands(context, &upload->commandPool, &commandBuffer)) {
+        LOG_ERROR("Failed to begin temporary commands for image upload.");
+        destroyImageView(context, imageView);
         destroyImage(context, image, imageMemory);
-        destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
+        finishUpload(context, upload);
         return false;
     }
-
-    if (!transitionImageLayout(context, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT)) {
-        LOG_ERROR("Failed image layout transition to SHADER_READ_ONLY_OPTIMAL.");
+    const bool recorded = cmdTransitionImageLayout(context, commandBuffer, *image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+    if (recorded) {
+        cmdCopyBufferToImage(commandBuffer, upload->stagingBuffer, *image, width, height);
+    }
+    if (!recorded || !cmdTransitionImageLayout(context, commandBuffer, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT)
+        || !submitSingleUseCommands(context, commandBuffer, &upload->fence)) {
+        LOG_ERROR("Failed to submit image upload.");
+        destroyImageView(context, imageView);
         destroyImage(context, image, imageMemory);
-        destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
+        finishUpload(context, upload);
         return false;
     }
 
-    if (!createImageView(context, *image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, imageView)) {
-        LOG_ERROR("Failed to create image view for uploaded image.");
-        destroyImage(context, image, imageMemory);
-        destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
-        return false;
+    context->uploadedBytes += imageSize;
+    return true;
+}
+
+void finishUpload(VulkanContext* context, VulkanPendingUpload* upload) {
+    if (upload->fence != VK_NULL_HANDLE) {
+        VKA(vkWaitForFences(context->device, 1, &upload->fence, VK_TRUE, UINT64_MAX));
+        VK(vkDestroyFence(context->device, upload->fence, context->allocator));
+        upload->fence = VK_NULL_HANDLE;
+    }
+    if (upload->commandPool != VK_NULL_HANDLE) {
+        VK(vkDestroyCommandPool(context->device, upload->commandPool, context->allocator));
+        upload->commandPool = VK_NULL_HANDLE;
     }
+    destroyBuffer(context, &upload->stagingBuffer, &upload->stagingBufferMemory);
+}
 
-    destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
+bool uploadToDeviceLocalImageRGBA8(VulkanContext* context, const void* pixelData, uint32_t width, uint32_t height, VkImage* image, VkDeviceMemory* imageMemory, VkImageView* imageView) {
+    VulkanPendingUpload upload = {};
+    if (!beginUploadToDeviceLocalImageRGBA8(context, pixelData, width, height, image, imageMemory, imageView, &upload)) {
+        return false;
+    }
+    finishUpload(context, &upload);
     return true;
 }
 
 bool uploadToDeviceLocalBuffer(VulkanContext* context, const void* srcData, VkDeviceSize size, VkBufferUsageFlags targetUsage, VkBuffer* dstBuffer, VkDeviceMemory* dstBufferMemory) {
+    PROFILE_FUNCTION();
     if (srcData == nullptr || size == 0) {
         LOG_ERROR("Invalid upload source data or size.");
         return false;
@@ -382,6 +427,7 @@ bool uploadToDeviceLocalBuffer(VulkanContext* context, const void* srcData, VkDe
         LOG_ERROR("Failed to create staging buffer.");
         return false;
     }
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, stagingBuffer, "Upload staging buffer");
 
     {
         void* mappedMemory = nullptr;
@@ -410,5 +456,93 @@ bool uploadToDeviceLocalBuffer(VulkanContext* context, const void* srcData, VkDe
     }
 
     destroyBuffer(context, &stagingBuffer, &stagingBufferMemory);
+    context->uploadedBytes += size;
+    return true;
+}
+
+// Fills up to maxHeapCount entries and returns how many were written.
+uint32_t getMemoryHeapStats(VulkanContext* context, VulkanMemoryHeapStats* stats, uint32_t maxHeapCount) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 memoryProperties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2};
+    if (context->memoryBudgetEnabled) {
+        memoryProperties.pNext = &budgetProperties;
+    }
+    vkGetPhysicalDeviceMemoryProperties2(context->physicalDevice, &memoryProperties);
+
+    uint32_t heapCount = memoryProperties.memoryProperties.memoryHeapCount;
+    if (heapCount > maxHeapCount) {
+        heapCount = maxHeapCount;
+    }
+    for (uint32_t i = 0; i < heapCount; i++) {
+        const VkMemoryHeap& heap = memoryProperties.memoryProperties.memoryHeaps[i];
+        stats[i].size = heap.size;
+        stats[i].deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        stats[i].budget = context->memoryBudgetEnabled ? budgetProperties.heapBudget[i] : 0;
+        stats[i].usage = context->memoryBudgetEnabled ? budgetProperties.heapUsage[i] : 0;
+    }
+    return heapCount;
+}
+
+// Copies a color image with 4 bytes per texel into pixels, tightly packed.
+// The image has to be in TRANSFER_SRC_OPTIMAL and idle on the GPU.
+bool readbackImage(VulkanContext* context, VkImage image, uint32_t width, uint32_t height, std::vector<uint8_t>* pixels) {
+    PROFILE_FUNCTION();
+    const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+
+    VkBuffer readbackBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory readbackBufferMemory = VK_NULL_HANDLE;
+    if (!createBuffer(
+            context,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &readbackBuffer,
+            &readbackBufferMemory)) {
+        LOG_ERROR("Failed to create readback buffer.");
+        return false;
+    }
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, readbackBuffer, "Readback buffer");
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!beginSingleUseCommands(context, &commandPool, &commandBuffer)) {
+        LOG_ERROR("Failed to begin temporary commands for image readback.");
+        destroyBuffer(context, &readbackBuffer, &readbackBufferMemory);
+        return false;
+    }
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+    // The fence only orders the copy before the host's read; this makes its writes visible to it.
+    VkBufferMemoryBarrier hostReadBarrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    hostReadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostReadBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostReadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostReadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostReadBarrier.buffer = readbackBuffer;
+    hostReadBarrier.offset = 0;
+    hostReadBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostReadBarrier, 0, nullptr);
+
+    if (!endSingleUseCommands(context, commandPool, commandBuffer)) {
+        LOG_ERROR("Failed to submit temporary commands for image readback.");
+        destroyBuffer(context, &readbackBuffer, &readbackBufferMemory);
+        return false;
+    }
+
+    void* mappedMemory = nullptr;
+    VKA(vkMapMemory(context->device, readbackBufferMemory, 0, size, 0, &mappedMemory));
+    pixels->resize(static_cast<size_t>(size));
+    std::memcpy(pixels->data(), mappedMemory, static_cast<size_t>(size));
+    vkUnmapMemory(context->device, readbackBufferMemory);
+
+    destroyBuffer(context, &readbackBuffer, &readbackBufferMemory);
     return true;
 }
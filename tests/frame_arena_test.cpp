@@ -0,0 +1,181 @@
+// Checks the frame arenas: bumping and alignment, rolling back the latest allocation, resets,
+// overflow into the heap, the heap path without an arena, the slot ring and which arena
+// FrameArenaAllocator carries through container copies, moves and swaps. Returns non-zero when a
+// check fails.
+#include "../src/frame_arena.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+// Small enough to overflow on purpose.
+static constexpr size_t TEST_ARENA_SIZE = 1024;
+
+static uint32_t failureCount = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failureCount++;
+    }
+}
+
+static bool inArena(const FrameArena* arena, const void* pointer, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(pointer);
+    return arena->base != nullptr && bytes >= arena->base && bytes + size <= arena->base + arena->capacity;
+}
+
+static bool isAligned(const void* pointer, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+static void testBumpAndRollback() {
+    FrameArena arena;
+    if (!createFrameArena(&arena, TEST_ARENA_SIZE)) {
+        check(false, "createFrameArena");
+        return;
+    }
+    void* first = frameArenaAllocate(&arena, 3, 1);
+    void* aligned = frameArenaAllocate(&arena, 32, 64);
+    check(first == arena.base && inArena(&arena, aligned, 32) && isAligned(aligned, 64), "allocations bump through the block at their alignment");
+    const size_t head = arena.head;
+    void* latest = frameArenaAllocate(&arena, 100, 8);
+    frameArenaFree(&arena, latest, 100);
+    check(arena.head == head && arena.peak == head + 100, "freeing the latest allocation rolls head back but keeps the peak");
+    check(frameArenaAllocate(&arena, 100, 8) == latest, "the rolled back space is handed out again");
+    frameArenaFree(&arena, aligned, 32);
+    check(arena.head == head + 100, "freeing anything but the latest allocation gives nothing back");
+
+    resetFrameArena(&arena);
+    check(arena.head == 0 && arena.peak == 0, "a reset empties the arena");
+    check(frameArenaAllocate(&arena, 3, 1) == first, "after a reset allocations start at the base again");
+    destroyFrameArena(&arena);
+    check(arena.base == nullptr && arena.capacity == 0, "destroyFrameArena clears the arena");
+}
+
+static void testOverflow() {
+    FrameArena arena;
+    if (!createFrameArena(&arena, TEST_ARENA_SIZE)) {
+        check(false, "createFrameArena");
+        return;
+    }
+    void* inside = frameArenaAllocate(&arena, TEST_ARENA_SIZE - 16, 16);
+    uint8_t* spilled = static_cast<uint8_t*>(frameArenaAllocate(&arena, 4096, 16));
+    uint8_t* overAligned = static_cast<uint8_t*>(frameArenaAllocate(&arena, 100, 256));
+    std::memset(spilled, 0x5A, 4096);
+    std::memset(overAligned, 0xA5, 100);
+    check(inArena(&arena, inside, TEST_ARENA_SIZE - 16), "allocations that fit stay in the block");
+    check(!inArena(&arena, spilled, 1) && !inArena(&arena, overAligned, 1), "allocations that do not fit go to the heap");
+    check(isAligned(spilled, 16) && isAligned(overAligned, 256), "heap fallbacks keep the requested alignment");
+    check(spilled[4095] == 0x5A && overAligned[0] == 0xA5, "heap fallbacks do not overlap");
+    check(arena.overflow != nullptr && arena.overflowBytes == 4096 + 100, "heap fallbacks are counted");
+    check(frameArenaAllocate(&arena, 16, 16) != nullptr && arena.head == TEST_ARENA_SIZE, "what still fits goes to the block after an overflow");
+
+    resetFrameArena(&arena);
+    check(arena.overflow == nullptr && arena.overflowBytes == 0, "a reset frees the heap fallbacks");
+    check(frameArenaAllocate(&arena, 64, 16) == arena.base, "the block is used again after the reset");
+    destroyFrameArena(&arena);
+
+    // An arena without a block, e.g. one whose creation failed, still hands out memory.
+    FrameArena empty = {};
+    uint64_t* value = static_cast<uint64_t*>(frameArenaAllocate(&empty, sizeof(uint64_t), alignof(uint64_t)));
+    *value = 42;
+    check(empty.overflowBytes == sizeof(uint64_t), "an arena without a block allocates from the heap");
+    resetFrameArena(&empty);
+}
+
+static void testNullArena() {
+    bool usedHeap = false;
+    bool intact = false;
+    // A fresh thread has never called beginFrameArena().
+    std::thread([&usedHeap, &intact] {
+        FrameVector<uint32_t> values;
+        usedHeap = values.get_allocator().arena == nullptr && getThreadFrameArena() == nullptr;
+        for (uint32_t i = 0; i < 1000; i++) {
+            values.push_back(i);
+        }
+        intact = values.size() == 1000 && values[999] == 999;
+    }).join();
+    check(usedHeap, "FrameArenaAllocator without an arena falls back to the heap");
+    check(intact, "containers work on the heap path");
+}
+
+static void testRing() {
+    FrameArenaRing ring;
+    if (!createFrameArenaRing(&ring, 2, TEST_ARENA_SIZE)) {
+        check(false, "createFrameArenaRing");
+        return;
+    }
+    FrameArena* first = beginFrameArena(&ring, 0);
+    check(getThreadFrameArena() == first, "beginFrameArena makes the slot's arena the thread's arena");
+    uint32_t* kept = frameArenaNewArray<uint32_t>(first, 16);
+    kept[15] = 1234;
+    FrameArena* second = beginFrameArena(&ring, 1);
+    check(second != first && kept[15] == 1234 && first->head != 0, "the previous frame's data stays valid while the next frame is built");
+    check(ring.lastFrameBytes == 16 * sizeof(uint32_t), "the previous slot's peak is kept for statistics");
+    check(beginFrameArena(&ring, 2) == first && first->head == 0, "a slot's arena is reset when the slot comes around again");
+    destroyFrameArenaRing(&ring);
+    check(getThreadFrameArena() == nullptr, "destroying the ring clears the thread's arena");
+
+    check(createFrameArenaRing(&ring, FRAME_ARENA_MAX_SLOTS + 3, 0) && ring.slotCount == FRAME_ARENA_MAX_SLOTS, "slot counts are clamped to FRAME_ARENA_MAX_SLOTS");
+    destroyFrameArenaRing(&ring);
+}
+
+static void testAllocatorPropagation() {
+    FrameArena current;
+    FrameArena next;
+    if (!createFrameArena(&current, TEST_ARENA_SIZE) || !createFrameArena(&next, TEST_ARENA_SIZE)) {
+        check(false, "createFrameArena");
+        return;
+    }
+    const FrameArenaAllocator<uint32_t> currentAllocator(&current);
+    const FrameArenaAllocator<uint32_t> nextAllocator(&next);
+    FrameArenaAllocator<uint64_t> rebound(currentAllocator);
+    check(rebound.arena == &current && rebound == currentAllocator, "a rebound allocator keeps its arena");
+
+    FrameVector<uint32_t> source(currentAllocator);
+    source.reserve(8);
+    source.assign({1, 2, 3});
+    FrameVector<uint32_t> copied(source);
+    check(copied.get_allocator().arena == &current && inArena(&current, copied.data(), 3), "copy construction allocates from the source's arena");
+
+    FrameVector<uint32_t> target(nextAllocator);
+    target.reserve(8);
+    target = source;
+    check(target.get_allocator().arena == &current && inArena(&current, target.data(), 3) && target[2] == 3, "copy assignment takes the source's arena along");
+
+    FrameVector<uint32_t> moved(nextAllocator);
+    const uint32_t* sourceData = source.data();
+    moved = std::move(source);
+    check(moved.get_allocator().arena == &current && moved.data() == sourceData, "move assignment takes the source's arena and its buffer");
+
+    // Pointing a container at the next frame's arena, the way frame-long containers do.
+    copied = FrameVector<uint32_t>(nextAllocator);
+    copied.reserve(4);
+    check(copied.get_allocator().arena == &next && inArena(&next, copied.data(), 4), "assigning a fresh container moves to its arena");
+
+    FrameVector<uint32_t> left(currentAllocator);
+    FrameVector<uint32_t> right(nextAllocator);
+    left.push_back(7);
+    right.push_back(9);
+    left.swap(right);
+    check(left.get_allocator().arena == &next && right.get_allocator().arena == &current && left[0] == 9 && inArena(&next, left.data(), 1), "swapping exchanges the arenas with the buffers");
+
+    destroyFrameArena(&current);
+    destroyFrameArena(&next);
+}
+
+int main() {
+    testBumpAndRollback();
+    testOverflow();
+    testNullArena();
+    testRing();
+    testAllocatorPropagation();
+    if (failureCount != 0) {
+        std::fprintf(stderr, "%u frame_arena checks failed.\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    std::printf("frame_arena checks passed.\n");
+    return EXIT_SUCCESS;
+}
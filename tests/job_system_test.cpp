@@ -0,0 +1,187 @@
+// Runs the job system with real worker threads: parallelFor sums, submissions from a thread outside
+// the system, jobs that wait on nested fork-join work, continuations and stopping and restarting
+// with different worker counts. Returns non-zero when a check fails or a job is lost.
+#include "../src/job_system.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Enough workers to steal from each other even on a machine with few cores.
+static constexpr uint32_t TEST_WORKER_COUNT = 4;
+// Deliberately not a multiple of the batch size so the last batch is a short one.
+static constexpr uint32_t TEST_SUM_COUNT = 1000003;
+static constexpr uint32_t TEST_SUM_BATCH_SIZE = 1000;
+static constexpr uint32_t TEST_SUM_ROUNDS = 20;
+// More than one injection queue holds, so the external thread also runs jobs inline.
+static constexpr uint32_t TEST_EXTERNAL_JOB_COUNT = JOB_DEQUE_CAPACITY + 500;
+static constexpr uint32_t TEST_NESTED_JOB_COUNT = 64;
+static constexpr uint32_t TEST_NESTED_COUNT = 5000;
+static constexpr uint32_t TEST_RESTART_ROUNDS = 8;
+
+// Too large for the stack, and stopJobSystem() leaves it ready for the next startJobSystem().
+static JobSystem jobs;
+static uint32_t failureCount = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failureCount++;
+    }
+}
+
+struct SumData {
+    std::atomic<uint64_t> sum;
+    std::atomic<uint32_t> calls;
+    // Every index has to be visited exactly once.
+    std::vector<uint8_t> visits;
+};
+
+static void sumRange(void* data, uint32_t begin, uint32_t end) {
+    SumData* sum = static_cast<SumData*>(data);
+    uint64_t partial = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        partial += i;
+        sum->visits[i]++;
+    }
+    sum->sum.fetch_add(partial, std::memory_order_relaxed);
+    sum->calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+static bool runParallelSum(uint32_t count, uint32_t batchSize) {
+    SumData sum;
+    sum.sum.store(0, std::memory_order_relaxed);
+    sum.calls.store(0, std::memory_order_relaxed);
+    sum.visits.assign(count, 0);
+    parallelFor(&jobs, count, batchSize, sumRange, &sum, "test sum");
+    bool visitedOnce = true;
+    for (uint8_t visits : sum.visits) {
+        visitedOnce = visitedOnce && visits == 1;
+    }
+    const uint64_t expected = static_cast<uint64_t>(count) * (count - 1) / 2;
+    return visitedOnce && sum.sum.load(std::memory_order_relaxed) == expected && sum.calls.load(std::memory_order_relaxed) <= JOB_MAX_PARALLEL_BATCHES;
+}
+
+static void testParallelFor() {
+    bool same = true;
+    for (uint32_t round = 0; round < TEST_SUM_ROUNDS; round++) {
+        same = same && runParallelSum(TEST_SUM_COUNT, TEST_SUM_BATCH_SIZE);
+    }
+    check(same, "parallelFor visits every index once and the sum matches");
+    check(runParallelSum(7, 0), "parallelFor treats a batch size of 0 as 1");
+    check(runParallelSum(1, 64), "parallelFor runs a single short batch");
+    SumData empty;
+    empty.calls.store(0, std::memory_order_relaxed);
+    parallelFor(&jobs, 0, 16, sumRange, &empty, "test empty");
+    check(empty.calls.load(std::memory_order_relaxed) == 0, "parallelFor with a count of 0 calls nothing");
+}
+
+static void countJob(void* data) {
+    static_cast<std::atomic<uint32_t>*>(data)->fetch_add(1, std::memory_order_relaxed);
+}
+
+static void testExternalSubmission() {
+    std::atomic<uint32_t> ran{0};
+    std::vector<Job> externalJobs(TEST_EXTERNAL_JOB_COUNT);
+    bool waited = false;
+    // Not part of the job system, so it goes through the injection queue and waits from outside.
+    std::thread external([&] {
+        for (Job& job : externalJobs) {
+            job = {countJob, &ran, "test external", nullptr};
+        }
+        JobCounter counter = {};
+        submitJobs(&jobs, externalJobs.data(), TEST_EXTERNAL_JOB_COUNT, JOB_PRIORITY_LOW, &counter);
+        waitForCounter(&jobs, &counter);
+        waited = counter.pending.load(std::memory_order_acquire) == 0;
+    });
+    // The main thread keeps the workers busy with its own work in the meantime.
+    const bool sumMatches = runParallelSum(TEST_SUM_COUNT, TEST_SUM_BATCH_SIZE);
+    external.join();
+    check(waited && ran.load(std::memory_order_relaxed) == TEST_EXTERNAL_JOB_COUNT, "a thread outside the job system submits jobs and waits for all of them");
+    check(sumMatches, "parallelFor is unaffected by injected jobs");
+}
+
+struct NestedData {
+    std::atomic<uint32_t> passed;
+};
+
+// Waits on its own fork-join work from inside a job, so workers run jobs while they wait.
+static void nestedJob(void* data) {
+    NestedData* nested = static_cast<NestedData*>(data);
+    if (runParallelSum(TEST_NESTED_COUNT, 100)) {
+        nested->passed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void testNestedWaits() {
+    NestedData nested;
+    nested.passed.store(0, std::memory_order_relaxed);
+    Job nestedJobs[TEST_NESTED_JOB_COUNT];
+    for (Job& job : nestedJobs) {
+        job = {nestedJob, &nested, "test nested", nullptr};
+    }
+    JobCounter counter = {};
+    submitJobs(&jobs, nestedJobs, TEST_NESTED_JOB_COUNT, JOB_PRIORITY_HIGH, &counter);
+    waitForCounter(&jobs, &counter);
+    check(nested.passed.load(std::memory_order_relaxed) == TEST_NESTED_JOB_COUNT, "jobs that wait on nested parallelFor calls all finish with correct sums");
+}
+
+struct ContinuationData {
+    std::atomic<uint32_t> ran;
+    std::atomic<uint32_t> ranAtContinuation;
+    JobCounter done;
+};
+
+static void continuationJob(void* data) {
+    ContinuationData* continuation = static_cast<ContinuationData*>(data);
+    continuation->ranAtContinuation.store(continuation->ran.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    finishJobCounter(&jobs, &continuation->done);
+}
+
+static void testContinuation() {
+    ContinuationData continuation;
+    continuation.ran.store(0, std::memory_order_relaxed);
+    continuation.ranAtContinuation.store(0, std::memory_order_relaxed);
+    continuation.done.pending.store(1, std::memory_order_relaxed);
+    continuation.done.continuation = nullptr;
+    Job next = {continuationJob, &continuation, "test continuation", nullptr};
+    Job work[32];
+    for (Job& job : work) {
+        job = {countJob, &continuation.ran, "test work", nullptr};
+    }
+    JobCounter counter = {};
+    counter.continuation = &next;
+    submitJobs(&jobs, work, 32, JOB_PRIORITY_NORMAL, &counter);
+    waitForCounter(&jobs, &continuation.done);
+    check(continuation.ranAtContinuation.load(std::memory_order_relaxed) == 32, "a counter's continuation runs after every job of the counter");
+}
+
+static void testRestart() {
+    bool same = true;
+    for (uint32_t round = 0; round < TEST_RESTART_ROUNDS; round++) {
+        stopJobSystem(&jobs);
+        // 0 workers has the calling thread run everything itself.
+        const uint32_t workerCount = round % 3 == 0 ? 0 : round % TEST_WORKER_COUNT + 1;
+        same = same && startJobSystem(&jobs, workerCount, false) && jobs.workerCount == workerCount;
+        same = same && runParallelSum(TEST_SUM_COUNT / 10, TEST_SUM_BATCH_SIZE);
+    }
+    check(same, "the job system runs work after every stop and restart");
+}
+
+int main() {
+    if (!startJobSystem(&jobs, TEST_WORKER_COUNT, false)) {
+        std::fprintf(stderr, "FAIL: startJobSystem\n");
+        return EXIT_FAILURE;
+    }
+    testParallelFor();
+    testExternalSubmission();
+    testNestedWaits();
+    testContinuation();
+    testRestart();
+    stopJobSystem(&jobs);
+    if (failureCount != 0) {
+        std::fprintf(stderr, "%u job_system checks failed.\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    std::printf("job_system checks passed.\n");
+    return EXIT_SUCCESS;
+}
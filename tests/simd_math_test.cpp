@@ -0,0 +1,210 @@
+// Checks the math library against itself: quaternion and matrix forms of the same rotation, the
+// transform order, the projection depth range and the SIMD batch routines against their scalar
+// references. Returns non-zero when a check fails.
+#include "../src/simd_math.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Single precision leaves a few ulps of error after a handful of multiplies.
+static constexpr float TEST_EPSILON = 1e-4f;
+// Deliberately not a multiple of SIMD_BATCH_SIZE so the tail loops run too.
+static constexpr uint32_t TEST_BATCH_COUNT = 1003;
+
+static uint32_t failureCount = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failureCount++;
+    }
+}
+
+static bool nearlyEqual(float a, float b) {
+    return std::fabs(a - b) <= TEST_EPSILON * std::fmax(1.0f, std::fmax(std::fabs(a), std::fabs(b)));
+}
+
+static bool vec3NearlyEqual(Vec3 a, Vec3 b) {
+    return nearlyEqual(a.x, b.x) && nearlyEqual(a.y, b.y) && nearlyEqual(a.z, b.z);
+}
+
+static bool mat4NearlyEqual(const Mat4* a, const Mat4* b) {
+    const float* left = &a->columns[0].x;
+    const float* right = &b->columns[0].x;
+    for (uint32_t i = 0; i < 16; i++) {
+        if (!nearlyEqual(left[i], right[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Vec3 transformPoint(const Mat4* matrix, Vec3 point) {
+    const Vec4 result = mat4MultiplyVec4(matrix, vec4(point.x, point.y, point.z, 1.0f));
+    return vec3(result.x, result.y, result.z);
+}
+
+// Deterministic values in [low, high), so a failure reproduces.
+static float randomFloat(uint32_t* state, float low, float high) {
+    *state = *state * 1664525u + 1013904223u;
+    return low + (high - low) * static_cast<float>(*state >> 8) / 16777216.0f;
+}
+
+static void testQuaternions() {
+    const Quat first = quatFromAxisAngle(vec3Normalize(vec3(1.0f, 2.0f, 0.5f)), 1.1f);
+    const Quat second = quatFromAxisAngle(vec3(0.0f, 0.0f, 1.0f), 0.7f);
+    const Vec3 point = vec3(1.0f, 2.0f, 3.0f);
+
+    const Vec3 nested = quatRotate(second, quatRotate(first, point));
+    const Vec3 composed = quatRotate(quatMultiply(second, first), point);
+    check(vec3NearlyEqual(nested, composed), "quatMultiply(b, a) rotates by a, then by b");
+
+    const Vec3 quarterTurn = quatRotate(quatFromAxisAngle(vec3(0.0f, 0.0f, 1.0f), 1.57079633f), vec3(1.0f, 0.0f, 0.0f));
+    check(vec3NearlyEqual(quarterTurn, vec3(0.0f, 1.0f, 0.0f)), "a positive angle about z turns x into y");
+    check(vec3NearlyEqual(quatRotate(quatIdentity(), point), point), "quatIdentity leaves points unchanged");
+
+    const Quat scaled = {first.x * 3.0f, first.y * 3.0f, first.z * 3.0f, first.w * 3.0f};
+    const Quat normalized = quatNormalize(scaled);
+    check(nearlyEqual(normalized.x, first.x) && nearlyEqual(normalized.y, first.y) && nearlyEqual(normalized.z, first.z) && nearlyEqual(normalized.w, first.w), "quatNormalize restores unit length");
+
+    Mat4 rotation;
+    mat4FromQuat(quatMultiply(second, first), &rotation);
+    check(vec3NearlyEqual(transformPoint(&rotation, point), composed), "mat4FromQuat matches quatRotate");
+}
+
+static void testTransforms() {
+    const Quat rotation = quatFromAxisAngle(vec3Normalize(vec3(0.3f, -1.0f, 0.2f)), 0.9f);
+    const Vec3 translation = vec3(5.0f, -6.0f, 7.0f);
+    const Vec3 scale = vec3(2.0f, 3.0f, 0.5f);
+    const Vec3 point = vec3(1.0f, 2.0f, 3.0f);
+
+    Mat4 transform;
+    mat4FromTransform(translation, rotation, scale, &transform);
+    const Vec3 expected = vec3Add(quatRotate(rotation, vec3(point.x * scale.x, point.y * scale.y, point.z * scale.z)), translation);
+    check(vec3NearlyEqual(transformPoint(&transform, point), expected), "mat4FromTransform scales, then rotates, then translates");
+
+    Mat4 rotationMatrix;
+    Mat4 transposed;
+    Mat4 product;
+    Mat4 identity;
+    mat4Identity(&identity);
+    mat4FromQuat(rotation, &rotationMatrix);
+    mat4Transpose(&rotationMatrix, &transposed);
+    mat4Multiply(&transposed, &rotationMatrix, &product);
+    check(mat4NearlyEqual(&product, &identity), "a rotation's transpose is its inverse");
+
+    Mat4 twice;
+    mat4Transpose(&transposed, &twice);
+    check(mat4NearlyEqual(&twice, &rotationMatrix), "transposing twice gives the original matrix");
+
+    // (AB)^T = B^T A^T, with out aliasing an input.
+    Mat4 productTransposed;
+    mat4Multiply(&transform, &rotationMatrix, &product);
+    mat4Transpose(&product, &productTransposed);
+    Mat4 transformTransposed;
+    mat4Transpose(&transform, &transformTransposed);
+    mat4Multiply(&transposed, &transformTransposed, &transposed);
+    check(mat4NearlyEqual(&productTransposed, &transposed), "the transpose of a product is the reversed product of transposes");
+
+    // The inverse undoes translation, rotation and scale in reverse order: S^-1 * R^-1 * T^-1.
+    const Quat inverseRotation = {-rotation.x, -rotation.y, -rotation.z, rotation.w};
+    Mat4 inverseTranslation;
+    Mat4 inverseScale;
+    Mat4 inverse;
+    mat4FromTransform(vec3Scale(translation, -1.0f), quatIdentity(), vec3(1.0f, 1.0f, 1.0f), &inverseTranslation);
+    mat4FromTransform(vec3(0.0f, 0.0f, 0.0f), quatIdentity(), vec3(1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z), &inverseScale);
+    mat4FromQuat(inverseRotation, &inverse);
+    mat4Multiply(&inverseScale, &inverse, &inverse);
+    mat4Multiply(&inverse, &inverseTranslation, &inverse);
+    mat4Multiply(&inverse, &transform, &product);
+    check(mat4NearlyEqual(&product, &identity), "inverting each part of a transform in reverse order gives its inverse");
+}
+
+static void testPerspective() {
+    const float nearPlane = 0.1f;
+    const float farPlane = 500.0f;
+    Mat4 projection;
+    mat4Perspective(1.2f, 16.0f / 9.0f, nearPlane, farPlane, &projection);
+
+    const Vec4 nearPoint = mat4MultiplyVec4(&projection, vec4(0.0f, 0.0f, -nearPlane, 1.0f));
+    const Vec4 farPoint = mat4MultiplyVec4(&projection, vec4(0.0f, 0.0f, -farPlane, 1.0f));
+    const Vec4 middlePoint = mat4MultiplyVec4(&projection, vec4(0.0f, 0.0f, -10.0f, 1.0f));
+    check(std::fabs(nearPoint.z / nearPoint.w) <= TEST_EPSILON, "the near plane maps to depth 0");
+    check(nearlyEqual(farPoint.z / farPoint.w, 1.0f), "the far plane maps to depth 1");
+    const float middleDepth = middlePoint.z / middlePoint.w;
+    check(middleDepth > 0.0f && middleDepth < 1.0f, "points between the planes map into (0, 1)");
+
+    const Vec4 upPoint = mat4MultiplyVec4(&projection, vec4(0.0f, 1.0f, -1.0f, 1.0f));
+    check(upPoint.y < 0.0f, "view space up maps to negative clip y");
+}
+
+static void testBatches() {
+    uint32_t state = 12345;
+    std::vector<float> minX(TEST_BATCH_COUNT), minY(TEST_BATCH_COUNT), minZ(TEST_BATCH_COUNT);
+    std::vector<float> maxX(TEST_BATCH_COUNT), maxY(TEST_BATCH_COUNT), maxZ(TEST_BATCH_COUNT);
+    for (uint32_t i = 0; i < TEST_BATCH_COUNT; i++) {
+        minX[i] = randomFloat(&state, -200.0f, 200.0f);
+        minY[i] = randomFloat(&state, -200.0f, 200.0f);
+        minZ[i] = randomFloat(&state, -200.0f, 200.0f);
+        maxX[i] = minX[i] + randomFloat(&state, 0.0f, 10.0f);
+        maxY[i] = minY[i] + randomFloat(&state, 0.0f, 10.0f);
+        maxZ[i] = minZ[i] + randomFloat(&state, 0.0f, 10.0f);
+    }
+
+    Mat4 view;
+    Mat4 projection;
+    Mat4 viewProjection;
+    mat4LookAt(vec3(0.0f, 0.0f, 150.0f), vec3(20.0f, 10.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), &view);
+    mat4Perspective(1.2f, 16.0f / 9.0f, 0.1f, 300.0f, &projection);
+    mat4Multiply(&projection, &view, &viewProjection);
+    Frustum frustum;
+    frustumFromViewProjection(&viewProjection, &frustum);
+
+    // Every prefix length from 0 to two batches plus the full odd count.
+    uint32_t counts[2 * SIMD_BATCH_SIZE + 2];
+    for (uint32_t i = 0; i <= 2 * SIMD_BATCH_SIZE; i++) {
+        counts[i] = i;
+    }
+    counts[2 * SIMD_BATCH_SIZE + 1] = TEST_BATCH_COUNT;
+
+    std::vector<uint8_t> visible(TEST_BATCH_COUNT);
+    std::vector<uint8_t> visibleScalar(TEST_BATCH_COUNT);
+    std::vector<float> outX(TEST_BATCH_COUNT), outY(TEST_BATCH_COUNT), outZ(TEST_BATCH_COUNT);
+    std::vector<float> scalarX(TEST_BATCH_COUNT), scalarY(TEST_BATCH_COUNT), scalarZ(TEST_BATCH_COUNT);
+    for (uint32_t count : counts) {
+        const AabbSoa boxes = {minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), count};
+        const uint32_t visibleCount = cullAabbs(&frustum, &boxes, visible.data());
+        const uint32_t visibleCountScalar = cullAabbsScalar(&frustum, &boxes, visibleScalar.data());
+        bool same = visibleCount == visibleCountScalar;
+        for (uint32_t i = 0; i < count; i++) {
+            same = same && visible[i] == visibleScalar[i];
+        }
+        check(same, "cullAabbs matches cullAabbsScalar");
+
+        transformPoints(&viewProjection, minX.data(), minY.data(), minZ.data(), outX.data(), outY.data(), outZ.data(), count);
+        transformPointsScalar(&viewProjection, minX.data(), minY.data(), minZ.data(), scalarX.data(), scalarY.data(), scalarZ.data(), count);
+        same = true;
+        for (uint32_t i = 0; i < count; i++) {
+            same = same && nearlyEqual(outX[i], scalarX[i]) && nearlyEqual(outY[i], scalarY[i]) && nearlyEqual(outZ[i], scalarZ[i]);
+        }
+        check(same, "transformPoints matches transformPointsScalar");
+    }
+
+    // The full count has to exercise both outcomes, or the comparison above proves little.
+    const AabbSoa boxes = {minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), TEST_BATCH_COUNT};
+    const uint32_t visibleCount = cullAabbsScalar(&frustum, &boxes, visibleScalar.data());
+    check(visibleCount > 0 && visibleCount < TEST_BATCH_COUNT, "the test frustum keeps some boxes and culls others");
+}
+
+int main() {
+    testQuaternions();
+    testTransforms();
+    testPerspective();
+    testBatches();
+    if (failureCount != 0) {
+        std::fprintf(stderr, "%u simd_math checks failed (%s backend).\n", failureCount, getSimdMathBackendName());
+        return EXIT_FAILURE;
+    }
+    std::printf("simd_math checks passed (%s backend).\n", getSimdMathBackendName());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+// Checks the slab allocator through its stats: which size class each request size lands in, frees
+// from another thread, the thread cache flush at thread exit, the malloc fallback and that churn
+// reuses empty slabs instead of purging and faulting them in again. Returns non-zero when a check
+// fails.
+#include "../src/slab_allocator.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static constexpr uint32_t TEST_CROSS_THREAD_OBJECTS = 1000;
+static constexpr uint32_t TEST_CHURN_THREADS = 4;
+static constexpr uint32_t TEST_CHURN_ROUNDS = 500;
+// Objects each churn thread allocates and then frees every round, about 1 MiB of random sizes.
+// All threads' bursts together stay within what the size classes retain, but not within what the
+// region alone does.
+static constexpr uint32_t TEST_CHURN_BURST = 256;
+
+static uint32_t failureCount = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failureCount++;
+    }
+}
+
+static SlabAllocatorStats getStats() {
+    SlabAllocatorStats stats;
+    getSlabAllocatorStats(&stats);
+    return stats;
+}
+
+static uint64_t getOutstandingObjects(const SlabAllocatorStats& stats) {
+    uint64_t outstanding = 0;
+    for (const SlabPoolStats& pool : stats.pools) {
+        outstanding += pool.outstandingObjects;
+    }
+    return outstanding;
+}
+
+// The size class a fresh thread's first allocation of size refills, or SLAB_SIZE_CLASS_COUNT when
+// it went to malloc. The thread's exit hands the cached objects back.
+static uint32_t findSizeClass(size_t size) {
+    const SlabAllocatorStats before = getStats();
+    bool aligned = false;
+    std::thread([size, &aligned] {
+        void* memory = slabAllocate(size);
+        aligned = memory != nullptr && reinterpret_cast<uintptr_t>(memory) % 16 == 0;
+        slabFree(memory);
+    }).join();
+    const SlabAllocatorStats after = getStats();
+    if (!aligned) {
+        return UINT32_MAX;
+    }
+    uint32_t sizeClass = SLAB_SIZE_CLASS_COUNT;
+    for (uint32_t i = 0; i < SLAB_SIZE_CLASS_COUNT; i++) {
+        if (after.pools[i].refillCount != before.pools[i].refillCount) {
+            if (sizeClass != SLAB_SIZE_CLASS_COUNT) {
+                return UINT32_MAX;
+            }
+            sizeClass = i;
+        }
+    }
+    if (sizeClass == SLAB_SIZE_CLASS_COUNT && after.largeAllocationCount != before.largeAllocationCount + 1) {
+        return UINT32_MAX;
+    }
+    return sizeClass;
+}
+
+static void testSizeClasses() {
+    bool same = findSizeClass(0) == 0 && findSizeClass(1) == 0;
+    for (uint32_t i = 0; i < SLAB_SIZE_CLASS_COUNT; i++) {
+        const size_t smallest = i == 0 ? 1 : SLAB_SIZE_CLASSES[i - 1] + 1;
+        same = same && findSizeClass(smallest) == i && findSizeClass(SLAB_SIZE_CLASSES[i]) == i;
+        if (i + 1 < SLAB_SIZE_CLASS_COUNT) {
+            same = same && findSizeClass(SLAB_SIZE_CLASSES[i] + 1) == i + 1;
+        }
+    }
+    check(same, "every size from one class boundary to the next lands in the upper class");
+    check(findSizeClass(SLAB_MAX_OBJECT_SIZE + 1) == SLAB_SIZE_CLASS_COUNT, "sizes beyond SLAB_MAX_OBJECT_SIZE go to malloc");
+}
+
+static void testLargeAllocations() {
+    const SlabAllocatorStats before = getStats();
+    bool intact = true;
+    std::thread([&intact] {
+        const size_t size = 1024 * 1024;
+        uint8_t* memory = static_cast<uint8_t*>(slabAllocate(size));
+        std::memset(memory, 0xAB, size);
+        intact = memory[0] == 0xAB && memory[size - 1] == 0xAB;
+        slabFree(memory);
+        slabFree(nullptr);
+    }).join();
+    const SlabAllocatorStats after = getStats();
+    check(intact && after.largeAllocationCount == before.largeAllocationCount + 1, "a large allocation is usable and counted");
+    check(getOutstandingObjects(after) == getOutstandingObjects(before), "a large allocation takes nothing from the pools");
+}
+
+static void testCrossThreadFree() {
+    const SlabAllocatorStats before = getStats();
+    std::vector<uint32_t*> objects(TEST_CROSS_THREAD_OBJECTS);
+    std::thread([&objects] {
+        for (uint32_t i = 0; i < TEST_CROSS_THREAD_OBJECTS; i++) {
+            objects[i] = static_cast<uint32_t*>(slabAllocate(sizeof(uint32_t) * (1 + i % 64)));
+            objects[i][0] = i;
+        }
+    }).join();
+    bool intact = true;
+    std::thread([&objects, &intact] {
+        for (uint32_t i = 0; i < TEST_CROSS_THREAD_OBJECTS; i++) {
+            intact = intact && objects[i][0] == i;
+            slabFree(objects[i]);
+        }
+    }).join();
+    const SlabAllocatorStats after = getStats();
+    check(intact, "objects keep their contents when another thread frees them");
+    check(getOutstandingObjects(after) == getOutstandingObjects(before), "objects freed on another thread go back to their pools");
+}
+
+static void testThreadExitFlush() {
+    const SlabAllocatorStats before = getStats();
+    std::atomic<bool> freed{false};
+    std::atomic<bool> exit{false};
+    std::thread thread([&freed, &exit] {
+        slabDelete(slabNew<uint64_t>(42));
+        freed.store(true, std::memory_order_release);
+        while (!exit.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    });
+    while (!freed.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    const SlabAllocatorStats cached = getStats();
+    exit.store(true, std::memory_order_release);
+    thread.join();
+    const SlabAllocatorStats after = getStats();
+    check(getOutstandingObjects(cached) > getOutstandingObjects(before), "a live thread keeps freed objects in its cache");
+    check(getOutstandingObjects(after) == getOutstandingObjects(before), "the cache goes back to the pools when its thread exits");
+}
+
+// Lines the churn threads up, so every round all bursts are live at once and then all are freed.
+struct ChurnBarrier {
+    std::atomic<uint32_t> arrived;
+};
+
+static void waitForChurnThreads(ChurnBarrier* barrier, uint32_t* generation) {
+    *generation += TEST_CHURN_THREADS;
+    barrier->arrived.fetch_add(1, std::memory_order_acq_rel);
+    while (barrier->arrived.load(std::memory_order_acquire) < *generation) {
+        std::this_thread::yield();
+    }
+}
+
+static void churn(uint32_t seed, ChurnBarrier* barrier, bool* intact) {
+    std::vector<uint32_t*> objects(TEST_CHURN_BURST);
+    std::vector<uint32_t> values(TEST_CHURN_BURST);
+    uint32_t state = seed;
+    uint32_t generation = 0;
+    for (uint32_t round = 0; round < TEST_CHURN_ROUNDS; round++) {
+        for (uint32_t i = 0; i < TEST_CHURN_BURST; i++) {
+            state = state * 1664525u + 1013904223u;
+            objects[i] = static_cast<uint32_t*>(slabAllocate(sizeof(uint32_t) + (state >> 8) % (SLAB_MAX_OBJECT_SIZE - sizeof(uint32_t))));
+            objects[i][0] = state;
+            values[i] = state;
+        }
+        waitForChurnThreads(barrier, &generation);
+        // Freed newest first like a frame's scratch objects, which empties whole slabs at a time.
+        for (uint32_t i = 0; i < TEST_CHURN_BURST; i++) {
+            const uint32_t index = TEST_CHURN_BURST - 1 - i;
+            *intact = *intact && objects[index][0] == values[index];
+            slabFree(objects[index]);
+        }
+        waitForChurnThreads(barrier, &generation);
+    }
+}
+
+static void testChurn() {
+    const SlabAllocatorStats before = getStats();
+    ChurnBarrier barrier;
+    barrier.arrived.store(0, std::memory_order_relaxed);
+    bool intact[TEST_CHURN_THREADS];
+    std::thread threads[TEST_CHURN_THREADS];
+    for (uint32_t i = 0; i < TEST_CHURN_THREADS; i++) {
+        intact[i] = true;
+        threads[i] = std::thread(churn, 12345 + i, &barrier, &intact[i]);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const SlabAllocatorStats after = getStats();
+    uint64_t peakSlabs = 0;
+    for (const SlabPoolStats& pool : after.pools) {
+        peakSlabs += pool.peakSlabCount;
+    }
+    // Thrashing purges the same slabs every round, a hundred times the peak and more. Without it
+    // each slab goes at most once, when the threads exit and the live set drops for good.
+    const uint64_t purged = after.purgedSlabCount - before.purgedSlabCount;
+    if (purged > peakSlabs) {
+        std::fprintf(stderr, "%llu slabs purged over %u rounds, peak %llu slabs\n", static_cast<unsigned long long>(purged), TEST_CHURN_ROUNDS, static_cast<unsigned long long>(peakSlabs));
+    }
+    check(purged <= peakSlabs, "churn within the retained slabs does not purge and refault slabs every round");
+    check(getOutstandingObjects(after) == getOutstandingObjects(before), "churn leaves no objects behind");
+    bool allIntact = true;
+    for (bool threadIntact : intact) {
+        allIntact = allIntact && threadIntact;
+    }
+    check(allIntact, "churned objects keep their contents until freed");
+}
+
+int main() {
+    // Before initSlabAllocator() there is no region, so everything goes to malloc.
+    const SlabAllocatorStats uninitialised = getStats();
+    void* early = slabAllocate(16);
+    check(early != nullptr && getStats().largeAllocationCount == uninitialised.largeAllocationCount + 1, "allocations before initSlabAllocator() use malloc");
+    slabFree(early);
+
+    initSlabAllocator();
+    testSizeClasses();
+    testLargeAllocations();
+    testCrossThreadFree();
+    testThreadExitFlush();
+    testChurn();
+    if (failureCount != 0) {
+        std::fprintf(stderr, "%u slab_allocator checks failed.\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    std::printf("slab_allocator checks passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+// Runs coroutines on the job system: loops over tasks that finish right away, long enough to
+// overflow the stack if each one nested a resumption, tasks started from outside any coroutine, detached tasks, batches of jobs
+// awaited with runJobsAsync() and file reads through AsyncIo, including a file that does not
+// exist. Returns non-zero when a check fails.
+#include "../src/task.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static constexpr uint32_t TEST_WORKER_COUNT = 4;
+// Each task that finishes right away would cost a few stack frames if it resumed its awaiter.
+static constexpr uint32_t TEST_CHAIN_LENGTH = 1000000;
+static constexpr uint32_t TEST_BATCH_JOBS = 64;
+static constexpr uint32_t TEST_CONCURRENT_TASKS = 64;
+static constexpr uint32_t TEST_CONCURRENT_ROUNDS = 50;
+static constexpr uint32_t TEST_FILE_SIZE = 100000;
+static constexpr const char* TEST_FILE_PATH = "task_test_file.bin";
+static constexpr const char* TEST_MISSING_PATH = "task_test_missing_file.bin";
+
+// Too large for the stack.
+static JobSystem jobs;
+static AsyncIo asyncIo;
+static uint32_t failureCount = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failureCount++;
+    }
+}
+
+// Finishes without suspending, so its continuation runs straight from its final suspension.
+static Task<uint32_t> immediate(uint32_t value) {
+    co_return value;
+}
+
+static Task<uint64_t> sumImmediates(uint32_t count) {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += co_await immediate(i);
+    }
+    co_return sum;
+}
+
+static Task<std::vector<uint32_t>> makeValues(uint32_t count) {
+    std::vector<uint32_t> values(count);
+    for (uint32_t i = 0; i < count; i++) {
+        values[i] = i * i;
+    }
+    co_return values;
+}
+
+static Task<> appendValues(std::vector<uint32_t>* out) {
+    std::vector<uint32_t> values = co_await makeValues(10);
+    out->insert(out->end(), values.begin(), values.end());
+}
+
+static void testTasks() {
+    JobCounter counter = {};
+    Task<uint64_t> sum = sumImmediates(TEST_CHAIN_LENGTH);
+    startTask(&jobs, &sum, &counter);
+    waitForCounter(&jobs, &counter);
+    check(sum.result() == static_cast<uint64_t>(TEST_CHAIN_LENGTH) * (TEST_CHAIN_LENGTH - 1) / 2, "a million synchronously finished co_awaits run in constant stack");
+
+    std::vector<uint32_t> values;
+    Task<> append = appendValues(&values);
+    startTask(&jobs, &append, &counter);
+    waitForCounter(&jobs, &counter);
+    check(values.size() == 10 && values[9] == 81, "Task<void> awaits a task that returns a vector");
+
+    Task<uint64_t> moved = std::move(sum);
+    check(sum.handle == nullptr && moved.handle != nullptr, "moving a task moves its coroutine");
+}
+
+static void addJob(void* data) {
+    static_cast<std::atomic<uint32_t>*>(data)->fetch_add(1, std::memory_order_relaxed);
+}
+
+// Hops onto a worker, then awaits a batch of jobs and yields how many of them ran.
+static Task<uint32_t> runBatch(uint32_t jobCount) {
+    co_await scheduleOnJobs(&jobs);
+    std::atomic<uint32_t> ran{0};
+    std::vector<Job> batch(jobCount);
+    for (Job& job : batch) {
+        job = {addJob, &ran, "test batch", nullptr};
+    }
+    co_await runJobsAsync(&jobs, batch.data(), jobCount);
+    co_return ran.load(std::memory_order_relaxed);
+}
+
+static void testJobsAwaiter() {
+    JobCounter counter = {};
+    Task<uint32_t> empty = runBatch(0);
+    Task<uint32_t> single = runBatch(1);
+    Task<uint32_t> batch = runBatch(TEST_BATCH_JOBS);
+    startTask(&jobs, &empty, &counter);
+    startTask(&jobs, &single, &counter);
+    startTask(&jobs, &batch, &counter);
+    waitForCounter(&jobs, &counter);
+    check(empty.result() == 0 && single.result() == 1, "awaiting zero or one job continues once they are done");
+    check(batch.result() == TEST_BATCH_JOBS, "awaiting a batch continues once every job of it ran");
+
+    // Many tasks suspending and resuming at once, so some batches finish before the suspension.
+    bool same = true;
+    for (uint32_t round = 0; round < TEST_CONCURRENT_ROUNDS; round++) {
+        std::vector<Task<uint32_t>> tasks;
+        tasks.reserve(TEST_CONCURRENT_TASKS);
+        for (uint32_t i = 0; i < TEST_CONCURRENT_TASKS; i++) {
+            tasks.push_back(runBatch(i % 8));
+            startTask(&jobs, &tasks.back(), &counter);
+        }
+        waitForCounter(&jobs, &counter);
+        for (uint32_t i = 0; i < TEST_CONCURRENT_TASKS; i++) {
+            same = same && tasks[i].result() == i % 8;
+        }
+    }
+    check(same, "concurrent tasks each see all of their own jobs finish");
+}
+
+static DetachedTask signalFromWorker(JobCounter* counter, std::atomic<uint32_t>* value) {
+    co_await scheduleOnJobs(&jobs, JOB_PRIORITY_HIGH);
+    value->store(42, std::memory_order_relaxed);
+    finishJobCounter(&jobs, counter);
+}
+
+static void testDetachedTask() {
+    std::atomic<uint32_t> value{0};
+    JobCounter counter = {};
+    counter.pending.store(1, std::memory_order_relaxed);
+    signalFromWorker(&counter, &value);
+    waitForCounter(&jobs, &counter);
+    check(value.load(std::memory_order_relaxed) == 42, "a detached task runs to completion on its own");
+}
+
+static Task<bool> readFile(const char* path, std::vector<uint8_t>* bytes) {
+    co_return co_await readFileAsync(&asyncIo, path, bytes);
+}
+
+static void testReadFile() {
+    std::vector<uint8_t> expected(TEST_FILE_SIZE);
+    for (uint32_t i = 0; i < TEST_FILE_SIZE; i++) {
+        expected[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    FILE* file = std::fopen(TEST_FILE_PATH, "wb");
+    const bool written = file != nullptr && std::fwrite(expected.data(), 1, expected.size(), file) == expected.size();
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+    if (!written) {
+        check(false, "writing the test file");
+        return;
+    }
+    std::remove(TEST_MISSING_PATH);
+
+    std::vector<uint8_t> bytes;
+    // Stale contents, which a failed read has to clear.
+    std::vector<uint8_t> missingBytes(16, 0xFF);
+    JobCounter counter = {};
+    Task<bool> read = readFile(TEST_FILE_PATH, &bytes);
+    Task<bool> missing = readFile(TEST_MISSING_PATH, &missingBytes);
+    startTask(&jobs, &read, &counter);
+    startTask(&jobs, &missing, &counter);
+    waitForCounter(&jobs, &counter);
+    check(read.result() && bytes == expected, "readFileAsync reads a whole file");
+    check(!missing.result() && missingBytes.empty(), "readFileAsync yields false and no bytes for a missing file");
+    std::remove(TEST_FILE_PATH);
+}
+
+int main() {
+    if (!startJobSystem(&jobs, TEST_WORKER_COUNT, false)) {
+        std::fprintf(stderr, "FAIL: startJobSystem\n");
+        return EXIT_FAILURE;
+    }
+    startAsyncIo(&asyncIo, &jobs);
+    testTasks();
+    testJobsAwaiter();
+    testDetachedTask();
+    testReadFile();
+    stopAsyncIo(&asyncIo);
+    stopJobSystem(&jobs);
+    if (failureCount != 0) {
+        std::fprintf(stderr, "%u task checks failed.\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    std::printf("task checks passed.\n");
+    return EXIT_SUCCESS;
+}